@@ -1,5 +1,6 @@
 use crate::graphics::SharedGraphicsContext;
 use crate::model::Model;
+use crate::streaming::TEXTURE_STREAMER;
 use crate::texture::{Texture, TextureBuilder};
 use crate::utils::ResourceReference;
 use parking_lot::RwLock;
@@ -174,6 +175,7 @@ impl AssetRegistry {
                 return true;
             }
 
+            TEXTURE_STREAMER.lock().unregister(*id);
             counter += 1;
             false
         });
@@ -195,6 +197,47 @@ impl AssetRegistry {
         self.model_labels.clear();
         self.textures.clear();
         self.texture_labels.clear();
+        TEXTURE_STREAMER.lock().clear();
+    }
+
+    /// Rebuilds the material bind groups of every model that samples from any texture in `ids`,
+    /// such as after a texture has been swapped with [`AssetRegistry::update_texture`].
+    ///
+    /// Models that are currently borrowed elsewhere cannot be mutated, so the texture ids they
+    /// use are returned to be retried later.
+    pub fn rebind_materials(
+        &mut self,
+        graphics: &Arc<SharedGraphicsContext>,
+        ids: &HashSet<u64>,
+    ) -> HashSet<u64> {
+        puffin::profile_function!();
+        let mut unbound = HashSet::new();
+        if ids.is_empty() {
+            return unbound;
+        }
+
+        let mut models = std::mem::take(&mut self.models);
+        for model in models.values_mut() {
+            if !model.materials.iter().any(|m| m.uses_any_texture(ids)) {
+                continue;
+            }
+
+            let Some(model) = Arc::get_mut(model) else {
+                for material in &model.materials {
+                    unbound.extend(material.texture_ids().filter(|id| ids.contains(id)));
+                }
+                continue;
+            };
+
+            for material in model.materials.iter_mut() {
+                if material.uses_any_texture(ids) {
+                    material.rebuild_bind_group(self, graphics);
+                }
+            }
+        }
+        self.models = models;
+
+        unbound
     }
 }
 
@@ -0,0 +1,530 @@
+//! The real-time half of the audio engine.
+//!
+//! [`Mixer::render`] runs on the audio device's thread, so nothing in here may lock, allocate or
+//! wait on anything. Everything it needs is allocated up front, commands come in over a lock-free
+//! queue, and voices it is done with are handed back to the game thread to be freed.
+
+use super::stream::StreamFormat;
+use super::{AudioConfig, AudioStats, Listener, PlayParams, SoundId};
+use glam::{Vec3, Vec4};
+use rtrb::{Consumer, Producer};
+use std::cmp::Ordering;
+use std::f32::consts::FRAC_PI_4;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering as AtomicOrdering};
+
+/// The most frames mixed in one go. Gains and the set of real voices are updated once per block.
+pub(crate) const BLOCK_FRAMES: usize = 256;
+
+/// How much faster than the output a voice can read its source (sample rate difference and pitch
+/// combined), which bounds how much has to be read for one block.
+const MAX_STEP: f64 = 8.0;
+
+/// The most source frames a voice can need for one block, including the extra frame read for
+/// interpolating across the block boundary.
+const MAX_INPUT_FRAMES: usize = (MAX_STEP as usize) * BLOCK_FRAMES + 2;
+
+/// Messages from the game thread to the mixer.
+pub(crate) enum MixerCommand {
+    Play(VoiceStart),
+    Stop(SoundId),
+    SetVolume(SoundId, f32),
+    SetPitch(SoundId, f32),
+    SetPosition(SoundId, Vec3),
+    SetListener(Listener),
+    SetMasterVolume(f32),
+}
+
+/// Everything the mixer needs to start playing a sound.
+pub(crate) struct VoiceStart {
+    pub id: SoundId,
+    pub samples: Consumer<f32>,
+    pub format: Arc<StreamFormat>,
+    pub params: PlayParams,
+}
+
+/// Messages from the mixer back to the game thread.
+pub(crate) enum MixerEvent {
+    /// The mixer is done with a sound, because it ended, was stopped or lost its voice. Its ring
+    /// buffer comes along so that it is freed on the game thread rather than the audio thread.
+    Retired(VoiceStart),
+}
+
+/// Counters the mixer updates for [`AudioStats`].
+#[derive(Default)]
+pub(crate) struct MixerStats {
+    voices: AtomicUsize,
+    real_voices: AtomicUsize,
+    starved: AtomicU64,
+}
+
+impl MixerStats {
+    pub fn snapshot(&self) -> AudioStats {
+        AudioStats {
+            voices: self.voices.load(AtomicOrdering::Relaxed),
+            real_voices: self.real_voices.load(AtomicOrdering::Relaxed),
+            starved: self.starved.load(AtomicOrdering::Relaxed),
+        }
+    }
+}
+
+/// A playing sound, as the mixer sees it.
+struct Voice {
+    id: SoundId,
+    samples: Consumer<f32>,
+    format: Arc<StreamFormat>,
+    params: PlayParams,
+    /// How far into the oldest frame left in the ring playback is, in frames.
+    cursor: f64,
+    /// The gains the voice should be at by the end of this block.
+    target: [f32; 2],
+    /// The gains the voice was mixed at by the end of the last block. Moving from these to
+    /// `target` over a block keeps volume changes, stops and voices becoming real from clicking.
+    applied: [f32; 2],
+    stopping: bool,
+    done: bool,
+}
+
+impl Voice {
+    fn new(start: VoiceStart) -> Self {
+        Self {
+            id: start.id,
+            samples: start.samples,
+            format: start.format,
+            params: start.params,
+            cursor: 0.0,
+            target: [0.0; 2],
+            applied: [0.0; 2],
+            stopping: false,
+            done: false,
+        }
+    }
+
+    fn into_start(self) -> VoiceStart {
+        VoiceStart {
+            id: self.id,
+            samples: self.samples,
+            format: self.format,
+            params: self.params,
+        }
+    }
+
+    /// The priority of the voice, then how loud it currently is.
+    fn importance(&self) -> (u8, f32) {
+        (self.params.priority, self.target[0].max(self.target[1]))
+    }
+
+    fn update_target(&mut self, listener: &Listener, master_volume: f32) {
+        if self.stopping {
+            self.target = [0.0; 2];
+            return;
+        }
+
+        let volume = self.params.volume * master_volume;
+        self.target = match self.params.position {
+            None => [volume; 2],
+            Some(position) => {
+                let offset = position - listener.position;
+                let distance = offset.length();
+                let gain = volume
+                    * attenuation(distance, self.params.min_distance, self.params.max_distance);
+                let pan = if distance > f32::EPSILON {
+                    (offset.dot(listener.right) / distance).clamp(-1.0, 1.0)
+                } else {
+                    0.0
+                };
+                // equal power, so a sound moving across the listener keeps its loudness
+                let angle = (pan + 1.0) * FRAC_PI_4;
+                [gain * angle.cos(), gain * angle.sin()]
+            }
+        };
+    }
+
+    /// How fast to read the source and how many channels it has, or `None` if the streamer has
+    /// not decoded anything yet.
+    fn step(&self, output_rate: u32) -> Option<(f64, usize)> {
+        let rate = self.format.sample_rate.load(AtomicOrdering::Acquire);
+        if rate == 0 {
+            return None;
+        }
+        let channels = self
+            .format
+            .channels
+            .load(AtomicOrdering::Relaxed)
+            .clamp(1, 2) as usize;
+        let step = rate as f64 / output_rate as f64 * self.params.pitch as f64;
+        Some((step.min(MAX_STEP), channels))
+    }
+
+    /// Whether the stream ended (or broke) and everything it decoded has been played.
+    fn is_exhausted(&self, channels: usize) -> bool {
+        if self.format.failed.load(AtomicOrdering::Relaxed) {
+            return true;
+        }
+        let ended =
+            self.format.finished.load(AtomicOrdering::Acquire) || self.samples.is_abandoned();
+        ended && self.samples.slots() < channels * 2
+    }
+
+    /// Handles a voice whose stream has not started yet.
+    fn wait_for_stream(&mut self) {
+        self.applied = [0.0; 2];
+        self.done = self.stopping
+            || self.format.failed.load(AtomicOrdering::Relaxed)
+            || self.samples.is_abandoned();
+    }
+
+    /// Resamples the next block into `scratch` and adds it onto `out`. Returns whether the stream
+    /// could not keep up.
+    fn mix(
+        &mut self,
+        out: &mut [f32],
+        input: &mut [f32],
+        scratch: &mut [f32],
+        output_rate: u32,
+    ) -> bool {
+        let Some((step, channels)) = self.step(output_rate) else {
+            self.wait_for_stream();
+            return false;
+        };
+        let frames = out.len() / 2;
+
+        let wanted = (self.cursor + step * frames as f64) as usize + 2;
+        let available = (self.samples.slots() / channels)
+            .min(wanted)
+            .min(input.len() / channels);
+        let Ok(chunk) = self.samples.read_chunk(available * channels) else {
+            return true;
+        };
+        let (first, second) = chunk.as_slices();
+        input[..first.len()].copy_from_slice(first);
+        input[first.len()..first.len() + second.len()].copy_from_slice(second);
+
+        // linear interpolation between the two source frames either side of the cursor
+        let scratch = &mut scratch[..frames * 2];
+        let mut cursor = self.cursor;
+        let mut produced = 0;
+        while produced < frames {
+            let index = cursor as usize;
+            if index + 1 >= available {
+                break;
+            }
+            let t = (cursor - index as f64) as f32;
+            let (left, right) = if channels == 2 {
+                let i = index * 2;
+                (
+                    lerp(input[i], input[i + 2], t),
+                    lerp(input[i + 1], input[i + 3], t),
+                )
+            } else {
+                let sample = lerp(input[index], input[index + 1], t);
+                (sample, sample)
+            };
+            scratch[produced * 2] = left;
+            scratch[produced * 2 + 1] = right;
+            produced += 1;
+            cursor += step;
+        }
+        scratch[produced * 2..].fill(0.0);
+
+        // the frame under the cursor is kept, as the next block interpolates from it
+        let consumed = (cursor as usize).min(available);
+        chunk.commit(consumed * channels);
+        self.cursor = cursor - consumed as f64;
+
+        accumulate(out, scratch, self.applied, self.target);
+        self.applied = self.target;
+
+        let exhausted = self.is_exhausted(channels);
+        self.done = exhausted || (self.stopping && self.applied == [0.0; 2]);
+        produced < frames && !exhausted
+    }
+
+    /// Moves a virtual voice along as if it had been mixed, without resampling or mixing it.
+    fn skip(&mut self, frames: usize, output_rate: u32) {
+        let Some((step, channels)) = self.step(output_rate) else {
+            self.wait_for_stream();
+            return;
+        };
+        self.applied = [0.0; 2];
+
+        let cursor = self.cursor + step * frames as f64;
+        let whole = cursor as usize;
+        let consumed = whole.min(self.samples.slots() / channels);
+        if let Ok(chunk) = self.samples.read_chunk(consumed * channels) {
+            chunk.commit_all();
+        }
+        self.cursor = if consumed == whole {
+            cursor - whole as f64
+        } else {
+            0.0
+        };
+
+        self.done = self.stopping || self.is_exhausted(channels);
+    }
+}
+
+fn lerp(a: f32, b: f32, t: f32) -> f32 {
+    a + (b - a) * t
+}
+
+/// Inverse distance rolloff from `min_distance`, faded out to silence at `max_distance`.
+fn attenuation(distance: f32, min_distance: f32, max_distance: f32) -> f32 {
+    if distance <= min_distance {
+        return 1.0;
+    }
+    if distance >= max_distance {
+        return 0.0;
+    }
+    let fade = (max_distance - distance) / (max_distance - min_distance);
+    min_distance / distance * fade
+}
+
+fn compare(a: (u8, f32), b: (u8, f32)) -> Ordering {
+    a.0.cmp(&b.0).then(a.1.total_cmp(&b.1))
+}
+
+/// Adds `input` onto `out` (both interleaved stereo), with the gains moving linearly from `from`
+/// to `to` over the block. Two frames are handled at a time as one [`Vec4`], which glam maps onto
+/// SSE2 or NEON.
+fn accumulate(out: &mut [f32], input: &[f32], from: [f32; 2], to: [f32; 2]) {
+    let frames = out.len() / 2;
+    if frames == 0 || (from == [0.0; 2] && to == [0.0; 2]) {
+        return;
+    }
+
+    let delta = [
+        (to[0] - from[0]) / frames as f32,
+        (to[1] - from[1]) / frames as f32,
+    ];
+    let mut gain = Vec4::new(from[0], from[1], from[0] + delta[0], from[1] + delta[1]);
+    let step = Vec4::new(delta[0], delta[1], delta[0], delta[1]) * 2.0;
+
+    let mut out_chunks = out.chunks_exact_mut(4);
+    let mut in_chunks = input.chunks_exact(4);
+    for (out, input) in (&mut out_chunks).zip(&mut in_chunks) {
+        let mixed = Vec4::from_slice(out) + Vec4::from_slice(input) * gain;
+        mixed.write_to_slice(out);
+        gain += step;
+    }
+    if let [left, right] = out_chunks.into_remainder()
+        && let [in_left, in_right] = in_chunks.remainder()
+    {
+        *left += in_left * gain.x;
+        *right += in_right * gain.y;
+    }
+}
+
+/// Keeps the mix within the range the output can represent.
+fn clamp(out: &mut [f32]) {
+    let mut chunks = out.chunks_exact_mut(4);
+    for chunk in &mut chunks {
+        let clamped = Vec4::from_slice(chunk).clamp(Vec4::NEG_ONE, Vec4::ONE);
+        clamped.write_to_slice(chunk);
+    }
+    for sample in chunks.into_remainder() {
+        *sample = sample.clamp(-1.0, 1.0);
+    }
+}
+
+/// Mixes every playing sound into one interleaved stereo signal.
+///
+/// The mixer normally lives in the audio device's callback. [`super::AudioEngine::with_mixer`]
+/// hands it out instead, for when something else should drive it (such as a test or an offline
+/// render).
+pub struct Mixer {
+    commands: Consumer<MixerCommand>,
+    events: Producer<MixerEvent>,
+    stats: Arc<MixerStats>,
+    sample_rate: u32,
+    max_voices: usize,
+    max_real_voices: usize,
+    voices: Vec<Voice>,
+    /// Voice indices, most important first up to `max_real_voices`.
+    order: Vec<usize>,
+    /// Source frames read out of a voice's ring, in one piece.
+    input: Vec<f32>,
+    /// A voice's block, resampled to the output rate.
+    scratch: Vec<f32>,
+    listener: Listener,
+    master_volume: f32,
+}
+
+impl Mixer {
+    pub(crate) fn new(
+        config: &AudioConfig,
+        sample_rate: u32,
+        commands: Consumer<MixerCommand>,
+        events: Producer<MixerEvent>,
+        stats: Arc<MixerStats>,
+    ) -> Self {
+        Self {
+            commands,
+            events,
+            stats,
+            sample_rate: sample_rate.max(1),
+            max_voices: config.max_voices,
+            max_real_voices: config.max_real_voices,
+            voices: Vec::with_capacity(config.max_voices),
+            order: Vec::with_capacity(config.max_voices),
+            input: vec![0.0; MAX_INPUT_FRAMES * 2],
+            scratch: vec![0.0; BLOCK_FRAMES * 2],
+            listener: Listener::default(),
+            master_volume: 1.0,
+        }
+    }
+
+    pub fn sample_rate(&self) -> u32 {
+        self.sample_rate
+    }
+
+    pub(crate) fn set_sample_rate(&mut self, sample_rate: u32) {
+        self.sample_rate = sample_rate.max(1);
+    }
+
+    /// Fills `out` (interleaved stereo) with the next frames of the mix.
+    pub fn render(&mut self, out: &mut [f32]) {
+        self.apply_commands();
+        for block in out.chunks_mut(BLOCK_FRAMES * 2) {
+            self.render_block(block);
+        }
+    }
+
+    fn apply_commands(&mut self) {
+        while let Ok(command) = self.commands.pop() {
+            match command {
+                MixerCommand::Play(start) => self.start_voice(start),
+                MixerCommand::Stop(id) => {
+                    if let Some(voice) = self.voice_mut(id) {
+                        voice.stopping = true;
+                    }
+                }
+                MixerCommand::SetVolume(id, volume) => {
+                    if let Some(voice) = self.voice_mut(id) {
+                        voice.params.volume = volume;
+                    }
+                }
+                MixerCommand::SetPitch(id, pitch) => {
+                    if let Some(voice) = self.voice_mut(id) {
+                        voice.params.pitch = pitch;
+                    }
+                }
+                MixerCommand::SetPosition(id, position) => {
+                    if let Some(voice) = self.voice_mut(id) {
+                        voice.params.position = Some(position);
+                    }
+                }
+                MixerCommand::SetListener(listener) => self.listener = listener,
+                MixerCommand::SetMasterVolume(volume) => self.master_volume = volume,
+            }
+        }
+    }
+
+    fn voice_mut(&mut self, id: SoundId) -> Option<&mut Voice> {
+        self.voices.iter_mut().find(|voice| voice.id == id)
+    }
+
+    /// Adds a voice, taking the place of the least important one when every voice is in use. If
+    /// the new sound is the least important, it is not played at all.
+    fn start_voice(&mut self, start: VoiceStart) {
+        let mut voice = Voice::new(start);
+        voice.update_target(&self.listener, self.master_volume);
+
+        if self.voices.len() >= self.max_voices {
+            let weakest = self
+                .voices
+                .iter()
+                .enumerate()
+                .min_by(|(_, a), (_, b)| compare(a.importance(), b.importance()))
+                .map(|(index, _)| index);
+            match weakest {
+                Some(weakest)
+                    if compare(voice.importance(), self.voices[weakest].importance()).is_gt() =>
+                {
+                    let stolen = self.voices.swap_remove(weakest);
+                    self.retire(stolen);
+                }
+                _ => {
+                    self.retire(voice);
+                    return;
+                }
+            }
+        }
+
+        self.voices.push(voice);
+    }
+
+    fn retire(&mut self, voice: Voice) {
+        // the queue has room for every voice, so this only drops (and frees) the voice here when
+        // the game thread stopped collecting them
+        let _ = self.events.push(MixerEvent::Retired(voice.into_start()));
+    }
+
+    fn render_block(&mut self, out: &mut [f32]) {
+        out.fill(0.0);
+        let frames = out.len() / 2;
+
+        let Self {
+            voices,
+            order,
+            input,
+            scratch,
+            listener,
+            master_volume,
+            sample_rate,
+            max_real_voices,
+            ..
+        } = self;
+
+        for voice in voices.iter_mut() {
+            voice.update_target(listener, *master_volume);
+        }
+
+        // only the most important voices are mixed, the rest just keep their place
+        order.clear();
+        order.extend(0..voices.len());
+        let real = (*max_real_voices).min(voices.len());
+        if real > 0 && real < voices.len() {
+            order.select_nth_unstable_by(real - 1, |&a, &b| {
+                compare(voices[b].importance(), voices[a].importance())
+            });
+        }
+
+        let mut starved = 0;
+        for (rank, &index) in order.iter().enumerate() {
+            let voice = &mut voices[index];
+            if rank < real {
+                if voice.mix(out, input, scratch, *sample_rate) {
+                    starved += 1;
+                }
+            } else {
+                voice.skip(frames, *sample_rate);
+            }
+        }
+
+        clamp(out);
+
+        let mut index = 0;
+        while index < self.voices.len() {
+            if self.voices[index].done {
+                let voice = self.voices.swap_remove(index);
+                self.retire(voice);
+            } else {
+                index += 1;
+            }
+        }
+
+        self.stats
+            .voices
+            .store(self.voices.len(), AtomicOrdering::Relaxed);
+        self.stats.real_voices.store(
+            self.max_real_voices.min(self.voices.len()),
+            AtomicOrdering::Relaxed,
+        );
+        if starved > 0 {
+            self.stats
+                .starved
+                .fetch_add(starved, AtomicOrdering::Relaxed);
+        }
+    }
+}
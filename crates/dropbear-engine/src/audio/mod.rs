@@ -0,0 +1,556 @@
+//! Audio playback.
+//!
+//! Sounds are mixed on the audio device's own thread by a [`Mixer`], which never locks, allocates
+//! or touches the disk, so a long frame or a busy loader cannot make the audio crackle. The game
+//! talks to it through an [`AudioEngine`] (normally the [`AUDIO`] global), over lock-free single
+//! producer, single consumer queues.
+//!
+//! Sounds are never decoded in full. A streamer thread decodes each playing sound a few packets at
+//! a time into a ring buffer its voice reads from, so a ten minute track costs as much memory as a
+//! footstep.
+//!
+//! Only the [`AudioConfig::max_real_voices`] most important and loudest sounds are actually mixed.
+//! The rest keep their place as virtual voices, and are mixed again once they matter.
+
+mod mixer;
+mod output;
+mod stream;
+
+pub use mixer::Mixer;
+
+use crate::camera::Camera;
+use crate::entity::EntityTransform;
+use glam::{DVec3, Vec3};
+use hecs::{Entity, World};
+use mixer::{MixerCommand, MixerEvent, MixerStats, VoiceStart};
+use output::Output;
+use parking_lot::Mutex;
+use rtrb::{Consumer, Producer, RingBuffer};
+use std::collections::HashMap;
+use std::path::PathBuf;
+use std::sync::mpsc::Sender;
+use std::sync::{Arc, LazyLock};
+use stream::{StreamFormat, StreamRequest};
+
+pub static AUDIO: LazyLock<Mutex<AudioEngine>> =
+    LazyLock::new(|| Mutex::new(AudioEngine::new(AudioConfig::default())));
+
+/// The amount of commands that can be waiting for the mixer.
+const COMMAND_CAPACITY: usize = 4096;
+
+/// How far an attached sound's entity has to move before the mixer is told about it.
+const POSITION_EPSILON: f32 = 1.0e-3;
+
+/// Settings for the [`AudioEngine`].
+#[derive(Debug, Clone)]
+pub struct AudioConfig {
+    /// The most sounds that can play at once. Past this, a new sound takes the place of the least
+    /// important one, or is not played if it is the least important itself.
+    pub max_voices: usize,
+    /// The most sounds mixed at once. The others play on silently as virtual voices.
+    pub max_real_voices: usize,
+    /// How many frames of each sound are decoded ahead of the mixer.
+    pub stream_buffer_frames: usize,
+    /// The sample rate used when there is no output device to ask.
+    pub fallback_sample_rate: u32,
+}
+
+impl Default for AudioConfig {
+    fn default() -> Self {
+        Self {
+            max_voices: 256,
+            max_real_voices: 64,
+            stream_buffer_frames: 8192,
+            fallback_sample_rate: 48_000,
+        }
+    }
+}
+
+/// A snapshot of the mixer's bookkeeping, useful for debug overlays.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct AudioStats {
+    /// Sounds playing, real or virtual.
+    pub voices: usize,
+    /// Sounds being mixed.
+    pub real_voices: usize,
+    /// How many times a sound ran out of decoded audio while being mixed.
+    pub starved: u64,
+}
+
+/// Identifies a playing sound. `0` is never used.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct SoundId(pub u64);
+
+/// Where a sound is decoded from.
+#[derive(Debug, Clone)]
+pub enum SoundSource {
+    File(PathBuf),
+    Memory(Arc<[u8]>),
+}
+
+/// How a sound is played.
+#[derive(Debug, Clone, Copy)]
+pub struct PlayParams {
+    pub volume: f32,
+    /// Playback speed, where `2.0` plays an octave higher.
+    pub pitch: f32,
+    pub looping: bool,
+    /// Higher priority sounds are mixed (and kept when voices run out) before lower priority
+    /// ones, however loud either is.
+    pub priority: u8,
+    /// Where the sound is in the world, or `None` for sounds heard the same everywhere (such as
+    /// music).
+    pub position: Option<Vec3>,
+    /// Closer than this, the sound plays at full volume.
+    pub min_distance: f32,
+    /// Further than this, the sound is silent.
+    pub max_distance: f32,
+}
+
+impl Default for PlayParams {
+    fn default() -> Self {
+        Self {
+            volume: 1.0,
+            pitch: 1.0,
+            looping: false,
+            priority: 0,
+            position: None,
+            min_distance: 1.0,
+            max_distance: 50.0,
+        }
+    }
+}
+
+impl PlayParams {
+    fn sanitised(mut self) -> Self {
+        self.volume = sanitise_volume(self.volume);
+        self.pitch = sanitise_pitch(self.pitch);
+        self.min_distance = self.min_distance.max(0.01);
+        self.max_distance = self.max_distance.max(self.min_distance + 0.01);
+        self
+    }
+}
+
+fn sanitise_volume(volume: f32) -> f32 {
+    if volume.is_finite() {
+        volume.max(0.0)
+    } else {
+        0.0
+    }
+}
+
+fn sanitise_pitch(pitch: f32) -> f32 {
+    if pitch.is_finite() {
+        pitch.clamp(1.0 / 64.0, 8.0)
+    } else {
+        1.0
+    }
+}
+
+/// Where sounds are heard from.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Listener {
+    pub position: Vec3,
+    /// The listener's right, which pans sounds on that side into the right channel.
+    pub right: Vec3,
+}
+
+impl Default for Listener {
+    fn default() -> Self {
+        Self {
+            position: Vec3::ZERO,
+            right: Vec3::X,
+        }
+    }
+}
+
+impl Listener {
+    /// A listener at the camera's eye, facing where it looks.
+    pub fn from_camera(camera: &Camera) -> Self {
+        Self::looking_at(camera.eye, camera.target, camera.up)
+    }
+
+    /// A listener at `eye` facing `target`, the same way a [`Camera`] with those values looks.
+    pub fn looking_at(eye: DVec3, target: DVec3, up: DVec3) -> Self {
+        let forward = (target - eye).normalize_or(DVec3::Z);
+        // the engine is left handed, see Camera::move_right
+        let right = up.cross(forward).normalize_or(DVec3::X);
+        Self {
+            position: eye.as_vec3(),
+            right: right.as_vec3(),
+        }
+    }
+}
+
+/// A sound the game thread still considers playing.
+struct PlayingSound {
+    /// The entity the sound follows around.
+    entity: Option<Entity>,
+    /// The position the mixer was last told about.
+    position: Option<Vec3>,
+}
+
+/// The game thread's side of the audio engine.
+pub struct AudioEngine {
+    config: AudioConfig,
+    commands: Producer<MixerCommand>,
+    events: Consumer<MixerEvent>,
+    streamer: Sender<StreamRequest>,
+    stats: Arc<MixerStats>,
+    sample_rate: u32,
+    next_id: u64,
+    sounds: HashMap<SoundId, PlayingSound>,
+    listener: Option<Listener>,
+    _output: Option<Output>,
+}
+
+impl AudioEngine {
+    /// Creates an audio engine that plays on the default output device, falling back to a null
+    /// output when there is none.
+    pub fn new(config: AudioConfig) -> Self {
+        let (mut engine, mixer) = Self::with_mixer(config.clone(), config.fallback_sample_rate);
+        let output = output::start(mixer);
+        engine.sample_rate = output.sample_rate;
+        engine._output = Some(output);
+        engine
+    }
+
+    /// Creates an audio engine without any output, along with the [`Mixer`] it feeds. Nothing is
+    /// heard (or progresses) unless the mixer is rendered by the caller.
+    pub fn with_mixer(config: AudioConfig, sample_rate: u32) -> (Self, Mixer) {
+        let (commands, command_consumer) = RingBuffer::new(COMMAND_CAPACITY);
+        // room for every voice to retire, along with every play command that could be refused
+        let (event_producer, events) = RingBuffer::new(config.max_voices + COMMAND_CAPACITY);
+        let stats = Arc::new(MixerStats::default());
+
+        let mixer = Mixer::new(
+            &config,
+            sample_rate,
+            command_consumer,
+            event_producer,
+            stats.clone(),
+        );
+        let engine = Self {
+            config,
+            commands,
+            events,
+            streamer: stream::spawn(),
+            stats,
+            sample_rate,
+            next_id: 1,
+            sounds: HashMap::new(),
+            listener: None,
+            _output: None,
+        };
+        (engine, mixer)
+    }
+
+    /// The sample rate the mix is rendered at.
+    pub fn sample_rate(&self) -> u32 {
+        self.sample_rate
+    }
+
+    pub fn stats(&self) -> AudioStats {
+        self.stats.snapshot()
+    }
+
+    /// Starts playing a sound. Decoding starts straight away, on the streamer thread.
+    pub fn play(&mut self, source: SoundSource, params: PlayParams) -> anyhow::Result<SoundId> {
+        let id = SoundId(self.next_id);
+        let params = params.sanitised();
+
+        let (producer, consumer) = RingBuffer::new(self.config.stream_buffer_frames.max(1024) * 2);
+        let format = Arc::new(StreamFormat::default());
+
+        let start = VoiceStart {
+            id,
+            samples: consumer,
+            format: format.clone(),
+            params,
+        };
+        if self.commands.push(MixerCommand::Play(start)).is_err() {
+            anyhow::bail!("Too many audio commands are waiting for the mixer");
+        }
+        self.next_id += 1;
+
+        let request = StreamRequest {
+            id,
+            source,
+            looping: params.looping,
+            samples: producer,
+            format,
+        };
+        if self.streamer.send(request).is_err() {
+            // the voice notices its stream is gone and ends itself
+            anyhow::bail!("The audio streamer has stopped");
+        }
+
+        self.sounds.insert(
+            id,
+            PlayingSound {
+                entity: None,
+                position: params.position,
+            },
+        );
+        Ok(id)
+    }
+
+    /// Starts playing a sound that follows `entity` around, which needs an [`EntityTransform`].
+    pub fn play_attached(
+        &mut self,
+        world: &World,
+        entity: Entity,
+        source: SoundSource,
+        params: PlayParams,
+    ) -> anyhow::Result<SoundId> {
+        let transform = world
+            .get::<&EntityTransform>(entity)
+            .map_err(|_| anyhow::anyhow!("Entity {:?} has no EntityTransform", entity))?;
+        let position = transform.sync().position.as_vec3();
+        drop(transform);
+
+        let id = self.play(
+            source,
+            PlayParams {
+                position: Some(position),
+                ..params
+            },
+        )?;
+        if let Some(sound) = self.sounds.get_mut(&id) {
+            sound.entity = Some(entity);
+        }
+        Ok(id)
+    }
+
+    /// Whether a sound is still playing, as of the last [`Self::update`].
+    pub fn is_playing(&self, id: SoundId) -> bool {
+        self.sounds.contains_key(&id)
+    }
+
+    /// Stops a sound, fading it out over a few milliseconds.
+    pub fn stop(&mut self, id: SoundId) {
+        if self.sounds.contains_key(&id) {
+            self.send(MixerCommand::Stop(id));
+        }
+    }
+
+    pub fn set_volume(&mut self, id: SoundId, volume: f32) {
+        if self.sounds.contains_key(&id) {
+            self.send(MixerCommand::SetVolume(id, sanitise_volume(volume)));
+        }
+    }
+
+    pub fn set_pitch(&mut self, id: SoundId, pitch: f32) {
+        if self.sounds.contains_key(&id) {
+            self.send(MixerCommand::SetPitch(id, sanitise_pitch(pitch)));
+        }
+    }
+
+    /// Moves a sound, detaching it from the entity it followed.
+    pub fn set_position(&mut self, id: SoundId, position: Vec3) {
+        if let Some(sound) = self.sounds.get_mut(&id) {
+            sound.entity = None;
+            sound.position = Some(position);
+            self.send(MixerCommand::SetPosition(id, position));
+        }
+    }
+
+    pub fn set_master_volume(&mut self, volume: f32) {
+        self.send(MixerCommand::SetMasterVolume(sanitise_volume(volume)));
+    }
+
+    /// Stops every sound, such as when the scene is replaced.
+    pub fn stop_all(&mut self) {
+        let ids: Vec<SoundId> = self.sounds.keys().copied().collect();
+        for id in ids {
+            self.send(MixerCommand::Stop(id));
+        }
+    }
+
+    fn send(&mut self, command: MixerCommand) {
+        if self.commands.push(command).is_err() {
+            log_once::warn_once!("The audio command queue is full, some commands were dropped");
+        }
+    }
+
+    /// Collects the sounds that ended, and moves the listener and every attached sound to where
+    /// they are now. Call this once a frame.
+    pub fn update(&mut self, world: &World, listener: Listener) {
+        puffin::profile_function!();
+
+        // dropping these frees the ring buffers, which the mixer cannot do itself
+        while let Ok(MixerEvent::Retired(start)) = self.events.pop() {
+            self.sounds.remove(&start.id);
+        }
+
+        if self.listener != Some(listener) {
+            self.listener = Some(listener);
+            self.send(MixerCommand::SetListener(listener));
+        }
+
+        for (id, sound) in &mut self.sounds {
+            let Some(entity) = sound.entity else {
+                continue;
+            };
+            let Ok(transform) = world.get::<&EntityTransform>(entity) else {
+                // the entity is gone, so the sound stays where it was last heard
+                sound.entity = None;
+                continue;
+            };
+            let position = transform.sync().position.as_vec3();
+            let moved = sound
+                .position
+                .is_none_or(|last| last.distance(position) > POSITION_EPSILON);
+            if moved
+                && self
+                    .commands
+                    .push(MixerCommand::SetPosition(*id, position))
+                    .is_ok()
+            {
+                sound.position = Some(position);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::{Duration, Instant};
+
+    /// A 16 bit PCM wav of a constant signal.
+    fn wav(sample_rate: u32, channels: u16, frames: usize, value: i16) -> Arc<[u8]> {
+        let data_len = (frames * channels as usize * 2) as u32;
+        let mut bytes = Vec::new();
+        bytes.extend_from_slice(b"RIFF");
+        bytes.extend_from_slice(&(36 + data_len).to_le_bytes());
+        bytes.extend_from_slice(b"WAVEfmt ");
+        bytes.extend_from_slice(&16u32.to_le_bytes());
+        bytes.extend_from_slice(&1u16.to_le_bytes());
+        bytes.extend_from_slice(&channels.to_le_bytes());
+        bytes.extend_from_slice(&sample_rate.to_le_bytes());
+        bytes.extend_from_slice(&(sample_rate * channels as u32 * 2).to_le_bytes());
+        bytes.extend_from_slice(&(channels * 2).to_le_bytes());
+        bytes.extend_from_slice(&16u16.to_le_bytes());
+        bytes.extend_from_slice(b"data");
+        bytes.extend_from_slice(&data_len.to_le_bytes());
+        for _ in 0..frames * channels as usize {
+            bytes.extend_from_slice(&value.to_le_bytes());
+        }
+        bytes.into()
+    }
+
+    /// Renders blocks until `done` is true about one of them, giving the streamer time to decode.
+    fn render_until(mixer: &mut Mixer, mut done: impl FnMut(&[f32]) -> bool) -> Vec<f32> {
+        let mut out = vec![0.0; 512 * 2];
+        let deadline = Instant::now() + Duration::from_secs(5);
+        loop {
+            mixer.render(&mut out);
+            if done(&out) {
+                return out;
+            }
+            assert!(Instant::now() < deadline, "timed out waiting for the mixer");
+            std::thread::sleep(Duration::from_millis(1));
+        }
+    }
+
+    #[test]
+    fn streams_resamples_and_finishes() {
+        let (mut engine, mut mixer) = AudioEngine::with_mixer(AudioConfig::default(), 48_000);
+        let world = World::new();
+        let sound = wav(44_100, 1, 4410, 8192);
+
+        let id = engine
+            .play(SoundSource::Memory(sound), PlayParams::default())
+            .unwrap();
+        engine.update(&world, Listener::default());
+        assert!(engine.is_playing(id));
+
+        let out = render_until(&mut mixer, |out| out.iter().any(|s| *s != 0.0));
+        assert!(out.iter().all(|s| (-1.0..=1.0).contains(s)));
+
+        render_until(&mut mixer, |_| engine.stats().voices == 0);
+        engine.update(&world, Listener::default());
+        assert!(!engine.is_playing(id));
+    }
+
+    #[test]
+    fn limits_and_virtualises_voices() {
+        let config = AudioConfig {
+            max_voices: 4,
+            max_real_voices: 2,
+            ..Default::default()
+        };
+        let (mut engine, mut mixer) = AudioEngine::with_mixer(config, 48_000);
+        let world = World::new();
+        let sound = wav(48_000, 1, 4800, 1000);
+
+        let ids: Vec<SoundId> = (0..6)
+            .map(|priority| {
+                let params = PlayParams {
+                    looping: true,
+                    priority,
+                    ..Default::default()
+                };
+                engine
+                    .play(SoundSource::Memory(sound.clone()), params)
+                    .unwrap()
+            })
+            .collect();
+
+        render_until(&mut mixer, |out| out.iter().any(|s| *s != 0.0));
+        engine.update(&world, Listener::default());
+
+        let stats = engine.stats();
+        assert_eq!(stats.voices, 4);
+        assert_eq!(stats.real_voices, 2);
+        // the lowest priority sounds lost their voices to the later ones
+        assert!(!engine.is_playing(ids[0]));
+        assert!(!engine.is_playing(ids[1]));
+        assert!(ids[2..].iter().all(|id| engine.is_playing(*id)));
+    }
+
+    #[test]
+    fn pans_towards_the_sound() {
+        let (mut engine, mut mixer) = AudioEngine::with_mixer(AudioConfig::default(), 48_000);
+        let params = PlayParams {
+            looping: true,
+            position: Some(Vec3::new(5.0, 0.0, 0.0)),
+            ..Default::default()
+        };
+        engine
+            .play(SoundSource::Memory(wav(48_000, 1, 4800, 8192)), params)
+            .unwrap();
+        engine.update(&World::new(), Listener::default());
+
+        // the first block the voice is mixed in fades in from silence, so wait for a full one
+        let out = render_until(&mut mixer, |out| {
+            out.iter().skip(1).step_by(2).all(|s| *s != 0.0)
+        });
+        let left: f32 = out.iter().step_by(2).map(|s| s.abs()).sum();
+        let right: f32 = out.iter().skip(1).step_by(2).map(|s| s.abs()).sum();
+        assert!(right > left * 2.0, "left {} right {}", left, right);
+    }
+
+    #[test]
+    fn camera_listener_hears_the_right_of_the_screen_on_the_right() {
+        for (eye, target) in [
+            (DVec3::ZERO, DVec3::Z),
+            (DVec3::ZERO, DVec3::NEG_Z),
+            (DVec3::new(3.0, 1.0, -2.0), DVec3::new(-4.0, 1.0, 5.0)),
+        ] {
+            let listener = Listener::looking_at(eye, target, DVec3::Y);
+            // the same view matrix the camera renders with
+            let view = glam::DMat4::look_at_lh(eye, target, DVec3::Y);
+            let on_the_right = view.inverse().transform_point3(DVec3::new(5.0, 0.0, 5.0));
+
+            let offset = on_the_right.as_vec3() - listener.position;
+            assert!(
+                offset.dot(listener.right) > 0.0,
+                "looking from {} to {}",
+                eye,
+                target
+            );
+        }
+    }
+}
@@ -0,0 +1,182 @@
+//! Audio output.
+//!
+//! The mixer runs inside the default output device's callback. Without a device (such as on a
+//! server, or a machine with its audio disabled), a null output renders the mix on a timer and
+//! throws it away, so sounds still play out and end as they would with one.
+
+use super::mixer::{BLOCK_FRAMES, Mixer};
+use cpal::traits::{DeviceTrait, HostTrait, StreamTrait};
+use cpal::{FromSample, SampleFormat, SizedSample};
+use parking_lot::Mutex;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, mpsc};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+
+/// The most frames rendered into the stereo scratch buffer at once, whatever size of buffer the
+/// device asks for.
+const CALLBACK_FRAMES: usize = BLOCK_FRAMES * 4;
+
+/// The amount of frames the null output renders at a time.
+const NULL_PERIOD_FRAMES: usize = 1024;
+
+/// Keeps the output running until dropped.
+pub(crate) struct Output {
+    shutdown: Arc<AtomicBool>,
+    thread: Option<JoinHandle<()>>,
+    pub sample_rate: u32,
+}
+
+impl Drop for Output {
+    fn drop(&mut self) {
+        self.shutdown.store(true, Ordering::Relaxed);
+        if let Some(thread) = self.thread.take() {
+            thread.thread().unpark();
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Starts playing the mix on the default output device, or on a null output if there is none.
+///
+/// `cpal::Stream` cannot leave the thread that built it, so the output gets a thread of its own.
+pub(crate) fn start(mixer: Mixer) -> Output {
+    let shutdown = Arc::new(AtomicBool::new(false));
+    let (report, reported) = mpsc::channel();
+
+    let thread_shutdown = shutdown.clone();
+    let thread = std::thread::Builder::new()
+        .name("dropbear-audio-output".to_string())
+        .spawn(move || {
+            let fallback_rate = mixer.sample_rate();
+            // the mixer is only moved into the callback once the stream works, so it can still be
+            // used by the null output if building the stream fails
+            let slot = Arc::new(Mutex::new(Some(mixer)));
+            match open_device(&slot) {
+                Ok((stream, sample_rate, name)) => {
+                    log::info!("Playing audio on \"{}\" at {} Hz", name, sample_rate);
+                    let _ = report.send(sample_rate);
+                    while !thread_shutdown.load(Ordering::Relaxed) {
+                        std::thread::park_timeout(Duration::from_millis(100));
+                    }
+                    drop(stream);
+                }
+                Err(e) => {
+                    log::warn!(
+                        "No audio output available, sounds will play silently: {}",
+                        e
+                    );
+                    let _ = report.send(fallback_rate);
+                    if let Some(mut mixer) = slot.lock().take() {
+                        // the device's rate may have been set before building the stream failed
+                        mixer.set_sample_rate(fallback_rate);
+                        run_null(mixer, &thread_shutdown);
+                    }
+                }
+            }
+        })
+        .expect("Unable to spawn the audio output thread");
+
+    let sample_rate = reported.recv().unwrap_or_default();
+    Output {
+        shutdown,
+        thread: Some(thread),
+        sample_rate,
+    }
+}
+
+fn open_device(slot: &Arc<Mutex<Option<Mixer>>>) -> anyhow::Result<(cpal::Stream, u32, String)> {
+    let host = cpal::default_host();
+    let device = host
+        .default_output_device()
+        .ok_or_else(|| anyhow::anyhow!("There is no default output device"))?;
+    let name = device
+        .name()
+        .unwrap_or_else(|_| "Unknown device".to_string());
+    let supported = device.default_output_config()?;
+    let sample_format = supported.sample_format();
+    let config: cpal::StreamConfig = supported.into();
+    let sample_rate = config.sample_rate.0;
+
+    // set before the stream can take the mixer, and put back by the caller if this fails
+    if let Some(mixer) = slot.lock().as_mut() {
+        mixer.set_sample_rate(sample_rate);
+    }
+
+    let stream = match sample_format {
+        SampleFormat::F32 => build_stream::<f32>(&device, &config, slot.clone()),
+        SampleFormat::F64 => build_stream::<f64>(&device, &config, slot.clone()),
+        SampleFormat::I16 => build_stream::<i16>(&device, &config, slot.clone()),
+        SampleFormat::I32 => build_stream::<i32>(&device, &config, slot.clone()),
+        SampleFormat::U16 => build_stream::<u16>(&device, &config, slot.clone()),
+        SampleFormat::U8 => build_stream::<u8>(&device, &config, slot.clone()),
+        other => anyhow::bail!("Unsupported output sample format {:?}", other),
+    }?;
+    stream.play()?;
+
+    Ok((stream, sample_rate, name))
+}
+
+fn build_stream<T>(
+    device: &cpal::Device,
+    config: &cpal::StreamConfig,
+    slot: Arc<Mutex<Option<Mixer>>>,
+) -> anyhow::Result<cpal::Stream>
+where
+    T: SizedSample + FromSample<f32>,
+{
+    let channels = config.channels as usize;
+    let mut mixer: Option<Mixer> = None;
+    let mut stereo = vec![0.0f32; CALLBACK_FRAMES * 2];
+
+    let stream = device.build_output_stream(
+        config,
+        move |data: &mut [T], _: &cpal::OutputCallbackInfo| {
+            if mixer.is_none() {
+                // only ever locked on the first callback
+                mixer = slot.lock().take();
+            }
+            let Some(mixer) = mixer.as_mut() else {
+                data.fill(T::EQUILIBRIUM);
+                return;
+            };
+
+            for frames in data.chunks_mut(CALLBACK_FRAMES * channels) {
+                let stereo = &mut stereo[..frames.len() / channels * 2];
+                mixer.render(stereo);
+                for (frame, mixed) in frames
+                    .chunks_exact_mut(channels)
+                    .zip(stereo.chunks_exact(2))
+                {
+                    if channels == 1 {
+                        frame[0] = T::from_sample((mixed[0] + mixed[1]) * 0.5);
+                        continue;
+                    }
+                    frame[0] = T::from_sample(mixed[0]);
+                    frame[1] = T::from_sample(mixed[1]);
+                    frame[2..].fill(T::EQUILIBRIUM);
+                }
+            }
+        },
+        |error| log::error!("Audio output error: {}", error),
+        None,
+    )?;
+
+    Ok(stream)
+}
+
+/// Renders the mix in real time and discards it.
+fn run_null(mut mixer: Mixer, shutdown: &AtomicBool) {
+    let mut buffer = vec![0.0f32; NULL_PERIOD_FRAMES * 2];
+    let period = Duration::from_secs_f64(NULL_PERIOD_FRAMES as f64 / mixer.sample_rate() as f64);
+    let mut deadline = Instant::now();
+
+    while !shutdown.load(Ordering::Relaxed) {
+        mixer.render(&mut buffer);
+        deadline += period;
+        match deadline.checked_duration_since(Instant::now()) {
+            Some(wait) => std::thread::sleep(wait),
+            None => deadline = Instant::now(),
+        }
+    }
+}
@@ -0,0 +1,318 @@
+//! Streaming decode.
+//!
+//! One thread decodes every playing sound, a few packets at a time, into the ring buffer its voice
+//! reads from. A sound never exists fully decoded in memory, only the few thousand frames its ring
+//! holds.
+
+use super::SoundSource;
+use rtrb::Producer;
+use std::fs::File;
+use std::io::{Cursor, ErrorKind};
+use std::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use std::sync::mpsc::{Receiver, RecvTimeoutError, Sender, TryRecvError};
+use std::sync::{Arc, mpsc};
+use std::time::Duration;
+use symphonia::core::audio::{SampleBuffer, SignalSpec};
+use symphonia::core::codecs::{CODEC_TYPE_NULL, Decoder, DecoderOptions};
+use symphonia::core::errors::Error as SymphoniaError;
+use symphonia::core::formats::{FormatOptions, FormatReader, SeekMode, SeekTo};
+use symphonia::core::io::{MediaSource, MediaSourceStream};
+use symphonia::core::meta::MetadataOptions;
+use symphonia::core::probe::Hint;
+use symphonia::core::units::Time;
+
+/// How long the streamer sleeps when every ring is full.
+const IDLE_WAIT: Duration = Duration::from_millis(2);
+
+/// The most packets decoded for one stream before moving on to the next, so one sound cannot hold
+/// up the others.
+const MAX_PACKETS_PER_FILL: usize = 8;
+
+/// What the streamer tells the mixer about a stream, through atomics so neither side waits.
+#[derive(Default)]
+pub(crate) struct StreamFormat {
+    /// The sample rate of the decoded audio, or `0` until the first packet is decoded.
+    pub sample_rate: AtomicU32,
+    /// `1` or `2`, anything wider is downmixed to stereo.
+    pub channels: AtomicU32,
+    /// Set once every sample has been pushed into the ring.
+    pub finished: AtomicBool,
+    /// Set when the sound could not be opened or decoded.
+    pub failed: AtomicBool,
+}
+
+pub(crate) struct StreamRequest {
+    pub id: super::SoundId,
+    pub source: SoundSource,
+    pub looping: bool,
+    pub samples: Producer<f32>,
+    pub format: Arc<StreamFormat>,
+}
+
+/// Starts the streamer thread.
+pub(crate) fn spawn() -> Sender<StreamRequest> {
+    let (sender, receiver) = mpsc::channel();
+    std::thread::Builder::new()
+        .name("dropbear-audio-streamer".to_string())
+        .spawn(move || run(receiver))
+        .expect("Unable to spawn the audio streamer thread");
+    sender
+}
+
+fn run(requests: Receiver<StreamRequest>) {
+    let mut streams: Vec<Stream> = Vec::new();
+    let mut busy = false;
+
+    loop {
+        // take every new request, waiting a little for one when there is nothing else to do
+        let mut wait = !busy;
+        loop {
+            let request = if wait {
+                requests
+                    .recv_timeout(IDLE_WAIT)
+                    .map_err(|e| e == RecvTimeoutError::Disconnected)
+            } else {
+                requests
+                    .try_recv()
+                    .map_err(|e| e == TryRecvError::Disconnected)
+            };
+            match request {
+                Ok(request) => {
+                    wait = false;
+                    let id = request.id;
+                    let format = request.format.clone();
+                    match Stream::open(request) {
+                        Ok(stream) => streams.push(stream),
+                        Err(e) => {
+                            log::warn!("Unable to play sound {}: {}", id.0, e);
+                            format.failed.store(true, Ordering::Relaxed);
+                        }
+                    }
+                }
+                Err(true) => return,
+                Err(false) => break,
+            }
+        }
+
+        busy = false;
+        streams.retain_mut(|stream| match stream.fill() {
+            Ok(Fill::Busy) => {
+                busy = true;
+                true
+            }
+            Ok(Fill::Idle) => true,
+            Ok(Fill::Done) => false,
+            Err(e) => {
+                log::warn!("Unable to decode sound {}: {}", stream.id.0, e);
+                stream.format.failed.store(true, Ordering::Relaxed);
+                false
+            }
+        });
+    }
+}
+
+enum Fill {
+    /// Something was decoded or pushed.
+    Busy,
+    /// The ring is full.
+    Idle,
+    /// The stream ended or its voice is gone.
+    Done,
+}
+
+struct Stream {
+    id: super::SoundId,
+    reader: Box<dyn FormatReader>,
+    decoder: Box<dyn Decoder>,
+    track_id: u32,
+    looping: bool,
+    samples: Producer<f32>,
+    format: Arc<StreamFormat>,
+    decoded: Option<SampleBuffer<f32>>,
+    /// The capacity and layout `decoded` was made for.
+    decoded_spec: Option<(usize, SignalSpec)>,
+    /// Decoded samples that did not fit in the ring yet, starting at `pending_start`.
+    pending: Vec<f32>,
+    pending_start: usize,
+    /// Whether anything was decoded since the start of the sound, so that looping an empty sound
+    /// does not spin forever.
+    decoded_since_start: bool,
+    announced: bool,
+    ended: bool,
+}
+
+impl Stream {
+    fn open(request: StreamRequest) -> anyhow::Result<Self> {
+        let mut hint = Hint::new();
+        let media: Box<dyn MediaSource> = match &request.source {
+            SoundSource::File(path) => {
+                if let Some(extension) = path.extension().and_then(|e| e.to_str()) {
+                    hint.with_extension(extension);
+                }
+                Box::new(File::open(path)?)
+            }
+            SoundSource::Memory(bytes) => Box::new(Cursor::new(bytes.clone())),
+        };
+        let stream = MediaSourceStream::new(media, Default::default());
+
+        let probed = symphonia::default::get_probe().format(
+            &hint,
+            stream,
+            &FormatOptions::default(),
+            &MetadataOptions::default(),
+        )?;
+        let reader = probed.format;
+        let track = reader
+            .tracks()
+            .iter()
+            .find(|track| track.codec_params.codec != CODEC_TYPE_NULL)
+            .ok_or_else(|| anyhow::anyhow!("No audio track"))?;
+        let track_id = track.id;
+        let decoder = symphonia::default::get_codecs()
+            .make(&track.codec_params, &DecoderOptions::default())?;
+
+        Ok(Self {
+            id: request.id,
+            reader,
+            decoder,
+            track_id,
+            looping: request.looping,
+            samples: request.samples,
+            format: request.format,
+            decoded: None,
+            decoded_spec: None,
+            pending: Vec::new(),
+            pending_start: 0,
+            decoded_since_start: false,
+            announced: false,
+            ended: false,
+        })
+    }
+
+    /// Tops up the ring.
+    fn fill(&mut self) -> anyhow::Result<Fill> {
+        if self.samples.is_abandoned() {
+            return Ok(Fill::Done);
+        }
+
+        let mut busy = false;
+        for _ in 0..MAX_PACKETS_PER_FILL {
+            if self.pending_start < self.pending.len() {
+                busy |= self.push_pending() > 0;
+                if self.pending_start < self.pending.len() {
+                    break;
+                }
+            }
+            if self.ended {
+                self.format.finished.store(true, Ordering::Release);
+                return Ok(Fill::Done);
+            }
+            self.decode_next()?;
+            busy = true;
+        }
+
+        Ok(if busy { Fill::Busy } else { Fill::Idle })
+    }
+
+    fn push_pending(&mut self) -> usize {
+        let pending = &self.pending[self.pending_start..];
+        let count = pending.len().min(self.samples.slots());
+        let Ok(chunk) = self.samples.write_chunk_uninit(count) else {
+            return 0;
+        };
+        let written = chunk.fill_from_iter(pending.iter().copied());
+        self.pending_start += written;
+        written
+    }
+
+    /// Decodes the next packet into `pending`.
+    fn decode_next(&mut self) -> anyhow::Result<()> {
+        let packet = match self.reader.next_packet() {
+            Ok(packet) => packet,
+            Err(SymphoniaError::IoError(e)) if e.kind() == ErrorKind::UnexpectedEof => {
+                self.end_of_stream();
+                return Ok(());
+            }
+            Err(SymphoniaError::ResetRequired) => {
+                self.decoder.reset();
+                return Ok(());
+            }
+            Err(e) => return Err(e.into()),
+        };
+        if packet.track_id() != self.track_id {
+            return Ok(());
+        }
+
+        let decoded = match self.decoder.decode(&packet) {
+            Ok(decoded) => decoded,
+            // a corrupt packet is skipped rather than ending the sound
+            Err(SymphoniaError::DecodeError(e)) => {
+                log::debug!("Skipping a corrupt packet of sound {}: {}", self.id.0, e);
+                return Ok(());
+            }
+            Err(e) => return Err(e.into()),
+        };
+        if decoded.frames() == 0 {
+            return Ok(());
+        }
+
+        let spec = *decoded.spec();
+        let channels = spec.channels.count();
+        // the conversion buffer is kept for as long as the packets keep the same layout
+        if self.decoded_spec != Some((decoded.capacity(), spec)) {
+            self.decoded = None;
+        }
+        let buffer = self
+            .decoded
+            .get_or_insert_with(|| SampleBuffer::new(decoded.capacity() as u64, spec));
+        self.decoded_spec = Some((decoded.capacity(), spec));
+        buffer.copy_interleaved_ref(decoded);
+
+        if !self.announced {
+            self.format
+                .channels
+                .store(channels.min(2) as u32, Ordering::Relaxed);
+            self.format.sample_rate.store(spec.rate, Ordering::Release);
+            self.announced = true;
+        }
+
+        self.pending.clear();
+        self.pending_start = 0;
+        let samples = buffer.samples();
+        if channels <= 2 {
+            self.pending.extend_from_slice(samples);
+        } else {
+            // the front left and right channels come first
+            for frame in samples.chunks_exact(channels) {
+                self.pending.extend_from_slice(&frame[..2]);
+            }
+        }
+        self.decoded_since_start = true;
+        Ok(())
+    }
+
+    fn end_of_stream(&mut self) {
+        if !self.looping || !self.decoded_since_start {
+            self.ended = true;
+            return;
+        }
+
+        let seek = self.reader.seek(
+            SeekMode::Accurate,
+            SeekTo::Time {
+                time: Time::new(0, 0.0),
+                track_id: Some(self.track_id),
+            },
+        );
+        match seek {
+            Ok(_) => {
+                self.decoder.reset();
+                self.decoded_since_start = false;
+            }
+            Err(e) => {
+                log::warn!("Unable to loop sound {}: {}", self.id.0, e);
+                self.ended = true;
+            }
+        }
+    }
+}
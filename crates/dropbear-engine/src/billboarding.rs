@@ -187,7 +187,7 @@ impl BillboardPipeline {
                         write_mask: wgpu::ColorWrites::ALL,
                     })],
                 }),
-                cache: None,
+                cache: graphics.pipeline_cache.get(),
                 multiview_mask: None,
             });
 
@@ -2,6 +2,7 @@
 
 use std::marker::PhantomData;
 use std::ops::Range;
+use std::sync::atomic::{AtomicU64, Ordering};
 use bytemuck::NoUninit;
 use dropbear_utils::Dirty;
 
@@ -179,9 +180,17 @@ impl<T: NoUninit, B: WritableBuffer<T>> MutableDataBuffer<T, B> {
     }
 }
 
+/// Source of [`DynamicBuffer::generation`], shared so that no two uploads get the same value.
+static NEXT_GENERATION: AtomicU64 = AtomicU64::new(1);
+
+fn next_generation() -> u64 {
+    NEXT_GENERATION.fetch_add(1, Ordering::Relaxed)
+}
+
 pub struct DynamicBuffer<T> {
     data: Vec<T>,
     dirty_range: Option<Range<usize>>,
+    generation: u64,
     buffer: wgpu::Buffer,
     capacity: usize,
     usage: wgpu::BufferUsages,
@@ -194,6 +203,7 @@ impl<T: Clone> Clone for DynamicBuffer<T> {
         Self {
             data: self.data.clone(),
             dirty_range: self.dirty_range.clone(),
+            generation: next_generation(),
             buffer: self.buffer.clone(),
             capacity: self.capacity,
             usage: self.usage,
@@ -233,6 +243,7 @@ impl<T: NoUninit> DynamicBuffer<T> {
         Self {
             data: Vec::with_capacity(initial_capacity),
             dirty_range: None,
+            generation: next_generation(),
             buffer,
             capacity: initial_capacity,
             usage,
@@ -260,6 +271,7 @@ impl<T: NoUninit> DynamicBuffer<T> {
             capacity: data.len(),
             data: data.to_vec(),
             dirty_range: None,
+            generation: next_generation(),
             buffer,
             usage,
             label: label.to_string(),
@@ -275,6 +287,12 @@ impl<T: NoUninit> DynamicBuffer<T> {
         self.data.is_empty()
     }
 
+    /// Changes every time the contents are uploaded, and is never shared with another buffer.
+    /// Lets caches derived from [`data`](DynamicBuffer::data) tell when they are stale.
+    pub fn generation(&self) -> u64 {
+        self.generation
+    }
+
     /// Borrow the CPU-side data slice.
     pub fn data(&self) -> &[T] {
         &self.data
@@ -317,6 +335,9 @@ impl<T: NoUninit> DynamicBuffer<T> {
     /// Truncate the CPU buffer. Does not shrink the GPU allocation; the GPU buffer
     /// will simply have unused capacity at the end until re-populated.
     pub fn truncate(&mut self, len: usize) {
+        if len < self.data.len() {
+            self.generation = next_generation();
+        }
         self.data.truncate(len);
         if let Some(ref mut r) = self.dirty_range {
             r.end = r.end.min(len);
@@ -334,6 +355,7 @@ impl<T: NoUninit> DynamicBuffer<T> {
     pub fn flush(&mut self, device: &wgpu::Device, queue: &wgpu::Queue) {
         puffin::profile_function!(&self.label);
         let Some(dirty) = self.dirty_range.take() else { return };
+        self.generation = next_generation();
 
         if self.data.len() > self.capacity {
             self.capacity = self.data.len().max(self.capacity * 2);
@@ -369,12 +391,34 @@ impl<T: NoUninit> DynamicBuffer<T> {
     {
         self.data.clear();
         self.data.extend_from_slice(data);
-        if !data.is_empty() {
+        if data.is_empty() {
+            self.generation = next_generation();
+        } else {
             self.dirty_range = Some(0..data.len());
         }
         self.flush(device, queue);
     }
 
+    /// Like [`write`](DynamicBuffer::write), but only uploads the range of elements that differ
+    /// from what the buffer already holds. Use this for buffers that are usually unchanged
+    /// between frames, such as the instances of static models.
+    pub fn write_changed(&mut self, device: &wgpu::Device, queue: &wgpu::Queue, data: &[T])
+    where
+        T: Copy + PartialEq,
+    {
+        if self.data.len() != data.len() {
+            self.write(device, queue, data);
+            return;
+        }
+
+        let differs = |(a, b): (&T, &T)| a != b;
+        if let Some(first) = self.data.iter().zip(data).position(differs) {
+            let last = self.data.iter().zip(data).rposition(differs).unwrap_or(first);
+            self.update_range(first, &data[first..=last]);
+        }
+        self.flush(device, queue);
+    }
+
     /// The underlying `wgpu::Buffer` — use this when binding to a render pass.
     pub fn buffer(&self) -> &wgpu::Buffer {
         &self.buffer
@@ -2,7 +2,8 @@
 
 use std::sync::Arc;
 
-use glam::{DMat4, DQuat, DVec3, Mat4};
+use glam::{DMat4, DQuat, DVec3, Mat4, Vec3, Vec4};
+use parking_lot::RwLock;
 use serde::{Deserialize, Serialize};
 use wgpu::Buffer;
 
@@ -18,6 +19,48 @@ pub const OPENGL_TO_WGPU_MATRIX: [[f64; 4]; 4] = [
     [0.0, 0.0, 0.5, 1.0],
 ];
 
+/// How far the camera can get from the [`RenderOrigin`] before the origin is moved to it.
+pub const REBASE_DISTANCE: f64 = 2048.0;
+
+/// The point that world positions are made relative to, in f64, before they are converted to
+/// f32 for the GPU.
+///
+/// An f32 position loses precision quickly as it gets further from zero, which shows up as
+/// jittering geometry at the edges of large maps. The origin follows the active camera in steps of
+/// [`REBASE_DISTANCE`], so what is drawn always stays close to zero, while data already uploaded
+/// relative to the origin stays valid until the next step. Small worlds never move it.
+#[derive(Default)]
+pub struct RenderOrigin {
+    /// The origin, and how many times it was moved.
+    inner: RwLock<(DVec3, u64)>,
+}
+
+impl RenderOrigin {
+    pub fn get(&self) -> DVec3 {
+        self.inner.read().0
+    }
+
+    /// Changes every time the origin moves, so anything converted relative to it can tell it is
+    /// out of date.
+    pub fn generation(&self) -> u64 {
+        self.inner.read().1
+    }
+
+    /// Moves the origin to `eye` if it got too far away. Returns whether it moved.
+    pub fn follow(&self, eye: DVec3) -> bool {
+        let mut inner = self.inner.write();
+        if inner.0.distance_squared(eye) <= REBASE_DISTANCE * REBASE_DISTANCE {
+            return false;
+        }
+
+        // snapped to a grid, so the same spot always gives the same origin
+        inner.0 = (eye / REBASE_DISTANCE).round() * REBASE_DISTANCE;
+        inner.1 += 1;
+        log::debug!("Moved the render origin to {}", inner.0);
+        true
+    }
+}
+
 /// Shared tuning data for camera movement and projection.
 #[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub struct CameraSettings {
@@ -78,6 +121,10 @@ pub struct Camera {
     pub view_mat: DMat4,
     /// Projection Matrix
     pub proj_mat: DMat4,
+
+    /// The [`RenderOrigin`] the uniform was last built relative to. [`Self::view_mat`] and
+    /// [`Self::proj_mat`] are always in world space.
+    pub render_origin: DVec3,
 }
 
 /// A simple builder/struct that allows you to build a [`Camera`]
@@ -148,6 +195,7 @@ impl Camera {
             },
             view_mat,
             proj_mat,
+            render_origin: DVec3::ZERO,
             bind_group,
         };
 
@@ -170,7 +218,7 @@ impl Camera {
                 eye: DVec3::new(0.0, 1.0, 2.0),
                 target: DVec3::new(0.0, 0.0, 0.0),
                 up: DVec3::Y,
-                aspect: (graphics.window.inner_size().width / graphics.window.inner_size().height)
+                aspect: (graphics.window().inner_size().width / graphics.window().inner_size().height)
                     .into(),
                 znear: 0.1,
                 zfar: 100.0,
@@ -228,10 +276,32 @@ impl Camera {
 
     pub fn update(&mut self, graphics: Arc<SharedGraphicsContext>) {
         puffin::profile_function!();
+        self.render_origin = graphics.render_origin.get();
         self.update_view_proj();
         self.buffer.write(&graphics.queue, &self.uniform);
     }
 
+    /// Moves the render origin along with this camera, and rebuilds the uniform if it was made
+    /// relative to an older origin. Call this on the camera that is being rendered from.
+    pub fn follow_render_origin(&mut self, graphics: Arc<SharedGraphicsContext>) {
+        graphics.render_origin.follow(self.eye);
+        if self.render_origin != graphics.render_origin.get() {
+            self.update(graphics);
+        }
+    }
+
+    /// The view projection matrix in world space rather than relative to the render origin, for
+    /// geometry that is not rebased such as debug lines.
+    pub fn world_view_proj(&self) -> Mat4 {
+        (DMat4::from_cols_array_2d(&OPENGL_TO_WGPU_MATRIX) * self.proj_mat * self.view_mat).as_mat4()
+    }
+
+    /// The side planes of what the camera sees, relative to its render origin like
+    /// [`CameraUniform::view_proj`].
+    pub fn frustum(&self) -> Frustum {
+        Frustum::from_view_proj(Mat4::from_cols_array_2d(&self.uniform.view_proj))
+    }
+
     pub fn update_view_proj(&mut self) {
         puffin::profile_function!();
         let mut uniform = self.uniform;
@@ -315,10 +385,15 @@ impl CameraUniform {
     }
 
     pub fn update(&mut self, camera: &mut Camera) {
-        self.view_position = camera.eye.as_vec3().extend(1.0).to_array();
-
-        let vp = camera.build_vp();
-        let view = camera.view_mat;
+        self.view_position = (camera.eye - camera.render_origin)
+            .as_vec3()
+            .extend(1.0)
+            .to_array();
+
+        // made relative to the render origin in f64, so the f32 matrices stay precise far from zero
+        let to_world = DMat4::from_translation(camera.render_origin);
+        let vp = camera.build_vp() * to_world;
+        let view = camera.view_mat * to_world;
         let proj = camera.proj_mat;
 
         let wgpu_matrix = DMat4::from_cols_array_2d(&OPENGL_TO_WGPU_MATRIX);
@@ -329,3 +404,48 @@ impl CameraUniform {
         self.inv_view = view.inverse().as_mat4().to_cols_array_2d();
     }
 }
+
+/// The left, right, bottom and top planes of a view projection, for telling whether something can
+/// be seen.
+///
+/// Cameras use an infinite reversed depth range, so there is no far plane to test against, and
+/// the near plane culls next to nothing.
+#[derive(Debug, Clone, Copy)]
+pub struct Frustum {
+    /// Normalised so that `xyz · point + w` is the distance of a point in front of the plane.
+    planes: [Vec4; 4],
+}
+
+impl Frustum {
+    pub fn from_view_proj(view_proj: Mat4) -> Self {
+        let (x, y, w) = (view_proj.row(0), view_proj.row(1), view_proj.row(3));
+        let planes = [w + x, w - x, w + y, w - y]
+            .map(|plane| plane / plane.truncate().length().max(f32::EPSILON));
+        Self { planes }
+    }
+
+    /// Whether any part of a sphere can be seen.
+    pub fn intersects_sphere(&self, center: Vec3, radius: f32) -> bool {
+        self.planes
+            .iter()
+            .all(|plane| plane.truncate().dot(center) + plane.w >= -radius)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn frustum_culls_spheres_outside_the_view() {
+        let proj = Mat4::perspective_infinite_reverse_lh(90f32.to_radians(), 1.0, 0.1);
+        let view = Mat4::look_at_lh(Vec3::ZERO, Vec3::Z, Vec3::Y);
+        let frustum = Frustum::from_view_proj(proj * view);
+
+        assert!(frustum.intersects_sphere(Vec3::new(0.0, 0.0, 10.0), 1.0));
+        // a 90 degree view reaches 10 units to the side at 10 units away
+        assert!(frustum.intersects_sphere(Vec3::new(10.5, 0.0, 10.0), 1.0));
+        assert!(!frustum.intersects_sphere(Vec3::new(12.0, 0.0, 10.0), 1.0));
+        assert!(!frustum.intersects_sphere(Vec3::new(0.0, 0.0, -10.0), 1.0));
+    }
+}
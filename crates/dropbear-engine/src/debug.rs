@@ -516,7 +516,7 @@ impl DebugDrawPipeline {
                     mask: !0,
                     alpha_to_coverage_enabled: false,
                 },
-                cache: None,
+                cache: graphics.pipeline_cache.get(),
                 multiview_mask: None,
             });
 
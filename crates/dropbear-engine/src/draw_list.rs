@@ -0,0 +1,400 @@
+//! Sorted draw submission.
+//!
+//! Drawing a mesh needs a pipeline, its material, an animation bind group and its vertex, index
+//! and instance buffers bound first. Binding all of them for every mesh makes bind group changes
+//! most of the CPU cost of a pass once a scene has a few hundred materials, so a [`DrawList`]
+//! collects the draws of a pass, sorts them by pipeline, then material, then mesh, and only binds
+//! the state that differs from the previous draw when it is recorded.
+//!
+//! Large lists are split into chunks that are recorded into render bundles on the rayon pool and
+//! then executed in order, so recording is not limited to the render thread.
+//!
+//! That is rayon's global pool rather than the compute pool of the
+//! [`JobSystem`](dropbear_future_queue::JobSystem). The frame waits for the bundles. A compute
+//! worker runs a whole job before it looks at anything else, such as decoding a texture or
+//! parsing a glTF file, so a frame could wait behind a queue of them. The global pool only runs
+//! parallel iterators, which are split into small pieces that a worker finishes quickly.
+
+use crate::buffer::DynamicBuffer;
+use crate::graphics::InstanceRaw;
+use crate::model::{AlphaMode, Material, Mesh};
+use rayon::prelude::*;
+use std::ops::Range;
+use wgpu::util::RenderEncoder;
+
+/// Below this many draws, recording on the render thread is faster than splitting the list up.
+const PARALLEL_THRESHOLD: usize = 512;
+/// The fewest draws recorded into one bundle.
+const MIN_DRAWS_PER_BUNDLE: usize = 128;
+
+/// One instanced draw of a mesh.
+pub struct DrawCommand<'a> {
+    pub pipeline: &'a wgpu::RenderPipeline,
+    pub mesh: &'a Mesh,
+    pub material: &'a Material,
+    pub animation_bind_group: &'a wgpu::BindGroup,
+    pub instance_buffer: &'a DynamicBuffer<InstanceRaw>,
+    pub instances: Range<u32>,
+}
+
+/// How much state a [`DrawList`] had to bind when it was recorded.
+#[derive(Debug, Default, Clone, Copy)]
+pub struct DrawListStats {
+    pub draws: u32,
+    pub pipeline_changes: u32,
+    pub material_changes: u32,
+    pub mesh_changes: u32,
+}
+
+impl std::fmt::Display for DrawListStats {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(
+            f,
+            "{} draws, {} pipeline, {} material and {} mesh binds",
+            self.draws, self.pipeline_changes, self.material_changes, self.mesh_changes
+        )
+    }
+}
+
+impl DrawListStats {
+    fn merge(self, other: Self) -> Self {
+        Self {
+            draws: self.draws + other.draws,
+            pipeline_changes: self.pipeline_changes + other.pipeline_changes,
+            material_changes: self.material_changes + other.material_changes,
+            mesh_changes: self.mesh_changes + other.mesh_changes,
+        }
+    }
+}
+
+/// The attachments of the pass a [`DrawList`] is recorded into, which its bundles have to match.
+#[derive(Debug, Clone, Copy)]
+pub struct PassTargets {
+    pub color_format: wgpu::TextureFormat,
+    pub depth_format: Option<wgpu::TextureFormat>,
+    pub sample_count: u32,
+}
+
+#[derive(Default)]
+pub struct DrawList<'a> {
+    commands: Vec<DrawCommand<'a>>,
+}
+
+/// The address of a resource, which is all that is needed to tell whether it is already bound.
+fn key<T>(resource: &T) -> usize {
+    resource as *const T as usize
+}
+
+/// What a [`DrawCommand`] binds. Ordering by it groups draws by pipeline, then material, then
+/// mesh, with blended materials last.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+struct DrawKey {
+    blended: bool,
+    pipeline: usize,
+    material: usize,
+    mesh: usize,
+    animation: usize,
+    instances: usize,
+}
+
+impl DrawCommand<'_> {
+    fn key(&self) -> DrawKey {
+        DrawKey {
+            blended: self.material.alpha_mode == AlphaMode::Blend,
+            pipeline: key(self.pipeline),
+            material: key(&self.material.bind_group),
+            mesh: key(self.mesh),
+            animation: key(self.animation_bind_group),
+            instances: key(self.instance_buffer),
+        }
+    }
+}
+
+/// Which bindings of a draw differ from the draw before it.
+#[derive(Debug, Default, Clone, Copy, PartialEq)]
+struct Rebind {
+    pipeline: bool,
+    material: bool,
+    mesh: bool,
+    animation: bool,
+    instances: bool,
+}
+
+/// What is bound while a list is recorded, and what binding it took so far.
+#[derive(Default)]
+struct BindState {
+    bound: Option<DrawKey>,
+    stats: DrawListStats,
+}
+
+impl BindState {
+    /// Returns which of `next`'s bindings have to be set for it to be drawn.
+    fn draw(&mut self, next: DrawKey) -> Rebind {
+        let rebind = match self.bound {
+            Some(bound) => Rebind {
+                pipeline: bound.pipeline != next.pipeline,
+                material: bound.material != next.material,
+                mesh: bound.mesh != next.mesh,
+                animation: bound.animation != next.animation,
+                instances: bound.instances != next.instances,
+            },
+            None => Rebind {
+                pipeline: true,
+                material: true,
+                mesh: true,
+                animation: true,
+                instances: true,
+            },
+        };
+        self.bound = Some(next);
+        self.stats.draws += 1;
+        self.stats.pipeline_changes += rebind.pipeline as u32;
+        self.stats.material_changes += rebind.material as u32;
+        self.stats.mesh_changes += rebind.mesh as u32;
+        rebind
+    }
+}
+
+impl<'a> DrawList<'a> {
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self {
+            commands: Vec::with_capacity(capacity),
+        }
+    }
+
+    pub fn push(&mut self, command: DrawCommand<'a>) {
+        self.commands.push(command);
+    }
+
+    pub fn len(&self) -> usize {
+        self.commands.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.commands.is_empty()
+    }
+
+    /// Groups draws that share state. Blended materials are kept after everything else, as they
+    /// have to be drawn over what is behind them.
+    pub fn sort(&mut self) {
+        puffin::profile_function!();
+        self.commands.sort_by_key(DrawCommand::key);
+    }
+
+    /// Records every draw into `pass`, skipping the bindings that are already set.
+    pub fn record<'p>(
+        &'p self,
+        pass: &mut wgpu::RenderPass<'p>,
+        per_frame_bind_group: &'p wgpu::BindGroup,
+        environment_bind_group: &'p wgpu::BindGroup,
+    ) -> DrawListStats {
+        puffin::profile_function!();
+        record_into(
+            pass,
+            &self.commands,
+            per_frame_bind_group,
+            environment_bind_group,
+        )
+    }
+
+    /// Like [`Self::record`], but a large list is split up and recorded into render bundles on
+    /// the global rayon pool (see the [module docs](self) for why), which are then executed in
+    /// order.
+    pub fn record_parallel<'p>(
+        &'p self,
+        device: &wgpu::Device,
+        targets: PassTargets,
+        pass: &mut wgpu::RenderPass<'p>,
+        per_frame_bind_group: &'p wgpu::BindGroup,
+        environment_bind_group: &'p wgpu::BindGroup,
+    ) -> DrawListStats {
+        if self.commands.len() < PARALLEL_THRESHOLD {
+            return self.record(pass, per_frame_bind_group, environment_bind_group);
+        }
+        puffin::profile_function!();
+
+        let chunk_size = self
+            .commands
+            .len()
+            .div_ceil(rayon::current_num_threads())
+            .max(MIN_DRAWS_PER_BUNDLE);
+        let bundles: Vec<(wgpu::RenderBundle, DrawListStats)> = self
+            .commands
+            .par_chunks(chunk_size)
+            .map(|commands| {
+                puffin::profile_scope!("recording draw bundle");
+                let mut encoder =
+                    device.create_render_bundle_encoder(&wgpu::RenderBundleEncoderDescriptor {
+                        label: Some("draw list bundle"),
+                        color_formats: &[Some(targets.color_format)],
+                        depth_stencil: targets.depth_format.map(|format| {
+                            wgpu::RenderBundleDepthStencil {
+                                format,
+                                depth_read_only: false,
+                                stencil_read_only: true,
+                            }
+                        }),
+                        sample_count: targets.sample_count,
+                        ..Default::default()
+                    });
+                // bundles start without any state, so each binds its own
+                let stats = record_into(
+                    &mut encoder,
+                    commands,
+                    per_frame_bind_group,
+                    environment_bind_group,
+                );
+                let bundle = encoder.finish(&wgpu::RenderBundleDescriptor {
+                    label: Some("draw list bundle"),
+                });
+                (bundle, stats)
+            })
+            .collect();
+
+        pass.execute_bundles(bundles.iter().map(|(bundle, _)| bundle));
+        bundles
+            .iter()
+            .fold(DrawListStats::default(), |total, (_, stats)| {
+                total.merge(*stats)
+            })
+    }
+}
+
+/// Records `commands` into a render pass or bundle, skipping the bindings that are already set.
+///
+/// The per-frame and environment bind groups are the same for every draw, so they are bound once
+/// up front.
+fn record_into<'r>(
+    encoder: &mut impl RenderEncoder<'r>,
+    commands: &'r [DrawCommand<'r>],
+    per_frame_bind_group: &'r wgpu::BindGroup,
+    environment_bind_group: &'r wgpu::BindGroup,
+) -> DrawListStats {
+    if commands.is_empty() {
+        return DrawListStats::default();
+    }
+
+    encoder.set_bind_group(0, Some(per_frame_bind_group), &[]);
+    encoder.set_bind_group(3, Some(environment_bind_group), &[]);
+
+    let mut state = BindState::default();
+    for command in commands {
+        let rebind = state.draw(command.key());
+        if rebind.pipeline {
+            encoder.set_pipeline(command.pipeline);
+        }
+        if rebind.material {
+            encoder.set_bind_group(1, Some(&command.material.bind_group), &[]);
+        }
+        if rebind.animation {
+            encoder.set_bind_group(2, Some(command.animation_bind_group), &[]);
+        }
+        if rebind.mesh {
+            encoder.set_vertex_buffer(0, command.mesh.vertex_buffer.full_slice());
+            encoder.set_index_buffer(
+                command.mesh.index_buffer.full_slice(),
+                wgpu::IndexFormat::Uint32,
+            );
+        }
+        if rebind.instances {
+            // bound whole, so draws of a different number of instances can share it
+            encoder.set_vertex_buffer(1, command.instance_buffer.buffer().slice(..));
+        }
+
+        encoder.draw_indexed(0..command.mesh.num_elements, 0, command.instances.clone());
+    }
+
+    state.stats
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn draw(pipeline: usize, material: usize, mesh: usize) -> DrawKey {
+        DrawKey {
+            blended: false,
+            pipeline,
+            material,
+            mesh,
+            animation: 0,
+            instances: 0,
+        }
+    }
+
+    #[test]
+    fn keys_order_by_pipeline_then_material_then_mesh() {
+        let mut keys = vec![
+            draw(2, 1, 1),
+            DrawKey {
+                blended: true,
+                ..draw(1, 1, 1)
+            },
+            draw(1, 2, 1),
+            draw(1, 1, 2),
+            draw(1, 1, 1),
+        ];
+        keys.sort();
+        assert_eq!(
+            keys,
+            vec![
+                draw(1, 1, 1),
+                draw(1, 1, 2),
+                draw(1, 2, 1),
+                draw(2, 1, 1),
+                // blended draws go over everything else, whatever their pipeline
+                DrawKey {
+                    blended: true,
+                    ..draw(1, 1, 1)
+                },
+            ]
+        );
+    }
+
+    #[test]
+    fn stats_only_count_the_binds_that_were_not_skipped() {
+        let mut state = BindState::default();
+        let first = state.draw(draw(1, 1, 1));
+        assert!(first.pipeline && first.material && first.mesh && first.animation);
+
+        assert_eq!(state.draw(draw(1, 1, 1)), Rebind::default());
+        assert_eq!(
+            state.draw(draw(1, 1, 2)),
+            Rebind {
+                mesh: true,
+                ..Rebind::default()
+            }
+        );
+        // a new pipeline does not make the material or mesh that are bound go away
+        assert_eq!(
+            state.draw(draw(2, 1, 2)),
+            Rebind {
+                pipeline: true,
+                ..Rebind::default()
+            }
+        );
+        state.draw(draw(2, 3, 1));
+
+        let stats = state.stats;
+        assert_eq!(stats.draws, 5);
+        assert_eq!(stats.pipeline_changes, 2);
+        assert_eq!(stats.material_changes, 2);
+        assert_eq!(stats.mesh_changes, 3);
+    }
+
+    #[test]
+    fn merged_stats_add_up() {
+        let mut a = BindState::default();
+        a.draw(draw(1, 1, 1));
+        a.draw(draw(1, 2, 1));
+        let mut b = BindState::default();
+        b.draw(draw(1, 2, 1));
+
+        let total = a.stats.merge(b.stats);
+        assert_eq!(total.draws, 3);
+        // each bundle starts without any state, so binds the pipeline again
+        assert_eq!(total.pipeline_changes, 2);
+        assert_eq!(total.material_changes, 3);
+        assert_eq!(total.mesh_changes, 2);
+    }
+}
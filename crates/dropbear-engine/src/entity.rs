@@ -6,7 +6,8 @@ use crate::asset::Handle;
 use crate::model::{Material, NodeTransform};
 use crate::{
     asset::ASSET_REGISTRY,
-    graphics::{Instance, SharedGraphicsContext},
+    camera::RenderOrigin,
+    graphics::{Instance, InstanceRaw, SharedGraphicsContext},
     model::Model,
     texture::Texture,
     utils::ResourceReference,
@@ -514,6 +515,8 @@ pub struct MeshRenderer {
     handle: Handle<Model>,
     pub instance: Instance,
     previous_matrix: DMat4,
+    /// The last [`Self::instance_raw`], with the instance and origin generation it was made from.
+    raw_instance: Option<(Instance, u64, InstanceRaw)>,
     pub material_snapshot: HashMap<String, Material>,
 }
 
@@ -532,6 +535,7 @@ impl MeshRenderer {
             handle: model,
             instance: Instance::default(),
             previous_matrix: DMat4::IDENTITY,
+            raw_instance: None,
             import_scale: 1.0,
             is_selected: false,
             material_snapshot: hm,
@@ -557,6 +561,7 @@ impl MeshRenderer {
             instance: Instance::default(),
             import_scale: 1.0,
             previous_matrix: DMat4::IDENTITY,
+            raw_instance: None,
             is_selected: false,
             material_snapshot: Default::default(),
         })
@@ -573,6 +578,31 @@ impl MeshRenderer {
         }
     }
 
+    /// Draws the renderer at `position` and `rotation` instead of where its transform puts it,
+    /// until the next [`Self::update`] puts it back.
+    pub fn set_render_pose(&mut self, position: glam::DVec3, rotation: glam::DQuat) {
+        self.instance.position = position;
+        self.instance.rotation = rotation;
+        // makes the next update rebuild the instance even if the transform has not changed
+        self.previous_matrix = DMat4::NAN;
+    }
+
+    /// The instance converted for the GPU relative to the render origin. The conversion is only
+    /// redone when the instance changes or the origin moves.
+    pub fn instance_raw(&mut self, origin: &RenderOrigin) -> InstanceRaw {
+        let generation = origin.generation();
+        if let Some((instance, cached_generation, raw)) = &self.raw_instance
+            && *instance == self.instance
+            && *cached_generation == generation
+        {
+            return *raw;
+        }
+
+        let raw = self.instance.to_raw_relative(origin.get());
+        self.raw_instance = Some((self.instance.clone(), generation, raw));
+        raw
+    }
+
     pub fn set_import_scale(&mut self, scale: f32) {
         self.import_scale = scale;
     }
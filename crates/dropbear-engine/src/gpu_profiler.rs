@@ -0,0 +1,386 @@
+//! GPU timings of the render passes, through timestamp queries.
+//!
+//! Each pass that wants to be timed asks the [`GpuProfiler`] for its
+//! [`timestamp_writes`](GpuProfiler::timestamp_writes), which records the GPU clock at the start
+//! and end of the pass. At the end of the frame the queries are [resolved](GpuProfiler::resolve)
+//! into a readback buffer, and a few frames later, once the GPU has caught up, they are
+//! [collected](GpuProfiler::collect) without ever stalling on the GPU.
+//!
+//! The collected timings are reported to puffin on a "GPU" thread, next to the CPU scopes, and
+//! are available through [`GpuProfiler::latest`].
+//!
+//! Timestamp queries are an optional feature. On adapters without them the profiler does
+//! nothing and passes are simply not timed.
+
+use parking_lot::Mutex;
+use puffin::{GlobalProfiler, ScopeDetails, ScopeId, StreamInfo, ThreadInfo};
+use std::collections::HashMap;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU8, Ordering};
+use wgpu::{Buffer, Device, QuerySet, Queue, RenderPassTimestampWrites};
+
+/// How many frames can be waiting for their timings at once. When the GPU falls further behind
+/// than that, the passes of the newer frames are not timed.
+const FRAMES_IN_FLIGHT: usize = 4;
+
+/// How many passes of one frame can be timed. The model pass runs once per batch, so this is
+/// generous.
+const MAX_SCOPES: usize = 256;
+
+const QUERY_SIZE: u64 = size_of::<u64>() as u64;
+const FRAME_QUERIES: u32 = (MAX_SCOPES * 2) as u32;
+
+const MAP_PENDING: u8 = 0;
+const MAP_DONE: u8 = 1;
+const MAP_FAILED: u8 = 2;
+
+/// How long the passes with the same label took in a frame.
+#[derive(Debug, Clone, PartialEq)]
+pub struct GpuPassTiming {
+    pub label: String,
+    /// How many passes had this label, such as one model pass per batch.
+    pub count: u32,
+    pub milliseconds: f64,
+}
+
+/// The GPU timings of one frame.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct GpuFrameTimings {
+    /// In the order the passes first ran.
+    pub passes: Vec<GpuPassTiming>,
+    /// From the start of the first timed pass to the end of the last one.
+    pub total_milliseconds: f64,
+}
+
+pub struct GpuProfiler {
+    inner: Option<Inner>,
+}
+
+struct Inner {
+    query_set: QuerySet,
+    resolve_buffer: Buffer,
+    /// Nanoseconds per timestamp tick.
+    period: f64,
+    state: Mutex<ProfilerState>,
+}
+
+struct ProfilerState {
+    frames: Vec<Frame>,
+    /// The frame slot that the passes of this frame are recorded into.
+    recording: Option<usize>,
+    next: usize,
+    frame_index: u64,
+    scope_ids: HashMap<String, ScopeId>,
+    latest: Option<Arc<GpuFrameTimings>>,
+}
+
+struct Frame {
+    readback: Buffer,
+    labels: Vec<String>,
+    status: FrameStatus,
+    index: u64,
+    /// The puffin clock when the frame was resolved, which the GPU clock is lined up with.
+    resolved_ns: puffin::NanoSecond,
+}
+
+enum FrameStatus {
+    Free,
+    Recording,
+    Resolved,
+    Mapping(Arc<AtomicU8>),
+}
+
+impl GpuProfiler {
+    pub fn new(device: &Device, queue: &Queue) -> Self {
+        if !device.features().contains(wgpu::Features::TIMESTAMP_QUERY) {
+            log::info!("Timestamp queries are not supported, GPU passes will not be profiled");
+            return Self { inner: None };
+        }
+
+        let query_set = device.create_query_set(&wgpu::QuerySetDescriptor {
+            label: Some("gpu profiler query set"),
+            ty: wgpu::QueryType::Timestamp,
+            count: FRAME_QUERIES * FRAMES_IN_FLIGHT as u32,
+        });
+        let resolve_buffer = device.create_buffer(&wgpu::BufferDescriptor {
+            label: Some("gpu profiler resolve buffer"),
+            size: FRAME_QUERIES as u64 * FRAMES_IN_FLIGHT as u64 * QUERY_SIZE,
+            usage: wgpu::BufferUsages::QUERY_RESOLVE | wgpu::BufferUsages::COPY_SRC,
+            mapped_at_creation: false,
+        });
+        let frames = (0..FRAMES_IN_FLIGHT)
+            .map(|i| Frame {
+                readback: device.create_buffer(&wgpu::BufferDescriptor {
+                    label: Some(&format!("gpu profiler readback buffer {}", i)),
+                    size: FRAME_QUERIES as u64 * QUERY_SIZE,
+                    usage: wgpu::BufferUsages::MAP_READ | wgpu::BufferUsages::COPY_DST,
+                    mapped_at_creation: false,
+                }),
+                labels: Vec::with_capacity(MAX_SCOPES),
+                status: FrameStatus::Free,
+                index: 0,
+                resolved_ns: 0,
+            })
+            .collect();
+
+        Self {
+            inner: Some(Inner {
+                query_set,
+                resolve_buffer,
+                period: queue.get_timestamp_period() as f64,
+                state: Mutex::new(ProfilerState {
+                    frames,
+                    recording: None,
+                    next: 0,
+                    frame_index: 0,
+                    scope_ids: HashMap::new(),
+                    latest: None,
+                }),
+            }),
+        }
+    }
+
+    /// Whether the device supports timestamp queries.
+    pub fn is_enabled(&self) -> bool {
+        self.inner.is_some()
+    }
+
+    /// Returns the timestamp writes that time a render pass under `label`.
+    ///
+    /// Returns `None` when timestamp queries are unsupported or the GPU is too far behind, which
+    /// is also what the pass would use without profiling.
+    pub fn timestamp_writes(&self, label: &str) -> Option<RenderPassTimestampWrites<'_>> {
+        let inner = self.inner.as_ref()?;
+        let mut state = inner.state.lock();
+
+        let slot = match state.recording {
+            Some(slot) => slot,
+            None => {
+                let slot = state.next;
+                if !matches!(state.frames[slot].status, FrameStatus::Free) {
+                    return None;
+                }
+                state.frame_index += 1;
+                let frame_index = state.frame_index;
+                let frame = &mut state.frames[slot];
+                frame.status = FrameStatus::Recording;
+                frame.index = frame_index;
+                frame.labels.clear();
+                state.recording = Some(slot);
+                slot
+            }
+        };
+
+        let frame = &mut state.frames[slot];
+        if frame.labels.len() >= MAX_SCOPES {
+            return None;
+        }
+        let base = slot as u32 * FRAME_QUERIES + frame.labels.len() as u32 * 2;
+        frame.labels.push(label.to_string());
+
+        Some(RenderPassTimestampWrites {
+            query_set: &inner.query_set,
+            beginning_of_pass_write_index: Some(base),
+            end_of_pass_write_index: Some(base + 1),
+        })
+    }
+
+    /// Resolves the queries of this frame. Record into the last encoder submitted in a frame, after
+    /// every timed pass.
+    pub fn resolve(&self, encoder: &mut wgpu::CommandEncoder) {
+        let Some(inner) = &self.inner else {
+            return;
+        };
+        let mut state = inner.state.lock();
+        let Some(slot) = state.recording.take() else {
+            return;
+        };
+        state.next = (slot + 1) % FRAMES_IN_FLIGHT;
+
+        let frame = &mut state.frames[slot];
+        if frame.labels.is_empty() {
+            frame.status = FrameStatus::Free;
+            return;
+        }
+
+        let first = slot as u32 * FRAME_QUERIES;
+        let count = frame.labels.len() as u32 * 2;
+        let offset = first as u64 * QUERY_SIZE;
+        encoder.resolve_query_set(
+            &inner.query_set,
+            first..first + count,
+            &inner.resolve_buffer,
+            offset,
+        );
+        encoder.copy_buffer_to_buffer(
+            &inner.resolve_buffer,
+            offset,
+            &frame.readback,
+            0,
+            count as u64 * QUERY_SIZE,
+        );
+        frame.status = FrameStatus::Resolved;
+        frame.resolved_ns = puffin::now_ns();
+    }
+
+    /// Starts reading back the frames resolved since the last call. Call after the encoder passed
+    /// to [`Self::resolve`] was submitted.
+    pub fn after_submit(&self) {
+        let Some(inner) = &self.inner else {
+            return;
+        };
+        let mut state = inner.state.lock();
+        for frame in &mut state.frames {
+            if !matches!(frame.status, FrameStatus::Resolved) {
+                continue;
+            }
+
+            let mapped = Arc::new(AtomicU8::new(MAP_PENDING));
+            let callback_mapped = mapped.clone();
+            let size = frame.labels.len() as u64 * 2 * QUERY_SIZE;
+            frame
+                .readback
+                .slice(..size)
+                .map_async(wgpu::MapMode::Read, move |result| {
+                    let status = if result.is_ok() { MAP_DONE } else { MAP_FAILED };
+                    callback_mapped.store(status, Ordering::Release);
+                });
+            frame.status = FrameStatus::Mapping(mapped);
+        }
+    }
+
+    /// Collects the timings of every frame the GPU has finished, without waiting for the ones it
+    /// has not, and reports them to puffin. Call once per frame.
+    pub fn collect(&self, device: &Device) {
+        let Some(inner) = &self.inner else {
+            return;
+        };
+        puffin::profile_function!();
+        let _ = device.poll(wgpu::PollType::Poll);
+
+        let mut state = inner.state.lock();
+        let mut finished: Vec<usize> = state
+            .frames
+            .iter()
+            .enumerate()
+            .filter(|(_, frame)| match &frame.status {
+                FrameStatus::Mapping(mapped) => mapped.load(Ordering::Acquire) != MAP_PENDING,
+                _ => false,
+            })
+            .map(|(slot, _)| slot)
+            .collect();
+        finished.sort_by_key(|slot| state.frames[*slot].index);
+
+        for slot in finished {
+            let frame = &mut state.frames[slot];
+            let FrameStatus::Mapping(mapped) = &frame.status else {
+                continue;
+            };
+            if mapped.load(Ordering::Acquire) == MAP_FAILED {
+                log_once::warn_once!("Unable to read back GPU timestamps");
+                frame.status = FrameStatus::Free;
+                continue;
+            }
+
+            let size = frame.labels.len() as u64 * 2 * QUERY_SIZE;
+            let ticks: Vec<u64> = {
+                let view = frame.readback.slice(..size).get_mapped_range();
+                view.chunks_exact(QUERY_SIZE as usize)
+                    .map(|bytes| u64::from_le_bytes(bytes.try_into().unwrap()))
+                    .collect()
+            };
+            frame.readback.unmap();
+            frame.status = FrameStatus::Free;
+
+            let labels = std::mem::take(&mut frame.labels);
+            let resolved_ns = frame.resolved_ns;
+            let timings = inner.publish(&mut state.scope_ids, &labels, &ticks, resolved_ns);
+            state.frames[slot].labels = labels;
+            if let Some(timings) = timings {
+                state.latest = Some(Arc::new(timings));
+            }
+        }
+    }
+
+    /// The timings of the most recent frame the GPU finished.
+    pub fn latest(&self) -> Option<Arc<GpuFrameTimings>> {
+        self.inner.as_ref()?.state.lock().latest.clone()
+    }
+}
+
+impl Inner {
+    /// Turns the raw timestamps of a frame into [`GpuFrameTimings`], and reports them to puffin.
+    fn publish(
+        &self,
+        scope_ids: &mut HashMap<String, ScopeId>,
+        labels: &[String],
+        ticks: &[u64],
+        resolved_ns: puffin::NanoSecond,
+    ) -> Option<GpuFrameTimings> {
+        // a pass that was handed its timestamp writes but never began leaves zeroes behind
+        let passes: Vec<(&str, u64, u64)> = labels
+            .iter()
+            .zip(ticks.chunks_exact(2))
+            .filter(|(_, pair)| pair[0] != 0 && pair[1] >= pair[0])
+            .map(|(label, pair)| (label.as_str(), pair[0], pair[1]))
+            .collect();
+
+        let first = passes.iter().map(|(_, start, _)| *start).min()?;
+        let last = passes.iter().map(|(_, _, end)| *end).max()?;
+        let to_ns = |ticks: u64| (ticks as f64 * self.period) as i64;
+
+        let mut timings = GpuFrameTimings {
+            passes: Vec::new(),
+            total_milliseconds: to_ns(last - first) as f64 / 1_000_000.0,
+        };
+        for (label, start, end) in &passes {
+            let milliseconds = to_ns(end - start) as f64 / 1_000_000.0;
+            match timings.passes.iter_mut().find(|pass| pass.label == *label) {
+                Some(pass) => {
+                    pass.count += 1;
+                    pass.milliseconds += milliseconds;
+                }
+                None => timings.passes.push(GpuPassTiming {
+                    label: label.to_string(),
+                    count: 1,
+                    milliseconds,
+                }),
+            }
+        }
+
+        if puffin::are_scopes_on() {
+            // the GPU clock has no relation to the CPU one, so the frame is placed to end when it
+            // was resolved. That is early, but keeps the GPU lane in step with the CPU frames.
+            let origin = resolved_ns - to_ns(last - first);
+
+            let mut profiler = GlobalProfiler::lock();
+            let mut stream = puffin::Stream::default();
+            for (label, start, end) in &passes {
+                let id = *scope_ids.entry(label.to_string()).or_insert_with(|| {
+                    profiler
+                        .register_user_scopes(&[ScopeDetails::from_scope_name(label.to_string())])
+                        [0]
+                });
+                let start_ns = origin + to_ns(start - first);
+                let (offset, _) = stream.begin_scope(|| start_ns, id, "");
+                stream.end_scope(offset, origin + to_ns(end - first));
+            }
+
+            let info = StreamInfo {
+                stream,
+                num_scopes: passes.len(),
+                depth: 1,
+                range_ns: (origin, resolved_ns),
+            };
+            profiler.report_user_scopes(
+                ThreadInfo {
+                    start_time_ns: None,
+                    name: "GPU".to_string(),
+                },
+                &info.as_stream_into_ref(),
+            );
+        }
+
+        Some(timings)
+    }
+}
@@ -11,29 +11,40 @@ use std::sync::Arc;
 use wgpu::*;
 use winit::window::Window;
 
+use crate::camera::RenderOrigin;
+use crate::gpu_profiler::GpuProfiler;
 use crate::mipmap::MipMapper;
 use crate::multisampling::AntiAliasingMode;
+use crate::pipeline_cache::PipelineCache;
 use crate::pipelines::hdr::HdrPipeline;
+use crate::render_graph::TransientPool;
 
 pub const NO_TEXTURE: &[u8] = include_bytes!("../../../resources/textures/no-texture.png");
 
 pub struct SharedGraphicsContext {
     pub device: Arc<Device>,
     pub queue: Arc<Queue>,
-    pub surface: Arc<Surface<'static>>,
+    /// `None` for [headless](crate::headless) contexts.
+    pub surface: Option<Arc<Surface<'static>>>,
     pub surface_format: TextureFormat,
     pub surface_config: Arc<RwLock<SurfaceConfiguration>>,
     pub instance: Arc<wgpu::Instance>,
-    pub window: Arc<Window>,
+    /// `None` for [headless](crate::headless) contexts, see [`Self::window`].
+    pub window: Option<Arc<Window>>,
     pub viewport_texture: Arc<texture::Texture>,
     pub depth_texture: Arc<texture::Texture>,
-    pub egui_renderer: Arc<Mutex<EguiRenderer>>,
+    /// `None` for [headless](crate::headless) contexts, see [`Self::egui_renderer`].
+    pub egui_renderer: Option<Arc<Mutex<EguiRenderer>>>,
     pub texture_id: Arc<TextureId>,
     pub future_queue: Arc<FutureQueue>,
     pub mipmapper: Arc<MipMapper>,
     pub hdr: Arc<RwLock<HdrPipeline>>,
     pub antialiasing: Arc<RwLock<AntiAliasingMode>>,
     pub layouts: Arc<BindGroupLayouts>,
+    pub gpu_profiler: Arc<GpuProfiler>,
+    pub pipeline_cache: Arc<PipelineCache>,
+    pub transient_textures: Arc<Mutex<TransientPool>>,
+    pub render_origin: Arc<RenderOrigin>,
     pub debug_draw: Arc<Mutex<Option<DebugDraw>>>,
 }
 
@@ -44,24 +55,53 @@ impl SharedGraphicsContext {
             device: state.device.clone(),
             queue: state.queue.clone(),
             instance: state.instance.clone(),
-            window: state.window.clone(),
+            window: Some(state.window.clone()),
             viewport_texture: state.viewport_texture.clone(),
             depth_texture: state.depth_texture.clone(),
-            egui_renderer: state.egui_renderer.clone(),
+            egui_renderer: Some(state.egui_renderer.clone()),
             texture_id: state.texture_id.clone(),
-            surface: state.surface.clone(),
+            surface: Some(state.surface.clone()),
             surface_format: state.surface_format,
             mipmapper: state.mipmapper.clone(),
             hdr: state.hdr.clone(),
             surface_config: state.config.clone(),
             antialiasing: state.antialiasing.clone(),
             layouts: state.layouts.clone(),
+            gpu_profiler: state.gpu_profiler.clone(),
+            pipeline_cache: state.pipeline_cache.clone(),
+            transient_textures: state.transient_textures.clone(),
+            render_origin: state.render_origin.clone(),
             debug_draw: state.debug_draw.clone(),
         }
     }
+
+    /// The window this context renders to.
+    ///
+    /// # Panics
+    /// If the context is [headless](crate::headless). Only code that is never run headless, such
+    /// as input handling and the editor UI, should call this.
+    pub fn window(&self) -> &Arc<Window> {
+        self.window
+            .as_ref()
+            .expect("A headless graphics context has no window")
+    }
+
+    /// The egui renderer of the window.
+    ///
+    /// # Panics
+    /// If the context is [headless](crate::headless).
+    pub fn egui_renderer(&self) -> &Arc<Mutex<EguiRenderer>> {
+        self.egui_renderer
+            .as_ref()
+            .expect("A headless graphics context has no egui renderer")
+    }
+
+    pub fn is_headless(&self) -> bool {
+        self.window.is_none()
+    }
 }
 
-#[derive(Default, Clone)]
+#[derive(Default, Clone, PartialEq)]
 pub struct Instance {
     pub position: DVec3,
     pub rotation: DQuat,
@@ -78,8 +118,17 @@ impl Instance {
     }
 
     pub fn to_raw(&self) -> InstanceRaw {
-        let model_matrix =
-            DMat4::from_scale_rotation_translation(self.scale, self.rotation, self.position);
+        self.to_raw_relative(DVec3::ZERO)
+    }
+
+    /// Converts the instance for the GPU with its position relative to `origin`, which is
+    /// subtracted in f64 so the instance stays precise far away from the world origin.
+    pub fn to_raw_relative(&self, origin: DVec3) -> InstanceRaw {
+        let model_matrix = DMat4::from_scale_rotation_translation(
+            self.scale,
+            self.rotation,
+            self.position - origin,
+        );
         let normal_matrix = Mat3::from_mat4(model_matrix.as_mat4())
             .inverse()
             .transpose();
@@ -113,12 +162,19 @@ impl Instance {
 /// };
 /// ```
 #[repr(C)]
-#[derive(Copy, Clone, Default, bytemuck::Pod, bytemuck::Zeroable)]
+#[derive(Copy, Clone, Default, PartialEq, bytemuck::Pod, bytemuck::Zeroable)]
 pub struct InstanceRaw {
     model: [[f32; 4]; 4],
     normal: [[f32; 3]; 3],
 }
 
+impl InstanceRaw {
+    /// The model (world) matrix of this instance.
+    pub fn model_matrix(&self) -> glam::Mat4 {
+        glam::Mat4::from_cols_array_2d(&self.model)
+    }
+}
+
 impl Vertex for InstanceRaw {
     fn desc() -> VertexBufferLayout<'static> {
         VertexBufferLayout {
@@ -0,0 +1,169 @@
+//! Rendering without a window.
+//!
+//! A headless [`SharedGraphicsContext`] renders into the same offscreen viewport, depth and HDR
+//! targets as a windowed one, it just has no surface to present to and no egui renderer. It is
+//! used by the benchmarks, which need to run on CI machines without a display or a GPU (pass
+//! [`HeadlessOptions::force_fallback_adapter`] to use a software adapter such as lavapipe or
+//! WARP).
+
+use crate::BindGroupLayouts;
+use crate::camera::RenderOrigin;
+use crate::gpu_profiler::GpuProfiler;
+use crate::graphics::SharedGraphicsContext;
+use crate::mipmap::MipMapper;
+use crate::multisampling::AntiAliasingMode;
+use crate::pipeline_cache::PipelineCache;
+use crate::pipelines::hdr::HdrPipeline;
+use crate::render_graph::TransientPool;
+use crate::texture::TextureBuilder;
+use dropbear_future_queue::FutureQueue;
+use egui::TextureId;
+use parking_lot::{Mutex, RwLock};
+use std::sync::Arc;
+use wgpu::{SurfaceConfiguration, TextureFormat};
+
+/// How a headless context is created.
+#[derive(Debug, Clone)]
+pub struct HeadlessOptions {
+    pub width: u32,
+    pub height: u32,
+    /// Format of the offscreen target, which stands in for the surface format.
+    pub format: TextureFormat,
+    pub antialiasing: AntiAliasingMode,
+    /// Only accept a software adapter. If `false`, a software adapter is still used when no
+    /// hardware adapter is available.
+    pub force_fallback_adapter: bool,
+    pub backends: wgpu::Backends,
+}
+
+impl Default for HeadlessOptions {
+    fn default() -> Self {
+        Self {
+            width: 1280,
+            height: 720,
+            format: TextureFormat::Bgra8UnormSrgb,
+            antialiasing: AntiAliasingMode::None,
+            force_fallback_adapter: false,
+            // respects WGPU_BACKEND, so CI can pin the backend of the runner
+            backends: wgpu::Backends::from_env().unwrap_or_default(),
+        }
+    }
+}
+
+impl SharedGraphicsContext {
+    /// Creates a graphics context that renders offscreen, without a window or surface.
+    pub async fn headless(
+        options: HeadlessOptions,
+        future_queue: Arc<FutureQueue>,
+    ) -> anyhow::Result<Self> {
+        puffin::profile_function!();
+        let instance = wgpu::Instance::new(wgpu::InstanceDescriptor {
+            backends: options.backends,
+            flags: Default::default(),
+            memory_budget_thresholds: Default::default(),
+            backend_options: Default::default(),
+            display: None,
+        });
+
+        let adapter = match instance
+            .request_adapter(&wgpu::RequestAdapterOptions {
+                power_preference: wgpu::PowerPreference::default(),
+                compatible_surface: None,
+                force_fallback_adapter: options.force_fallback_adapter,
+            })
+            .await
+        {
+            Ok(adapter) => adapter,
+            Err(e) if !options.force_fallback_adapter => {
+                log::warn!("No hardware adapter ({}), trying a software adapter", e);
+                instance
+                    .request_adapter(&wgpu::RequestAdapterOptions {
+                        power_preference: wgpu::PowerPreference::default(),
+                        compatible_surface: None,
+                        force_fallback_adapter: true,
+                    })
+                    .await?
+            }
+            Err(e) => return Err(e.into()),
+        };
+
+        let info = adapter.get_info();
+        log::info!(
+            "Headless rendering on {} ({:?}, {})",
+            info.name,
+            info.device_type,
+            info.backend
+        );
+
+        let (device, queue) = crate::request_device(&adapter, "headless").await?;
+
+        let config = SurfaceConfiguration {
+            usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
+            format: options.format,
+            width: options.width.max(1),
+            height: options.height.max(1),
+            present_mode: wgpu::PresentMode::AutoNoVsync,
+            alpha_mode: wgpu::CompositeAlphaMode::Auto,
+            view_formats: vec![options.format.add_srgb_suffix()],
+            desired_maximum_frame_latency: 2,
+        };
+
+        let flags = adapter.get_texture_format_features(config.format).flags;
+        let antialiasing = if options.antialiasing == AntiAliasingMode::MSAA4
+            && !flags.contains(wgpu::TextureFormatFeatureFlags::MULTISAMPLE_X4)
+        {
+            log::warn!("Adapter does not support MSAA4, rendering without antialiasing");
+            AntiAliasingMode::None
+        } else {
+            options.antialiasing
+        };
+
+        let depth_texture = Arc::new(
+            TextureBuilder::new(&device)
+                .depth(&config, antialiasing)
+                .label("headless depth texture")
+                .build(),
+        );
+        let viewport_texture = Arc::new(
+            TextureBuilder::new(&device)
+                .viewport(&config)
+                .label("headless viewport texture")
+                .build(),
+        );
+
+        let mipmapper = Arc::new(MipMapper::new(&device));
+        let hdr = HdrPipeline::new(
+            &device,
+            &config,
+            config.format.add_srgb_suffix(),
+            antialiasing,
+        );
+        let layouts = BindGroupLayouts::init(&device);
+        let gpu_profiler = GpuProfiler::new(&device, &queue);
+
+        Ok(Self {
+            device: Arc::new(device),
+            queue: Arc::new(queue),
+            surface: None,
+            surface_format: config.format,
+            surface_config: Arc::new(RwLock::new(config)),
+            instance: Arc::new(instance),
+            window: None,
+            viewport_texture,
+            depth_texture,
+            egui_renderer: None,
+            texture_id: Arc::new(TextureId::default()),
+            future_queue,
+            mipmapper,
+            hdr: Arc::new(RwLock::new(hdr)),
+            antialiasing: Arc::new(RwLock::new(antialiasing)),
+            layouts: Arc::new(layouts),
+            gpu_profiler: Arc::new(gpu_profiler),
+            // benchmarks measure compilation too, so nothing is cached between runs
+            pipeline_cache: Arc::new(PipelineCache::disabled()),
+            transient_textures: Arc::new(Mutex::new(TransientPool::default())),
+            render_origin: Arc::new(RenderOrigin::default()),
+            debug_draw: Arc::new(Mutex::new(None)),
+        })
+    }
+}
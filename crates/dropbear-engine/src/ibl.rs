@@ -0,0 +1,748 @@
+//! Image based lighting for sky environments.
+//!
+//! An [`EnvironmentMaps`] holds everything the renderer needs from a sky:
+//! - the environment cubemap itself, drawn by the [`SkyPipeline`](crate::sky::SkyPipeline)
+//! - a GGX prefiltered specular cubemap, with roughness mapped linearly over its mip chain
+//! - a diffuse irradiance cubemap
+//! - the split-sum BRDF lookup table
+//!
+//! Decoding an `.hdr` and convolving it is slow, so the baked maps are cached to disk and keyed
+//! by the hash of the source file. Loading a scene with a sky that has been seen before only
+//! reads the cache back into textures.
+
+use crate::sky::{CubeTexture, HdrLoader};
+use sha2::{Digest, Sha256};
+use std::fs;
+use std::io::{BufReader, BufWriter, Read, Write};
+use std::path::{Path, PathBuf};
+use wgpu::util::DeviceExt;
+
+/// Bumped whenever the output of the bake changes, which invalidates every cached bake.
+const BAKE_VERSION: u32 = 1;
+const CACHE_MAGIC: &[u8; 8] = b"DBIBLv\0\0";
+
+/// Every baked map is stored as [`wgpu::TextureFormat::Rgba16Float`].
+const BAKE_FORMAT: wgpu::TextureFormat = wgpu::TextureFormat::Rgba16Float;
+const BYTES_PER_TEXEL: u32 = 8;
+
+pub const SPECULAR_SIZE: u32 = 256;
+/// The specular mip chain stops at 8x8, past that the faces are too small to hold a lobe.
+pub const SPECULAR_MIPS: u32 = 6;
+pub const IRRADIANCE_SIZE: u32 = 32;
+pub const BRDF_LUT_SIZE: u32 = 256;
+
+const SPECULAR_SAMPLES: u32 = 512;
+const IRRADIANCE_SAMPLES: u32 = 2048;
+/// The irradiance is read from the mip of the environment closest to this size.
+const IRRADIANCE_SOURCE_SIZE: u32 = 64;
+
+/// Returns the default directory of baked environments for an app.
+pub fn cache_dir(app_info: &app_dirs2::AppInfo) -> Option<PathBuf> {
+    app_dirs2::app_root(app_dirs2::AppDataType::UserCache, app_info)
+        .ok()
+        .map(|root| root.join("ibl"))
+}
+
+/// The baked image based lighting of a sky. See the [module docs](self) for more info.
+pub struct EnvironmentMaps {
+    pub sky: CubeTexture,
+    pub specular: CubeTexture,
+    pub irradiance: CubeTexture,
+    pub brdf_lut: wgpu::Texture,
+    pub brdf_lut_view: wgpu::TextureView,
+}
+
+impl EnvironmentMaps {
+    /// Loads the baked maps of an equirectangular `.hdr` from `cache_dir`, baking (and caching)
+    /// them if they do not exist yet.
+    ///
+    /// Passing [`None`] as the `cache_dir` always bakes.
+    pub fn load_or_bake(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        data: &[u8],
+        sky_size: u32,
+        cache_dir: Option<&Path>,
+        label: Option<&str>,
+    ) -> anyhow::Result<Self> {
+        puffin::profile_function!();
+        let cache_path = cache_dir.map(|dir| dir.join(cache_file_name(data, sky_size)));
+
+        if let Some(path) = cache_path.as_ref().filter(|p| p.exists()) {
+            match Self::load_cached(device, queue, path, label) {
+                Ok(maps) => {
+                    log::debug!("Loaded baked environment from {}", path.display());
+                    return Ok(maps);
+                }
+                Err(e) => log::warn!(
+                    "Baked environment at {} is unusable, rebaking: {}",
+                    path.display(),
+                    e
+                ),
+            }
+        }
+
+        let maps = Self::bake(device, queue, data, sky_size, label)?;
+
+        if let Some(path) = cache_path {
+            if let Err(e) = maps.store(device, queue, &path) {
+                log::warn!(
+                    "Unable to cache baked environment to {}: {}",
+                    path.display(),
+                    e
+                );
+            }
+        }
+
+        Ok(maps)
+    }
+
+    /// Converts the equirectangular `.hdr` to a cubemap and bakes its lighting, without touching
+    /// the disk cache.
+    pub fn bake(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        data: &[u8],
+        sky_size: u32,
+        label: Option<&str>,
+    ) -> anyhow::Result<Self> {
+        puffin::profile_function!();
+        let sky = HdrLoader::from_equirectangular_bytes(device, queue, data, sky_size, label)?;
+        let baker = IblBaker::new(device);
+
+        let (specular, irradiance) = Self::create_targets(device, label);
+        let (brdf_lut, brdf_lut_view) = create_brdf_lut(device);
+
+        baker.bake(device, queue, &sky, &specular, &irradiance, &brdf_lut_view);
+
+        Ok(Self {
+            sky,
+            specular,
+            irradiance,
+            brdf_lut,
+            brdf_lut_view,
+        })
+    }
+
+    /// Creates the environment bind group (group 3 of the main shader).
+    pub fn create_bind_group(
+        &self,
+        device: &wgpu::Device,
+        layout: &wgpu::BindGroupLayout,
+        label: Option<&str>,
+    ) -> wgpu::BindGroup {
+        device.create_bind_group(&wgpu::BindGroupDescriptor {
+            label,
+            layout,
+            entries: &[
+                wgpu::BindGroupEntry {
+                    binding: 0,
+                    resource: wgpu::BindingResource::TextureView(self.sky.view()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 1,
+                    resource: wgpu::BindingResource::Sampler(self.sky.sampler()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 2,
+                    resource: wgpu::BindingResource::TextureView(self.specular.view()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 3,
+                    resource: wgpu::BindingResource::TextureView(self.irradiance.view()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 4,
+                    resource: wgpu::BindingResource::TextureView(&self.brdf_lut_view),
+                },
+            ],
+        })
+    }
+
+    fn create_targets(device: &wgpu::Device, label: Option<&str>) -> (CubeTexture, CubeTexture) {
+        let usage = wgpu::TextureUsages::STORAGE_BINDING
+            | wgpu::TextureUsages::TEXTURE_BINDING
+            | wgpu::TextureUsages::COPY_SRC
+            | wgpu::TextureUsages::COPY_DST;
+        let specular = CubeTexture::create_2d(
+            device,
+            SPECULAR_SIZE,
+            SPECULAR_SIZE,
+            BAKE_FORMAT,
+            SPECULAR_MIPS,
+            usage,
+            wgpu::FilterMode::Linear,
+            label.map(|l| format!("{l} (specular)")).as_deref(),
+        );
+        let irradiance = CubeTexture::create_2d(
+            device,
+            IRRADIANCE_SIZE,
+            IRRADIANCE_SIZE,
+            BAKE_FORMAT,
+            1,
+            usage,
+            wgpu::FilterMode::Linear,
+            label.map(|l| format!("{l} (irradiance)")).as_deref(),
+        );
+        (specular, irradiance)
+    }
+
+    /// Reads a bake written by [`EnvironmentMaps::store`].
+    fn load_cached(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        path: &Path,
+        label: Option<&str>,
+    ) -> anyhow::Result<Self> {
+        puffin::profile_function!();
+        let mut reader = BufReader::new(fs::File::open(path)?);
+
+        let mut magic = [0u8; 8];
+        reader.read_exact(&mut magic)?;
+        if &magic != CACHE_MAGIC {
+            anyhow::bail!("not a baked environment");
+        }
+        let version = read_u32(&mut reader)?;
+        if version != BAKE_VERSION {
+            anyhow::bail!("baked with version {}, expected {}", version, BAKE_VERSION);
+        }
+
+        let sky_size = read_u32(&mut reader)?;
+        let sky_mips = read_u32(&mut reader)?;
+
+        let sky = CubeTexture::create_2d(
+            device,
+            sky_size,
+            sky_size,
+            BAKE_FORMAT,
+            sky_mips,
+            wgpu::TextureUsages::TEXTURE_BINDING
+                | wgpu::TextureUsages::COPY_SRC
+                | wgpu::TextureUsages::COPY_DST,
+            wgpu::FilterMode::Linear,
+            label,
+        );
+        let (specular, irradiance) = Self::create_targets(device, label);
+        let (brdf_lut, brdf_lut_view) = create_brdf_lut(device);
+
+        upload(queue, &mut reader, sky.texture())?;
+        upload(queue, &mut reader, specular.texture())?;
+        upload(queue, &mut reader, irradiance.texture())?;
+        upload(queue, &mut reader, &brdf_lut)?;
+
+        Ok(Self {
+            sky,
+            specular,
+            irradiance,
+            brdf_lut,
+            brdf_lut_view,
+        })
+    }
+
+    /// Starts reading the maps back from the GPU, and writes them to `path` from a background
+    /// thread once they arrive. Returns as soon as the copies are submitted, so a fresh bake is
+    /// usable without waiting on the readback or the disk.
+    ///
+    /// The file is written next to `path` first and then renamed over it, so a crash never
+    /// leaves a half written bake behind.
+    pub fn store(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        path: &Path,
+    ) -> anyhow::Result<()> {
+        puffin::profile_function!();
+        let textures = [
+            self.sky.texture(),
+            self.specular.texture(),
+            self.irradiance.texture(),
+            &self.brdf_lut,
+        ];
+        let readback = ReadBack::start(device, queue, &textures);
+        let sky_size = self.sky.texture().width();
+        let sky_mips = self.sky.texture().mip_level_count();
+
+        let device = device.clone();
+        let path = path.to_path_buf();
+        std::thread::Builder::new()
+            .name("ibl cache writer".into())
+            .spawn(move || {
+                let levels = readback.finish(&device);
+                if let Err(e) = levels.and_then(|l| write_cache(&path, sky_size, sky_mips, &l)) {
+                    log::warn!(
+                        "Unable to cache baked environment to {}: {}",
+                        path.display(),
+                        e
+                    );
+                }
+            })?;
+        Ok(())
+    }
+}
+
+/// Writes the levels read back by [`EnvironmentMaps::store`] in the layout read by
+/// [`EnvironmentMaps::load_cached`].
+fn write_cache(
+    path: &Path,
+    sky_size: u32,
+    sky_mips: u32,
+    levels: &[Vec<u8>],
+) -> anyhow::Result<()> {
+    puffin::profile_function!();
+    if let Some(parent) = path.parent() {
+        fs::create_dir_all(parent)?;
+    }
+
+    let temp_path = path.with_extension("tmp");
+    {
+        let mut writer = BufWriter::new(fs::File::create(&temp_path)?);
+        writer.write_all(CACHE_MAGIC)?;
+        writer.write_all(&BAKE_VERSION.to_le_bytes())?;
+        writer.write_all(&sky_size.to_le_bytes())?;
+        writer.write_all(&sky_mips.to_le_bytes())?;
+        for level in levels {
+            writer.write_all(level)?;
+        }
+        writer.flush()?;
+    }
+    fs::rename(&temp_path, path)?;
+
+    log::debug!("Cached baked environment to {}", path.display());
+    Ok(())
+}
+
+/// The compute pipelines of `shaders/ibl.wgsl`.
+pub struct IblBaker {
+    bake_layout: wgpu::BindGroupLayout,
+    lut_layout: wgpu::BindGroupLayout,
+    prefilter_pipeline: wgpu::ComputePipeline,
+    irradiance_pipeline: wgpu::ComputePipeline,
+    brdf_pipeline: wgpu::ComputePipeline,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, bytemuck::Pod, bytemuck::Zeroable)]
+struct BakeParams {
+    roughness: f32,
+    sample_count: u32,
+    source_size: f32,
+    source_lod: f32,
+}
+
+impl IblBaker {
+    pub fn new(device: &wgpu::Device) -> Self {
+        puffin::profile_function!();
+        let module = device.create_shader_module(wgpu::include_wgsl!("shaders/ibl.wgsl"));
+
+        let bake_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("IblBaker::bake_layout"),
+            entries: &[
+                wgpu::BindGroupLayoutEntry {
+                    binding: 0,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::Texture {
+                        sample_type: wgpu::TextureSampleType::Float { filterable: true },
+                        view_dimension: wgpu::TextureViewDimension::Cube,
+                        multisampled: false,
+                    },
+                    count: None,
+                },
+                wgpu::BindGroupLayoutEntry {
+                    binding: 1,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::Sampler(wgpu::SamplerBindingType::Filtering),
+                    count: None,
+                },
+                wgpu::BindGroupLayoutEntry {
+                    binding: 2,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::StorageTexture {
+                        access: wgpu::StorageTextureAccess::WriteOnly,
+                        format: BAKE_FORMAT,
+                        view_dimension: wgpu::TextureViewDimension::D2Array,
+                    },
+                    count: None,
+                },
+                wgpu::BindGroupLayoutEntry {
+                    binding: 3,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::Buffer {
+                        ty: wgpu::BufferBindingType::Uniform,
+                        has_dynamic_offset: false,
+                        min_binding_size: None,
+                    },
+                    count: None,
+                },
+            ],
+        });
+
+        let lut_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("IblBaker::lut_layout"),
+            entries: &[wgpu::BindGroupLayoutEntry {
+                binding: 0,
+                visibility: wgpu::ShaderStages::COMPUTE,
+                ty: wgpu::BindingType::StorageTexture {
+                    access: wgpu::StorageTextureAccess::WriteOnly,
+                    format: BAKE_FORMAT,
+                    view_dimension: wgpu::TextureViewDimension::D2,
+                },
+                count: None,
+            }],
+        });
+
+        let bake_pipeline_layout = device.create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
+            label: Some("IblBaker::bake_pipeline_layout"),
+            bind_group_layouts: &[Some(&bake_layout)],
+            immediate_size: 0,
+        });
+        let lut_pipeline_layout = device.create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
+            label: Some("IblBaker::lut_pipeline_layout"),
+            bind_group_layouts: &[None, Some(&lut_layout)],
+            immediate_size: 0,
+        });
+
+        let create = |label: &str, layout: &wgpu::PipelineLayout, entry_point: &str| {
+            device.create_compute_pipeline(&wgpu::ComputePipelineDescriptor {
+                label: Some(label),
+                layout: Some(layout),
+                module: &module,
+                entry_point: Some(entry_point),
+                compilation_options: Default::default(),
+                cache: None,
+            })
+        };
+
+        Self {
+            prefilter_pipeline: create(
+                "ibl specular prefilter",
+                &bake_pipeline_layout,
+                "prefilter_specular",
+            ),
+            irradiance_pipeline: create(
+                "ibl irradiance convolution",
+                &bake_pipeline_layout,
+                "convolve_irradiance",
+            ),
+            brdf_pipeline: create("ibl brdf lut", &lut_pipeline_layout, "integrate_brdf"),
+            bake_layout,
+            lut_layout,
+        }
+    }
+
+    /// Records and submits every bake pass in a single submission.
+    pub fn bake(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        environment: &CubeTexture,
+        specular: &CubeTexture,
+        irradiance: &CubeTexture,
+        brdf_lut: &wgpu::TextureView,
+    ) {
+        puffin::profile_function!();
+        let source_size = environment.texture().width() as f32;
+        let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("ibl bake encoder"),
+        });
+
+        let mut passes = Vec::with_capacity(SPECULAR_MIPS as usize + 1);
+        for level in 0..SPECULAR_MIPS {
+            let params = BakeParams {
+                roughness: level as f32 / (SPECULAR_MIPS - 1) as f32,
+                sample_count: SPECULAR_SAMPLES,
+                source_size,
+                source_lod: 0.0,
+            };
+            let size = (SPECULAR_SIZE >> level).max(1);
+            passes.push((
+                &self.prefilter_pipeline,
+                self.bake_bind_group(device, environment, specular.texture(), level, params),
+                size,
+            ));
+        }
+
+        let params = BakeParams {
+            roughness: 1.0,
+            sample_count: IRRADIANCE_SAMPLES,
+            source_size,
+            source_lod: (source_size / IRRADIANCE_SOURCE_SIZE as f32)
+                .log2()
+                .max(0.0),
+        };
+        passes.push((
+            &self.irradiance_pipeline,
+            self.bake_bind_group(device, environment, irradiance.texture(), 0, params),
+            IRRADIANCE_SIZE,
+        ));
+
+        let lut_bind_group = device.create_bind_group(&wgpu::BindGroupDescriptor {
+            label: Some("ibl brdf lut bind group"),
+            layout: &self.lut_layout,
+            entries: &[wgpu::BindGroupEntry {
+                binding: 0,
+                resource: wgpu::BindingResource::TextureView(brdf_lut),
+            }],
+        });
+
+        {
+            let mut pass = encoder.begin_compute_pass(&wgpu::ComputePassDescriptor {
+                label: Some("ibl bake pass"),
+                timestamp_writes: None,
+            });
+
+            for (pipeline, bind_group, size) in &passes {
+                let workgroups = (size + 7) / 8;
+                pass.set_pipeline(pipeline);
+                pass.set_bind_group(0, bind_group, &[]);
+                pass.dispatch_workgroups(workgroups, workgroups, 6);
+            }
+
+            let workgroups = (BRDF_LUT_SIZE + 7) / 8;
+            pass.set_pipeline(&self.brdf_pipeline);
+            pass.set_bind_group(1, &lut_bind_group, &[]);
+            pass.dispatch_workgroups(workgroups, workgroups, 1);
+        }
+
+        queue.submit([encoder.finish()]);
+    }
+
+    fn bake_bind_group(
+        &self,
+        device: &wgpu::Device,
+        environment: &CubeTexture,
+        target: &wgpu::Texture,
+        level: u32,
+        params: BakeParams,
+    ) -> wgpu::BindGroup {
+        let target_view = target.create_view(&wgpu::TextureViewDescriptor {
+            label: Some("ibl bake target view"),
+            dimension: Some(wgpu::TextureViewDimension::D2Array),
+            base_mip_level: level,
+            mip_level_count: Some(1),
+            base_array_layer: 0,
+            array_layer_count: Some(6),
+            ..Default::default()
+        });
+        let params = device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
+            label: Some("ibl bake params"),
+            contents: bytemuck::bytes_of(&params),
+            usage: wgpu::BufferUsages::UNIFORM,
+        });
+
+        device.create_bind_group(&wgpu::BindGroupDescriptor {
+            label: Some("ibl bake bind group"),
+            layout: &self.bake_layout,
+            entries: &[
+                wgpu::BindGroupEntry {
+                    binding: 0,
+                    resource: wgpu::BindingResource::TextureView(environment.view()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 1,
+                    resource: wgpu::BindingResource::Sampler(environment.sampler()),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 2,
+                    resource: wgpu::BindingResource::TextureView(&target_view),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 3,
+                    resource: params.as_entire_binding(),
+                },
+            ],
+        })
+    }
+}
+
+/// The cache file of an `.hdr`, keyed by its content and the size of the sky it is baked to.
+fn cache_file_name(data: &[u8], sky_size: u32) -> String {
+    let digest = Sha256::digest(data);
+    let hash: String = digest[..16].iter().map(|b| format!("{b:02x}")).collect();
+    format!("{hash}-{sky_size}.ibl")
+}
+
+fn create_brdf_lut(device: &wgpu::Device) -> (wgpu::Texture, wgpu::TextureView) {
+    let texture = device.create_texture(&wgpu::TextureDescriptor {
+        label: Some("ibl brdf lut"),
+        size: wgpu::Extent3d {
+            width: BRDF_LUT_SIZE,
+            height: BRDF_LUT_SIZE,
+            depth_or_array_layers: 1,
+        },
+        mip_level_count: 1,
+        sample_count: 1,
+        dimension: wgpu::TextureDimension::D2,
+        format: BAKE_FORMAT,
+        usage: wgpu::TextureUsages::STORAGE_BINDING
+            | wgpu::TextureUsages::TEXTURE_BINDING
+            | wgpu::TextureUsages::COPY_SRC
+            | wgpu::TextureUsages::COPY_DST,
+        view_formats: &[],
+    });
+    let view = texture.create_view(&Default::default());
+    (texture, view)
+}
+
+fn mip_extent(texture: &wgpu::Texture, level: u32) -> wgpu::Extent3d {
+    wgpu::Extent3d {
+        width: (texture.width() >> level).max(1),
+        height: (texture.height() >> level).max(1),
+        depth_or_array_layers: texture.depth_or_array_layers(),
+    }
+}
+
+/// Copies of every mip level of some [`BAKE_FORMAT`] textures, on their way to the CPU.
+struct ReadBack {
+    /// A buffer per level, with the unpadded and padded length of its rows.
+    levels: Vec<(wgpu::Buffer, u32, u32)>,
+    mapped: std::sync::mpsc::Receiver<Result<(), wgpu::BufferAsyncError>>,
+}
+
+impl ReadBack {
+    /// Submits the copies and asks for the buffers to be mapped, without waiting for either.
+    fn start(device: &wgpu::Device, queue: &wgpu::Queue, textures: &[&wgpu::Texture]) -> Self {
+        puffin::profile_function!();
+        let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("ibl read back encoder"),
+        });
+
+        let mut levels = Vec::new();
+        for texture in textures {
+            for level in 0..texture.mip_level_count() {
+                let extent = mip_extent(texture, level);
+                let unpadded = extent.width * BYTES_PER_TEXEL;
+                let padded = unpadded.div_ceil(wgpu::COPY_BYTES_PER_ROW_ALIGNMENT)
+                    * wgpu::COPY_BYTES_PER_ROW_ALIGNMENT;
+
+                let buffer = device.create_buffer(&wgpu::BufferDescriptor {
+                    label: Some("ibl read back buffer"),
+                    size: (padded * extent.height * extent.depth_or_array_layers) as u64,
+                    usage: wgpu::BufferUsages::COPY_DST | wgpu::BufferUsages::MAP_READ,
+                    mapped_at_creation: false,
+                });
+
+                encoder.copy_texture_to_buffer(
+                    wgpu::TexelCopyTextureInfo {
+                        texture,
+                        mip_level: level,
+                        origin: wgpu::Origin3d::ZERO,
+                        aspect: wgpu::TextureAspect::All,
+                    },
+                    wgpu::TexelCopyBufferInfo {
+                        buffer: &buffer,
+                        layout: wgpu::TexelCopyBufferLayout {
+                            offset: 0,
+                            bytes_per_row: Some(padded),
+                            rows_per_image: Some(extent.height),
+                        },
+                    },
+                    extent,
+                );
+
+                levels.push((buffer, unpadded, padded));
+            }
+        }
+
+        queue.submit([encoder.finish()]);
+
+        let (sender, mapped) = std::sync::mpsc::channel();
+        for (buffer, _, _) in &levels {
+            let sender = sender.clone();
+            buffer
+                .slice(..)
+                .map_async(wgpu::MapMode::Read, move |result| {
+                    let _ = sender.send(result);
+                });
+        }
+
+        Self { levels, mapped }
+    }
+
+    /// Waits for the copies and returns every level in order, with its rows tightly packed.
+    /// Blocks until the GPU is done, so call it off the main thread.
+    fn finish(self, device: &wgpu::Device) -> anyhow::Result<Vec<Vec<u8>>> {
+        puffin::profile_function!();
+        device.poll(wgpu::PollType::wait_indefinitely())?;
+        for _ in 0..self.levels.len() {
+            self.mapped.recv()??;
+        }
+
+        let levels = self
+            .levels
+            .into_iter()
+            .map(|(buffer, unpadded, padded)| {
+                let level = unpad_rows(&buffer.slice(..).get_mapped_range(), unpadded, padded);
+                buffer.unmap();
+                level
+            })
+            .collect();
+        Ok(levels)
+    }
+}
+
+/// Strips the row padding that texture to buffer copies need.
+fn unpad_rows(mapped: &[u8], unpadded: u32, padded: u32) -> Vec<u8> {
+    mapped
+        .chunks_exact(padded as usize)
+        .flat_map(|row| &row[..unpadded as usize])
+        .copied()
+        .collect()
+}
+
+/// Reads every mip level of `texture` (in the layout written by [`ReadBack`]) and uploads it.
+fn upload(
+    queue: &wgpu::Queue,
+    reader: &mut impl Read,
+    texture: &wgpu::Texture,
+) -> anyhow::Result<()> {
+    for level in 0..texture.mip_level_count() {
+        let extent = mip_extent(texture, level);
+        let bytes_per_row = extent.width * BYTES_PER_TEXEL;
+        let mut pixels =
+            vec![0u8; (bytes_per_row * extent.height * extent.depth_or_array_layers) as usize];
+        reader.read_exact(&mut pixels)?;
+
+        queue.write_texture(
+            wgpu::TexelCopyTextureInfo {
+                texture,
+                mip_level: level,
+                origin: wgpu::Origin3d::ZERO,
+                aspect: wgpu::TextureAspect::All,
+            },
+            &pixels,
+            wgpu::TexelCopyBufferLayout {
+                offset: 0,
+                bytes_per_row: Some(bytes_per_row),
+                rows_per_image: Some(extent.height),
+            },
+            extent,
+        );
+    }
+    Ok(())
+}
+
+fn read_u32(reader: &mut impl Read) -> std::io::Result<u32> {
+    let mut bytes = [0u8; 4];
+    reader.read_exact(&mut bytes)?;
+    Ok(u32::from_le_bytes(bytes))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cache_key_depends_on_content_and_size() {
+        let a = cache_file_name(b"sky a", 1080);
+        assert_eq!(a, cache_file_name(b"sky a", 1080));
+        assert_ne!(a, cache_file_name(b"sky b", 1080));
+        assert_ne!(a, cache_file_name(b"sky a", 512));
+    }
+
+    #[test]
+    fn unpadding_keeps_only_the_texels_of_each_row() {
+        let padded = [1, 2, 0, 0, 3, 4, 0, 0, 5, 6, 0, 0];
+        assert_eq!(unpad_rows(&padded, 2, 4), [1, 2, 3, 4, 5, 6]);
+        assert_eq!(unpad_rows(&padded[..4], 4, 4), [1, 2, 0, 0]);
+    }
+}
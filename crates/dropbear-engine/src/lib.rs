@@ -1,28 +1,37 @@
 pub mod animation;
 pub mod asset;
 pub mod attenuation;
+pub mod audio;
 pub mod billboarding;
 pub mod bind_groups;
 pub mod buffer;
 pub mod camera;
 pub mod colour;
 pub mod debug;
+pub mod draw_list;
 pub mod egui_renderer;
 pub mod entity;
 pub mod features;
+pub mod gpu_profiler;
 pub mod graphics;
+pub mod headless;
+pub mod ibl;
 pub mod input;
 pub mod lighting;
 pub mod mipmap;
 pub mod model;
 pub mod multisampling;
 pub mod panic;
+pub mod pipeline_cache;
 pub mod pipelines;
 pub mod procedural;
+pub mod render_graph;
 pub mod resources;
 pub mod scene;
 pub mod shader;
+pub mod shadows;
 pub mod sky;
+pub mod streaming;
 pub mod texture;
 pub mod utils;
 
@@ -35,6 +44,8 @@ features! {
 pub static WGPU_BACKEND: OnceLock<String> = OnceLock::new();
 pub const PHYSICS_STEP_RATE: u32 = 120;
 const MAX_PHYSICS_STEPS_PER_FRAME: usize = 4;
+/// The amount of time each frame is allowed to spend running [`FutureQueue`] completion callbacks.
+const COMPLETION_BUDGET: Duration = Duration::from_millis(2);
 
 use app_dirs2::{AppDataType, AppInfo};
 use bytemuck::Contiguous;
@@ -50,6 +61,7 @@ use parking_lot::{Mutex, RwLock};
 use spin_sleep::SpinSleeper;
 use std::collections::HashMap;
 use std::fs::OpenOptions;
+use std::path::Path;
 use std::rc::Rc;
 use std::sync::OnceLock;
 use std::{
@@ -71,8 +83,12 @@ use winit::{
     window::Window,
 };
 
+use crate::camera::RenderOrigin;
 use crate::debug::DebugDraw;
 use crate::egui_renderer::EguiRenderer;
+use crate::gpu_profiler::GpuProfiler;
+use crate::pipeline_cache::PipelineCache;
+use crate::render_graph::TransientPool;
 use crate::graphics::{CommandEncoder, SharedGraphicsContext};
 use crate::mipmap::MipMapper;
 use crate::texture::{Texture, TextureBuilder};
@@ -92,7 +108,6 @@ pub struct BindGroupLayouts {
     pub material_bind_layout: wgpu::BindGroupLayout,
     pub animation_layout: wgpu::BindGroupLayout,
     pub environment_layout: wgpu::BindGroupLayout,
-    pub light_cube_layout: wgpu::BindGroupLayout,
 }
 
 impl BindGroupLayouts {
@@ -148,6 +163,46 @@ impl BindGroupLayouts {
                     },
                     count: None,
                 },
+                // s_shadows
+                BindGroupLayoutEntry {
+                    binding: 3,
+                    visibility: ShaderStages::FRAGMENT,
+                    ty: BindingType::Buffer {
+                        ty: BufferBindingType::Storage { read_only: true },
+                        has_dynamic_offset: false,
+                        min_binding_size: None,
+                    },
+                    count: None,
+                },
+                // t_shadow_cascades
+                BindGroupLayoutEntry {
+                    binding: 4,
+                    visibility: ShaderStages::FRAGMENT,
+                    ty: BindingType::Texture {
+                        multisampled: false,
+                        view_dimension: wgpu::TextureViewDimension::D2Array,
+                        sample_type: wgpu::TextureSampleType::Depth,
+                    },
+                    count: None,
+                },
+                // t_shadow_atlas
+                BindGroupLayoutEntry {
+                    binding: 5,
+                    visibility: ShaderStages::FRAGMENT,
+                    ty: BindingType::Texture {
+                        multisampled: false,
+                        view_dimension: wgpu::TextureViewDimension::D2,
+                        sample_type: wgpu::TextureSampleType::Depth,
+                    },
+                    count: None,
+                },
+                // s_shadow
+                BindGroupLayoutEntry {
+                    binding: 6,
+                    visibility: ShaderStages::FRAGMENT,
+                    ty: BindingType::Sampler(wgpu::SamplerBindingType::Comparison),
+                    count: None,
+                },
             ],
         });
 
@@ -329,37 +384,82 @@ impl BindGroupLayouts {
                         ty: wgpu::BindingType::Sampler(wgpu::SamplerBindingType::Filtering),
                         count: None,
                     },
+                    // prefiltered specular
+                    wgpu::BindGroupLayoutEntry {
+                        binding: 2,
+                        visibility: wgpu::ShaderStages::FRAGMENT,
+                        ty: wgpu::BindingType::Texture {
+                            sample_type: wgpu::TextureSampleType::Float { filterable: true },
+                            view_dimension: wgpu::TextureViewDimension::Cube,
+                            multisampled: false,
+                        },
+                        count: None,
+                    },
+                    // irradiance
+                    wgpu::BindGroupLayoutEntry {
+                        binding: 3,
+                        visibility: wgpu::ShaderStages::FRAGMENT,
+                        ty: wgpu::BindingType::Texture {
+                            sample_type: wgpu::TextureSampleType::Float { filterable: true },
+                            view_dimension: wgpu::TextureViewDimension::Cube,
+                            multisampled: false,
+                        },
+                        count: None,
+                    },
+                    // brdf lut
+                    wgpu::BindGroupLayoutEntry {
+                        binding: 4,
+                        visibility: wgpu::ShaderStages::FRAGMENT,
+                        ty: wgpu::BindingType::Texture {
+                            sample_type: wgpu::TextureSampleType::Float { filterable: true },
+                            view_dimension: wgpu::TextureViewDimension::D2,
+                            multisampled: false,
+                        },
+                        count: None,
+                    },
                 ],
             });
 
-        let light_cube_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
-            label: Some("light cube light bind group layout"),
-            entries: &[
-                // u_light
-                wgpu::BindGroupLayoutEntry {
-                    binding: 0,
-                    visibility: wgpu::ShaderStages::VERTEX,
-                    ty: wgpu::BindingType::Buffer {
-                        ty: wgpu::BufferBindingType::Uniform,
-                        has_dynamic_offset: false,
-                        min_binding_size: None,
-                    },
-                    count: None,
-                },
-            ],
-        });
-
         Self {
             camera_bind_group_layout,
             per_frame_layout,
             material_bind_layout,
             animation_layout,
             environment_layout,
-            light_cube_layout,
         }
     }
 }
 
+/// Requests the device every [`SharedGraphicsContext`] is built on, windowed or
+/// [headless](crate::headless).
+pub(crate) async fn request_device(
+    adapter: &wgpu::Adapter,
+    label: &str,
+) -> anyhow::Result<(Device, Queue)> {
+    let limits = wgpu::Limits {
+        max_bind_groups: 8,
+        ..wgpu::Limits::defaults()
+    };
+
+    let supported_features = adapter.features();
+    // pipeline caches are native only, see [`pipeline_cache`]
+    let features = supported_features
+        & (wgpu::Features::all_webgpu_mask() | wgpu::Features::PIPELINE_CACHE);
+
+    let (device, queue) = adapter
+        .request_device(&wgpu::DeviceDescriptor {
+            label: Some(format!("{} graphics device", label).as_str()),
+            required_features: features,
+            required_limits: limits,
+            experimental_features: ExperimentalFeatures::default(),
+            memory_hints: Default::default(),
+            trace: wgpu::Trace::Off,
+        })
+        .await?;
+
+    Ok((device, queue))
+}
+
 /// The backend information, such as the device, queue, config, surface, renderer, window and more.
 pub struct State {
     // keep top for drop order
@@ -381,6 +481,10 @@ pub struct State {
     pub hdr: Arc<RwLock<HdrPipeline>>,
     pub antialiasing: Arc<RwLock<AntiAliasingMode>>,
     pub layouts: Arc<BindGroupLayouts>,
+    pub gpu_profiler: Arc<GpuProfiler>,
+    pub pipeline_cache: Arc<PipelineCache>,
+    pub transient_textures: Arc<Mutex<TransientPool>>,
+    pub render_origin: Arc<RenderOrigin>,
 
     physics_accumulator: Duration,
 
@@ -396,6 +500,7 @@ impl State {
         window: Arc<Window>,
         instance: Arc<Instance>,
         future_queue: Arc<FutureQueue>,
+        pipeline_cache_dir: Option<&Path>,
     ) -> anyhow::Result<Self> {
         let title = window.title();
 
@@ -415,24 +520,7 @@ impl State {
             })
             .await?;
 
-        let limits = wgpu::Limits {
-            max_bind_groups: 8,
-            ..wgpu::Limits::defaults()
-        };
-
-        let supported_features = adapter.features();
-        let features = supported_features & wgpu::Features::all_webgpu_mask();
-
-        let (device, queue) = adapter
-            .request_device(&wgpu::DeviceDescriptor {
-                label: Some(format!("{} graphics device", title).as_str()),
-                required_features: features,
-                required_limits: limits,
-                experimental_features: ExperimentalFeatures::default(),
-                memory_hints: Default::default(),
-                trace: wgpu::Trace::Off,
-            })
-            .await?;
+        let (device, queue) = request_device(&adapter, &title).await?;
 
         let supports_storage_resources = adapter
             .get_downlevel_capabilities()
@@ -569,6 +657,12 @@ Hardware:
         )));
 
         let layouts = BindGroupLayouts::init(&device);
+        let gpu_profiler = Arc::new(GpuProfiler::new(&device, &queue));
+        let pipeline_cache = Arc::new(PipelineCache::new(
+            &device,
+            &adapter.get_info(),
+            pipeline_cache_dir,
+        ));
 
         let result = Self {
             surface: Arc::new(surface),
@@ -590,6 +684,10 @@ Hardware:
             antialiasing: Arc::new(RwLock::new(antialiasing)),
             hdr,
             layouts: Arc::new(layouts),
+            gpu_profiler,
+            pipeline_cache,
+            transient_textures: Arc::new(Mutex::new(TransientPool::default())),
+            render_origin: Arc::new(RenderOrigin::default()),
             debug_draw: Arc::new(Mutex::new(None)),
         };
 
@@ -713,6 +811,9 @@ Hardware:
 
         let config = self.config.read().clone();
 
+        // timings of frames the GPU finished since the last one, never waits on the GPU
+        self.gpu_profiler.collect(&self.device);
+
         let output = match self.surface.get_current_texture() {
             wgpu::CurrentSurfaceTexture::Success(surface_texture) => surface_texture,
             wgpu::CurrentSurfaceTexture::Suboptimal(surface_texture) => {
@@ -803,6 +904,11 @@ Hardware:
                     physics_accumulator = physics_accumulator.min(physics_dt);
                 }
 
+                // whatever is left over is how far this frame is towards the next step
+                scene_manager.set_physics_alpha(
+                    (physics_accumulator.as_secs_f32() / physics_dt.as_secs_f32()).min(1.0),
+                );
+
                 let commands = scene_manager.update(previous_dt, graphics.clone(), event_loop, ui);
                 scene_manager.render(graphics.clone(), ui);
                 commands
@@ -822,11 +928,11 @@ Hardware:
 
             {
                 let hdr = self.hdr.read();
-                hdr.process(&mut encoder, &self.viewport_texture.view);
+                hdr.process(&mut encoder, &self.viewport_texture.view, None);
             }
         });
 
-        let encoder = self.egui_renderer.lock().process_output(
+        let mut encoder = self.egui_renderer.lock().process_output(
             full_output,
             &self.device,
             &self.queue,
@@ -834,6 +940,8 @@ Hardware:
             &view,
             screen_descriptor,
         );
+        // the scenes submitted their passes already, so this is the last encoder of the frame
+        self.gpu_profiler.resolve(&mut encoder);
 
         let command_buffer = encoder.finish();
 
@@ -846,6 +954,7 @@ Hardware:
                 return Err(anyhow::anyhow!("Command buffer submission failed"));
             }
         }
+        self.gpu_profiler.after_submit();
 
         match std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
             output.present();
@@ -865,6 +974,10 @@ Hardware:
 
         let _ = self.device.poll(wgpu::PollType::Poll);
 
+        if let Err(e) = self.pipeline_cache.save() {
+            log::warn!("Unable to save pipeline cache: {}", e);
+        }
+
         drop(self.egui_renderer);
 
         drop(self.depth_texture);
@@ -1135,7 +1248,6 @@ impl DropbearWindowBuilder {
 
 /// A struct storing the information about the application/game that is using the engine.
 pub struct App {
-    #[allow(dead_code)]
     app_data: AppInfo,
     /// The input manager, manages any inputs and their actions
     input_manager: input::Manager,
@@ -1204,7 +1316,8 @@ impl App {
             target_fps: u32::MAX, // assume max,
             // default settings for now
             gilrs: GilrsBuilder::new().build().unwrap(),
-            future_queue: future_queue.unwrap_or_else(|| Arc::new(FutureQueue::new())),
+            future_queue: future_queue
+                .unwrap_or_else(|| Arc::new(FutureQueue::with_job_system_or_fallback())),
             delta_position: None,
             instance,
             windows: Default::default(),
@@ -1238,10 +1351,12 @@ impl App {
 
         let window_id = window.id();
 
+        let pipeline_cache_dir = pipeline_cache::cache_dir(&self.app_data);
         let mut win_state = match pollster::block_on(State::new(
             window,
             self.instance.clone(),
             self.future_queue.clone(),
+            pipeline_cache_dir.as_deref(),
         )) {
             Ok(v) => v,
             Err(e) => {
@@ -1386,6 +1501,11 @@ impl ApplicationHandler for App {
 
                     puffin::GlobalProfiler::lock().new_frame();
 
+                    {
+                        puffin::profile_scope!("future queue completions");
+                        self.future_queue.poll_completions(COMPLETION_BUDGET);
+                    }
+
                     let frame_start = Instant::now();
 
                     let active_handlers = state.scene_manager.get_active_input_handlers();
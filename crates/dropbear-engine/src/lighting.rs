@@ -1,12 +1,8 @@
-use crate::asset::{ASSET_REGISTRY, Handle};
 use crate::attenuation::{Attenuation, RANGE_50};
-use crate::buffer::{DynamicBuffer, UniformBuffer, WritableBuffer};
+use crate::entity::Transform;
 use crate::graphics::SharedGraphicsContext;
-use crate::pipelines::light_cube::InstanceInput;
-use crate::procedural::ProcedurallyGeneratedObject;
-use crate::{entity::Transform, model::Model};
 use dropbear_utils::Dirty;
-use glam::{DMat4, DQuat, DVec3};
+use glam::{DQuat, DVec3};
 use std::fmt::{Display, Formatter};
 use std::sync::Arc;
 
@@ -26,6 +22,14 @@ pub struct LightUniform {
     pub linear: f32,
     pub quadratic: f32,
     pub cutoff: f32,
+    /// Where the shadow map of this light lives, as assigned by the
+    /// [`ShadowRenderer`](crate::shadows::ShadowRenderer).
+    pub shadow: [i32; 4],
+    /// How far a point or spot light reaches. The shader skips fragments further away.
+    pub range: f32,
+    /// 0 if the light is off (or its slot in the light buffer is empty).
+    pub enabled: u32,
+    pub _padding: [u32; 2],
 }
 
 fn dvec3_to_uniform_array(vec: DVec3) -> [f32; 4] {
@@ -61,6 +65,10 @@ impl Default for LightUniform {
             linear: 0.0,
             quadratic: 0.0,
             cutoff: f32::cos(12.5_f32.to_radians()),
+            shadow: [0; 4],
+            range: 0.0,
+            enabled: 0,
+            _padding: [0; 2],
         }
     }
 }
@@ -268,20 +276,22 @@ impl LightComponent {
     }
 }
 
+/// A light in the world.
+///
+/// Lights own no GPU resources. The [`LightCubePipeline`] packs every light into one storage
+/// buffer, and draws all of their cubes in one call.
+///
+/// [`LightCubePipeline`]: crate::pipelines::light_cube::LightCubePipeline
 #[derive(Clone)]
 pub struct Light {
     pub uniform: Dirty<LightUniform>,
-    pub cube_model: Handle<Model>,
     pub label: String,
-    pub buffer: UniformBuffer<LightUniform>,
-    pub bind_group: wgpu::BindGroup,
-    pub instance_buffer: DynamicBuffer<InstanceInput>,
     pub component: LightComponent,
 }
 
 impl Light {
     pub async fn new(
-        graphics: Arc<SharedGraphicsContext>,
+        _graphics: Arc<SharedGraphicsContext>,
         light: LightComponent,
         label: Option<&str>,
     ) -> Self {
@@ -298,58 +308,19 @@ impl Light {
             linear: light.attenuation.linear,
             quadratic: light.attenuation.quadratic,
             cutoff: f32::cos(light.cutoff_angle.to_radians()),
+            shadow: [0; 4],
+            range: light.attenuation.range,
+            enabled: light.enabled as u32,
+            _padding: [0; 2],
         });
 
-        log::trace!("Created new light uniform");
-
-        let cube_model = ProcedurallyGeneratedObject::cuboid(DVec3::ONE).build_model(
-            graphics.clone(),
-            None,
-            Some("light cube"),
-            ASSET_REGISTRY.clone(),
-        );
-
         let label_str = label.unwrap_or("Light").to_string();
-
-        let buffer = UniformBuffer::new(&graphics.device, &label_str);
-        let bind_group = graphics
-            .device
-            .create_bind_group(&wgpu::BindGroupDescriptor {
-                label: Some(&format!("{} light bind group", label_str)),
-                layout: &graphics.layouts.light_cube_layout,
-                entries: &[wgpu::BindGroupEntry {
-                    binding: 0,
-                    resource: buffer.buffer().as_entire_binding(),
-                }],
-            });
-
-        let transform = light.to_transform();
-        let instance: InstanceInput = DMat4::from_scale_rotation_translation(
-            transform.scale,
-            transform.rotation,
-            transform.position,
-        )
-        .into();
-
-        let mut instance_buffer = DynamicBuffer::new(
-            &graphics.device,
-            1,
-            wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST,
-            "Light Instance Buffer",
-        );
-
-        instance_buffer.write(&graphics.device, &graphics.queue, &[instance]);
-
         log::debug!("Created new light [{}]", label_str);
 
         Self {
             uniform,
-            cube_model,
             label: label_str,
-            buffer,
-            bind_group,
-            instance_buffer,
-            component: light.clone(),
+            component: light,
         }
     }
 
@@ -358,7 +329,8 @@ impl Light {
 
         let light = &mut self.component;
 
-        self.uniform.position = dvec3_to_uniform_array(light.position);
+        self.uniform.position =
+            dvec3_to_uniform_array(light.position - graphics.render_origin.get());
 
         self.uniform.direction =
             dvec3_direction_to_uniform_array(light.direction, light.outer_cutoff_angle);
@@ -370,10 +342,8 @@ impl Light {
         self.uniform.quadratic = light.attenuation.quadratic;
 
         self.uniform.cutoff = f32::cos(light.cutoff_angle.to_radians());
-
-        if self.uniform.is_dirty() {
-            self.buffer.write(&graphics.queue, &self.uniform);
-        }
+        self.uniform.range = light.attenuation.range;
+        self.uniform.enabled = light.enabled as u32;
     }
 
     pub fn uniform(&self) -> &Dirty<LightUniform> {
@@ -384,10 +354,6 @@ impl Light {
         self.uniform.mark_clean();
     }
 
-    pub fn model(&self) -> Handle<Model> {
-        self.cube_model
-    }
-
     pub fn label(&self) -> &str {
         &self.label
     }
@@ -1,5 +1,6 @@
 use crate::asset::{AssetRegistry, Handle};
 use crate::buffer::{DynamicBuffer, UniformBuffer, WritableBuffer};
+use crate::streaming::StreamSource;
 use crate::texture::TextureBuilder;
 use crate::{
     graphics::SharedGraphicsContext,
@@ -13,6 +14,7 @@ use puffin::profile_scope;
 use rayon::prelude::*;
 use rkyv::Archive;
 use serde::{Deserialize, Serialize};
+use std::collections::HashSet;
 use std::hash::{DefaultHasher, Hash, Hasher};
 use std::sync::Arc;
 use std::{mem, ops::Range};
@@ -450,6 +452,26 @@ impl Material {
             self.occlusion_texture,
         );
     }
+
+    /// Iterates over the ids of every texture this material samples from.
+    pub fn texture_ids(&self) -> impl Iterator<Item = u64> + '_ {
+        std::iter::once(self.diffuse_texture.id).chain(
+            [
+                self.normal_texture,
+                self.emissive_texture,
+                self.metallic_roughness_texture,
+                self.occlusion_texture,
+            ]
+            .into_iter()
+            .flatten()
+            .map(|h| h.id),
+        )
+    }
+
+    /// Returns true if this material samples from any texture in `ids`.
+    pub fn uses_any_texture(&self, ids: &HashSet<u64>) -> bool {
+        self.texture_ids().any(|id| ids.contains(&id))
+    }
 }
 
 #[derive(
@@ -476,6 +498,8 @@ pub enum AnimationInterpolation {
 struct GLTFTextureInformation {
     sampler: wgpu::SamplerDescriptor<'static>,
     pixels: Vec<u8>,
+    /// The encoded image when it is embedded in a buffer, which is what the texture streams from.
+    encoded: Option<Arc<[u8]>>,
     mime_type: Option<String>,
     width: u32,
     height: u32,
@@ -486,7 +510,11 @@ struct GLTFTextureInformation {
 }
 
 impl GLTFTextureInformation {
-    fn fetch(tex: &gltf::Texture<'_>, images: &Vec<gltf::image::Data>) -> GLTFTextureInformation {
+    fn fetch(
+        tex: &gltf::Texture<'_>,
+        buffers: &Vec<gltf::buffer::Data>,
+        images: &Vec<gltf::image::Data>,
+    ) -> GLTFTextureInformation {
         puffin::profile_function!();
         let sampler = tex.sampler();
 
@@ -552,6 +580,15 @@ impl GLTFTextureInformation {
 
         let mip_level_count = (width.max(height) as f32).log2().floor() as u32 + 1;
 
+        // streaming decodes to RGBA8, so only 8 bit colour images can be streamed
+        let encoded = match (tex.source().source(), image_data.format) {
+            (Source::View { view, .. }, Format::R8G8B8 | Format::R8G8B8A8) => buffers
+                .get(view.buffer().index())
+                .and_then(|buffer| buffer.get(view.offset()..view.offset() + view.length()))
+                .map(Arc::from),
+            _ => None,
+        };
+
         let (pixels, format) = match image_data.format {
             Format::R8 => (image_data.pixels.clone(), wgpu::TextureFormat::R8Unorm),
             Format::R8G8 => (image_data.pixels.clone(), wgpu::TextureFormat::Rg8Unorm),
@@ -592,6 +629,7 @@ impl GLTFTextureInformation {
             sampler,
             mip_level_count,
             pixels,
+            encoded,
             format,
             width,
             height,
@@ -655,6 +693,7 @@ struct ProcessedMaterialTextures {
 
 struct ProcessedTexture {
     pixels: Vec<u8>,
+    encoded: Option<Arc<[u8]>>,
     dimensions: (u32, u32),
     format: wgpu::TextureFormat,
     sampler: wgpu::SamplerDescriptor<'static>,
@@ -707,9 +746,21 @@ impl<'a> bevy_mikktspace::Geometry for MikktMesh<'a> {
 }
 
 impl Model {
+    /// A sphere around every vertex of the model in model space, as its centre and radius.
+    ///
+    /// This walks every vertex, so keep the result instead of asking every frame.
+    pub fn bounding_sphere(&self) -> (glam::Vec3, f32) {
+        bounding_sphere(
+            self.meshes
+                .iter()
+                .flat_map(|mesh| mesh.vertex_buffer.data())
+                .map(|vertex| glam::Vec3::from(vertex.position)),
+        )
+    }
+
     fn load_materials(
         gltf: &gltf::Document,
-        _buffers: &Vec<gltf::buffer::Data>,
+        buffers: &Vec<gltf::buffer::Data>,
         images: &Vec<gltf::image::Data>,
     ) -> Vec<GLTFMaterialInformation> {
         puffin::profile_function!();
@@ -718,7 +769,7 @@ impl Model {
                 "reading texture bytes",
                 texture.name().unwrap_or("Unnamed Texture")
             );
-            Some(GLTFTextureInformation::fetch(&texture, images))
+            Some(GLTFTextureInformation::fetch(&texture, buffers, images))
         };
 
         let mut material_data = Vec::new();
@@ -1267,6 +1318,7 @@ impl Model {
                 let extract = |info: Option<GLTFTextureInformation>| -> Option<ProcessedTexture> {
                     info.map(|info| ProcessedTexture {
                         pixels: info.pixels,
+                        encoded: info.encoded,
                         dimensions: (info.width, info.height),
                         format: info.format,
                         sampler: info.sampler,
@@ -1318,11 +1370,16 @@ impl Model {
 
             let build_texture = |tex: ProcessedTexture, format: wgpu::TextureFormat| -> Texture {
                 let mut builder = TextureBuilder::new(&graphics.device)
-                    .with_raw_pixels(graphics.clone(), tex.pixels.as_slice())
                     .size(tex.dimensions.0, tex.dimensions.1)
+                    .with_raw_pixels(graphics.clone(), tex.pixels.as_slice())
                     .format(format)
                     .sampler(tex.sampler)
                     .label(material_name.as_str());
+                if let Some(encoded) = tex.encoded {
+                    builder = builder
+                        .stream_source(StreamSource::Encoded(encoded))
+                        .streamed();
+                }
                 if let Some(mime) = tex.mime_type {
                     builder = builder.mime_type(&mime);
                 }
@@ -1607,33 +1664,21 @@ where
 
 pub trait DrawLight<'a> {
     #[allow(unused)]
-    fn draw_light_mesh(
-        &mut self,
-        mesh: &'a Mesh,
-        camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
-    );
+    fn draw_light_mesh(&mut self, mesh: &'a Mesh, camera_bind_group: &'a wgpu::BindGroup);
     fn draw_light_mesh_instanced(
         &mut self,
         mesh: &'a Mesh,
         instances: Range<u32>,
         camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
     );
 
     #[allow(unused)]
-    fn draw_light_model(
-        &mut self,
-        model: &'a Model,
-        camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
-    );
+    fn draw_light_model(&mut self, model: &'a Model, camera_bind_group: &'a wgpu::BindGroup);
     fn draw_light_model_instanced(
         &mut self,
         model: &'a Model,
         instances: Range<u32>,
         camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
     );
 }
 
@@ -1641,13 +1686,8 @@ impl<'a, 'b> DrawLight<'b> for wgpu::RenderPass<'a>
 where
     'b: 'a,
 {
-    fn draw_light_mesh(
-        &mut self,
-        mesh: &'a Mesh,
-        camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
-    ) {
-        self.draw_light_mesh_instanced(mesh, 0..1, camera_bind_group, light_bind_group);
+    fn draw_light_mesh(&mut self, mesh: &'a Mesh, camera_bind_group: &'a wgpu::BindGroup) {
+        self.draw_light_mesh_instanced(mesh, 0..1, camera_bind_group);
     }
 
     fn draw_light_mesh_instanced(
@@ -1655,22 +1695,15 @@ where
         mesh: &'a Mesh,
         instances: Range<u32>,
         camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
     ) {
         self.set_vertex_buffer(0, mesh.vertex_buffer.full_slice());
         self.set_index_buffer(mesh.index_buffer.full_slice(), wgpu::IndexFormat::Uint32);
         self.set_bind_group(0, camera_bind_group, &[]);
-        self.set_bind_group(1, light_bind_group, &[]);
         self.draw_indexed(0..mesh.num_elements, 0, instances);
     }
 
-    fn draw_light_model(
-        &mut self,
-        model: &'a Model,
-        camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
-    ) {
-        self.draw_light_model_instanced(model, 0..1, camera_bind_group, light_bind_group);
+    fn draw_light_model(&mut self, model: &'a Model, camera_bind_group: &'a wgpu::BindGroup) {
+        self.draw_light_model_instanced(model, 0..1, camera_bind_group);
     }
 
     fn draw_light_model_instanced(
@@ -1678,15 +1711,9 @@ where
         model: &'a Model,
         instances: Range<u32>,
         camera_bind_group: &'a wgpu::BindGroup,
-        light_bind_group: &'a wgpu::BindGroup,
     ) {
         for mesh in &model.meshes {
-            self.draw_light_mesh_instanced(
-                mesh,
-                instances.clone(),
-                camera_bind_group,
-                light_bind_group,
-            );
+            self.draw_light_mesh_instanced(mesh, instances.clone(), camera_bind_group);
         }
     }
 }
@@ -1864,4 +1891,42 @@ pub struct MaterialUniform {
     pub has_emissive_texture: u32,
     pub has_metallic_texture: u32,
     pub has_occlusion_texture: u32,
-}
\ No newline at end of file
+}
+
+/// The sphere centred on the bounds of `positions` that holds all of them, or a point at the origin
+/// if there are none.
+fn bounding_sphere(positions: impl Iterator<Item = glam::Vec3> + Clone) -> (glam::Vec3, f32) {
+    let (min, max) = positions.clone().fold(
+        (glam::Vec3::splat(f32::MAX), glam::Vec3::splat(f32::MIN)),
+        |(min, max), position| (min.min(position), max.max(position)),
+    );
+    if min.x > max.x {
+        return (glam::Vec3::ZERO, 0.0);
+    }
+    let centre = (min + max) * 0.5;
+    let radius = positions
+        .map(|position| position.distance(centre))
+        .fold(0.0, f32::max);
+    (centre, radius)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use glam::Vec3;
+
+    #[test]
+    fn bounding_sphere_holds_every_position() {
+        let positions = [
+            Vec3::new(1.0, 0.0, 0.0),
+            Vec3::new(3.0, 0.0, 0.0),
+            Vec3::new(2.0, 1.0, 0.0),
+        ];
+        let (centre, radius) = bounding_sphere(positions.iter().copied());
+        assert_eq!(centre, Vec3::new(2.0, 0.5, 0.0));
+        assert!(positions.iter().all(|p| p.distance(centre) <= radius + f32::EPSILON));
+        assert!((radius - 1.25_f32.sqrt()).abs() < 1e-6);
+
+        assert_eq!(bounding_sphere(std::iter::empty()), (Vec3::ZERO, 0.0));
+    }
+}
@@ -0,0 +1,137 @@
+//! A disk-backed cache of compiled pipelines.
+//!
+//! Compiling the shaders of every pipeline is most of a cold start. Where the backend supports
+//! it (currently Vulkan), the driver's compiled pipelines are kept in a [`wgpu::PipelineCache`]
+//! that is written to disk on exit and loaded on the next start, so unchanged pipelines are not
+//! compiled again.
+//!
+//! The cache file is keyed by the adapter and the driver version, as the data of one driver is
+//! useless to another. Data that is stale or corrupt anyway is discarded by wgpu.
+
+use parking_lot::Mutex;
+use sha2::{Digest, Sha256};
+use std::fs;
+use std::path::{Path, PathBuf};
+
+/// Returns the default directory of pipeline caches for an app.
+pub fn cache_dir(app_info: &app_dirs2::AppInfo) -> Option<PathBuf> {
+    app_dirs2::app_root(app_dirs2::AppDataType::UserCache, app_info)
+        .ok()
+        .map(|root| root.join("pipelines"))
+}
+
+pub struct PipelineCache {
+    cache: Option<wgpu::PipelineCache>,
+    path: Option<PathBuf>,
+    /// The size of the data last written, to skip saving a cache that did not grow.
+    saved_len: Mutex<usize>,
+}
+
+impl PipelineCache {
+    /// Loads the cache of this adapter from `dir`, or starts an empty one.
+    ///
+    /// Passing [`None`] as the `dir` keeps the cache in memory only.
+    pub fn new(
+        device: &wgpu::Device,
+        adapter_info: &wgpu::AdapterInfo,
+        dir: Option<&Path>,
+    ) -> Self {
+        if !device.features().contains(wgpu::Features::PIPELINE_CACHE) {
+            log::debug!(
+                "Pipeline caches are not supported on {}",
+                adapter_info.backend
+            );
+            return Self::disabled();
+        }
+
+        let path = dir
+            .zip(file_name(adapter_info))
+            .map(|(dir, name)| dir.join(name));
+        let data = path.as_deref().and_then(|path| match fs::read(path) {
+            Ok(data) => Some(data),
+            Err(e) => {
+                log::debug!("No pipeline cache at {}: {}", path.display(), e);
+                None
+            }
+        });
+
+        // SAFETY: the data was returned by `get_data` of a cache for this adapter and driver,
+        // which is what the file name is derived from. wgpu validates the header of the data and
+        // starts an empty cache when it does not match, as `fallback` is set.
+        let cache = unsafe {
+            device.create_pipeline_cache(&wgpu::PipelineCacheDescriptor {
+                label: Some("pipeline cache"),
+                data: data.as_deref(),
+                fallback: true,
+            })
+        };
+
+        log::info!(
+            "Using pipeline cache ({} bytes loaded)",
+            data.as_ref().map_or(0, Vec::len)
+        );
+
+        Self {
+            cache: Some(cache),
+            path,
+            saved_len: Mutex::new(data.map_or(0, |data| data.len())),
+        }
+    }
+
+    /// A cache that does nothing, for adapters without pipeline caches.
+    pub fn disabled() -> Self {
+        Self {
+            cache: None,
+            path: None,
+            saved_len: Mutex::new(0),
+        }
+    }
+
+    /// The cache to pass as the `cache` of a pipeline descriptor.
+    pub fn get(&self) -> Option<&wgpu::PipelineCache> {
+        self.cache.as_ref()
+    }
+
+    /// Writes the cache to disk if pipelines were added to it since it was last saved.
+    pub fn save(&self) -> anyhow::Result<()> {
+        let (Some(cache), Some(path)) = (&self.cache, &self.path) else {
+            return Ok(());
+        };
+        let Some(data) = cache.get_data() else {
+            return Ok(());
+        };
+
+        let mut saved_len = self.saved_len.lock();
+        if data.len() == *saved_len {
+            return Ok(());
+        }
+        puffin::profile_function!();
+
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        // written to the side and renamed, so a crash never leaves a half written cache
+        let temp = path.with_extension("tmp");
+        fs::write(&temp, &data)?;
+        fs::rename(&temp, path)?;
+
+        log::debug!("Saved pipeline cache ({} bytes)", data.len());
+        *saved_len = data.len();
+        Ok(())
+    }
+}
+
+/// Names the cache file after the adapter and its driver, or `None` if the backend has no
+/// pipeline caches.
+fn file_name(adapter_info: &wgpu::AdapterInfo) -> Option<String> {
+    let key = wgpu::util::pipeline_cache_key(adapter_info)?;
+
+    // a hash that stays the same across toolchains, so an update does not orphan the caches
+    let mut hasher = Sha256::new();
+    hasher.update(adapter_info.driver.as_bytes());
+    hasher.update([0]);
+    hasher.update(adapter_info.driver_info.as_bytes());
+    let digest = hasher.finalize();
+    let hash: String = digest[..8].iter().map(|b| format!("{b:02x}")).collect();
+    Some(format!("{}_{}.bin", key, hash))
+}
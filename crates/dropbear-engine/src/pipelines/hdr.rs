@@ -155,6 +155,7 @@ impl HdrPipeline {
             wgpu::PrimitiveTopology::TriangleList,
             shader,
             1,
+            None,
         );
 
         Self {
@@ -275,7 +276,14 @@ impl HdrPipeline {
 
     /// This renders the internal HDR texture to the [TextureView]
     /// supplied as parameter.
-    pub fn process(&self, encoder: &mut wgpu::CommandEncoder, output: &wgpu::TextureView) {
+    ///
+    /// `timestamp_writes` times the pass, see [`crate::gpu_profiler::GpuProfiler`].
+    pub fn process(
+        &self,
+        encoder: &mut wgpu::CommandEncoder,
+        output: &wgpu::TextureView,
+        timestamp_writes: Option<wgpu::RenderPassTimestampWrites<'_>>,
+    ) {
         puffin::profile_function!();
         let mut pass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
             label: Some("Hdr::process"),
@@ -289,7 +297,7 @@ impl HdrPipeline {
                 },
             })],
             depth_stencil_attachment: None,
-            timestamp_writes: None,
+            timestamp_writes,
             occlusion_query_set: None,
             multiview_mask: None,
         });
@@ -1,12 +1,17 @@
+use crate::asset::{ASSET_REGISTRY, Handle};
 use crate::buffer::{StorageBuffer, WritableBuffer};
+use crate::camera::{Camera, Frustum};
 use crate::graphics::SharedGraphicsContext;
-use crate::lighting::{Light, LightArrayUniform, MAX_LIGHTS};
-use crate::model::{ModelVertex, Vertex};
+use crate::lighting::{Light, LightArrayUniform, LightType, LightUniform, MAX_LIGHTS};
+use crate::model::{Model, ModelVertex, Vertex};
 use crate::pipelines::DropbearShaderPipeline;
+use crate::procedural::ProcedurallyGeneratedObject;
 use crate::shader::Shader;
 use crate::texture::Texture;
-use glam::DMat4;
+use bytemuck::Zeroable;
+use glam::{DVec3, Vec3};
 use slank::include_slang;
+use std::collections::HashMap;
 use std::mem::size_of;
 use std::sync::Arc;
 use wgpu::{BufferAddress, CompareFunction, DepthBiasState, StencilState};
@@ -16,6 +21,21 @@ pub struct LightCubePipeline {
     pipeline_layout: wgpu::PipelineLayout,
     pipeline: wgpu::RenderPipeline,
     storage_buffer: Option<StorageBuffer<LightArrayUniform>>,
+    /// What was last seen of every light in the world, whether it has a slot or not.
+    lights: HashMap<hecs::Entity, SeenLight>,
+    /// The lights picked for the slots this frame, kept to reuse the allocation.
+    picked: Vec<(hecs::Entity, bool, f32)>,
+    /// The lights in the slots of the storage buffer and the cube instances.
+    slots: Vec<Option<LightSlot>>,
+    slot_of: HashMap<hecs::Entity, usize>,
+    /// One past the last slot in use.
+    slot_end: usize,
+    cube_instances: wgpu::Buffer,
+    cube_model: Handle<Model>,
+    /// The render origin the slots were written relative to.
+    origin: DVec3,
+    /// Set until the first update, which has to look at every light.
+    rescan: bool,
 }
 
 impl DropbearShaderPipeline for LightCubePipeline {
@@ -30,10 +50,7 @@ impl DropbearShaderPipeline for LightCubePipeline {
                 .device
                 .create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
                     label: Some("light cube pipeline layout"),
-                    bind_group_layouts: &[
-                        Some(&graphics.layouts.camera_bind_group_layout),
-                        Some(&graphics.layouts.light_cube_layout),
-                    ],
+                    bind_group_layouts: &[Some(&graphics.layouts.camera_bind_group_layout)],
                     immediate_size: 0,
                 });
 
@@ -52,7 +69,7 @@ impl DropbearShaderPipeline for LightCubePipeline {
                         // model
                         LightCubeVertex::desc(),
                         // instance
-                        InstanceInput::desc(),
+                        LightCubeInstance::desc(),
                     ],
                 },
                 fragment: Some(wgpu::FragmentState {
@@ -89,18 +106,40 @@ impl DropbearShaderPipeline for LightCubePipeline {
                     mask: !0,
                     alpha_to_coverage_enabled: false,
                 },
-                cache: None,
+                cache: graphics.pipeline_cache.get(),
                 multiview_mask: None,
             });
 
         let storage_buffer =
             StorageBuffer::new_read_only(&graphics.device, "light cube pipeline storage buffer");
+        // zeroed, which is what an empty slot holds in both buffers
+        let cube_instances = graphics.device.create_buffer(&wgpu::BufferDescriptor {
+            label: Some("light cube instance buffer"),
+            size: (MAX_LIGHTS * size_of::<LightCubeInstance>()) as BufferAddress,
+            usage: wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST,
+            mapped_at_creation: false,
+        });
+        let cube_model = ProcedurallyGeneratedObject::cuboid(DVec3::ONE).build_model(
+            graphics.clone(),
+            None,
+            Some("light cube"),
+            ASSET_REGISTRY.clone(),
+        );
 
         Self {
             shader,
             pipeline_layout,
             pipeline,
             storage_buffer: Some(storage_buffer),
+            lights: HashMap::new(),
+            picked: Vec::new(),
+            slots: (0..MAX_LIGHTS).map(|_| None).collect(),
+            slot_of: HashMap::new(),
+            slot_end: 0,
+            cube_instances,
+            cube_model,
+            origin: DVec3::ZERO,
+            rescan: true,
         }
     }
 
@@ -125,42 +164,196 @@ impl LightCubePipeline {
             .buffer()
     }
 
-    pub fn update(&mut self, graphics: Arc<SharedGraphicsContext>, world: &hecs::World) {
-        let mut light_array = LightArrayUniform::default();
+    /// The amount of slots in [`Self::light_buffer`] the shader has to look at, which the shader
+    /// globals need to know.
+    pub fn light_count(&self) -> u32 {
+        self.slot_end as u32
+    }
 
-        let mut light_index: usize = 0;
+    /// One cube instance per light slot, where the cubes of hidden lights and empty slots are
+    /// collapsed to nothing.
+    pub fn cube_instances(&self) -> (&wgpu::Buffer, u32) {
+        (&self.cube_instances, self.slot_end as u32)
+    }
 
-        for light in world.query::<&mut Light>().iter() {
-            light.update(graphics.as_ref());
+    pub fn cube_model(&self) -> Handle<Model> {
+        self.cube_model
+    }
 
+    /// Brings the light storage buffer and the cube instances up to date with the world.
+    ///
+    /// Only the lights in `changes` (or every light, for [`LightChanges::All`] and when the render
+    /// origin moved) are read from the world. Then the lights whose range reaches into `camera`'s
+    /// view, or whose cube can be seen, are picked for the slots. When more than [`MAX_LIGHTS`]
+    /// are left, directional lights are kept first, then the lights nearest to the camera.
+    ///
+    /// A picked light keeps its slot in both buffers for as long as it stays picked, and a slot
+    /// is only written when what it holds is different.
+    pub fn update(
+        &mut self,
+        graphics: Arc<SharedGraphicsContext>,
+        world: &hecs::World,
+        camera: &Camera,
+        changes: LightChanges<'_>,
+    ) {
+        puffin::profile_function!();
+        let origin = graphics.render_origin.get();
+        // every light is relative to the render origin, so moving it moves all of them
+        let rescan = self.rescan || origin != self.origin || matches!(changes, LightChanges::All);
+        self.rescan = false;
+        self.origin = origin;
 
-            let instance: InstanceInput = light.component.to_transform().matrix().into();
+        if rescan {
+            self.lights.clear();
+            for (entity, light) in world.query::<(hecs::Entity, &mut Light)>().iter() {
+                light.update(&graphics);
+                self.lights.insert(entity, SeenLight::new(light, origin));
+            }
+        } else if let LightChanges::Only(entities) = changes {
+            for entity in entities {
+                match world.get::<&mut Light>(*entity) {
+                    Ok(mut light) => {
+                        light.update(&graphics);
+                        self.lights.insert(*entity, SeenLight::new(&light, origin));
+                    }
+                    // despawned, or no longer a light
+                    Err(_) => {
+                        self.lights.remove(entity);
+                    }
+                }
+            }
+        }
 
-            light
-                .instance_buffer
-                .write(&graphics.device, &graphics.queue, &[instance]);
+        // the camera's matrices are relative to its own render origin
+        let view_origin = camera.render_origin;
+        let eye = (camera.eye - view_origin).as_vec3();
+        Self::pick(&self.lights, &camera.frustum(), view_origin, eye, &mut self.picked);
+        self.fill_slots(&graphics.queue);
+    }
 
-            if light.component.enabled && light_index < MAX_LIGHTS {
-                let uniform = light.uniform();
+    /// Fills `picked` with the lights that get a slot, whether each is shaded, and how far its
+    /// reach is from `eye`.
+    fn pick(
+        lights: &HashMap<hecs::Entity, SeenLight>,
+        frustum: &Frustum,
+        view_origin: DVec3,
+        eye: Vec3,
+        picked: &mut Vec<(hecs::Entity, bool, f32)>,
+    ) {
+        picked.clear();
+        for (entity, light) in lights {
+            let centre = (light.position - view_origin).as_vec3();
+            let shaded = light.enabled
+                && light.reach.is_none_or(|radius| frustum.intersects_sphere(centre, radius));
+            let cube = light.cube_visible && frustum.intersects_sphere(centre, CUBE_RADIUS);
+            if !shaded && !cube {
+                continue;
+            }
+            // lights that reach everywhere come first
+            let distance = match light.reach {
+                Some(radius) => (centre.distance(eye) - radius).max(0.0),
+                None => -1.0,
+            };
+            picked.push((*entity, shaded, distance));
+        }
 
-                if uniform.is_dirty() {
-                    light.buffer.write(&graphics.queue, &uniform);
-                }
+        if picked.len() > MAX_LIGHTS {
+            // shaded lights before the ones that only have their cube drawn
+            picked.sort_by(|a, b| b.1.cmp(&a.1).then(a.2.total_cmp(&b.2)));
+            picked.truncate(MAX_LIGHTS);
+        }
+    }
 
-                light_array.lights[light_index] = *uniform.get();
-                light_index += 1;
+    /// Frees the slots of lights that were not picked, then gives every picked light a slot
+    /// (keeping the one it had) and writes the slots that hold something different.
+    fn fill_slots(&mut self, queue: &wgpu::Queue) {
+        for index in 0..self.slot_end {
+            let Some(slot) = &self.slots[index] else {
+                continue;
+            };
+            let entity = slot.entity;
+            if !self.picked.iter().any(|(picked, ..)| *picked == entity) {
+                self.release(queue, index);
             }
         }
 
-        light_array.light_count = light_index as u32;
+        for (entity, shaded, _) in &self.picked {
+            let Some(light) = self.lights.get(entity) else {
+                continue;
+            };
+            let mut uniform = light.uniform;
+            uniform.enabled = *shaded as u32;
+            let cube = light.cube;
 
-        if let Some(buf) = &self.storage_buffer {
-            buf.write(&graphics.queue, &light_array);
-        } else {
-            panic!("A storage buffer should have been created");
+            let index = match self.slot_of.get(entity) {
+                Some(index) => *index,
+                None => {
+                    // there are never more picked lights than slots
+                    let Some(index) = self.slots.iter().position(Option::is_none) else {
+                        continue;
+                    };
+                    self.slot_of.insert(*entity, index);
+                    self.slot_end = self.slot_end.max(index + 1);
+                    index
+                }
+            };
+
+            if let Some(slot) = &self.slots[index]
+                && bytemuck::bytes_of(&slot.uniform) == bytemuck::bytes_of(&uniform)
+                && slot.cube == cube
+            {
+                continue;
+            }
+            Self::write_slot(
+                queue,
+                self.storage_buffer.as_ref().expect("Light cube storage buffer missing").buffer(),
+                &self.cube_instances,
+                index,
+                &uniform,
+                &cube,
+            );
+            self.slots[index] = Some(LightSlot {
+                entity: *entity,
+                uniform,
+                cube,
+            });
         }
     }
 
+    /// Empties the slot at `index`.
+    fn release(&mut self, queue: &wgpu::Queue, index: usize) {
+        let Some(slot) = self.slots[index].take() else {
+            return;
+        };
+        self.slot_of.remove(&slot.entity);
+        Self::write_slot(
+            queue,
+            self.light_buffer(),
+            &self.cube_instances,
+            index,
+            &LightUniform::default(),
+            &LightCubeInstance::zeroed(),
+        );
+        while self.slot_end > 0 && self.slots[self.slot_end - 1].is_none() {
+            self.slot_end -= 1;
+        }
+    }
+
+    fn write_slot(
+        queue: &wgpu::Queue,
+        light_buffer: &wgpu::Buffer,
+        cube_instances: &wgpu::Buffer,
+        index: usize,
+        uniform: &LightUniform,
+        cube: &LightCubeInstance,
+    ) {
+        puffin::profile_function!();
+        let light_offset = (index * size_of::<LightUniform>()) as BufferAddress;
+        queue.write_buffer(light_buffer, light_offset, bytemuck::bytes_of(uniform));
+        let cube_offset = (index * size_of::<LightCubeInstance>()) as BufferAddress;
+        queue.write_buffer(cube_instances, cube_offset, bytemuck::bytes_of(cube));
+    }
+
     pub fn buffer(&self) -> &wgpu::Buffer {
         if let Some(s) = &self.storage_buffer {
             s.buffer()
@@ -170,6 +363,54 @@ impl LightCubePipeline {
     }
 }
 
+/// Which lights [`LightCubePipeline::update`] has to look at.
+pub enum LightChanges<'a> {
+    /// Lights came and went without it being logged, so every light in the world is read again.
+    All,
+    /// Only these entities changed since the last update, including lights that were added and
+    /// removed. Entities that are not lights are skipped.
+    Only(&'a [hecs::Entity]),
+}
+
+/// The light in one slot of [`LightCubePipeline`]'s buffers, and what was last written there.
+struct LightSlot {
+    entity: hecs::Entity,
+    uniform: LightUniform,
+    cube: LightCubeInstance,
+}
+
+/// The radius of a sphere around a light cube.
+const CUBE_RADIUS: f32 = 0.87;
+
+/// What [`LightCubePipeline`] last read of a light from the world.
+struct SeenLight {
+    uniform: LightUniform,
+    cube: LightCubeInstance,
+    position: DVec3,
+    /// The radius of a sphere around `position` holding everything the light reaches, or `None`
+    /// if the light reaches everywhere.
+    reach: Option<f32>,
+    enabled: bool,
+    cube_visible: bool,
+}
+
+impl SeenLight {
+    fn new(light: &Light, origin: DVec3) -> Self {
+        let component = &light.component;
+        Self {
+            uniform: **light.uniform(),
+            cube: LightCubeInstance::of(light, origin),
+            position: component.position,
+            reach: match component.light_type {
+                LightType::Directional => None,
+                LightType::Point | LightType::Spot => Some(component.attenuation.range),
+            },
+            enabled: component.enabled,
+            cube_visible: component.visible,
+        }
+    }
+}
+
 pub struct LightCubeVertex;
 
 impl LightCubeVertex {
@@ -186,25 +427,40 @@ impl LightCubeVertex {
     }
 }
 
-/// As mapped in `shaders/light.slang` as
-/// ```wgsl
-/// struct InstanceInput {
-///     @location(5) model_matrix_0: vec4<f32>,
-///     @location(6) model_matrix_1: vec4<f32>,
-///     @location(7) model_matrix_2: vec4<f32>,
-///     @location(8) model_matrix_3: vec4<f32>,
-/// }
+/// One light cube, as mapped in `shaders/light.slang` as
+/// ```slang
+/// [[vk::location(5)]] float4 model_matrix_0;
+/// [[vk::location(6)]] float4 model_matrix_1;
+/// [[vk::location(7)]] float4 model_matrix_2;
+/// [[vk::location(8)]] float4 model_matrix_3;
+/// [[vk::location(9)]] float4 colour;
 /// ```
 #[repr(C)]
-#[derive(Debug, Copy, Clone, bytemuck::Pod, bytemuck::Zeroable)]
-pub struct InstanceInput {
+#[derive(Debug, Copy, Clone, PartialEq, bytemuck::Pod, bytemuck::Zeroable)]
+pub struct LightCubeInstance {
     pub model_matrix: [[f32; 4]; 4],
+    pub colour: [f32; 4],
+}
+
+impl LightCubeInstance {
+    /// The cube of `light`, or nothing if its cube is hidden.
+    fn of(light: &Light, origin: DVec3) -> Self {
+        if !light.component.visible {
+            return Self::zeroed();
+        }
+        let mut transform = light.component.to_transform();
+        transform.position -= origin;
+        Self {
+            model_matrix: transform.matrix().as_mat4().to_cols_array_2d(),
+            colour: light.uniform.colour,
+        }
+    }
 }
 
-impl Vertex for InstanceInput {
+impl Vertex for LightCubeInstance {
     fn desc() -> wgpu::VertexBufferLayout<'static> {
         wgpu::VertexBufferLayout {
-            array_stride: size_of::<InstanceInput>() as BufferAddress,
+            array_stride: size_of::<LightCubeInstance>() as BufferAddress,
             step_mode: wgpu::VertexStepMode::Instance,
             attributes: &[
                 // model_matrix_0
@@ -231,15 +487,116 @@ impl Vertex for InstanceInput {
                     shader_location: 8,
                     format: wgpu::VertexFormat::Float32x4,
                 },
+                // colour
+                wgpu::VertexAttribute {
+                    offset: size_of::<[f32; 16]>() as wgpu::BufferAddress,
+                    shader_location: 9,
+                    format: wgpu::VertexFormat::Float32x4,
+                },
             ],
         }
     }
 }
 
-impl Into<InstanceInput> for DMat4 {
-    fn into(self) -> InstanceInput {
-        InstanceInput {
-            model_matrix: self.as_mat4().to_cols_array_2d(),
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lighting::LightComponent;
+    use dropbear_utils::Dirty;
+
+    fn light(component: LightComponent) -> Light {
+        Light {
+            uniform: Dirty::new(LightUniform::default()),
+            label: String::from("light"),
+            component,
         }
     }
+
+    fn seen(position: DVec3, reach: Option<f32>, enabled: bool) -> SeenLight {
+        SeenLight {
+            uniform: LightUniform::default(),
+            cube: LightCubeInstance::zeroed(),
+            position,
+            reach,
+            enabled,
+            cube_visible: true,
+        }
+    }
+
+    #[test]
+    fn lights_in_view_are_picked_directional_then_nearest_first() {
+        let proj = glam::Mat4::perspective_infinite_reverse_lh(90f32.to_radians(), 1.0, 0.1);
+        let view = glam::Mat4::look_at_lh(Vec3::ZERO, Vec3::Z, Vec3::Y);
+        let frustum = Frustum::from_view_proj(proj * view);
+
+        let mut world = hecs::World::new();
+        let mut lights = HashMap::new();
+        let sun = world.spawn(());
+        lights.insert(sun, seen(DVec3::new(0.0, 0.0, -1000.0), None, true));
+        let behind = world.spawn(());
+        lights.insert(behind, seen(DVec3::new(0.0, 0.0, -20.0), Some(1.0), true));
+        let off = world.spawn(());
+        lights.insert(off, seen(DVec3::new(0.0, 0.0, 2.0), Some(1.0), false));
+        let points: Vec<hecs::Entity> = (0..MAX_LIGHTS + 2)
+            .map(|i| {
+                let entity = world.spawn(());
+                lights.insert(entity, seen(DVec3::new(0.0, 0.0, 5.0 + i as f64), Some(1.0), true));
+                entity
+            })
+            .collect();
+
+        let mut picked = Vec::new();
+        LightCubePipeline::pick(&lights, &frustum, DVec3::ZERO, Vec3::ZERO, &mut picked);
+
+        let picked: Vec<hecs::Entity> = picked.iter().map(|(entity, ..)| *entity).collect();
+        let mut expected = vec![sun];
+        expected.extend_from_slice(&points[..MAX_LIGHTS - 1]);
+        assert_eq!(picked, expected);
+    }
+
+    #[test]
+    fn a_light_that_is_off_only_gets_a_slot_for_its_cube() {
+        let proj = glam::Mat4::perspective_infinite_reverse_lh(90f32.to_radians(), 1.0, 0.1);
+        let view = glam::Mat4::look_at_lh(Vec3::ZERO, Vec3::Z, Vec3::Y);
+        let frustum = Frustum::from_view_proj(proj * view);
+
+        let mut world = hecs::World::new();
+        let off = world.spawn(());
+        let mut lights = HashMap::new();
+        lights.insert(off, seen(DVec3::new(0.0, 0.0, 2.0), Some(1.0), false));
+
+        let mut picked = Vec::new();
+        LightCubePipeline::pick(&lights, &frustum, DVec3::ZERO, Vec3::ZERO, &mut picked);
+        assert_eq!(picked, vec![(off, false, 1.0)]);
+
+        lights.get_mut(&off).unwrap().cube_visible = false;
+        LightCubePipeline::pick(&lights, &frustum, DVec3::ZERO, Vec3::ZERO, &mut picked);
+        assert!(picked.is_empty());
+    }
+
+    #[test]
+    fn light_uniform_matches_shader_layout() {
+        // 4 vectors, 4 scalars, the shadow, then range, enabled and padding
+        assert_eq!(size_of::<LightUniform>(), 96);
+        assert_eq!(
+            size_of::<LightCubeInstance>() % wgpu::COPY_BUFFER_ALIGNMENT as usize,
+            0
+        );
+    }
+
+    #[test]
+    fn cubes_sit_relative_to_the_origin_and_hidden_ones_collapse() {
+        let mut component = LightComponent::default();
+        component.position = DVec3::new(10.0, 2.0, -4.0);
+        let origin = DVec3::new(8.0, 0.0, 0.0);
+
+        let cube = LightCubeInstance::of(&light(component.clone()), origin);
+        assert_eq!(cube.model_matrix[3], [2.0, 2.0, -4.0, 1.0]);
+
+        component.hide_cube();
+        assert_eq!(
+            LightCubeInstance::of(&light(component), origin),
+            LightCubeInstance::zeroed()
+        );
+    }
 }
@@ -112,6 +112,7 @@ pub fn create_render_pipeline(
     topology: wgpu::PrimitiveTopology,
     shader: wgpu::ShaderModuleDescriptor,
     sample_count: u32,
+    cache: Option<&wgpu::PipelineCache>,
 ) -> wgpu::RenderPipeline {
     create_render_pipeline_ex(
         label,
@@ -125,6 +126,7 @@ pub fn create_render_pipeline(
         true, // depth_write_enabled
         wgpu::CompareFunction::LessEqual,
         sample_count,
+        cache,
     )
 }
 
@@ -140,6 +142,7 @@ pub fn create_render_pipeline_ex(
     depth_write_enabled: bool,
     depth_compare: wgpu::CompareFunction,
     sample_count: u32,
+    cache: Option<&wgpu::PipelineCache>,
 ) -> wgpu::RenderPipeline {
     let shader = device.create_shader_module(shader);
 
@@ -186,7 +189,7 @@ pub fn create_render_pipeline_ex(
             mask: !0,
             alpha_to_coverage_enabled: false,
         },
-        cache: None,
+        cache,
         multiview_mask: None,
     })
 }
@@ -1,7 +1,9 @@
 use crate::graphics::{InstanceRaw, SharedGraphicsContext};
+use crate::ibl::EnvironmentMaps;
 use crate::model;
 use crate::model::Vertex;
 use crate::pipelines::HotPipeline;
+use crate::shadows::ShadowRenderer;
 use crate::texture::Texture;
 use std::sync::Arc;
 use wesl::ModulePath;
@@ -37,6 +39,7 @@ impl MainRenderPipeline {
         let hdr_format = graphics.hdr.read().format();
         let sample_count: u32 = (*graphics.antialiasing.read()).into();
         let device = graphics.device.clone();
+        let pipeline_cache = graphics.pipeline_cache.clone();
 
         let shader_dir = std::path::PathBuf::from(concat!(
             env!("CARGO_MANIFEST_DIR"),
@@ -113,7 +116,7 @@ impl MainRenderPipeline {
                             mask: !0,
                             alpha_to_coverage_enabled: false,
                         },
-                        cache: None,
+                        cache: pipeline_cache.get(),
                         multiview_mask: None,
                     });
 
@@ -144,6 +147,7 @@ impl MainRenderPipeline {
         globals_buffer: &wgpu::Buffer,
         camera_buffer: &wgpu::Buffer,
         light_array_buffer: &wgpu::Buffer,
+        shadows: &ShadowRenderer,
     ) -> &wgpu::BindGroup {
         if self.per_frame.is_none() {
             let bind_group = graphics
@@ -164,6 +168,22 @@ impl MainRenderPipeline {
                             binding: 2,
                             resource: light_array_buffer.as_entire_binding(),
                         },
+                        wgpu::BindGroupEntry {
+                            binding: 3,
+                            resource: shadows.buffer().as_entire_binding(),
+                        },
+                        wgpu::BindGroupEntry {
+                            binding: 4,
+                            resource: wgpu::BindingResource::TextureView(shadows.cascade_view()),
+                        },
+                        wgpu::BindGroupEntry {
+                            binding: 5,
+                            resource: wgpu::BindingResource::TextureView(shadows.atlas_view()),
+                        },
+                        wgpu::BindGroupEntry {
+                            binding: 6,
+                            resource: wgpu::BindingResource::Sampler(shadows.sampler()),
+                        },
                     ],
                 });
 
@@ -212,28 +232,14 @@ impl MainRenderPipeline {
     pub fn environment_bind_group(
         &mut self,
         graphics: Arc<SharedGraphicsContext>,
-        environment_view: &wgpu::TextureView,
-        environment_sampler: &wgpu::Sampler,
+        environment: &EnvironmentMaps,
     ) -> &wgpu::BindGroup {
         if self.environment.is_none() {
-            let bind_group = graphics
-                .device
-                .create_bind_group(&wgpu::BindGroupDescriptor {
-                    label: Some("environment bind group"),
-                    layout: &graphics.layouts.environment_layout,
-                    entries: &[
-                        wgpu::BindGroupEntry {
-                            binding: 0,
-                            resource: wgpu::BindingResource::TextureView(environment_view),
-                        },
-                        wgpu::BindGroupEntry {
-                            binding: 1,
-                            resource: wgpu::BindingResource::Sampler(environment_sampler),
-                        },
-                    ],
-                });
-
-            self.environment = Some(bind_group);
+            self.environment = Some(environment.create_bind_group(
+                &graphics.device,
+                &graphics.layouts.environment_layout,
+                Some("environment bind group"),
+            ));
         }
 
         self.environment.as_ref().unwrap()
@@ -0,0 +1,506 @@
+//! A small render graph, which orders, batches and culls the passes of a frame.
+//!
+//! Instead of recording passes into encoders by hand, a frame declares each pass with the
+//! resources it reads and writes, and the graph works out the rest when it is
+//! [executed](RenderGraph::execute):
+//!
+//! - Passes run in the order they were added. A pass whose writes are never read by a later pass
+//!   (and that does not write an [imported](RenderGraph::import) resource) is culled.
+//! - Consecutive passes are recorded into the same encoder and submitted together. The graph only
+//!   submits early when a pass [uploads](PassBuilder::uploads) through the queue into something
+//!   an earlier pass of the same encoder used, as queue writes land before the whole submission.
+//! - [Transient](RenderGraph::transient) textures only live for the passes that use them. Two
+//!   transients with the same description share one texture when their lifetimes don't overlap,
+//!   and the textures are pooled between frames in [`SharedGraphicsContext::transient_textures`].
+//!
+//! Every pass is handed the context `C` of the frame, which holds whatever the passes draw with,
+//! so the passes of a graph can share mutable state without fighting over borrows.
+
+use crate::graphics::{CommandEncoder, SharedGraphicsContext};
+use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+/// How many frames a pooled transient texture is kept for after it was last used.
+const POOL_KEEP_FRAMES: u64 = 60;
+
+/// A resource tracked by a [`RenderGraph`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct ResourceId(usize);
+
+/// The description of a transient texture. Transients with equal descriptions can be aliased.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct TransientTexture {
+    pub size: wgpu::Extent3d,
+    pub format: wgpu::TextureFormat,
+    pub usage: wgpu::TextureUsages,
+    pub sample_count: u32,
+}
+
+enum ResourceKind {
+    /// Lives outside of the graph, such as the HDR target or the shadow maps.
+    Imported,
+    Transient(TransientTexture),
+}
+
+struct Resource {
+    name: &'static str,
+    kind: ResourceKind,
+}
+
+type PassFn<'a, C> = Box<dyn FnOnce(&mut C, &mut PassContext<'_>) + 'a>;
+
+struct Pass<'a, C> {
+    name: &'static str,
+    reads: Vec<ResourceId>,
+    writes: Vec<ResourceId>,
+    uploads: Vec<&'static str>,
+    side_effects: bool,
+    run: PassFn<'a, C>,
+}
+
+/// What a pass records with.
+pub struct PassContext<'r> {
+    pub encoder: &'r mut CommandEncoder,
+    textures: &'r [Option<wgpu::TextureView>],
+}
+
+impl PassContext<'_> {
+    /// The view of a transient texture. Imported resources are only tracked by the graph, and
+    /// `None` is returned for them.
+    pub fn texture(&self, id: ResourceId) -> Option<&wgpu::TextureView> {
+        self.textures.get(id.0).and_then(Option::as_ref)
+    }
+}
+
+/// The passes of one frame. See the [module docs](self).
+pub struct RenderGraph<'a, C> {
+    resources: Vec<Resource>,
+    passes: Vec<Pass<'a, C>>,
+}
+
+impl<'a, C> Default for RenderGraph<'a, C> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<'a, C> RenderGraph<'a, C> {
+    pub fn new() -> Self {
+        Self {
+            resources: Vec::new(),
+            passes: Vec::new(),
+        }
+    }
+
+    /// Tracks a resource that outlives the frame. Passes that write to it are never culled.
+    pub fn import(&mut self, name: &'static str) -> ResourceId {
+        self.add_resource(name, ResourceKind::Imported)
+    }
+
+    /// Declares a texture that only lives while the passes of this frame use it.
+    pub fn transient(&mut self, name: &'static str, texture: TransientTexture) -> ResourceId {
+        self.add_resource(name, ResourceKind::Transient(texture))
+    }
+
+    fn add_resource(&mut self, name: &'static str, kind: ResourceKind) -> ResourceId {
+        self.resources.push(Resource { name, kind });
+        ResourceId(self.resources.len() - 1)
+    }
+
+    /// Starts declaring a pass, which runs after every pass added before it.
+    pub fn add_pass(&mut self, name: &'static str) -> PassBuilder<'_, 'a, C> {
+        PassBuilder {
+            graph: self,
+            name,
+            reads: Vec::new(),
+            writes: Vec::new(),
+            uploads: Vec::new(),
+            side_effects: false,
+        }
+    }
+
+    /// Records and submits every pass that contributes to the frame.
+    pub fn execute(
+        self,
+        graphics: &Arc<SharedGraphicsContext>,
+        context: &mut C,
+    ) -> anyhow::Result<()> {
+        self.execute_timed(graphics, context, |_, _| {})
+    }
+
+    /// Like [`Self::execute`], but hands `timed` how long each pass took to record on the CPU,
+    /// and how long each submission took under the name `"submit"`.
+    pub fn execute_timed(
+        self,
+        graphics: &Arc<SharedGraphicsContext>,
+        context: &mut C,
+        mut timed: impl FnMut(&'static str, Duration),
+    ) -> anyhow::Result<()> {
+        puffin::profile_function!();
+        let plan = self.compile()?;
+
+        let textures: Vec<Option<wgpu::TextureView>> = {
+            let mut pool = graphics.transient_textures.lock();
+            pool.frame += 1;
+            let textures = self
+                .resources
+                .iter()
+                .zip(&plan.slots)
+                .map(|(resource, slot)| match (&resource.kind, slot) {
+                    (ResourceKind::Transient(texture), Some(slot)) => {
+                        Some(pool.acquire(&graphics.device, texture, *slot, resource.name))
+                    }
+                    _ => None,
+                })
+                .collect();
+            pool.trim();
+            textures
+        };
+
+        let mut passes: Vec<Option<Pass<'a, C>>> = self.passes.into_iter().map(Some).collect();
+        let mut encoder = None;
+        for (position, index) in plan.passes.iter().enumerate() {
+            let Some(pass) = passes[*index].take() else {
+                continue;
+            };
+            let encoder_ref = encoder.get_or_insert_with(|| {
+                CommandEncoder::new(graphics.clone(), Some("render graph encoder"))
+            });
+
+            {
+                puffin::profile_scope!("render graph pass", pass.name);
+                let start = Instant::now();
+                (pass.run)(
+                    context,
+                    &mut PassContext {
+                        encoder: encoder_ref,
+                        textures: &textures,
+                    },
+                );
+                timed(pass.name, start.elapsed());
+            }
+
+            if plan.submit_after[position] {
+                if let Some(encoder) = encoder.take() {
+                    let start = Instant::now();
+                    encoder.submit()?;
+                    timed("submit", start.elapsed());
+                }
+            }
+        }
+
+        Ok(())
+    }
+
+    /// Works out which passes run, where to submit, and which texture each transient gets.
+    fn compile(&self) -> anyhow::Result<Plan> {
+        // a transient has to be written before it can be read
+        let mut written = HashSet::new();
+        for pass in &self.passes {
+            for read in &pass.reads {
+                let resource = &self.resources[read.0];
+                if matches!(resource.kind, ResourceKind::Transient(_)) && !written.contains(read) {
+                    anyhow::bail!(
+                        "Pass \"{}\" reads \"{}\" before any pass writes it",
+                        pass.name,
+                        resource.name
+                    );
+                }
+            }
+            written.extend(pass.writes.iter().copied());
+        }
+
+        // walk backwards, keeping the passes whose writes are needed later on
+        let mut needed: HashSet<ResourceId> = HashSet::new();
+        let mut kept = vec![false; self.passes.len()];
+        for (index, pass) in self.passes.iter().enumerate().rev() {
+            let keep = pass.side_effects
+                || pass.writes.iter().any(|write| {
+                    needed.contains(write)
+                        || matches!(self.resources[write.0].kind, ResourceKind::Imported)
+                });
+            if keep {
+                kept[index] = true;
+                needed.extend(pass.reads.iter().copied());
+            }
+        }
+        let passes: Vec<usize> = (0..self.passes.len()).filter(|i| kept[*i]).collect();
+
+        // submit before a pass whose uploads would overwrite something the encoder still needs
+        let mut submit_after = vec![false; passes.len()];
+        let mut uploaded: HashSet<&'static str> = HashSet::new();
+        for (position, index) in passes.iter().enumerate() {
+            let pass = &self.passes[*index];
+            if position > 0 && pass.uploads.iter().any(|key| uploaded.contains(key)) {
+                submit_after[position - 1] = true;
+                uploaded.clear();
+            }
+            uploaded.extend(pass.uploads.iter().copied());
+        }
+        if let Some(last) = submit_after.last_mut() {
+            *last = true;
+        }
+
+        // the span of kept passes each transient is used in
+        let mut lifetimes: Vec<Option<(usize, usize)>> = vec![None; self.resources.len()];
+        for (position, index) in passes.iter().enumerate() {
+            let pass = &self.passes[*index];
+            for id in pass.reads.iter().chain(&pass.writes) {
+                let lifetime = &mut lifetimes[id.0];
+                *lifetime = Some(match *lifetime {
+                    Some((first, _)) => (first, position),
+                    None => (position, position),
+                });
+            }
+        }
+
+        // hand out textures in order of first use, reusing any whose last user already ran
+        let mut order: Vec<usize> = (0..self.resources.len())
+            .filter(|i| {
+                lifetimes[*i].is_some()
+                    && matches!(self.resources[*i].kind, ResourceKind::Transient(_))
+            })
+            .collect();
+        order.sort_by_key(|i| lifetimes[*i].map(|(first, _)| first));
+
+        let mut slots = vec![None; self.resources.len()];
+        let mut slot_ends: HashMap<TransientTexture, Vec<usize>> = HashMap::new();
+        for index in order {
+            let ResourceKind::Transient(texture) = &self.resources[index].kind else {
+                continue;
+            };
+            let Some((first, last)) = lifetimes[index] else {
+                continue;
+            };
+            let ends = slot_ends.entry(*texture).or_default();
+            let slot = match ends.iter().position(|end| *end < first) {
+                Some(slot) => {
+                    ends[slot] = last;
+                    slot
+                }
+                None => {
+                    ends.push(last);
+                    ends.len() - 1
+                }
+            };
+            slots[index] = Some(slot);
+        }
+
+        Ok(Plan {
+            passes,
+            submit_after,
+            slots,
+        })
+    }
+}
+
+/// The result of [`RenderGraph::compile`].
+struct Plan {
+    /// The passes that run, in order.
+    passes: Vec<usize>,
+    /// Whether to submit after the pass at the same position in `passes`.
+    submit_after: Vec<bool>,
+    /// The texture each transient resource uses, out of the pooled textures of its description.
+    slots: Vec<Option<usize>>,
+}
+
+/// Declares the resources of a pass. See [`RenderGraph::add_pass`].
+pub struct PassBuilder<'g, 'a, C> {
+    graph: &'g mut RenderGraph<'a, C>,
+    name: &'static str,
+    reads: Vec<ResourceId>,
+    writes: Vec<ResourceId>,
+    uploads: Vec<&'static str>,
+    side_effects: bool,
+}
+
+impl<'g, 'a, C> PassBuilder<'g, 'a, C> {
+    pub fn read(mut self, resource: ResourceId) -> Self {
+        self.reads.push(resource);
+        self
+    }
+
+    pub fn write(mut self, resource: ResourceId) -> Self {
+        self.writes.push(resource);
+        self
+    }
+
+    /// A pass that loads an attachment and draws on top of it both reads and writes it.
+    pub fn read_write(self, resource: ResourceId) -> Self {
+        self.read(resource).write(resource)
+    }
+
+    /// Marks that the pass writes buffers named by `key` through the queue while it records.
+    /// Two passes uploading under the same key are never submitted together.
+    pub fn uploads(mut self, key: &'static str) -> Self {
+        self.uploads.push(key);
+        self
+    }
+
+    /// Keeps the pass even if nothing reads what it writes.
+    pub fn side_effects(mut self) -> Self {
+        self.side_effects = true;
+        self
+    }
+
+    /// Adds the pass with the function that records it.
+    pub fn build(self, run: impl FnOnce(&mut C, &mut PassContext<'_>) + 'a) {
+        self.graph.passes.push(Pass {
+            name: self.name,
+            reads: self.reads,
+            writes: self.writes,
+            uploads: self.uploads,
+            side_effects: self.side_effects,
+            run: Box::new(run),
+        });
+    }
+}
+
+/// The textures behind the transient resources of [`RenderGraph`]s, kept between frames.
+#[derive(Default)]
+pub struct TransientPool {
+    textures: HashMap<TransientTexture, Vec<PooledTexture>>,
+    frame: u64,
+}
+
+struct PooledTexture {
+    view: wgpu::TextureView,
+    last_used: u64,
+}
+
+impl TransientPool {
+    fn acquire(
+        &mut self,
+        device: &wgpu::Device,
+        texture: &TransientTexture,
+        slot: usize,
+        label: &str,
+    ) -> wgpu::TextureView {
+        let pooled = self.textures.entry(*texture).or_default();
+        while pooled.len() <= slot {
+            puffin::profile_scope!("allocating transient texture", label);
+            let created = device.create_texture(&wgpu::TextureDescriptor {
+                label: Some(label),
+                size: texture.size,
+                mip_level_count: 1,
+                sample_count: texture.sample_count,
+                dimension: wgpu::TextureDimension::D2,
+                format: texture.format,
+                usage: texture.usage,
+                view_formats: &[],
+            });
+            pooled.push(PooledTexture {
+                view: created.create_view(&wgpu::TextureViewDescriptor::default()),
+                last_used: self.frame,
+            });
+        }
+
+        pooled[slot].last_used = self.frame;
+        pooled[slot].view.clone()
+    }
+
+    /// Drops the textures that went unused for a while, such as those of an old viewport size.
+    fn trim(&mut self) {
+        let frame = self.frame;
+        // slots are handed out lowest first, so the spare textures are always at the end
+        for pooled in self.textures.values_mut() {
+            while pooled
+                .last()
+                .is_some_and(|texture| texture.last_used + POOL_KEEP_FRAMES < frame)
+            {
+                pooled.pop();
+            }
+        }
+        self.textures.retain(|_, pooled| !pooled.is_empty());
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const TARGET: TransientTexture = TransientTexture {
+        size: wgpu::Extent3d {
+            width: 64,
+            height: 64,
+            depth_or_array_layers: 1,
+        },
+        format: wgpu::TextureFormat::Rgba16Float,
+        usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
+        sample_count: 1,
+    };
+
+    fn noop(_: &mut (), _: &mut PassContext<'_>) {}
+
+    #[test]
+    fn culls_passes_nobody_reads() {
+        let mut graph = RenderGraph::<()>::new();
+        let output = graph.import("output");
+        let unused = graph.transient("unused", TARGET);
+        graph.add_pass("unused").write(unused).build(noop);
+        graph.add_pass("output").write(output).build(noop);
+        graph.add_pass("effect").side_effects().build(noop);
+
+        let plan = graph.compile().unwrap();
+        assert_eq!(plan.passes, vec![1, 2]);
+        assert_eq!(plan.slots[unused.0], None);
+    }
+
+    #[test]
+    fn aliases_transients_that_do_not_overlap() {
+        let mut graph = RenderGraph::<()>::new();
+        let output = graph.import("output");
+        let a = graph.transient("a", TARGET);
+        let b = graph.transient("b", TARGET);
+        let c = graph.transient("c", TARGET);
+        graph.add_pass("write a").write(a).build(noop);
+        graph.add_pass("a to b").read(a).write(b).build(noop);
+        graph.add_pass("b to c").read(b).write(c).build(noop);
+        graph
+            .add_pass("c to output")
+            .read(c)
+            .write(output)
+            .build(noop);
+
+        let plan = graph.compile().unwrap();
+        // a and b are alive together in "a to b", but a is done by the time c is written
+        assert_eq!(plan.slots[a.0], Some(0));
+        assert_eq!(plan.slots[b.0], Some(1));
+        assert_eq!(plan.slots[c.0], Some(0));
+    }
+
+    #[test]
+    fn submits_only_between_clashing_uploads() {
+        let mut graph = RenderGraph::<()>::new();
+        let output = graph.import("output");
+        graph
+            .add_pass("first")
+            .write(output)
+            .uploads("ui")
+            .build(noop);
+        graph.add_pass("second").read_write(output).build(noop);
+        graph
+            .add_pass("third")
+            .read_write(output)
+            .uploads("ui")
+            .build(noop);
+
+        let plan = graph.compile().unwrap();
+        assert_eq!(plan.submit_after, vec![false, true, true]);
+    }
+
+    #[test]
+    fn rejects_reading_an_unwritten_transient() {
+        let mut graph = RenderGraph::<()>::new();
+        let output = graph.import("output");
+        let target = graph.transient("target", TARGET);
+        graph
+            .add_pass("read")
+            .read(target)
+            .write(output)
+            .build(noop);
+
+        assert!(graph.compile().is_err());
+    }
+}
@@ -17,6 +17,10 @@ pub trait Scene {
     fn physics_update(&mut self, dt: f32, graphics: Arc<SharedGraphicsContext>, ui: &mut Ui);
     fn update(&mut self, dt: f32, graphics: Arc<SharedGraphicsContext>, ui: &mut Ui);
     fn render<'a>(&mut self, graphics: Arc<SharedGraphicsContext>, ui: &mut Ui);
+    /// Called every frame before [`Self::update`] with how far the frame is between the last
+    /// fixed physics step and the next one, from `0.0` to `1.0`, so the scene can draw its bodies
+    /// blended between the last two steps.
+    fn set_physics_alpha(&mut self, _alpha: f32) {}
     fn exit(&mut self, event_loop: &ActiveEventLoop);
     fn handle_event(&mut self, _event: &WindowEvent) {}
     /// By far a mess of a trait however it works.
@@ -174,6 +178,14 @@ impl Manager {
         }
     }
 
+    pub fn set_physics_alpha(&mut self, alpha: f32) {
+        if let Some(scene_name) = &self.current_scene
+            && let Some(scene) = self.scenes.get_mut(scene_name)
+        {
+            scene.write().set_physics_alpha(alpha)
+        }
+    }
+
     pub fn render<'a>(&mut self, graphics: Arc<SharedGraphicsContext>, ui: &mut Ui) {
         puffin::profile_function!();
         if let Some(scene_name) = &self.current_scene
@@ -0,0 +1,175 @@
+/// Bakes the image based lighting maps of an environment cubemap.
+///
+/// - `prefilter_specular` convolves the environment with the GGX lobe of `params.roughness`,
+///   with one dispatch per mip level of the specular cubemap.
+/// - `convolve_irradiance` produces the cosine weighted irradiance used for diffuse lighting.
+/// - `integrate_brdf` produces the split-sum BRDF lookup table, indexed by (N·V, roughness).
+///
+/// Cubemap outputs are D2Array storage views, with all 6 faces processed in the Z dimension.
+
+const PI: f32 = 3.14159265358979;
+
+struct BakeParams {
+    roughness:    f32,
+    sample_count: u32,
+    // size of mip 0 of `env_map`
+    source_size:  f32,
+    // mip of `env_map` read by `convolve_irradiance`
+    source_lod:   f32,
+}
+
+@group(0) @binding(0) var env_map:     texture_cube<f32>;
+@group(0) @binding(1) var env_sampler: sampler;
+@group(0) @binding(2) var dst:         texture_storage_2d_array<rgba16float, write>;
+@group(0) @binding(3) var<uniform> params: BakeParams;
+
+// the LUT does not depend on the environment, so it lives in its own group
+@group(1) @binding(0) var brdf_lut: texture_storage_2d<rgba16float, write>;
+
+const BRDF_SAMPLE_COUNT: u32 = 1024u;
+
+/// Direction through the centre of a texel, following the standard cube face layout so the
+/// result is sampled back with the same direction it was computed for.
+fn cube_direction(gid: vec3<u32>, size: vec2<u32>) -> vec3<f32> {
+    let uv = (vec2<f32>(gid.xy) + 0.5) / vec2<f32>(size) * 2.0 - 1.0;
+    switch gid.z {
+        case 0u: { return normalize(vec3<f32>(1.0, -uv.y, -uv.x)); }
+        case 1u: { return normalize(vec3<f32>(-1.0, -uv.y, uv.x)); }
+        case 2u: { return normalize(vec3<f32>(uv.x, 1.0, uv.y)); }
+        case 3u: { return normalize(vec3<f32>(uv.x, -1.0, -uv.y)); }
+        case 4u: { return normalize(vec3<f32>(uv.x, -uv.y, 1.0)); }
+        default: { return normalize(vec3<f32>(-uv.x, -uv.y, -1.0)); }
+    }
+}
+
+fn hammersley(i: u32, n: u32) -> vec2<f32> {
+    return vec2<f32>(f32(i) / f32(n), f32(reverseBits(i)) * 2.3283064365386963e-10);
+}
+
+/// Rotates a tangent-space vector (Z up) into the space around `n`.
+fn to_world(v: vec3<f32>, n: vec3<f32>) -> vec3<f32> {
+    let up        = select(vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 0.0, 1.0), abs(n.z) < 0.999);
+    let tangent   = normalize(cross(up, n));
+    let bitangent = cross(n, tangent);
+    return normalize(tangent * v.x + bitangent * v.y + n * v.z);
+}
+
+fn importance_sample_ggx(xi: vec2<f32>, n: vec3<f32>, roughness: f32) -> vec3<f32> {
+    let a         = roughness * roughness;
+    let phi       = 2.0 * PI * xi.x;
+    let cos_theta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    let sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+    return to_world(vec3<f32>(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta), n);
+}
+
+fn distribution_ggx(n_dot_h: f32, roughness: f32) -> f32 {
+    let a  = roughness * roughness;
+    let a2 = a * a;
+    let d  = n_dot_h * n_dot_h * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+fn geometry_schlick_ggx(n_dot_v: f32, roughness: f32) -> f32 {
+    // IBL remapping of k
+    let k = roughness * roughness / 2.0;
+    return n_dot_v / (n_dot_v * (1.0 - k) + k);
+}
+
+@compute @workgroup_size(8, 8, 1)
+fn prefilter_specular(@builtin(global_invocation_id) gid: vec3<u32>) {
+    let size = textureDimensions(dst);
+    if gid.x >= size.x || gid.y >= size.y || gid.z >= 6u {
+        return;
+    }
+
+    let n = cube_direction(gid, size);
+
+    // a perfect mirror only needs the environment, downsampled to this size
+    if params.roughness <= 0.0 {
+        let lod = max(log2(params.source_size / f32(size.x)), 0.0);
+        textureStore(dst, gid.xy, gid.z, textureSampleLevel(env_map, env_sampler, n, lod));
+        return;
+    }
+
+    // each sample reads the mip whose texels cover the same solid angle as the sample, which
+    // removes the fireflies caused by bright spots of the sky with low sample counts.
+    let texel_solid_angle = 4.0 * PI / (6.0 * params.source_size * params.source_size);
+
+    var colour = vec3<f32>(0.0);
+    var weight = 0.0;
+    for (var i = 0u; i < params.sample_count; i++) {
+        let h = importance_sample_ggx(hammersley(i, params.sample_count), n, params.roughness);
+        let l = normalize(2.0 * dot(n, h) * h - n);
+        let n_dot_l = dot(n, l);
+        if n_dot_l > 0.0 {
+            // pdf = D * (N·H) / (4 * V·H), with V = N
+            let pdf = distribution_ggx(max(dot(n, h), 0.0), params.roughness) * 0.25;
+            let sample_solid_angle = 1.0 / (f32(params.sample_count) * pdf + 0.0001);
+            let lod = max(0.5 * log2(sample_solid_angle / texel_solid_angle), 0.0);
+
+            colour += textureSampleLevel(env_map, env_sampler, l, lod).rgb * n_dot_l;
+            weight += n_dot_l;
+        }
+    }
+
+    textureStore(dst, gid.xy, gid.z, vec4<f32>(colour / max(weight, 0.0001), 1.0));
+}
+
+@compute @workgroup_size(8, 8, 1)
+fn convolve_irradiance(@builtin(global_invocation_id) gid: vec3<u32>) {
+    let size = textureDimensions(dst);
+    if gid.x >= size.x || gid.y >= size.y || gid.z >= 6u {
+        return;
+    }
+
+    let n = cube_direction(gid, size);
+
+    // cosine weighted samples, so the average radiance is the irradiance divided by PI, which
+    // is exactly what a lambertian surface reflects per unit of albedo.
+    var irradiance = vec3<f32>(0.0);
+    for (var i = 0u; i < params.sample_count; i++) {
+        let xi = hammersley(i, params.sample_count);
+        let phi = 2.0 * PI * xi.x;
+        let sin_theta = sqrt(xi.y);
+        let l = to_world(vec3<f32>(cos(phi) * sin_theta, sin(phi) * sin_theta, sqrt(1.0 - xi.y)), n);
+        irradiance += textureSampleLevel(env_map, env_sampler, l, params.source_lod).rgb;
+    }
+
+    textureStore(dst, gid.xy, gid.z, vec4<f32>(irradiance / f32(params.sample_count), 1.0));
+}
+
+@compute @workgroup_size(8, 8, 1)
+fn integrate_brdf(@builtin(global_invocation_id) gid: vec3<u32>) {
+    let size = textureDimensions(brdf_lut);
+    if gid.x >= size.x || gid.y >= size.y {
+        return;
+    }
+
+    let n_dot_v   = (f32(gid.x) + 0.5) / f32(size.x);
+    let roughness = (f32(gid.y) + 0.5) / f32(size.y);
+
+    let v = vec3<f32>(sqrt(1.0 - n_dot_v * n_dot_v), 0.0, n_dot_v);
+    let n = vec3<f32>(0.0, 0.0, 1.0);
+
+    var scale = 0.0;
+    var bias  = 0.0;
+    for (var i = 0u; i < BRDF_SAMPLE_COUNT; i++) {
+        let h = importance_sample_ggx(hammersley(i, BRDF_SAMPLE_COUNT), n, roughness);
+        let l = normalize(2.0 * dot(v, h) * h - v);
+
+        let n_dot_l = max(l.z, 0.0);
+        let n_dot_h = max(h.z, 0.0);
+        let v_dot_h = max(dot(v, h), 0.0);
+
+        if n_dot_l > 0.0 {
+            let g     = geometry_schlick_ggx(n_dot_v, roughness) * geometry_schlick_ggx(n_dot_l, roughness);
+            let g_vis = g * v_dot_h / (n_dot_h * n_dot_v);
+            let fc    = pow(1.0 - v_dot_h, 5.0);
+            scale += (1.0 - fc) * g_vis;
+            bias  += fc * g_vis;
+        }
+    }
+
+    let count = f32(BRDF_SAMPLE_COUNT);
+    textureStore(brdf_lut, gid.xy, vec4<f32>(scale / count, bias / count, 0.0, 1.0));
+}
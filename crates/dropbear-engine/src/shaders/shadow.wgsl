@@ -0,0 +1,36 @@
+/// Depth-only pass used to render shadow maps, see `shadows.rs`.
+///
+/// Every cascade and atlas tile gets its own `ShadowPass` slot, bound with a dynamic offset.
+
+struct ShadowPass {
+    view_proj: mat4x4<f32>,
+}
+
+@group(0) @binding(0) var<uniform> u_pass: ShadowPass;
+
+struct VertexInput {
+    @location(0)  position:       vec3<f32>,
+    @location(8)  model_matrix_0: vec4<f32>,
+    @location(9)  model_matrix_1: vec4<f32>,
+    @location(10) model_matrix_2: vec4<f32>,
+    @location(11) model_matrix_3: vec4<f32>,
+}
+
+@vertex
+fn vs_main(in: VertexInput) -> @builtin(position) vec4<f32> {
+    let model_matrix = mat4x4<f32>(
+        in.model_matrix_0,
+        in.model_matrix_1,
+        in.model_matrix_2,
+        in.model_matrix_3,
+    );
+    return u_pass.view_proj * model_matrix * vec4<f32>(in.position, 1.0);
+}
+
+/// Resets the depth of the current viewport. Atlas tiles share one texture, so they cannot be
+/// cleared with a load op without wiping every other light.
+@vertex
+fn vs_clear(@builtin(vertex_index) id: u32) -> @builtin(position) vec4<f32> {
+    let uv = vec2<f32>(f32((id << 1u) & 2u), f32(id & 2u));
+    return vec4<f32>(uv * 2.0 - 1.0, 1.0, 1.0);
+}
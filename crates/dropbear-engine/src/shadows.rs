@@ -0,0 +1,1169 @@
+//! Shadow maps for lights with [`LightComponent::cast_shadows`](crate::lighting::LightComponent::cast_shadows).
+//!
+//! - The first shadow casting directional light gets cascaded shadow maps, stored as layers of a
+//!   depth texture array and fitted to slices of the camera frustum.
+//! - Spot lights get one tile of a shared depth atlas, and point lights get six (one per cube face).
+//!
+//! Every cascade and tile is rendered with a depth-only pipeline that reuses the instance buffers
+//! of static models. Rendering is throttled, as a tile is only re-rendered when its light changes
+//! or when a caster in range of the light moves, and every frame has a budget of
+//! [`ShadowSettings::max_views_per_frame`] views. Anything over budget keeps its previous
+//! (slightly stale) map and is picked up on a later frame, oldest first.
+//!
+//! Shadows are sampled in `shaders/common/shadow.wesl`, through group 0 of the main shader.
+
+use crate::buffer::{DynamicBuffer, StorageBuffer};
+use crate::camera::Camera;
+use crate::graphics::{InstanceRaw, SharedGraphicsContext};
+use crate::lighting::{Light, LightComponent, LightType};
+use crate::model::{Model, ModelVertex, Vertex};
+use glam::{DVec3, Mat4, Vec3, Vec4};
+use hecs::Entity;
+use std::collections::HashMap;
+use std::hash::{DefaultHasher, Hash, Hasher};
+
+pub const MAX_CASCADES: usize = 4;
+pub const MAX_SHADOW_TILES: usize = 64;
+pub const SHADOW_FORMAT: wgpu::TextureFormat = wgpu::TextureFormat::Depth32Float;
+
+/// How many views a light of each kind needs.
+const POINT_FACES: usize = 6;
+/// One dynamic uniform slot per cascade and per atlas tile.
+const PASS_SLOTS: usize = MAX_CASCADES + MAX_SHADOW_TILES;
+
+/// Mirrors the `SHADOW_*` constants of `shadow.wesl`.
+#[repr(i32)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+enum ShadowKind {
+    None = 0,
+    Cascaded = 1,
+    Spot = 2,
+    Point = 3,
+}
+
+impl ShadowKind {
+    fn tile_count(&self) -> usize {
+        match self {
+            ShadowKind::None | ShadowKind::Cascaded => 0,
+            ShadowKind::Spot => 1,
+            ShadowKind::Point => POINT_FACES,
+        }
+    }
+}
+
+/// Quality and budget settings of the [`ShadowRenderer`].
+///
+/// The resolutions are only read when the renderer is created.
+#[derive(Clone, Debug, serde::Serialize, serde::Deserialize)]
+pub struct ShadowSettings {
+    pub enabled: bool,
+    /// Up to [`MAX_CASCADES`].
+    pub cascade_count: u32,
+    pub cascade_resolution: u32,
+    /// How far from the camera directional shadows reach.
+    pub max_distance: f32,
+    /// Blends between uniform (0.0) and logarithmic (1.0) cascade splits.
+    pub split_lambda: f32,
+    pub atlas_resolution: u32,
+    pub tile_resolution: u32,
+    /// The amount of cascades and atlas tiles that can be re-rendered each frame.
+    pub max_views_per_frame: u32,
+    pub depth_bias: f32,
+    /// World units to push the sampled position along its normal, which hides acne on slopes.
+    pub normal_bias: f32,
+}
+
+impl Default for ShadowSettings {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            cascade_count: 4,
+            cascade_resolution: 2048,
+            max_distance: 150.0,
+            split_lambda: 0.75,
+            atlas_resolution: 4096,
+            tile_resolution: 512,
+            max_views_per_frame: 8,
+            depth_bias: 0.0005,
+            normal_bias: 0.05,
+        }
+    }
+}
+
+/// Statistics of the last [`ShadowRenderer::render`].
+#[derive(Default, Clone, Copy, Debug)]
+pub struct ShadowStats {
+    pub views_rendered: u32,
+    pub lights_shadowed: u32,
+    /// Lights that needed an update but did not fit in the budget.
+    pub lights_deferred: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, bytemuck::Pod, bytemuck::Zeroable)]
+struct ShadowTileUniform {
+    view_proj: [[f32; 4]; 4],
+    rect: [f32; 4],
+}
+
+/// As defined by `ShadowData` in `shaders/common/shadow.wesl`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, bytemuck::Pod, bytemuck::Zeroable)]
+struct ShadowUniform {
+    cascade_view_proj: [[[f32; 4]; 4]; MAX_CASCADES],
+    cascade_splits: [f32; 4],
+    cascade_count: u32,
+    depth_bias: f32,
+    normal_bias: f32,
+    _padding: f32,
+    tiles: [ShadowTileUniform; MAX_SHADOW_TILES],
+}
+
+/// A batch of static instances that casts shadows.
+pub struct ShadowCaster<'a> {
+    /// Identifies the batch from one frame to the next, such as the handle of its model.
+    pub id: u64,
+    pub model: &'a Model,
+    /// Every instance in the buffer casts a shadow.
+    pub instances: &'a DynamicBuffer<InstanceRaw>,
+}
+
+/// The world-space bounds of a [`ShadowCaster`], used to tell which lights it reaches and
+/// whether it has moved. Kept between frames and only rebuilt when the instance buffer is
+/// uploaded again.
+struct CasterBounds {
+    /// The [`DynamicBuffer::generation`] the bounds were built from.
+    generation: u64,
+    /// The bounding sphere of the caster's model in model space, which only has to be found once.
+    model: (Vec3, f32),
+    /// Bounding spheres of the instances, the model's sphere moved by each of their transforms.
+    spheres: Vec<(Vec3, f32)>,
+    /// A sphere around all of `spheres`.
+    total: (Vec3, f32),
+    /// A hash of all of `spheres`.
+    stamp: u64,
+    seen: bool,
+}
+
+impl CasterBounds {
+    fn new(generation: u64, model: (Vec3, f32), instances: &[InstanceRaw]) -> Self {
+        let (centre, radius) = model;
+        let spheres = instances
+            .iter()
+            .map(|instance| {
+                let matrix = instance.model_matrix();
+                let scale = matrix
+                    .x_axis
+                    .truncate()
+                    .length()
+                    .max(matrix.y_axis.truncate().length())
+                    .max(matrix.z_axis.truncate().length());
+                (matrix.transform_point3(centre), radius * scale)
+            })
+            .collect();
+        Self::from_spheres(generation, model, spheres)
+    }
+
+    fn from_spheres(generation: u64, model: (Vec3, f32), spheres: Vec<(Vec3, f32)>) -> Self {
+        let (min, max) = spheres.iter().fold(
+            (Vec3::splat(f32::MAX), Vec3::splat(f32::MIN)),
+            |(min, max), &(position, size)| (min.min(position - size), max.max(position + size)),
+        );
+        let centre = if spheres.is_empty() {
+            Vec3::ZERO
+        } else {
+            (min + max) * 0.5
+        };
+        let radius = spheres
+            .iter()
+            .map(|(position, size)| position.distance(centre) + size)
+            .fold(0.0, f32::max);
+
+        Self {
+            generation,
+            model,
+            stamp: hash_spheres(spheres.iter()),
+            total: (centre, radius),
+            spheres,
+            seen: true,
+        }
+    }
+
+    fn reaches(&self, centre: Vec3, radius: f32) -> bool {
+        let distance = self.total.0.distance(centre);
+        if self.spheres.is_empty() || distance > radius + self.total.1 {
+            return false;
+        }
+        distance + self.total.1 <= radius
+            || self
+                .spheres
+                .iter()
+                .any(|(position, size)| position.distance(centre) <= radius + size)
+    }
+
+    /// A hash of the spheres within `range`, or `None` if there are none. Only batches that
+    /// straddle the edge of the range are hashed sphere by sphere.
+    fn stamp_within(&self, range: Option<(Vec3, f32)>) -> Option<u64> {
+        let Some((centre, radius)) = range else {
+            return (!self.spheres.is_empty()).then_some(self.stamp);
+        };
+        if !self.reaches(centre, radius) {
+            return None;
+        }
+        if self.total.0.distance(centre) + self.total.1 <= radius {
+            return Some(self.stamp);
+        }
+        let within = |(position, size): &&(Vec3, f32)| position.distance(centre) <= radius + size;
+        Some(hash_spheres(self.spheres.iter().filter(within)))
+    }
+}
+
+fn hash_spheres<'a>(spheres: impl Iterator<Item = &'a (Vec3, f32)>) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    for (position, size) in spheres {
+        Vec4::new(position.x, position.y, position.z, *size)
+            .to_array()
+            .map(f32::to_bits)
+            .hash(&mut hasher);
+    }
+    hasher.finish()
+}
+
+/// The views that may still be rendered this frame.
+struct ViewBudget {
+    remaining: u32,
+    /// Whether any light (as opposed to a cascade) has been rendered.
+    lit: bool,
+}
+
+impl ViewBudget {
+    fn new(views: u32) -> Self {
+        Self {
+            remaining: views,
+            lit: false,
+        }
+    }
+
+    fn take_cascade(&mut self) -> bool {
+        if self.remaining == 0 {
+            return false;
+        }
+        self.remaining -= 1;
+        true
+    }
+
+    /// A light that costs more than the whole budget still goes through on its own, so it is
+    /// never starved.
+    fn take_light(&mut self, views: u32) -> bool {
+        if views > self.remaining && self.lit {
+            return false;
+        }
+        self.remaining = self.remaining.saturating_sub(views);
+        self.lit = true;
+        true
+    }
+}
+
+struct ShadowedLight {
+    kind: ShadowKind,
+    first_tile: usize,
+    position: Vec3,
+    range: f32,
+    view_projs: Vec<Mat4>,
+    /// Hash of everything about the light that changes its shadow.
+    key: u64,
+    /// The key and caster stamp that the tiles were last rendered with.
+    rendered: Option<(u64, u64)>,
+    last_update: u64,
+    seen: bool,
+}
+
+#[derive(Default, Clone, Copy)]
+struct CascadeState {
+    view_proj: Mat4,
+    rendered: Option<(Mat4, u64)>,
+    last_update: u64,
+}
+
+/// Renders and owns every shadow map. See the [module docs](self) for more info.
+pub struct ShadowRenderer {
+    settings: ShadowSettings,
+    stats: ShadowStats,
+    frame: u64,
+
+    cascade_texture: wgpu::Texture,
+    cascade_view: wgpu::TextureView,
+    cascade_layer_views: Vec<wgpu::TextureView>,
+    atlas_texture: wgpu::Texture,
+    atlas_view: wgpu::TextureView,
+    sampler: wgpu::Sampler,
+    buffer: StorageBuffer<ShadowUniform>,
+
+    pass_stride: u64,
+    pass_buffer: wgpu::Buffer,
+    pass_bind_group: wgpu::BindGroup,
+    depth_pipeline: wgpu::RenderPipeline,
+    clear_pipeline: wgpu::RenderPipeline,
+
+    uniform: Box<ShadowUniform>,
+    directional: Option<(Entity, Vec3)>,
+    cascades: [CascadeState; MAX_CASCADES],
+    lights: HashMap<Entity, ShadowedLight>,
+    /// Lights whose [`LightUniform::shadow`](crate::lighting::LightUniform::shadow) was changed
+    /// by the last [`Self::assign`].
+    reassigned: Vec<Entity>,
+    tiles_in_use: Vec<bool>,
+    caster_bounds: HashMap<u64, CasterBounds>,
+}
+
+impl ShadowRenderer {
+    pub fn new(graphics: &SharedGraphicsContext, settings: ShadowSettings) -> Self {
+        puffin::profile_function!();
+        let device = &graphics.device;
+
+        let cascade_texture = device.create_texture(&wgpu::TextureDescriptor {
+            label: Some("shadow cascades"),
+            size: wgpu::Extent3d {
+                width: settings.cascade_resolution,
+                height: settings.cascade_resolution,
+                depth_or_array_layers: MAX_CASCADES as u32,
+            },
+            mip_level_count: 1,
+            sample_count: 1,
+            dimension: wgpu::TextureDimension::D2,
+            format: SHADOW_FORMAT,
+            usage: wgpu::TextureUsages::RENDER_ATTACHMENT | wgpu::TextureUsages::TEXTURE_BINDING,
+            view_formats: &[],
+        });
+        let cascade_view = cascade_texture.create_view(&wgpu::TextureViewDescriptor {
+            label: Some("shadow cascades view"),
+            dimension: Some(wgpu::TextureViewDimension::D2Array),
+            ..Default::default()
+        });
+        let cascade_layer_views = (0..MAX_CASCADES as u32)
+            .map(|layer| {
+                cascade_texture.create_view(&wgpu::TextureViewDescriptor {
+                    label: Some("shadow cascade layer view"),
+                    dimension: Some(wgpu::TextureViewDimension::D2),
+                    base_array_layer: layer,
+                    array_layer_count: Some(1),
+                    ..Default::default()
+                })
+            })
+            .collect();
+
+        let atlas_texture = device.create_texture(&wgpu::TextureDescriptor {
+            label: Some("shadow atlas"),
+            size: wgpu::Extent3d {
+                width: settings.atlas_resolution,
+                height: settings.atlas_resolution,
+                depth_or_array_layers: 1,
+            },
+            mip_level_count: 1,
+            sample_count: 1,
+            dimension: wgpu::TextureDimension::D2,
+            format: SHADOW_FORMAT,
+            usage: wgpu::TextureUsages::RENDER_ATTACHMENT | wgpu::TextureUsages::TEXTURE_BINDING,
+            view_formats: &[],
+        });
+        let atlas_view = atlas_texture.create_view(&Default::default());
+
+        let sampler = device.create_sampler(&wgpu::SamplerDescriptor {
+            label: Some("shadow sampler"),
+            address_mode_u: wgpu::AddressMode::ClampToEdge,
+            address_mode_v: wgpu::AddressMode::ClampToEdge,
+            address_mode_w: wgpu::AddressMode::ClampToEdge,
+            mag_filter: wgpu::FilterMode::Linear,
+            min_filter: wgpu::FilterMode::Linear,
+            compare: Some(wgpu::CompareFunction::LessEqual),
+            ..Default::default()
+        });
+
+        let buffer = StorageBuffer::new_read_only(device, "shadow storage buffer");
+
+        let pass_stride = (std::mem::size_of::<[[f32; 4]; 4]>() as u64)
+            .next_multiple_of(device.limits().min_uniform_buffer_offset_alignment as u64);
+        let pass_buffer = device.create_buffer(&wgpu::BufferDescriptor {
+            label: Some("shadow pass buffer"),
+            size: pass_stride * PASS_SLOTS as u64,
+            usage: wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_DST,
+            mapped_at_creation: false,
+        });
+
+        let pass_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("shadow pass bind group layout"),
+            entries: &[wgpu::BindGroupLayoutEntry {
+                binding: 0,
+                visibility: wgpu::ShaderStages::VERTEX,
+                ty: wgpu::BindingType::Buffer {
+                    ty: wgpu::BufferBindingType::Uniform,
+                    has_dynamic_offset: true,
+                    min_binding_size: wgpu::BufferSize::new(
+                        std::mem::size_of::<[[f32; 4]; 4]>() as u64
+                    ),
+                },
+                count: None,
+            }],
+        });
+        let pass_bind_group = device.create_bind_group(&wgpu::BindGroupDescriptor {
+            label: Some("shadow pass bind group"),
+            layout: &pass_layout,
+            entries: &[wgpu::BindGroupEntry {
+                binding: 0,
+                resource: wgpu::BindingResource::Buffer(wgpu::BufferBinding {
+                    buffer: &pass_buffer,
+                    offset: 0,
+                    size: wgpu::BufferSize::new(std::mem::size_of::<[[f32; 4]; 4]>() as u64),
+                }),
+            }],
+        });
+
+        let layout = device.create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
+            label: Some("shadow pipeline layout"),
+            bind_group_layouts: &[Some(&pass_layout)],
+            immediate_size: 0,
+        });
+        let module = device.create_shader_module(wgpu::include_wgsl!("shaders/shadow.wgsl"));
+
+        let create_pipeline = |label: &str,
+                               entry_point: &str,
+                               buffers: &[wgpu::VertexBufferLayout],
+                               compare: wgpu::CompareFunction,
+                               bias: wgpu::DepthBiasState| {
+            device.create_render_pipeline(&wgpu::RenderPipelineDescriptor {
+                label: Some(label),
+                layout: Some(&layout),
+                vertex: wgpu::VertexState {
+                    module: &module,
+                    entry_point: Some(entry_point),
+                    compilation_options: Default::default(),
+                    buffers,
+                },
+                fragment: None,
+                primitive: wgpu::PrimitiveState {
+                    topology: wgpu::PrimitiveTopology::TriangleList,
+                    strip_index_format: None,
+                    front_face: wgpu::FrontFace::Cw,
+                    // single sided geometry (such as planes) still has to cast
+                    cull_mode: None,
+                    polygon_mode: wgpu::PolygonMode::Fill,
+                    unclipped_depth: false,
+                    conservative: false,
+                },
+                depth_stencil: Some(wgpu::DepthStencilState {
+                    format: SHADOW_FORMAT,
+                    depth_write_enabled: Some(true),
+                    depth_compare: Some(compare),
+                    stencil: wgpu::StencilState::default(),
+                    bias,
+                }),
+                multisample: wgpu::MultisampleState::default(),
+                cache: graphics.pipeline_cache.get(),
+                multiview_mask: None,
+            })
+        };
+
+        let depth_pipeline = create_pipeline(
+            "shadow depth pipeline",
+            "vs_main",
+            &[ModelVertex::desc(), InstanceRaw::desc()],
+            wgpu::CompareFunction::Less,
+            wgpu::DepthBiasState {
+                constant: 2,
+                slope_scale: 2.0,
+                clamp: 0.0,
+            },
+        );
+        let clear_pipeline = create_pipeline(
+            "shadow clear pipeline",
+            "vs_clear",
+            &[],
+            wgpu::CompareFunction::Always,
+            wgpu::DepthBiasState::default(),
+        );
+
+        let tile_count = Self::tiles_per_row(&settings).pow(2).min(MAX_SHADOW_TILES);
+
+        Self {
+            settings,
+            stats: ShadowStats::default(),
+            frame: 0,
+            cascade_texture,
+            cascade_view,
+            cascade_layer_views,
+            atlas_texture,
+            atlas_view,
+            sampler,
+            buffer,
+            pass_stride,
+            pass_buffer,
+            pass_bind_group,
+            depth_pipeline,
+            clear_pipeline,
+            uniform: Box::new(bytemuck::Zeroable::zeroed()),
+            directional: None,
+            cascades: [CascadeState::default(); MAX_CASCADES],
+            lights: HashMap::new(),
+            reassigned: Vec::new(),
+            tiles_in_use: vec![false; tile_count],
+            caster_bounds: HashMap::new(),
+        }
+    }
+
+    pub fn settings(&self) -> &ShadowSettings {
+        &self.settings
+    }
+
+    /// Updates the settings that do not require new textures (everything but the resolutions).
+    pub fn set_settings(&mut self, settings: ShadowSettings) {
+        let resolutions = (
+            self.settings.cascade_resolution,
+            self.settings.atlas_resolution,
+            self.settings.tile_resolution,
+        );
+        self.settings = ShadowSettings {
+            cascade_resolution: resolutions.0,
+            atlas_resolution: resolutions.1,
+            tile_resolution: resolutions.2,
+            ..settings
+        };
+        // force everything to re-render with the new settings
+        for light in self.lights.values_mut() {
+            light.rendered = None;
+        }
+        for cascade in &mut self.cascades {
+            cascade.rendered = None;
+        }
+    }
+
+    pub fn stats(&self) -> ShadowStats {
+        self.stats
+    }
+
+    /// The lights whose shadow map moved in the last [`Self::assign`], so their slot in the light
+    /// buffer has to be written again.
+    pub fn reassigned(&self) -> &[Entity] {
+        &self.reassigned
+    }
+
+    /// The buffer bound at `@group(0) @binding(3)` of the main shader.
+    pub fn buffer(&self) -> &wgpu::Buffer {
+        self.buffer.buffer()
+    }
+
+    pub fn cascade_view(&self) -> &wgpu::TextureView {
+        &self.cascade_view
+    }
+
+    pub fn atlas_view(&self) -> &wgpu::TextureView {
+        &self.atlas_view
+    }
+
+    pub fn sampler(&self) -> &wgpu::Sampler {
+        &self.sampler
+    }
+
+    pub fn cascade_texture(&self) -> &wgpu::Texture {
+        &self.cascade_texture
+    }
+
+    pub fn atlas_texture(&self) -> &wgpu::Texture {
+        &self.atlas_texture
+    }
+
+    fn tiles_per_row(settings: &ShadowSettings) -> usize {
+        (settings.atlas_resolution / settings.tile_resolution.max(1)).max(1) as usize
+    }
+
+    /// Works out which lights get shadows this frame and writes where their shadow map lives into
+    /// [`LightUniform::shadow`](crate::lighting::LightUniform::shadow).
+    ///
+    /// Call this before the light array is uploaded
+    /// ([`LightCubePipeline::update`](crate::pipelines::light_cube::LightCubePipeline::update)).
+    pub fn assign(&mut self, world: &hecs::World, camera: &Camera) {
+        puffin::profile_function!();
+        self.frame += 1;
+        self.directional = None;
+        self.reassigned.clear();
+        for light in self.lights.values_mut() {
+            light.seen = false;
+        }
+
+        for (entity, light) in world.query::<(Entity, &mut Light)>().iter() {
+            let kind = self.kind_of(&light.component);
+            let shadow = match kind {
+                ShadowKind::None => [ShadowKind::None as i32, 0, 0, 0],
+                ShadowKind::Cascaded => {
+                    self.directional = Some((
+                        entity,
+                        light
+                            .component
+                            .direction
+                            .as_vec3()
+                            .normalize_or(Vec3::NEG_Y),
+                    ));
+                    [ShadowKind::Cascaded as i32, 0, 0, 0]
+                }
+                ShadowKind::Spot | ShadowKind::Point => {
+                    match self.track(entity, kind, &light.component, camera.render_origin) {
+                        Some(first_tile) => [kind as i32, first_tile as i32, 0, 0],
+                        None => {
+                            log_once::warn_once!(
+                                "Shadow atlas is full, some lights will not cast shadows"
+                            );
+                            [ShadowKind::None as i32, 0, 0, 0]
+                        }
+                    }
+                }
+            };
+
+            if light.uniform.shadow != shadow {
+                light.uniform.shadow = shadow;
+                self.reassigned.push(entity);
+            }
+        }
+
+        // release the tiles of lights that were removed or stopped casting
+        let tiles_in_use = &mut self.tiles_in_use;
+        self.lights.retain(|_, light| {
+            if !light.seen {
+                tiles_in_use[light.first_tile..light.first_tile + light.kind.tile_count()]
+                    .fill(false);
+            }
+            light.seen
+        });
+
+        if let Some((_, direction)) = self.directional {
+            self.fit_cascades(camera, direction);
+        }
+    }
+
+    fn kind_of(&self, light: &LightComponent) -> ShadowKind {
+        if !self.settings.enabled || !light.enabled || !light.cast_shadows {
+            return ShadowKind::None;
+        }
+        match light.light_type {
+            // only one directional light gets cascades
+            LightType::Directional
+                if self.directional.is_none() && self.settings.cascade_count > 0 =>
+            {
+                ShadowKind::Cascaded
+            }
+            LightType::Directional => ShadowKind::None,
+            LightType::Spot => ShadowKind::Spot,
+            LightType::Point => ShadowKind::Point,
+        }
+    }
+
+    /// Keeps the tiles of a light up to date, returning its first tile.
+    fn track(
+        &mut self,
+        entity: Entity,
+        kind: ShadowKind,
+        component: &LightComponent,
+        origin: DVec3,
+    ) -> Option<usize> {
+        let tile_count = kind.tile_count();
+
+        if let Some(existing) = self.lights.get(&entity) {
+            if existing.kind != kind {
+                let existing = self.lights.remove(&entity).unwrap();
+                self.tiles_in_use
+                    [existing.first_tile..existing.first_tile + existing.kind.tile_count()]
+                    .fill(false);
+            }
+        }
+
+        if !self.lights.contains_key(&entity) {
+            let first_tile = self
+                .tiles_in_use
+                .windows(tile_count)
+                .position(|run| run.iter().all(|used| !used))?;
+            self.tiles_in_use[first_tile..first_tile + tile_count].fill(true);
+            self.lights.insert(
+                entity,
+                ShadowedLight {
+                    kind,
+                    first_tile,
+                    position: Vec3::ZERO,
+                    range: 0.0,
+                    view_projs: Vec::new(),
+                    key: 0,
+                    rendered: None,
+                    last_update: 0,
+                    seen: false,
+                },
+            );
+        }
+
+        let light = self.lights.get_mut(&entity).unwrap();
+        light.seen = true;
+
+        // relative to the render origin like the rest of the frame, which also re-renders the
+        // light when the origin moves
+        let position = (component.position - origin).as_vec3();
+        let direction = component.direction.as_vec3().normalize_or(Vec3::NEG_Y);
+        let near = component.depth.start.max(0.05);
+        let range = component.attenuation.range.max(near + 0.01);
+
+        let mut hasher = DefaultHasher::new();
+        kind.hash(&mut hasher);
+        for value in position.to_array().iter().chain(&direction.to_array()) {
+            value.to_bits().hash(&mut hasher);
+        }
+        component.outer_cutoff_angle.to_bits().hash(&mut hasher);
+        near.to_bits().hash(&mut hasher);
+        range.to_bits().hash(&mut hasher);
+        let key = hasher.finish();
+
+        if key != light.key || light.view_projs.is_empty() {
+            light.key = key;
+            light.position = position;
+            light.range = range;
+            light.view_projs = match kind {
+                ShadowKind::Spot => {
+                    let fov = (component.outer_cutoff_angle * 2.0)
+                        .clamp(1.0, 170.0)
+                        .to_radians();
+                    let proj = Mat4::perspective_lh(fov, 1.0, near, range);
+                    vec![proj * look_towards(position, direction)]
+                }
+                _ => {
+                    let proj = Mat4::perspective_lh(std::f32::consts::FRAC_PI_2, 1.0, near, range);
+                    [
+                        Vec3::X,
+                        Vec3::NEG_X,
+                        Vec3::Y,
+                        Vec3::NEG_Y,
+                        Vec3::Z,
+                        Vec3::NEG_Z,
+                    ]
+                    .into_iter()
+                    .map(|face| proj * look_towards(position, face))
+                    .collect()
+                }
+            };
+        }
+
+        Some(light.first_tile)
+    }
+
+    /// Fits each cascade around a bounding sphere of its slice of the camera frustum, so the
+    /// cascades do not change size (and shimmer) as the camera rotates.
+    fn fit_cascades(&mut self, camera: &Camera, direction: Vec3) {
+        let count = (self.settings.cascade_count as usize).min(MAX_CASCADES);
+        let near = camera.znear as f32;
+        let far = self.settings.max_distance.max(near + 1.0);
+
+        let eye = (camera.eye - camera.render_origin).as_vec3();
+        let forward = camera.forward().as_vec3();
+        let right = camera.up.as_vec3().cross(forward).normalize_or(Vec3::X);
+        let up = forward.cross(right);
+        let tan_y = (camera.settings.fov_y as f32).to_radians() * 0.5;
+        let tan_y = tan_y.tan();
+        let tan_x = tan_y * camera.aspect as f32;
+
+        let light_view = look_towards(Vec3::ZERO, direction);
+        let resolution = self.settings.cascade_resolution as f32;
+
+        let mut split_near = near;
+        for i in 0..count {
+            let t = (i + 1) as f32 / count as f32;
+            let uniform_split = near + (far - near) * t;
+            let log_split = near * (far / near).powf(t);
+            let split_far =
+                uniform_split + (log_split - uniform_split) * self.settings.split_lambda;
+
+            // bounding sphere of the 8 corners of the slice
+            let corners = [split_near, split_far].map(|d| {
+                [(-1.0, -1.0), (1.0, -1.0), (-1.0, 1.0), (1.0, 1.0)].map(|(x, y)| {
+                    eye + forward * d + right * (x * tan_x * d) + up * (y * tan_y * d)
+                })
+            });
+            let corners = corners.as_flattened();
+            let centre = corners.iter().copied().sum::<Vec3>() / corners.len() as f32;
+            let radius = corners
+                .iter()
+                .map(|c| c.distance(centre))
+                .fold(0.0f32, f32::max)
+                .ceil();
+
+            // snap the centre to whole texels so the map does not shimmer as the camera moves
+            let texel = radius * 2.0 / resolution;
+            let centre_ls = light_view.transform_point3(centre);
+            let snapped = Vec3::new(
+                (centre_ls.x / texel).floor() * texel,
+                (centre_ls.y / texel).floor() * texel,
+                centre_ls.z,
+            );
+
+            // pull the near plane back so casters between the slice and the light are included
+            let proj = Mat4::orthographic_lh(
+                snapped.x - radius,
+                snapped.x + radius,
+                snapped.y - radius,
+                snapped.y + radius,
+                snapped.z - radius - far,
+                snapped.z + radius,
+            );
+
+            self.cascades[i].view_proj = proj * light_view;
+            self.uniform.cascade_splits[i] = split_far;
+            split_near = split_far;
+        }
+        self.uniform.cascade_count = count as u32;
+    }
+
+    /// Re-renders the cascades and tiles that are out of date, within the frame budget, and
+    /// uploads the shadow data for the main shader.
+    pub fn render(
+        &mut self,
+        graphics: &SharedGraphicsContext,
+        encoder: &mut wgpu::CommandEncoder,
+        casters: &[ShadowCaster],
+    ) {
+        puffin::profile_function!();
+        self.stats = ShadowStats::default();
+        self.refresh_bounds(casters);
+        let mut budget = ViewBudget::new(self.settings.max_views_per_frame);
+
+        if self.directional.is_none() {
+            self.uniform.cascade_count = 0;
+        } else {
+            let stamp = caster_stamp(&self.caster_bounds, None);
+            for i in 0..self.uniform.cascade_count as usize {
+                let cascade = self.cascades[i];
+                let outdated = cascade.rendered != Some((cascade.view_proj, stamp));
+                // far cascades cover more of the world per texel, so they can lag behind
+                let due = cascade.rendered.is_none()
+                    || self.frame.saturating_sub(cascade.last_update) >= 1 << i;
+                if !outdated || !due || !budget.take_cascade() {
+                    continue;
+                }
+
+                self.write_pass(graphics, i, cascade.view_proj);
+                let mut pass = depth_pass(encoder, &self.cascade_layer_views[i], true);
+                self.draw_casters(&mut pass, i, casters, None);
+                drop(pass);
+
+                self.cascades[i].rendered = Some((cascade.view_proj, stamp));
+                self.cascades[i].last_update = self.frame;
+                self.uniform.cascade_view_proj[i] = cascade.view_proj.to_cols_array_2d();
+                self.stats.views_rendered += 1;
+            }
+            self.stats.lights_shadowed += 1;
+        }
+
+        // oldest first, so no light is starved by the budget
+        let mut pending: Vec<(Entity, u64)> = Vec::new();
+        for (entity, light) in &self.lights {
+            let stamp = caster_stamp(&self.caster_bounds, Some((light.position, light.range)));
+            if light.rendered != Some((light.key, stamp)) {
+                pending.push((*entity, stamp));
+            }
+        }
+        pending.sort_by_key(|(entity, _)| self.lights[entity].last_update);
+
+        let tiles_per_row = Self::tiles_per_row(&self.settings);
+        let tile_uv = 1.0 / tiles_per_row as f32;
+        let tile_resolution = self.settings.tile_resolution as f32;
+
+        for (entity, stamp) in pending {
+            let light = &self.lights[&entity];
+            let (first_tile, range) = (light.first_tile, (light.position, light.range));
+            let view_projs = light.view_projs.clone();
+            let views = view_projs.len() as u32;
+            if !budget.take_light(views) {
+                self.stats.lights_deferred += 1;
+                continue;
+            }
+
+            let mut pass = depth_pass(encoder, &self.atlas_view, false);
+            for (face, view_proj) in view_projs.iter().enumerate() {
+                let tile = first_tile + face;
+                let (column, row) = (tile % tiles_per_row, tile / tiles_per_row);
+                let slot = MAX_CASCADES + tile;
+
+                self.write_pass(graphics, slot, *view_proj);
+                pass.set_viewport(
+                    column as f32 * tile_resolution,
+                    row as f32 * tile_resolution,
+                    tile_resolution,
+                    tile_resolution,
+                    0.0,
+                    1.0,
+                );
+
+                pass.set_pipeline(&self.clear_pipeline);
+                pass.set_bind_group(0, &self.pass_bind_group, &[self.slot_offset(slot)]);
+                pass.draw(0..3, 0..1);
+
+                self.draw_casters(&mut pass, slot, casters, Some(range));
+
+                self.uniform.tiles[tile] = ShadowTileUniform {
+                    view_proj: view_proj.to_cols_array_2d(),
+                    rect: [
+                        column as f32 * tile_uv,
+                        row as f32 * tile_uv,
+                        tile_uv,
+                        tile_uv,
+                    ],
+                };
+            }
+            drop(pass);
+
+            self.stats.views_rendered += views;
+
+            let light = self.lights.get_mut(&entity).unwrap();
+            light.rendered = Some((light.key, stamp));
+            light.last_update = self.frame;
+        }
+        self.stats.lights_shadowed += self.lights.len() as u32;
+
+        self.uniform.depth_bias = self.settings.depth_bias;
+        self.uniform.normal_bias = self.settings.normal_bias;
+        self.buffer.write(&graphics.queue, &self.uniform);
+    }
+
+    /// Rebuilds the bounds of the casters whose instance buffers were uploaded since the last
+    /// frame, and forgets the casters that are gone.
+    fn refresh_bounds(&mut self, casters: &[ShadowCaster]) {
+        puffin::profile_function!();
+        for bounds in self.caster_bounds.values_mut() {
+            bounds.seen = false;
+        }
+
+        for caster in casters {
+            let generation = caster.instances.generation();
+            match self.caster_bounds.get_mut(&caster.id) {
+                Some(bounds) if bounds.generation == generation => bounds.seen = true,
+                Some(bounds) => {
+                    *bounds = CasterBounds::new(generation, bounds.model, caster.instances.data());
+                }
+                None => {
+                    let model = caster.model.bounding_sphere();
+                    let bounds = CasterBounds::new(generation, model, caster.instances.data());
+                    self.caster_bounds.insert(caster.id, bounds);
+                }
+            }
+        }
+
+        self.caster_bounds.retain(|_, bounds| bounds.seen);
+    }
+
+    fn slot_offset(&self, slot: usize) -> u32 {
+        (slot as u64 * self.pass_stride) as u32
+    }
+
+    fn write_pass(&self, graphics: &SharedGraphicsContext, slot: usize, view_proj: Mat4) {
+        graphics.queue.write_buffer(
+            &self.pass_buffer,
+            slot as u64 * self.pass_stride,
+            bytemuck::cast_slice(&view_proj.to_cols_array()),
+        );
+    }
+
+    fn draw_casters<'a>(
+        &'a self,
+        pass: &mut wgpu::RenderPass<'_>,
+        slot: usize,
+        casters: &[ShadowCaster<'a>],
+        range: Option<(Vec3, f32)>,
+    ) {
+        pass.set_pipeline(&self.depth_pipeline);
+        pass.set_bind_group(0, &self.pass_bind_group, &[self.slot_offset(slot)]);
+
+        for caster in casters {
+            if let Some((position, radius)) = range {
+                let reaches = self
+                    .caster_bounds
+                    .get(&caster.id)
+                    .is_some_and(|bounds| bounds.reaches(position, radius));
+                if !reaches {
+                    continue;
+                }
+            }
+
+            let instance_count = caster.instances.len() as u32;
+            pass.set_vertex_buffer(1, caster.instances.full_slice());
+            for mesh in &caster.model.meshes {
+                pass.set_vertex_buffer(0, mesh.vertex_buffer.full_slice());
+                pass.set_index_buffer(mesh.index_buffer.full_slice(), wgpu::IndexFormat::Uint32);
+                pass.draw_indexed(0..mesh.num_elements, 0, 0..instance_count);
+            }
+        }
+    }
+}
+
+/// A left-handed view matrix looking from `position` along `direction`.
+fn look_towards(position: Vec3, direction: Vec3) -> Mat4 {
+    let up = if direction.abs().y > 0.99 {
+        Vec3::Z
+    } else {
+        Vec3::Y
+    };
+    Mat4::look_to_lh(position, direction, up)
+}
+
+fn depth_pass<'a>(
+    encoder: &'a mut wgpu::CommandEncoder,
+    view: &'a wgpu::TextureView,
+    clear: bool,
+) -> wgpu::RenderPass<'a> {
+    encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
+        label: Some("shadow depth pass"),
+        color_attachments: &[],
+        depth_stencil_attachment: Some(wgpu::RenderPassDepthStencilAttachment {
+            view,
+            depth_ops: Some(wgpu::Operations {
+                load: if clear {
+                    wgpu::LoadOp::Clear(1.0)
+                } else {
+                    wgpu::LoadOp::Load
+                },
+                store: wgpu::StoreOp::Store,
+            }),
+            stencil_ops: None,
+        }),
+        occlusion_query_set: None,
+        timestamp_writes: None,
+        multiview_mask: None,
+    })
+}
+
+/// A hash of every caster transform within `range`, which changes whenever a caster that can
+/// reach the light moves, appears or disappears. Batches are combined independently of the
+/// order they are iterated in.
+fn caster_stamp(casters: &HashMap<u64, CasterBounds>, range: Option<(Vec3, f32)>) -> u64 {
+    casters
+        .iter()
+        .filter_map(|(id, bounds)| {
+            let stamp = bounds.stamp_within(range)?;
+            let mut hasher = DefaultHasher::new();
+            (id, stamp).hash(&mut hasher);
+            Some(hasher.finish())
+        })
+        .fold(0, u64::wrapping_add)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn shadow_uniform_matches_shader_layout() {
+        // cascade matrices + splits + 4 scalars, then 64 tiles of a matrix and a rect
+        assert_eq!(std::mem::size_of::<ShadowTileUniform>(), 80);
+        assert_eq!(
+            std::mem::size_of::<ShadowUniform>(),
+            256 + 16 + 16 + 80 * MAX_SHADOW_TILES
+        );
+    }
+
+    const UNIT: (Vec3, f32) = (Vec3::ZERO, 1.0);
+
+    fn casters(batches: &[(u64, &[(Vec3, f32)])]) -> HashMap<u64, CasterBounds> {
+        batches
+            .iter()
+            .map(|(id, spheres)| (*id, CasterBounds::from_spheres(0, UNIT, spheres.to_vec())))
+            .collect()
+    }
+
+    #[test]
+    fn instance_spheres_follow_the_model_bounds() {
+        let instance = |translation: DVec3, scale: DVec3| {
+            let rotation = glam::DQuat::from_rotation_y(std::f64::consts::FRAC_PI_2);
+            crate::graphics::Instance::new(translation, rotation, scale).to_raw()
+        };
+        // a model sitting above its origin, so the instance translation alone misses it
+        let model = (Vec3::new(0.0, 4.0, 1.0), 2.0);
+        let bounds = CasterBounds::new(
+            0,
+            model,
+            &[instance(DVec3::new(10.0, 0.0, 0.0), DVec3::new(1.0, 3.0, 1.0))],
+        );
+
+        let (centre, radius) = bounds.spheres[0];
+        assert!(centre.distance(Vec3::new(11.0, 12.0, 0.0)) < 1e-4);
+        assert!((radius - 6.0).abs() < 1e-4);
+    }
+
+    #[test]
+    fn stamp_only_follows_casters_in_range() {
+        let light = Some((Vec3::ZERO, 5.0));
+        let near = (Vec3::new(1.0, 0.0, 0.0), 1.0);
+        let far = (Vec3::new(50.0, 0.0, 0.0), 1.0);
+        let moved_far = (Vec3::new(60.0, 0.0, 0.0), 1.0);
+        let moved_near = (Vec3::new(2.0, 0.0, 0.0), 1.0);
+
+        let before = caster_stamp(&casters(&[(1, &[near, far])]), light);
+        let after = caster_stamp(&casters(&[(1, &[near, moved_far])]), light);
+        assert_eq!(before, after);
+        let everything = caster_stamp(&casters(&[(1, &[near, far])]), None);
+        assert_ne!(
+            everything,
+            caster_stamp(&casters(&[(1, &[near, moved_far])]), None)
+        );
+
+        let after = caster_stamp(&casters(&[(1, &[moved_near, far])]), light);
+        assert_ne!(before, after);
+    }
+
+    #[test]
+    fn stamp_ignores_batch_order_and_out_of_range_batches() {
+        let light = Some((Vec3::ZERO, 5.0));
+        let a: &[(Vec3, f32)] = &[(Vec3::X, 1.0)];
+        let b: &[(Vec3, f32)] = &[(Vec3::Y, 0.5)];
+        let far: &[(Vec3, f32)] = &[(Vec3::splat(100.0), 1.0)];
+
+        let stamp = caster_stamp(&casters(&[(1, a), (2, b)]), light);
+        assert_eq!(stamp, caster_stamp(&casters(&[(2, b), (1, a)]), light));
+        assert_eq!(
+            stamp,
+            caster_stamp(&casters(&[(1, a), (2, b), (3, far)]), light)
+        );
+        assert_ne!(stamp, caster_stamp(&casters(&[(1, a)]), light));
+        assert_eq!(caster_stamp(&casters(&[(3, far)]), light), 0);
+    }
+
+    #[test]
+    fn contained_batches_stamp_like_straddling_ones() {
+        let spheres = [(Vec3::ZERO, 1.0), (Vec3::new(3.0, 0.0, 0.0), 1.0)];
+        let bounds = CasterBounds::from_spheres(0, UNIT, spheres.to_vec());
+
+        // one range holds the whole batch, the other only holds both spheres and not their bound
+        let contained = bounds.stamp_within(Some((Vec3::ZERO, 10.0)));
+        let straddling = bounds.stamp_within(Some((Vec3::new(-4.0, 0.0, 0.0), 7.5)));
+        assert_eq!(contained, Some(bounds.stamp));
+        assert_eq!(straddling, contained);
+
+        assert!(bounds.reaches(Vec3::new(6.0, 0.0, 0.0), 2.5));
+        assert!(!bounds.reaches(Vec3::new(0.0, 3.0, 0.0), 1.5));
+        assert_eq!(
+            bounds.stamp_within(Some((Vec3::new(0.0, 3.0, 0.0), 1.5))),
+            None
+        );
+        assert!(!CasterBounds::from_spheres(0, UNIT, Vec::new()).reaches(Vec3::ZERO, 1.0));
+    }
+
+    #[test]
+    fn budget_defers_lights_but_never_starves_them() {
+        let mut budget = ViewBudget::new(4);
+        assert!(budget.take_cascade());
+        assert!(budget.take_cascade());
+        // cascades alone never hold back the first light, however much it costs
+        assert!(budget.take_light(POINT_FACES as u32));
+        assert!(!budget.take_light(1));
+        assert!(!budget.take_cascade());
+
+        let mut budget = ViewBudget::new(2);
+        assert!(budget.take_light(1));
+        assert!(budget.take_light(1));
+        assert!(!budget.take_light(1));
+
+        let mut budget = ViewBudget::new(0);
+        assert!(!budget.take_cascade());
+        assert!(budget.take_light(1));
+        assert!(!budget.take_light(1));
+    }
+}
@@ -1,4 +1,5 @@
 use crate::graphics::SharedGraphicsContext;
+use crate::ibl::EnvironmentMaps;
 use crate::pipelines::create_render_pipeline_ex;
 use crate::texture::{Texture, TextureBuilder};
 use image::codecs::hdr::HdrDecoder;
@@ -257,7 +258,9 @@ impl HdrLoader {
             dst_size,
             loader.dst_format,
             mip_count,
-            wgpu::TextureUsages::STORAGE_BINDING | wgpu::TextureUsages::TEXTURE_BINDING,
+            wgpu::TextureUsages::STORAGE_BINDING
+                | wgpu::TextureUsages::TEXTURE_BINDING
+                | wgpu::TextureUsages::COPY_SRC,
             wgpu::FilterMode::Linear,
             label,
         );
@@ -357,18 +360,20 @@ impl HdrLoader {
 }
 
 pub struct SkyPipeline {
-    pub texture: CubeTexture,
+    pub environment: EnvironmentMaps,
     pub pipeline: wgpu::RenderPipeline,
     pub camera_layout: wgpu::BindGroupLayout,
     pub environment_layout: wgpu::BindGroupLayout,
     pub camera_bind_group: wgpu::BindGroup,
+    /// Shared by the sky and the main shader (as group 3), so models are lit by the same sky.
     pub environment_bind_group: wgpu::BindGroup,
 }
 
 impl SkyPipeline {
+    /// Creates the sky from the maps of [`EnvironmentMaps::load_or_bake`].
     pub fn new(
         graphics: Arc<SharedGraphicsContext>,
-        sky_texture: CubeTexture,
+        environment: EnvironmentMaps,
         camera_buffer: &wgpu::Buffer,
     ) -> Self {
         puffin::profile_function!();
@@ -389,30 +394,9 @@ impl SkyPipeline {
                     }],
                 });
 
-        let environment_layout =
-            graphics
-                .device
-                .create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
-                    label: Some("sky environment bind group layout"),
-                    entries: &[
-                        wgpu::BindGroupLayoutEntry {
-                            binding: 0,
-                            visibility: wgpu::ShaderStages::FRAGMENT,
-                            ty: wgpu::BindingType::Texture {
-                                sample_type: wgpu::TextureSampleType::Float { filterable: true },
-                                view_dimension: wgpu::TextureViewDimension::Cube,
-                                multisampled: false,
-                            },
-                            count: None,
-                        },
-                        wgpu::BindGroupLayoutEntry {
-                            binding: 1,
-                            visibility: wgpu::ShaderStages::FRAGMENT,
-                            ty: wgpu::BindingType::Sampler(wgpu::SamplerBindingType::Filtering),
-                            count: None,
-                        },
-                    ],
-                });
+        // the sky only reads the first two bindings, but sharing the layout lets one bind group
+        // serve both pipelines.
+        let environment_layout = graphics.layouts.environment_layout.clone();
 
         let camera_bind_group = graphics
             .device
@@ -425,23 +409,11 @@ impl SkyPipeline {
                 }],
             });
 
-        let environment_bind_group =
-            graphics
-                .device
-                .create_bind_group(&wgpu::BindGroupDescriptor {
-                    label: Some("sky environment bind group"),
-                    layout: &environment_layout,
-                    entries: &[
-                        wgpu::BindGroupEntry {
-                            binding: 0,
-                            resource: wgpu::BindingResource::TextureView(sky_texture.view()),
-                        },
-                        wgpu::BindGroupEntry {
-                            binding: 1,
-                            resource: wgpu::BindingResource::Sampler(sky_texture.sampler()),
-                        },
-                    ],
-                });
+        let environment_bind_group = environment.create_bind_group(
+            &graphics.device,
+            &environment_layout,
+            Some("sky environment bind group"),
+        );
 
         let sky_pipeline = {
             let layout = graphics
@@ -464,11 +436,12 @@ impl SkyPipeline {
                 false,
                 wgpu::CompareFunction::GreaterEqual,
                 (*graphics.antialiasing.read()).into(),
+                graphics.pipeline_cache.get(),
             )
         };
 
         Self {
-            texture: sky_texture,
+            environment,
             pipeline: sky_pipeline,
             camera_layout,
             environment_layout,
@@ -0,0 +1,745 @@
+//! Texture mip streaming.
+//!
+//! Material textures built with [`TextureBuilder::streamed`] only upload their low mips when they
+//! are first created. Renderers report how large each texture appears on screen through
+//! [`TextureStreamer::request`], and [`TextureStreamer::tick`] streams finer mips in (or coarser
+//! mips back out) as low priority compute jobs on the
+//! [`FutureQueue`](dropbear_future_queue::FutureQueue) while keeping the resident set under
+//! [`StreamingConfig::vram_budget`], evicting the least recently used textures first.
+//!
+//! Only a [`StreamSource`] is kept for every streamed texture, which is the image file on disk or
+//! its encoded (compressed) bytes. The source is decoded again on a worker whenever a different
+//! mip is needed, so no decoded pixels stay in system memory.
+
+use crate::asset::{ASSET_REGISTRY, Handle};
+use crate::graphics::SharedGraphicsContext;
+use crate::texture::{Texture, TextureBuilder};
+use dropbear_future_queue::{FutureHandle, JobPriority};
+use image::DynamicImage;
+use parking_lot::Mutex;
+use std::collections::{HashMap, HashSet};
+use std::path::PathBuf;
+use std::sync::{Arc, LazyLock};
+
+pub static TEXTURE_STREAMER: LazyLock<Mutex<TextureStreamer>> =
+    LazyLock::new(|| Mutex::new(TextureStreamer::new(StreamingConfig::default())));
+
+/// Settings for the [`TextureStreamer`].
+#[derive(Debug, Clone)]
+pub struct StreamingConfig {
+    /// When disabled, streamed textures are uploaded at their full resolution.
+    pub enabled: bool,
+    /// The maximum amount of bytes streamed textures are allowed to keep resident on the GPU.
+    pub vram_budget: u64,
+    /// The largest dimension a texture is initially uploaded at (and evicted back down to).
+    pub resident_floor: u32,
+    /// Maximum amount of mip transitions that can be scheduled each frame.
+    pub max_jobs_per_frame: usize,
+    /// Textures that have not been requested for this many frames fall back to their floor.
+    pub idle_frames: u64,
+    /// Bias added onto the computed mip. Positive values prefer coarser mips.
+    pub mip_bias: f32,
+}
+
+impl Default for StreamingConfig {
+    fn default() -> Self {
+        Self {
+            enabled: true,
+            vram_budget: 1024 * 1024 * 1024,
+            resident_floor: 128,
+            max_jobs_per_frame: 4,
+            idle_frames: 300,
+            mip_bias: 0.0,
+        }
+    }
+}
+
+/// A snapshot of the streamer's bookkeeping, useful for debug overlays.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct StreamingStats {
+    pub textures: usize,
+    pub in_flight: usize,
+    pub resident_bytes: u64,
+    pub vram_budget: u64,
+}
+
+/// Where the pixels of a streamed texture are read back from when a new mip is needed.
+#[derive(Debug, Clone)]
+pub enum StreamSource {
+    /// An image file that is read and decoded again on every transition.
+    File(PathBuf),
+    /// The encoded image, for textures that are not backed by a file of their own (such as images
+    /// embedded in a glTF buffer).
+    Encoded(Arc<[u8]>),
+}
+
+impl StreamSource {
+    fn decode(&self) -> anyhow::Result<DynamicImage> {
+        match self {
+            StreamSource::File(path) => Ok(image::load_from_memory(&std::fs::read(path)?)?),
+            StreamSource::Encoded(bytes) => Ok(image::load_from_memory(bytes)?),
+        }
+    }
+}
+
+/// Everything required to rebuild a texture at an arbitrary mip.
+struct StreamedTexture {
+    label: Option<String>,
+    source: StreamSource,
+    width: u32,
+    height: u32,
+    format: wgpu::TextureFormat,
+    sampler: wgpu::SamplerDescriptor<'static>,
+
+    /// The coarsest mip the texture will ever be reduced to.
+    floor_mip: u32,
+    /// The mip currently used as level 0 of the GPU texture.
+    resident_mip: u32,
+    /// The finest mip requested by a renderer this frame.
+    desired_mip: u32,
+    last_requested: u64,
+    in_flight: Option<(FutureHandle, u32)>,
+}
+
+impl StreamedTexture {
+    fn bytes_at(&self, mip: u32) -> u64 {
+        resident_bytes(self.width, self.height, mip)
+    }
+}
+
+/// A mip level that was resampled on a worker, waiting to be uploaded.
+struct StreamedLevel {
+    pixels: Vec<u8>,
+    width: u32,
+    height: u32,
+}
+
+/// A texture that finished streaming and needs to be swapped into the [`AssetRegistry`](crate::asset::AssetRegistry).
+struct CompletedLevel {
+    id: u64,
+    level: StreamedLevel,
+    label: Option<String>,
+    format: wgpu::TextureFormat,
+    sampler: wgpu::SamplerDescriptor<'static>,
+}
+
+pub struct TextureStreamer {
+    config: StreamingConfig,
+    textures: HashMap<u64, StreamedTexture>,
+    frame: u64,
+    resident_bytes: u64,
+    /// Textures whose owning models were borrowed while being swapped, so their materials still
+    /// need to be rebound.
+    pending_rebind: HashSet<u64>,
+}
+
+impl TextureStreamer {
+    pub fn new(config: StreamingConfig) -> Self {
+        Self {
+            config,
+            textures: HashMap::new(),
+            frame: 0,
+            resident_bytes: 0,
+            pending_rebind: HashSet::new(),
+        }
+    }
+
+    pub fn config(&self) -> &StreamingConfig {
+        &self.config
+    }
+
+    pub fn set_config(&mut self, config: StreamingConfig) {
+        self.config = config;
+    }
+
+    /// Sets the VRAM budget (in bytes) of all streamed textures.
+    pub fn set_budget(&mut self, bytes: u64) {
+        if self.config.vram_budget != bytes {
+            log::debug!(
+                "Texture streaming budget set to {} MiB",
+                bytes / (1024 * 1024)
+            );
+            self.config.vram_budget = bytes;
+        }
+    }
+
+    pub fn stats(&self) -> StreamingStats {
+        StreamingStats {
+            textures: self.textures.len(),
+            in_flight: self
+                .textures
+                .values()
+                .filter(|t| t.in_flight.is_some())
+                .count(),
+            resident_bytes: self.resident_bytes,
+            vram_budget: self.config.vram_budget,
+        }
+    }
+
+    /// Returns the mip a texture of `width` x `height` is initially uploaded at.
+    pub fn floor_mip(&self, width: u32, height: u32) -> u32 {
+        if !self.config.enabled {
+            return 0;
+        }
+        let floor = self.config.resident_floor.max(1);
+        let mut mip = 0;
+        while (width >> mip).max(height >> mip) > floor && mip + 1 < mip_count(width, height) {
+            mip += 1;
+        }
+        mip
+    }
+
+    /// Starts tracking a texture that has been uploaded at `resident_mip`.
+    ///
+    /// Registering an already tracked texture does nothing, as the registry keeps the first
+    /// texture added with any given hash.
+    pub(crate) fn register(
+        &mut self,
+        id: u64,
+        label: Option<String>,
+        source: StreamSource,
+        (width, height): (u32, u32),
+        format: wgpu::TextureFormat,
+        sampler: wgpu::SamplerDescriptor<'static>,
+        resident_mip: u32,
+    ) {
+        if self.textures.contains_key(&id) {
+            return;
+        }
+
+        let texture = StreamedTexture {
+            label,
+            source,
+            width,
+            height,
+            format,
+            sampler,
+            floor_mip: resident_mip,
+            resident_mip,
+            desired_mip: resident_mip,
+            last_requested: self.frame,
+            in_flight: None,
+        };
+        self.resident_bytes += texture.bytes_at(resident_mip);
+        self.textures.insert(id, texture);
+    }
+
+    /// Stops tracking a texture, typically after it was flushed from the registry.
+    pub fn unregister(&mut self, id: u64) {
+        if let Some(texture) = self.textures.remove(&id) {
+            self.resident_bytes = self
+                .resident_bytes
+                .saturating_sub(texture.bytes_at(texture.resident_mip));
+        }
+        self.pending_rebind.remove(&id);
+    }
+
+    pub fn clear(&mut self) {
+        self.textures.clear();
+        self.pending_rebind.clear();
+        self.resident_bytes = 0;
+    }
+
+    pub fn is_streamed(&self, id: u64) -> bool {
+        self.textures.contains_key(&id)
+    }
+
+    /// Records that a texture covers roughly `screen_pixels` pixels (along its largest axis)
+    /// this frame.
+    pub fn request(&mut self, id: u64, screen_pixels: f32) {
+        let frame = self.frame;
+        let bias = self.config.mip_bias;
+        let Some(texture) = self.textures.get_mut(&id) else {
+            return;
+        };
+
+        let size = texture.width.max(texture.height) as f32;
+        let mip = if screen_pixels <= 0.0 {
+            texture.floor_mip
+        } else {
+            ((size / screen_pixels).log2() + bias)
+                .floor()
+                .clamp(0.0, texture.floor_mip as f32) as u32
+        };
+
+        if texture.last_requested != frame {
+            texture.last_requested = frame;
+            texture.desired_mip = mip;
+        } else {
+            texture.desired_mip = texture.desired_mip.min(mip);
+        }
+    }
+
+    /// Advances streaming by a frame.
+    ///
+    /// Finished mip transitions are swapped into the [`ASSET_REGISTRY`], the materials of any
+    /// models using them are rebound and new transitions are scheduled. The returned set contains
+    /// the textures that were swapped, so that per-entity material snapshots can be rebound too.
+    pub fn tick(graphics: Arc<SharedGraphicsContext>) -> HashSet<u64> {
+        puffin::profile_function!();
+
+        // the streamer is never held while the registry is locked, as textures get registered
+        // while the registry is being written to.
+        let (completed, mut rebind) = {
+            let mut streamer = TEXTURE_STREAMER.lock();
+            streamer.frame += 1;
+            let completed = streamer.collect_completed(&graphics);
+            streamer.schedule(&graphics);
+            (completed, std::mem::take(&mut streamer.pending_rebind))
+        };
+
+        if completed.is_empty() && rebind.is_empty() {
+            return HashSet::new();
+        }
+
+        let mut swapped = HashSet::new();
+        let mut orphaned = Vec::new();
+        for completed in completed {
+            let Some(previous) = ASSET_REGISTRY.read().get_texture(Handle::new(completed.id))
+            else {
+                // built, but never added to (or already flushed from) the registry
+                orphaned.push(completed.id);
+                continue;
+            };
+            let mut texture = completed.build(&graphics);
+            // the reference may have been replaced after the texture was first built
+            texture.reference = previous.reference.clone();
+            ASSET_REGISTRY
+                .write()
+                .update_texture(Handle::new(completed.id), texture);
+            swapped.insert(completed.id);
+        }
+        rebind.extend(swapped.iter().copied());
+
+        let unbound = ASSET_REGISTRY.write().rebind_materials(&graphics, &rebind);
+        if !unbound.is_empty() || !orphaned.is_empty() {
+            let mut streamer = TEXTURE_STREAMER.lock();
+            for id in orphaned {
+                streamer.unregister(id);
+            }
+            streamer.pending_rebind.extend(unbound);
+        }
+
+        swapped
+    }
+
+    fn collect_completed(&mut self, graphics: &SharedGraphicsContext) -> Vec<CompletedLevel> {
+        let mut completed = Vec::new();
+        for (id, texture) in self.textures.iter_mut() {
+            let Some((handle, mip)) = texture.in_flight else {
+                continue;
+            };
+            let Some(level) = graphics
+                .future_queue
+                .exchange_owned_as::<Option<StreamedLevel>>(&handle)
+            else {
+                continue;
+            };
+
+            texture.in_flight = None;
+            let Some(level) = level else {
+                // the source is gone, so the texture stays at whatever mip it has now
+                texture.floor_mip = texture.resident_mip;
+                texture.desired_mip = texture.resident_mip;
+                continue;
+            };
+            self.resident_bytes = self
+                .resident_bytes
+                .saturating_sub(texture.bytes_at(texture.resident_mip))
+                + texture.bytes_at(mip);
+            texture.resident_mip = mip;
+
+            completed.push(CompletedLevel {
+                id: *id,
+                level,
+                label: texture.label.clone(),
+                format: texture.format,
+                sampler: texture.sampler.clone(),
+            });
+        }
+        completed
+    }
+
+    fn schedule(&mut self, graphics: &SharedGraphicsContext) {
+        for (id, mip) in self.plan() {
+            self.start(graphics, id, mip);
+        }
+    }
+
+    /// Picks the mip transitions to start this frame, in the order they should be started.
+    fn plan(&mut self) -> Vec<(u64, u32)> {
+        let mut transitions = Vec::new();
+        if !self.config.enabled {
+            return transitions;
+        }
+
+        let frame = self.frame;
+        let idle_frames = self.config.idle_frames;
+        let max_jobs = self.config.max_jobs_per_frame;
+
+        // bytes that are already promised to in-flight transitions
+        let mut committed = self.resident_bytes as i64;
+        let mut upgrades = Vec::new();
+        let mut downgrades = Vec::new();
+
+        for (id, texture) in self.textures.iter_mut() {
+            if frame.saturating_sub(texture.last_requested) > idle_frames {
+                texture.desired_mip = texture.floor_mip;
+            }
+
+            if let Some((_, mip)) = texture.in_flight {
+                committed +=
+                    texture.bytes_at(mip) as i64 - texture.bytes_at(texture.resident_mip) as i64;
+                continue;
+            }
+
+            if texture.desired_mip < texture.resident_mip {
+                upgrades.push(*id);
+            } else if texture.desired_mip > texture.resident_mip {
+                downgrades.push(*id);
+            }
+        }
+
+        // dropping unneeded mips frees memory, so it always goes first
+        for id in downgrades {
+            if transitions.len() >= max_jobs {
+                return transitions;
+            }
+            let t = &self.textures[&id];
+            committed += t.bytes_at(t.desired_mip) as i64 - t.bytes_at(t.resident_mip) as i64;
+            transitions.push((id, t.desired_mip));
+        }
+
+        // the biggest jumps in quality are streamed in first
+        upgrades.sort_by_key(|id| {
+            let t = &self.textures[id];
+            std::cmp::Reverse((t.resident_mip - t.desired_mip, t.last_requested))
+        });
+
+        let budget = self.config.vram_budget as i64;
+        for id in upgrades {
+            if transitions.len() >= max_jobs {
+                return transitions;
+            }
+            if transitions.iter().any(|(planned, _)| *planned == id) {
+                // already being evicted to make room for another texture
+                continue;
+            }
+
+            let (resident, desired) = {
+                let t = &self.textures[&id];
+                (t.resident_mip, t.desired_mip)
+            };
+
+            // find the finest mip that fits, evicting the least recently used textures if needed
+            let mut target = None;
+            for mip in desired..resident {
+                let t = &self.textures[&id];
+                let extra = t.bytes_at(mip) as i64 - t.bytes_at(resident) as i64;
+                while committed + extra > budget && transitions.len() < max_jobs {
+                    let Some(victim) = self.eviction_candidate(id, &transitions) else {
+                        break;
+                    };
+                    let v = &self.textures[&victim];
+                    committed += v.bytes_at(v.floor_mip) as i64 - v.bytes_at(v.resident_mip) as i64;
+                    transitions.push((victim, v.floor_mip));
+                }
+                if committed + extra <= budget {
+                    target = Some(mip);
+                    break;
+                }
+            }
+
+            let Some(mip) = target else { continue };
+            if transitions.len() >= max_jobs {
+                return transitions;
+            }
+            let t = &self.textures[&id];
+            committed += t.bytes_at(mip) as i64 - t.bytes_at(resident) as i64;
+            transitions.push((id, mip));
+        }
+
+        transitions
+    }
+
+    /// Finds the least recently used texture that is not at its floor and has no transition
+    /// planned yet.
+    fn eviction_candidate(&self, exclude: u64, planned: &[(u64, u32)]) -> Option<u64> {
+        self.textures
+            .iter()
+            .filter(|(id, t)| {
+                **id != exclude
+                    && t.in_flight.is_none()
+                    && t.resident_mip < t.floor_mip
+                    && t.last_requested < self.frame
+                    && !planned.iter().any(|(planned, _)| planned == *id)
+            })
+            .min_by_key(|(_, t)| t.last_requested)
+            .map(|(id, _)| *id)
+    }
+
+    /// Starts decoding and resampling a texture to `mip` on the future queue.
+    fn start(&mut self, graphics: &SharedGraphicsContext, id: u64, mip: u32) {
+        let Some(texture) = self.textures.get_mut(&id) else {
+            return;
+        };
+
+        let source = texture.source.clone();
+        let label = texture.label.clone();
+        let (width, height) = (texture.width, texture.height);
+        let handle = graphics
+            .future_queue
+            .push_compute(JobPriority::Low, move || match source.decode() {
+                Ok(image) => Some(resample(&image, width, height, mip)),
+                Err(e) => {
+                    log::warn!(
+                        "Unable to stream texture {:?} from {:?}: {}",
+                        label,
+                        source,
+                        e
+                    );
+                    None
+                }
+            });
+
+        texture.in_flight = Some((handle, mip));
+    }
+}
+
+impl CompletedLevel {
+    fn build(&self, graphics: &Arc<SharedGraphicsContext>) -> Texture {
+        puffin::profile_function!();
+        let label = self.label.as_deref().unwrap_or("streamed texture");
+        let mut texture = TextureBuilder::new(&graphics.device)
+            .size(self.level.width, self.level.height)
+            .with_raw_pixels(graphics.clone(), &self.level.pixels)
+            .format(self.format)
+            .sampler(self.sampler.clone())
+            .label(label)
+            .build();
+        texture.hash = Some(self.id);
+        texture
+    }
+}
+
+/// The amount of mips in a full chain, matching [`TextureBuilder`]'s automatic mip generation.
+pub fn mip_count(width: u32, height: u32) -> u32 {
+    width.min(height).max(1).ilog2() + 1
+}
+
+/// Approximate GPU memory used by a RGBA8 texture uploaded from `mip` down to its last mip.
+pub fn resident_bytes(width: u32, height: u32, mip: u32) -> u64 {
+    let w = (width >> mip).max(1);
+    let h = (height >> mip).max(1);
+    (0..mip_count(w, h))
+        .map(|l| ((w >> l).max(1) as u64) * ((h >> l).max(1) as u64) * 4)
+        .sum()
+}
+
+/// Resamples a decoded image to `mip` of a `width` x `height` texture.
+///
+/// The image is resized to the mip's size even at mip 0, as the texture may have been built at
+/// a different size than its source.
+fn resample(image: &DynamicImage, width: u32, height: u32, mip: u32) -> StreamedLevel {
+    let target_width = (width >> mip).max(1);
+    let target_height = (height >> mip).max(1);
+
+    let resized = if image.width() == target_width && image.height() == target_height {
+        image.to_rgba8()
+    } else {
+        image
+            .resize_exact(
+                target_width,
+                target_height,
+                image::imageops::FilterType::Triangle,
+            )
+            .to_rgba8()
+    };
+    let (width, height) = resized.dimensions();
+
+    StreamedLevel {
+        pixels: resized.into_raw(),
+        width,
+        height,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use image::RgbaImage;
+
+    fn streamer(budget: u64) -> TextureStreamer {
+        TextureStreamer::new(StreamingConfig {
+            vram_budget: budget,
+            resident_floor: 64,
+            max_jobs_per_frame: 8,
+            ..Default::default()
+        })
+    }
+
+    fn register(streamer: &mut TextureStreamer, id: u64, size: u32) {
+        let floor = streamer.floor_mip(size, size);
+        streamer.register(
+            id,
+            None,
+            StreamSource::Encoded(Arc::from(Vec::new())),
+            (size, size),
+            wgpu::TextureFormat::Rgba8Unorm,
+            wgpu::SamplerDescriptor::default(),
+            floor,
+        );
+    }
+
+    /// Pretends every planned transition finished, like [`TextureStreamer::collect_completed`].
+    fn apply(streamer: &mut TextureStreamer, transitions: &[(u64, u32)]) {
+        for (id, mip) in transitions {
+            let texture = streamer.textures.get_mut(id).unwrap();
+            streamer.resident_bytes = streamer
+                .resident_bytes
+                .saturating_sub(texture.bytes_at(texture.resident_mip))
+                + texture.bytes_at(*mip);
+            texture.resident_mip = *mip;
+        }
+    }
+
+    #[test]
+    fn floor_mip_stops_at_the_resident_floor() {
+        let streamer = streamer(u64::MAX);
+        assert_eq!(streamer.floor_mip(64, 64), 0);
+        assert_eq!(streamer.floor_mip(1024, 1024), 4);
+        assert_eq!(streamer.floor_mip(1024, 256), 4);
+    }
+
+    #[test]
+    fn requests_pick_the_mip_matching_the_screen_size() {
+        let mut streamer = streamer(u64::MAX);
+        register(&mut streamer, 1, 1024);
+
+        streamer.request(1, 256.0);
+        assert_eq!(streamer.textures[&1].desired_mip, 2);
+
+        // the finest mip requested in a frame wins
+        streamer.request(1, 1024.0);
+        streamer.request(1, 128.0);
+        assert_eq!(streamer.textures[&1].desired_mip, 0);
+
+        // never coarser than the floor
+        streamer.frame += 1;
+        streamer.request(1, 1.0);
+        assert_eq!(streamer.textures[&1].desired_mip, 4);
+    }
+
+    #[test]
+    fn upgrades_stay_within_the_budget() {
+        let budget = resident_bytes(1024, 1024, 1) + resident_bytes(1024, 1024, 4);
+        let mut streamer = streamer(budget);
+        register(&mut streamer, 1, 1024);
+        register(&mut streamer, 2, 1024);
+
+        streamer.frame += 1;
+        streamer.request(1, 1024.0);
+        let plan = streamer.plan();
+        // mip 0 would not fit next to the other texture's floor
+        assert_eq!(plan, vec![(1, 1)]);
+        apply(&mut streamer, &plan);
+        assert!(streamer.resident_bytes <= budget);
+    }
+
+    #[test]
+    fn upgrades_evict_the_least_recently_used_texture() {
+        let budget = resident_bytes(1024, 1024, 1) + resident_bytes(1024, 1024, 4);
+        let mut streamer = streamer(budget);
+        register(&mut streamer, 1, 1024);
+        register(&mut streamer, 2, 1024);
+
+        streamer.frame += 1;
+        streamer.request(1, 1024.0);
+        let plan = streamer.plan();
+        apply(&mut streamer, &plan);
+
+        // texture 1 is no longer looked at, while texture 2 now fills the screen
+        streamer.frame += 1;
+        streamer.request(2, 1024.0);
+        let plan = streamer.plan();
+        assert_eq!(plan, vec![(1, 4), (2, 1)]);
+        apply(&mut streamer, &plan);
+        assert!(streamer.resident_bytes <= budget);
+    }
+
+    #[test]
+    fn idle_textures_fall_back_to_their_floor() {
+        let mut streamer = streamer(u64::MAX);
+        register(&mut streamer, 1, 1024);
+
+        streamer.frame += 1;
+        streamer.request(1, 1024.0);
+        let plan = streamer.plan();
+        assert_eq!(plan, vec![(1, 0)]);
+        apply(&mut streamer, &plan);
+
+        streamer.frame += streamer.config.idle_frames + 1;
+        assert_eq!(streamer.plan(), vec![(1, 4)]);
+    }
+
+    #[test]
+    fn plans_are_limited_per_frame() {
+        let mut streamer = streamer(u64::MAX);
+        streamer.config.max_jobs_per_frame = 2;
+        for id in 0..4 {
+            register(&mut streamer, id, 1024);
+        }
+
+        streamer.frame += 1;
+        for id in 0..4 {
+            streamer.request(id, 1024.0);
+        }
+        assert_eq!(streamer.plan().len(), 2);
+    }
+
+    #[test]
+    fn resample_halves_every_mip() {
+        let image =
+            DynamicImage::ImageRgba8(RgbaImage::from_pixel(8, 4, image::Rgba([10, 20, 30, 255])));
+
+        let level = resample(&image, 8, 4, 0);
+        assert_eq!((level.width, level.height), (8, 4));
+        assert_eq!(level.pixels, image.to_rgba8().into_raw());
+
+        let level = resample(&image, 8, 4, 1);
+        assert_eq!((level.width, level.height), (4, 2));
+        assert_eq!(level.pixels.len(), 4 * 2 * 4);
+        assert!(level.pixels.chunks(4).all(|p| p == [10, 20, 30, 255]));
+
+        // mips past the last level clamp to a single pixel
+        let level = resample(&image, 8, 4, 5);
+        assert_eq!((level.width, level.height), (1, 1));
+    }
+
+    #[test]
+    fn resample_uses_the_built_size_rather_than_the_source_size() {
+        let image = DynamicImage::ImageRgba8(RgbaImage::new(16, 16));
+        let level = resample(&image, 8, 8, 1);
+        assert_eq!((level.width, level.height), (4, 4));
+    }
+
+    #[test]
+    fn encoded_sources_decode_again() {
+        let image =
+            DynamicImage::ImageRgba8(RgbaImage::from_pixel(4, 4, image::Rgba([1, 2, 3, 255])));
+        let mut encoded = std::io::Cursor::new(Vec::new());
+        image
+            .write_to(&mut encoded, image::ImageFormat::Png)
+            .unwrap();
+
+        let source = StreamSource::Encoded(Arc::from(encoded.into_inner()));
+        let decoded = source.decode().unwrap();
+        assert_eq!(decoded.to_rgba8(), image.to_rgba8());
+
+        assert!(
+            StreamSource::File(PathBuf::from("does/not/exist.png"))
+                .decode()
+                .is_err()
+        );
+    }
+}
@@ -3,6 +3,7 @@ use std::sync::Arc;
 use crate::asset::AssetRegistry;
 use crate::graphics::SharedGraphicsContext;
 use crate::multisampling::AntiAliasingMode;
+use crate::streaming::{StreamSource, TEXTURE_STREAMER};
 use crate::utils::ResourceReference;
 use image::{DynamicImage, GenericImageView, RgbaImage};
 use rkyv::Archive;
@@ -41,6 +42,14 @@ pub struct TextureBuilder<'a> {
     sample_count: u32,
     mip_level_count: u32,
     auto_mip: bool,
+    #[serde(default)]
+    streamed: bool,
+    #[serde(skip)]
+    stream_source: Option<StreamSource>,
+    /// The encoded image passed to [`TextureBuilder::with_bytes`], used as the stream source when
+    /// no other source was given.
+    #[serde(skip)]
+    encoded: Option<&'a [u8]>,
 
     mag_filter: wgpu::FilterMode,
     min_filter: wgpu::FilterMode,
@@ -163,6 +172,9 @@ impl<'a> TextureBuilder<'a> {
             sample_count: 1,
             mip_level_count: 1,
             auto_mip: false,
+            streamed: false,
+            stream_source: None,
+            encoded: None,
             mag_filter: wgpu::FilterMode::Linear,
             min_filter: wgpu::FilterMode::Linear,
             mipmap_filter: wgpu::MipmapFilterMode::Linear,
@@ -269,7 +281,10 @@ impl<'a> TextureBuilder<'a> {
         let requested_dimensions = Some((self.width, self.height)).filter(|&d| d != (1, 1));
 
         let image = match image::load_from_memory(bytes) {
-            Ok(image) => image,
+            Ok(image) => {
+                self.encoded = Some(bytes);
+                image
+            }
             Err(err) => {
                 if let Some((width, height)) = requested_dimensions {
                     let expected_len = (width as usize)
@@ -397,6 +412,24 @@ impl<'a> TextureBuilder<'a> {
         self
     }
 
+    /// Lets the [`TextureStreamer`](crate::streaming::TextureStreamer) manage the mips of this
+    /// texture.
+    ///
+    /// Only the low mips are uploaded when built, and finer mips are streamed in once the
+    /// texture is seen up close. Only applies to textures built from image data that can be
+    /// decoded again, which is either the encoded image passed to [`TextureBuilder::with_bytes`]
+    /// or a source set with [`TextureBuilder::stream_source`].
+    pub fn streamed(mut self) -> Self {
+        self.streamed = true;
+        self
+    }
+
+    /// Sets where a [`streamed`](TextureBuilder::streamed) texture reads its finer mips back from.
+    pub fn stream_source(mut self, source: StreamSource) -> Self {
+        self.stream_source = Some(source);
+        self
+    }
+
     pub fn label(mut self, label: &'a str) -> Self {
         self.label = Some(label);
         self
@@ -446,8 +479,53 @@ impl<'a> TextureBuilder<'a> {
                     }
                 }
 
+                let mut dimensions = image.dimensions();
+
+                if self.streamed {
+                    let mut streamer = TEXTURE_STREAMER.lock();
+                    let floor_mip = streamer.floor_mip(dimensions.0, dimensions.1);
+                    let source = (floor_mip > 0)
+                        .then(|| {
+                            self.stream_source.clone().or_else(|| {
+                                self.encoded
+                                    .map(|bytes| StreamSource::Encoded(Arc::from(bytes)))
+                            })
+                        })
+                        .flatten();
+                    if floor_mip > 0 && source.is_none() {
+                        log::debug!(
+                            "Texture [{:?}] has no source to stream from, uploading it in full",
+                            self.label
+                        );
+                    }
+
+                    if let Some(source) = source {
+                        streamer.register(
+                            *hash,
+                            self.label.map(|s| s.to_string()),
+                            source,
+                            dimensions,
+                            self.format,
+                            self.build_sampler_desc(),
+                            floor_mip,
+                        );
+                        drop(streamer);
+
+                        dimensions = (
+                            (dimensions.0 >> floor_mip).max(1),
+                            (dimensions.1 >> floor_mip).max(1),
+                        );
+                        image = image.resize_exact(
+                            dimensions.0,
+                            dimensions.1,
+                            image::imageops::FilterType::Triangle,
+                        );
+                    }
+                }
+
+                // only the level that is uploaded is converted, never the full one of a streamed
+                // texture
                 let rgba = image.to_rgba8().into_raw();
-                let dimensions = image.dimensions();
 
                 let size = wgpu::Extent3d {
                     width: dimensions.0,
@@ -0,0 +1,72 @@
+//! Measures how well the [`FutureQueue`] scales when many threads push, poll and exchange small
+//! jobs at the same time, such as the editor does with thumbnails.
+//!
+//! Run with `cargo bench -p dropbear_future-queue`.
+
+use dropbear_future_queue::{FutureQueue, JobPriority, JobSystemConfig};
+use std::sync::{Arc, Barrier};
+use std::time::{Duration, Instant};
+
+const JOBS_PER_THREAD: usize = 20_000;
+const THREAD_COUNTS: [usize; 6] = [1, 2, 4, 8, 16, 32];
+
+fn run(threads: usize) -> Duration {
+    let queue = Arc::new(
+        FutureQueue::with_job_system(JobSystemConfig::default())
+            .expect("Unable to create job system"),
+    );
+    let barrier = Arc::new(Barrier::new(threads + 1));
+
+    let workers: Vec<_> = (0..threads)
+        .map(|t| {
+            let queue = queue.clone();
+            let barrier = barrier.clone();
+            std::thread::spawn(move || {
+                barrier.wait();
+
+                let handles: Vec<_> = (0..JOBS_PER_THREAD)
+                    .map(|i| queue.push_compute(JobPriority::Normal, move || t ^ i))
+                    .collect();
+                queue.poll();
+
+                for (i, handle) in handles.iter().enumerate() {
+                    loop {
+                        let _ = queue.get_status(handle);
+                        if let Some(result) = queue.exchange_owned_as::<usize>(handle) {
+                            assert_eq!(result, t ^ i);
+                            break;
+                        }
+                        std::hint::spin_loop();
+                    }
+                }
+            })
+        })
+        .collect();
+
+    barrier.wait();
+    let start = Instant::now();
+    for worker in workers {
+        worker.join().unwrap();
+    }
+    let elapsed = start.elapsed();
+
+    queue.cleanup();
+    elapsed
+}
+
+fn main() {
+    // warm up the allocator and thread pools
+    run(1);
+
+    println!("{:>8} {:>12} {:>16}", "threads", "time (ms)", "jobs/sec");
+    for threads in THREAD_COUNTS {
+        let elapsed = run(threads);
+        let jobs = (threads * JOBS_PER_THREAD) as f64;
+        println!(
+            "{:>8} {:>12.2} {:>16.0}",
+            threads,
+            elapsed.as_secs_f64() * 1000.0,
+            jobs / elapsed.as_secs_f64()
+        );
+    }
+}
@@ -0,0 +1,171 @@
+//! Dedicated worker pools for the [`FutureQueue`](crate::FutureQueue).
+//!
+//! By default, everything pushed to a [`FutureQueue`](crate::FutureQueue) is thrown at
+//! [`tokio::spawn`], which means CPU heavy work (such as decoding images or parsing glTF files)
+//! competes for the same workers as I/O. A [`JobSystem`] splits them into:
+//! - a work-stealing compute pool (backed by [`rayon`]) for blocking CPU jobs
+//! - a separate tokio runtime for I/O futures
+//!
+//! Compute jobs are picked in [`JobPriority`] order, and jobs that are cancelled before they
+//! start are dropped without running.
+
+use crossbeam_channel::{Receiver, Sender};
+use std::sync::Arc;
+
+/// The order in which queued jobs are started. Higher priorities are always started first.
+#[derive(Default, Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum JobPriority {
+    /// Work the player is actively waiting on, such as the next scene.
+    High = 0,
+    #[default]
+    Normal = 1,
+    /// Work that only improves quality, such as streaming in texture mips or thumbnails.
+    Low = 2,
+}
+
+impl JobPriority {
+    pub(crate) const COUNT: usize = 3;
+}
+
+/// Configuration for a [`JobSystem`].
+#[derive(Clone, Debug)]
+pub struct JobSystemConfig {
+    /// Threads used for compute jobs. `0` uses all available cores but one (for the main thread).
+    pub compute_threads: usize,
+    /// Worker threads of the I/O runtime.
+    pub io_threads: usize,
+}
+
+impl Default for JobSystemConfig {
+    fn default() -> Self {
+        Self {
+            compute_threads: 0,
+            io_threads: 2,
+        }
+    }
+}
+
+impl JobSystemConfig {
+    /// The amount of compute threads a [`JobSystem`] created from this config ends up with.
+    pub fn resolved_compute_threads(&self) -> usize {
+        if self.compute_threads == 0 {
+            std::thread::available_parallelism()
+                .map(|n| n.get().saturating_sub(1))
+                .unwrap_or(1)
+                .max(1)
+        } else {
+            self.compute_threads
+        }
+    }
+}
+
+/// A compute job that has been handed to the [`JobSystem`], but not yet started.
+type PendingJob = Box<dyn FnOnce() + Send>;
+
+/// Lock-free queues of pending compute jobs, one for each [`JobPriority`].
+struct PendingJobs {
+    queues: [(Sender<PendingJob>, Receiver<PendingJob>); JobPriority::COUNT],
+}
+
+impl PendingJobs {
+    fn new() -> Self {
+        Self {
+            queues: std::array::from_fn(|_| crossbeam_channel::unbounded()),
+        }
+    }
+
+    /// Pops the highest priority job that is still pending.
+    fn pop(&self) -> Option<PendingJob> {
+        self.queues
+            .iter()
+            .find_map(|(_, receiver)| receiver.try_recv().ok())
+    }
+}
+
+/// Separate compute and I/O worker pools. See the [module docs](self) for more info.
+pub struct JobSystem {
+    compute: rayon::ThreadPool,
+    io: Option<tokio::runtime::Runtime>,
+    pending: Arc<PendingJobs>,
+}
+
+impl JobSystem {
+    /// Creates the worker pools.
+    pub fn new(config: JobSystemConfig) -> std::io::Result<Self> {
+        let compute_threads = config.resolved_compute_threads();
+
+        let compute = rayon::ThreadPoolBuilder::new()
+            .num_threads(compute_threads)
+            .thread_name(|i| format!("dropbear-compute-{i}"))
+            // jobs catch their own panics, this only keeps anything else from aborting the app
+            .panic_handler(|payload| {
+                log::error!(
+                    "Compute worker panicked: {}",
+                    crate::panic_message(&*payload)
+                );
+            })
+            .build()
+            .map_err(std::io::Error::other)?;
+
+        let io = tokio::runtime::Builder::new_multi_thread()
+            .worker_threads(config.io_threads.max(1))
+            .thread_name("dropbear-io")
+            .enable_all()
+            .build()?;
+
+        Ok(Self {
+            compute,
+            io: Some(io),
+            pending: Arc::new(PendingJobs::new()),
+        })
+    }
+
+    /// The handle of the I/O runtime.
+    pub fn io(&self) -> &tokio::runtime::Handle {
+        self.io
+            .as_ref()
+            .expect("I/O runtime is only taken when dropped")
+            .handle()
+    }
+
+    /// The amount of threads in the compute pool.
+    pub fn compute_threads(&self) -> usize {
+        self.compute.current_num_threads()
+    }
+
+    /// Queues a blocking job onto the compute pool.
+    ///
+    /// Each job hands the pool a "ticket", and whichever worker picks that ticket up runs the
+    /// highest priority job that is still pending. This keeps rayon's work stealing while still
+    /// respecting priorities.
+    pub(crate) fn spawn_compute(&self, priority: JobPriority, run: PendingJob) {
+        // the receiver is owned by `pending`, so this cannot fail
+        let _ = self.pending.queues[priority as usize].0.send(run);
+
+        let pending = self.pending.clone();
+        self.compute.spawn(move || {
+            if let Some(job) = pending.pop() {
+                job();
+            }
+        });
+    }
+
+    /// The amount of compute jobs waiting for a worker.
+    pub fn pending_compute_jobs(&self) -> usize {
+        self.pending
+            .queues
+            .iter()
+            .map(|(_, receiver)| receiver.len())
+            .sum()
+    }
+}
+
+impl Drop for JobSystem {
+    fn drop(&mut self) {
+        // dropping a runtime from within an async context panics, which is where most apps
+        // end up dropping their queue.
+        if let Some(io) = self.io.take() {
+            io.shutdown_background();
+        }
+    }
+}
@@ -34,17 +34,22 @@
 //! # });
 //! ```
 
-use ahash::{HashMap, HashMapExt};
-use parking_lot::Mutex;
+mod jobs;
+mod registry;
+
+pub use jobs::{JobPriority, JobSystem, JobSystemConfig};
+
+use crossbeam_channel::{Receiver, Sender};
+use registry::{HandleEntry, HandleRegistry};
 use std::any::Any;
 use std::cell::RefCell;
-use std::collections::VecDeque;
 use std::future::Future;
 use std::pin::Pin;
 use std::rc::Rc;
 use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
 use tokio::sync::oneshot;
-use tokio::task::JoinHandle;
 
 /// A type used for a future.
 ///
@@ -54,8 +59,10 @@ pub type BoxFuture<T> = Pin<Box<dyn Future<Output = T> + Send>>;
 pub type AnyResult = Arc<dyn Any + Send + Sync>;
 /// Internal function: A result receiver
 type ResultReceiver = oneshot::Receiver<AnyResult>;
-/// A type for storing the queue. It uses a [`VecDeque`] to store [`FutureHandle`]'s and [`BoxFuture`]
-pub type FutureStorage = Arc<Mutex<VecDeque<(FutureHandle, BoxFuture<()>)>>>;
+/// A callback ran on the main thread by [`FutureQueue::poll_completions`].
+type CompletionCallback = Box<dyn FnOnce(AnyResult) + Send>;
+/// A type for storing the queue. It uses a lock-free channel to store [`QueuedJob`]'s
+pub type FutureStorage = (Sender<QueuedJob>, Receiver<QueuedJob>);
 /// A type recommended to be used by [`FutureQueue`] to allow being thrown around in your app
 pub type Throwable<T> = Rc<RefCell<T>>;
 
@@ -66,6 +73,8 @@ pub enum FutureStatus {
     CurrentlyPolling,
     Completed,
     Cancelled,
+    /// The job panicked, so it has no result.
+    Failed,
 }
 
 /// A handle to the future task
@@ -74,34 +83,84 @@ pub struct FutureHandle {
     pub id: u64,
 }
 
-/// Internal storage per handle — separate from FutureHandle
-struct HandleEntry {
-    receiver: Option<ResultReceiver>,
-    status: FutureStatus,
-    cached_result: Option<AnyResult>,
-    task_handle: Option<JoinHandle<()>>,
+/// The work behind a [`QueuedJob`].
+enum JobKind {
+    /// An async future, ran on the I/O runtime (or the ambient tokio runtime).
+    Future(BoxFuture<()>),
+    /// A blocking job, ran on the compute pool.
+    Compute(Box<dyn FnOnce() + Send>),
+}
+
+/// A job that was pushed but is yet to be started by [`FutureQueue::poll`].
+pub struct QueuedJob {
+    handle: FutureHandle,
+    entry: Arc<HandleEntry>,
+    priority: JobPriority,
+    kind: JobKind,
 }
 
 /// A queue for polling futures. It is stored in here until [`FutureQueue::poll`] is run.
+///
+/// All of its state can be shared between threads without a global lock: ids come from an atomic
+/// counter, pushed jobs go through a lock-free channel, and handles live in a sharded registry
+/// with an atomic status each.
 pub struct FutureQueue {
     /// The queue for the futures.
     queued: FutureStorage,
     /// A place to store all handle data
-    handle_registry: Arc<Mutex<HashMap<FutureHandle, HandleEntry>>>,
+    handle_registry: HandleRegistry,
     /// Next id to be processed
-    next_id: Arc<Mutex<u64>>,
+    next_id: AtomicU64,
+    /// Dedicated worker pools. When [`None`], everything is spawned onto the ambient tokio runtime.
+    jobs: Option<Arc<JobSystem>>,
+    /// Finished jobs with a completion callback, drained by [`FutureQueue::poll_completions`].
+    completed: (Sender<Arc<HandleEntry>>, Receiver<Arc<HandleEntry>>),
 }
 
 impl FutureQueue {
     /// Creates a new [`Arc<FutureQueue>`].
+    ///
+    /// All jobs are spawned onto the ambient tokio runtime. Use [`FutureQueue::with_job_system`]
+    /// to run compute and I/O work on their own pools.
     pub fn new() -> Self {
         Self {
-            queued: Arc::new(Mutex::new(VecDeque::new())),
-            handle_registry: Arc::new(Mutex::new(HashMap::new())),
-            next_id: Arc::new(Mutex::new(0)),
+            queued: crossbeam_channel::unbounded(),
+            handle_registry: HandleRegistry::new(),
+            next_id: AtomicU64::new(0),
+            jobs: None,
+            completed: crossbeam_channel::unbounded(),
         }
     }
 
+    /// Creates a new [`FutureQueue`] backed by a [`JobSystem`], with separate pools for compute
+    /// jobs and I/O futures.
+    pub fn with_job_system(config: JobSystemConfig) -> std::io::Result<Self> {
+        let jobs = JobSystem::new(config)?;
+        log(format!(
+            "Created job system with {} compute threads",
+            jobs.compute_threads()
+        ));
+        Ok(Self {
+            jobs: Some(Arc::new(jobs)),
+            ..Self::new()
+        })
+    }
+
+    /// Creates a new [`FutureQueue`] backed by a [`JobSystem`] with the default
+    /// [`JobSystemConfig`], falling back to [`FutureQueue::new`] (and the ambient tokio runtime)
+    /// if its worker pools cannot be created.
+    pub fn with_job_system_or_fallback() -> Self {
+        Self::with_job_system(JobSystemConfig::default()).unwrap_or_else(|e| {
+            log::warn!("Unable to create job system, falling back to tokio: {}", e);
+            Self::new()
+        })
+    }
+
+    /// The [`JobSystem`] backing this queue, if any.
+    pub fn job_system(&self) -> Option<&Arc<JobSystem>> {
+        self.jobs.as_ref()
+    }
+
     /// Pushes a future to the FutureQueue. It will sit and wait
     /// to be processed until [`FutureQueue::poll`] is called.
     pub fn push<F, T>(&self, future: F) -> FutureHandle
@@ -109,80 +168,262 @@ impl FutureQueue {
         F: Future<Output = T> + Send + 'static,
         T: Send + Sync + 'static,
     {
-        let mut next_id = self.next_id.lock();
-        let id = *next_id;
-        *next_id += 1;
-
-        let id = FutureHandle { id };
-
-        let (sender, receiver) = oneshot::channel::<AnyResult>();
-
-        let entry = HandleEntry {
-            receiver: Some(receiver),
-            status: FutureStatus::NotPolled,
-            cached_result: None,
-            task_handle: None,
-        };
+        self.push_with_priority(JobPriority::Normal, future)
+    }
 
-        self.handle_registry.lock().insert(id, entry);
+    /// Pushes a future with a [`JobPriority`]. Higher priority futures are started first by
+    /// [`FutureQueue::poll`].
+    pub fn push_with_priority<F, T>(&self, priority: JobPriority, future: F) -> FutureHandle
+    where
+        F: Future<Output = T> + Send + 'static,
+        T: Send + Sync + 'static,
+    {
+        let (id, entry, sender) = self.register(None);
 
-        let wrapped_future: Pin<Box<dyn Future<Output = ()> + Send>> = Box::pin(async move {
+        let wrapped_future: BoxFuture<()> = Box::pin(async move {
             log("Starting future execution");
             let result = future.await;
-            let boxed_result: AnyResult = Arc::new(result);
-            log("Future completed, sending result");
+            Self::complete(Arc::new(result), sender, None);
+        });
+
+        self.enqueue(id, entry, priority, JobKind::Future(wrapped_future));
+        id
+    }
 
-            let _ = sender.send(boxed_result);
+    /// Pushes a blocking, CPU heavy job (such as decoding an image).
+    ///
+    /// When backed by a [`JobSystem`], it runs on the compute pool instead of stalling the I/O
+    /// runtime. Otherwise, it is ran with [`tokio::task::spawn_blocking`].
+    pub fn push_compute<F, T>(&self, priority: JobPriority, job: F) -> FutureHandle
+    where
+        F: FnOnce() -> T + Send + 'static,
+        T: Send + Sync + 'static,
+    {
+        self.push_compute_inner(priority, job, None)
+    }
 
-            log("Result sent via channel");
+    /// Pushes a blocking job like [`FutureQueue::push_compute`], with a callback that gets ran on
+    /// the thread calling [`FutureQueue::poll_completions`] once it finishes.
+    ///
+    /// The result is consumed by the callback, so it cannot be exchanged afterward.
+    pub fn push_compute_then<F, T, C>(
+        &self,
+        priority: JobPriority,
+        job: F,
+        on_complete: C,
+    ) -> FutureHandle
+    where
+        F: FnOnce() -> T + Send + 'static,
+        T: Send + Sync + 'static,
+        C: FnOnce(T) + Send + 'static,
+    {
+        let callback: CompletionCallback = Box::new(move |result: AnyResult| {
+            match result
+                .downcast::<T>()
+                .ok()
+                .and_then(|arc| Arc::try_unwrap(arc).ok())
+            {
+                Some(value) => on_complete(value),
+                None => log("Completion callback received an unexpected result type"),
+            }
         });
+        self.push_compute_inner(priority, job, Some(callback))
+    }
+
+    /// Pushes a future that is mostly CPU heavy work (such as loading a scene, which parses every
+    /// model in it) to be ran to completion on the compute pool, like [`FutureQueue::push_compute`].
+    ///
+    /// The future is driven with the I/O runtime's handle, so any file or network I/O it awaits
+    /// is still serviced by the I/O runtime. Prefer reading files with [`FutureQueue::push`] and
+    /// handing the bytes to [`FutureQueue::push_compute`] when the two can be split.
+    pub fn push_compute_future<F, T>(&self, priority: JobPriority, future: F) -> FutureHandle
+    where
+        F: Future<Output = T> + Send + 'static,
+        T: Send + Sync + 'static,
+    {
+        let io = self.jobs.as_ref().map(|jobs| jobs.io().clone());
+        self.push_compute(priority, move || {
+            // without a job system this runs in `spawn_blocking`, which is inside the ambient runtime
+            let runtime = io.unwrap_or_else(tokio::runtime::Handle::current);
+            runtime.block_on(future)
+        })
+    }
+
+    fn push_compute_inner<F, T>(
+        &self,
+        priority: JobPriority,
+        job: F,
+        on_complete: Option<CompletionCallback>,
+    ) -> FutureHandle
+    where
+        F: FnOnce() -> T + Send + 'static,
+        T: Send + Sync + 'static,
+    {
+        // only jobs with a callback need to be picked up by `poll_completions`
+        let completed = on_complete.is_some().then(|| self.completed.0.clone());
+        let (id, entry, sender) = self.register(on_complete);
+
+        let job_entry = entry.clone();
+        let wrapped_job: Box<dyn FnOnce() + Send> = Box::new(move || {
+            // cancelled while waiting for a worker, so drop the job without running it
+            if job_entry.is_cancelled() {
+                log("Skipping cancelled compute job");
+                return;
+            }
 
-        self.queued.lock().push_back((id, wrapped_future));
+            log("Starting compute job");
+            // a panic would otherwise take down the whole compute pool (and the app with it)
+            match std::panic::catch_unwind(std::panic::AssertUnwindSafe(job)) {
+                Ok(result) => Self::complete(
+                    Arc::new(result),
+                    sender,
+                    completed.map(|completed| (completed, job_entry)),
+                ),
+                Err(payload) => {
+                    log::error!("Compute job panicked: {}", panic_message(&*payload));
+                    job_entry.transition(FutureStatus::CurrentlyPolling, FutureStatus::Failed);
+                    // dropping `sender` closes the handle's channel
+                }
+            }
+        });
 
+        self.enqueue(id, entry, priority, JobKind::Compute(wrapped_job));
         id
     }
 
+    /// Creates a new handle and its registry entry.
+    fn register(
+        &self,
+        on_complete: Option<CompletionCallback>,
+    ) -> (FutureHandle, Arc<HandleEntry>, oneshot::Sender<AnyResult>) {
+        let id = FutureHandle {
+            id: self.next_id.fetch_add(1, Ordering::Relaxed),
+        };
+
+        let (sender, receiver) = oneshot::channel::<AnyResult>();
+
+        let entry = Arc::new(HandleEntry::new(receiver, on_complete));
+        self.handle_registry.insert(id, entry.clone());
+
+        (id, entry, sender)
+    }
+
+    fn enqueue(
+        &self,
+        handle: FutureHandle,
+        entry: Arc<HandleEntry>,
+        priority: JobPriority,
+        kind: JobKind,
+    ) {
+        // the receiver lives as long as the queue itself, so this cannot fail
+        let _ = self.queued.0.send(QueuedJob {
+            handle,
+            entry,
+            priority,
+            kind,
+        });
+    }
+
+    /// Sends the result of a finished job back to its handle.
+    fn complete(
+        result: AnyResult,
+        sender: oneshot::Sender<AnyResult>,
+        completed: Option<(Sender<Arc<HandleEntry>>, Arc<HandleEntry>)>,
+    ) {
+        log("Job completed, sending result");
+        // a closed channel means the handle was cancelled, so nobody needs the notification either
+        if sender.send(result).is_ok()
+            && let Some((completed, entry)) = completed
+        {
+            let _ = completed.send(entry);
+        }
+        log("Result sent via channel");
+    }
+
     /// Polls all the futures in the future queue and resolves the handles.
     ///
     /// This function spawns a new async thread for each item inside the thread and
-    /// sends updates to the Handle's receiver.
+    /// sends updates to the Handle's receiver. Jobs are started in order of their [`JobPriority`].
     pub fn poll(&self) {
-        let mut queue = self.queued.lock();
-        log("Locked queue for polling");
+        let mut jobs_to_spawn: Vec<QueuedJob> = self.queued.1.try_iter().collect();
 
-        if queue.is_empty() {
+        if jobs_to_spawn.is_empty() {
             log("Queue is empty, nothing to poll");
             return;
         }
 
-        let mut futures_to_spawn = Vec::new();
+        // stable, so jobs with the same priority keep their push order
+        jobs_to_spawn.sort_by_key(|job| job.priority);
 
-        while let Some((id, future)) = queue.pop_front() {
-            log(format!("Processing future with id: {:?}", id));
+        for job in jobs_to_spawn {
+            log(format!("Processing job with id: {:?}", job.handle));
 
+            // jobs cancelled before being polled are dropped here, freeing everything they hold
+            if !job
+                .entry
+                .transition(FutureStatus::NotPolled, FutureStatus::CurrentlyPolling)
             {
-                let mut registry = self.handle_registry.lock();
-                if let Some(entry) = registry.get_mut(&id) {
-                    entry.status = FutureStatus::CurrentlyPolling;
-                    log("Updated status to CurrentlyPolling");
-                }
+                log("Job was cancelled before being polled");
+                continue;
             }
 
-            futures_to_spawn.push((id, future));
+            let task_handle = match (job.kind, &self.jobs) {
+                (JobKind::Future(future), Some(jobs)) => Some(jobs.io().spawn(future)),
+                (JobKind::Future(future), None) => Some(tokio::spawn(future)),
+                (JobKind::Compute(run), Some(jobs)) => {
+                    jobs.spawn_compute(job.priority, run);
+                    None
+                }
+                (JobKind::Compute(run), None) => Some(tokio::task::spawn_blocking(run)),
+            };
+
+            if let Some(task_handle) = task_handle {
+                let mut slot = job.entry.slot.lock();
+                // cancelled while being spawned, in which case `cancel` could not abort it
+                if job.entry.is_cancelled() {
+                    task_handle.abort();
+                } else {
+                    slot.task_handle = Some(task_handle);
+                }
+            }
         }
+    }
 
-        drop(queue);
-
-        let registry = self.handle_registry.clone();
-        for (id, future) in futures_to_spawn {
-            log("Spawning future with tokio");
-            let handle = tokio::spawn(future);
+    /// Runs the completion callbacks of finished jobs (see [`FutureQueue::push_compute_then`]),
+    /// stopping once `max_duration` has passed so a burst of completions cannot spike a frame.
+    ///
+    /// Anything left over is picked up by the next call. Returns the number of callbacks ran.
+    pub fn poll_completions(&self, max_duration: Duration) -> usize {
+        let start = Instant::now();
+        let mut ran = 0;
+
+        while start.elapsed() < max_duration {
+            let Ok(entry) = self.completed.1.try_recv() else {
+                break;
+            };
+
+            let (callback, result) = {
+                let mut slot = entry.slot.lock();
+                if slot.on_complete.is_none() || entry.is_cancelled() {
+                    continue;
+                }
 
-            let mut reg = registry.lock();
-            if let Some(entry) = reg.get_mut(&id) {
-                entry.task_handle = Some(handle);
+                let result = slot.cached_result.take().or_else(|| {
+                    slot.receiver
+                        .take()
+                        .and_then(|mut receiver| receiver.try_recv().ok())
+                });
+                entry.set_status(FutureStatus::Completed);
+                (slot.on_complete.take(), result)
+            };
+
+            if let (Some(callback), Some(result)) = (callback, result) {
+                callback(result);
+                ran += 1;
             }
         }
+
+        ran
     }
 
     /// Exchanges the future for the result.
@@ -190,43 +431,7 @@ impl FutureQueue {
     /// When the handle is not successful, it will return nothing. When the handle is successful,
     /// it will return the result. The result is cached and can be retrieved multiple times.
     pub fn exchange(&self, handle: &FutureHandle) -> Option<AnyResult> {
-        let mut registry = self.handle_registry.lock();
-        if let Some(entry) = registry.get_mut(handle) {
-            match &entry.status {
-                FutureStatus::Completed => {
-                    log("FutureStatus::Completed - returning cached result");
-                    entry.cached_result.clone()
-                }
-                _ => {
-                    log("Future not completed yet, checking receiver");
-                    if let Some(receiver) = entry.receiver.as_mut() {
-                        match receiver.try_recv() {
-                            Ok(result) => {
-                                log("Received result from channel");
-                                entry.status = FutureStatus::Completed;
-                                entry.cached_result = Some(result.clone());
-                                entry.receiver = None;
-                                Some(result)
-                            }
-                            Err(oneshot::error::TryRecvError::Empty) => {
-                                log("Channel is empty - future still running");
-                                None
-                            }
-                            Err(oneshot::error::TryRecvError::Closed) => {
-                                log("Channel is closed - future may have panicked");
-                                None
-                            }
-                        }
-                    } else {
-                        log("No receiver available");
-                        None
-                    }
-                }
-            }
-        } else {
-            log("Handle not found in registry");
-            None
-        }
+        self.resolve(handle, false)
     }
 
     /// Exchanges the future for the result, taking ownership and consuming the cached result.
@@ -235,41 +440,51 @@ impl FutureQueue {
     /// it will return the result and remove it from the cache, allowing Arc::try_unwrap to succeed.
     /// This method can only be called once per completed future.
     pub fn exchange_owned(&self, handle: &FutureHandle) -> Option<AnyResult> {
-        let mut registry = self.handle_registry.lock();
-        if let Some(entry) = registry.get_mut(handle) {
-            match &entry.status {
-                FutureStatus::Completed => {
-                    log("FutureStatus::Completed - taking ownership of cached result");
-                    entry.cached_result.take()
+        self.resolve(handle, true)
+    }
+
+    fn resolve(&self, handle: &FutureHandle, take: bool) -> Option<AnyResult> {
+        let Some(entry) = self.handle_registry.get(handle) else {
+            log("Handle not found in registry");
+            return None;
+        };
+
+        let mut slot = entry.slot.lock();
+        match entry.status() {
+            FutureStatus::Completed => {
+                log("FutureStatus::Completed - returning cached result");
+                if take {
+                    slot.cached_result.take()
+                } else {
+                    slot.cached_result.clone()
                 }
-                _ => {
-                    log("Future not completed yet, checking receiver");
-                    if let Some(receiver) = entry.receiver.as_mut() {
-                        match receiver.try_recv() {
-                            Ok(result) => {
-                                log("Received result from channel");
-                                entry.status = FutureStatus::Completed;
-                                entry.receiver = None;
-                                Some(result)
-                            }
-                            Err(oneshot::error::TryRecvError::Empty) => {
-                                log("Channel is empty - future still running");
-                                None
-                            }
-                            Err(oneshot::error::TryRecvError::Closed) => {
-                                log("Channel is closed - future may have panicked");
-                                None
-                            }
+            }
+            FutureStatus::Cancelled => None,
+            _ => {
+                log("Future not completed yet, checking receiver");
+                let receiver = slot.receiver.as_mut()?;
+                match receiver.try_recv() {
+                    Ok(result) => {
+                        log("Received result from channel");
+                        slot.receiver = None;
+                        if !take {
+                            slot.cached_result = Some(result.clone());
                         }
-                    } else {
-                        log("No receiver available");
+                        entry.set_status(FutureStatus::Completed);
+                        Some(result)
+                    }
+                    Err(oneshot::error::TryRecvError::Empty) => {
+                        log("Channel is empty - future still running");
+                        None
+                    }
+                    Err(oneshot::error::TryRecvError::Closed) => {
+                        log("Channel is closed - future may have panicked");
+                        slot.receiver = None;
+                        entry.transition(FutureStatus::CurrentlyPolling, FutureStatus::Failed);
                         None
                     }
                 }
             }
-        } else {
-            log("Handle not found in registry");
-            None
         }
     }
 
@@ -295,65 +510,56 @@ impl FutureQueue {
 
     /// Get status of a handle
     pub fn get_status(&self, handle: &FutureHandle) -> Option<FutureStatus> {
-        let registry = self.handle_registry.lock();
-        registry.get(handle).map(|entry| entry.status.clone())
+        self.handle_registry.get(handle).map(|entry| entry.status())
     }
 
     /// Cancels a running future by its handle.
     ///
     /// This will abort the task if it's currently running, mark it as cancelled,
-    /// and clean up associated resources. Returns true if the task was cancelled,
-    /// false if the handle was not found or already completed.
+    /// and clean up associated resources. Jobs that have not started yet are dropped without
+    /// running. Returns true if the task was cancelled, false if the handle was not found or
+    /// already completed.
     pub fn cancel(&self, handle: &FutureHandle) -> bool {
-        let mut registry = self.handle_registry.lock();
-
-        if let Some(entry) = registry.get_mut(handle) {
-            if matches!(
-                entry.status,
-                FutureStatus::Completed | FutureStatus::Cancelled
-            ) {
-                return false;
-            }
-
-            if let Some(task_handle) = entry.task_handle.take() {
-                task_handle.abort();
-                log(format!("Aborted task for handle: {:?}", handle));
-            }
+        let Some(entry) = self.handle_registry.get(handle) else {
+            log(format!("Handle not found for cancellation: {:?}", handle));
+            return false;
+        };
 
-            entry.status = FutureStatus::Cancelled;
-            entry.receiver = None;
-            entry.cached_result = None;
+        if !entry.try_cancel() {
+            return false;
+        }
 
-            log(format!("Cancelled handle: {:?}", handle));
-            true
-        } else {
-            log(format!("Handle not found for cancellation: {:?}", handle));
-            false
+        let mut slot = entry.slot.lock();
+        if let Some(task_handle) = slot.task_handle.take() {
+            task_handle.abort();
+            log(format!("Aborted task for handle: {:?}", handle));
         }
+
+        slot.receiver = None;
+        slot.cached_result = None;
+        slot.on_complete = None;
+
+        log(format!("Cancelled handle: {:?}", handle));
+        true
     }
 
     /// Cleans up any completed handles and removes them from the registry.
     ///
     /// You can do this manually, however this is typically done at the end of the frame.
     pub fn cleanup(&self) {
-        let mut registry = self.handle_registry.lock();
-        let completed_ids: Vec<FutureHandle> = registry
-            .iter()
-            .filter_map(|(&id, entry)| {
-                matches!(
-                    entry.status,
-                    FutureStatus::Completed | FutureStatus::Cancelled
-                )
-                .then_some(id)
-            })
-            .collect();
-
-        for id in completed_ids {
-            registry.remove(&id);
-        }
+        self.handle_registry.remove_finished();
     }
 }
 
+/// The message a panic was raised with, if it was raised with a string.
+pub(crate) fn panic_message(payload: &(dyn Any + Send)) -> &str {
+    payload
+        .downcast_ref::<&str>()
+        .copied()
+        .or_else(|| payload.downcast_ref::<String>().map(String::as_str))
+        .unwrap_or("(no message)")
+}
+
 /// Internal function for logging to a file for tests (when stdout is not available).
 ///
 /// Only logs if the [`LOG_TO_FILE`] constant is set to true.
@@ -469,3 +675,116 @@ fn test_exchange_owned_as() {
             assert!(queue.exchange_owned_as::<i32>(&handle).is_none());
         });
 }
+
+#[test]
+fn test_job_system_compute() {
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    let queue = FutureQueue::with_job_system(JobSystemConfig {
+        compute_threads: 2,
+        io_threads: 1,
+    })
+    .unwrap();
+
+    let completed = Arc::new(AtomicUsize::new(0));
+    let handles: Vec<_> = (0..16)
+        .map(|i| {
+            let completed = completed.clone();
+            queue.push_compute_then(
+                JobPriority::Normal,
+                move || i * 2,
+                move |result: i32| {
+                    assert_eq!(result % 2, 0);
+                    completed.fetch_add(1, Ordering::SeqCst);
+                },
+            )
+        })
+        .collect();
+
+    let cancelled = queue.push_compute(JobPriority::Low, || 67 + 41);
+    assert!(queue.cancel(&cancelled));
+
+    queue.poll();
+
+    let start = Instant::now();
+    while completed.load(Ordering::SeqCst) < handles.len() {
+        queue.poll_completions(Duration::from_millis(1));
+        if start.elapsed() > Duration::from_secs(5) {
+            panic!("Compute jobs never completed");
+        }
+        std::thread::sleep(Duration::from_millis(1));
+    }
+
+    assert!(matches!(
+        queue.get_status(&cancelled),
+        Some(FutureStatus::Cancelled)
+    ));
+    assert!(queue.exchange_owned_as::<i32>(&cancelled).is_none());
+}
+
+#[test]
+fn test_job_system_compute_future() {
+    let queue = FutureQueue::with_job_system(JobSystemConfig {
+        compute_threads: 1,
+        io_threads: 1,
+    })
+    .unwrap();
+
+    let handle = queue.push_compute_future(JobPriority::High, async {
+        // timers belong to the I/O runtime, while the future itself is polled on a compute worker
+        tokio::time::sleep(Duration::from_millis(5)).await;
+        std::thread::current().name().map(str::to_string)
+    });
+    queue.poll();
+
+    let start = Instant::now();
+    let thread = loop {
+        if let Some(thread) = queue.exchange_owned_as::<Option<String>>(&handle) {
+            break thread;
+        }
+        if start.elapsed() > Duration::from_secs(5) {
+            panic!("Compute future never completed");
+        }
+        std::thread::sleep(Duration::from_millis(1));
+    };
+    assert!(thread.is_some_and(|name| name.starts_with("dropbear-compute")));
+}
+
+#[test]
+fn test_job_system_compute_panic() {
+    let queue = FutureQueue::with_job_system(JobSystemConfig {
+        compute_threads: 1,
+        io_threads: 1,
+    })
+    .unwrap();
+
+    let panicked = queue.push_compute(JobPriority::High, || -> i32 { panic!("malformed model") });
+    queue.poll();
+
+    let start = Instant::now();
+    while !matches!(queue.get_status(&panicked), Some(FutureStatus::Failed)) {
+        assert!(queue.exchange(&panicked).is_none());
+        if start.elapsed() > Duration::from_secs(5) {
+            panic!("Panicked job never reported failure");
+        }
+        std::thread::sleep(Duration::from_millis(1));
+    }
+
+    // the only worker survived the panic
+    let handle = queue.push_compute(JobPriority::Normal, || 67 + 41);
+    queue.poll();
+    let start = Instant::now();
+    loop {
+        if let Some(result) = queue.exchange_owned_as::<i32>(&handle) {
+            assert_eq!(result, 108);
+            break;
+        }
+        if start.elapsed() > Duration::from_secs(5) {
+            panic!("Compute pool stopped working after a panic");
+        }
+        std::thread::sleep(Duration::from_millis(1));
+    }
+
+    queue.cleanup();
+    assert!(queue.get_status(&panicked).is_none());
+}
@@ -0,0 +1,150 @@
+//! Per-handle bookkeeping for the [`FutureQueue`](crate::FutureQueue).
+//!
+//! Handles are spread over a fixed amount of shards so that threads pushing, polling and
+//! exchanging different handles rarely touch the same lock. The status of each handle is an
+//! atomic, so checking on a handle never blocks on a job that is being resolved.
+
+use crate::{AnyResult, CompletionCallback, FutureHandle, FutureStatus, ResultReceiver};
+use ahash::{HashMap, HashMapExt};
+use parking_lot::{Mutex, RwLock};
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU8, Ordering};
+use tokio::task::JoinHandle;
+
+/// The amount of shards in a [`HandleRegistry`]. Ids are handed out sequentially, so consecutive
+/// handles always land in different shards.
+const SHARD_COUNT: usize = 64;
+
+impl FutureStatus {
+    fn to_u8(&self) -> u8 {
+        match self {
+            FutureStatus::NotPolled => 0,
+            FutureStatus::CurrentlyPolling => 1,
+            FutureStatus::Completed => 2,
+            FutureStatus::Cancelled => 3,
+            FutureStatus::Failed => 4,
+        }
+    }
+
+    fn from_u8(value: u8) -> Self {
+        match value {
+            0 => FutureStatus::NotPolled,
+            1 => FutureStatus::CurrentlyPolling,
+            2 => FutureStatus::Completed,
+            4 => FutureStatus::Failed,
+            _ => FutureStatus::Cancelled,
+        }
+    }
+
+    /// Whether the handle is done with, and can be removed by [`FutureQueue::cleanup`](crate::FutureQueue::cleanup).
+    pub(crate) fn is_finished(&self) -> bool {
+        matches!(
+            self,
+            FutureStatus::Completed | FutureStatus::Cancelled | FutureStatus::Failed
+        )
+    }
+}
+
+/// Internal storage per handle — separate from FutureHandle
+pub(crate) struct HandleEntry {
+    status: AtomicU8,
+    /// Only ever locked by whoever is resolving this specific handle, so it is uncontended.
+    pub(crate) slot: Mutex<HandleSlot>,
+}
+
+#[derive(Default)]
+pub(crate) struct HandleSlot {
+    pub(crate) receiver: Option<ResultReceiver>,
+    pub(crate) cached_result: Option<AnyResult>,
+    pub(crate) task_handle: Option<JoinHandle<()>>,
+    pub(crate) on_complete: Option<CompletionCallback>,
+}
+
+impl HandleEntry {
+    pub(crate) fn new(receiver: ResultReceiver, on_complete: Option<CompletionCallback>) -> Self {
+        Self {
+            status: AtomicU8::new(FutureStatus::NotPolled.to_u8()),
+            slot: Mutex::new(HandleSlot {
+                receiver: Some(receiver),
+                on_complete,
+                ..Default::default()
+            }),
+        }
+    }
+
+    pub(crate) fn status(&self) -> FutureStatus {
+        FutureStatus::from_u8(self.status.load(Ordering::Acquire))
+    }
+
+    pub(crate) fn set_status(&self, status: FutureStatus) {
+        self.status.store(status.to_u8(), Ordering::Release);
+    }
+
+    pub(crate) fn is_cancelled(&self) -> bool {
+        matches!(self.status(), FutureStatus::Cancelled)
+    }
+
+    /// Moves the status from `current` to `new`, returning false if it was not `current`.
+    pub(crate) fn transition(&self, current: FutureStatus, new: FutureStatus) -> bool {
+        self.status
+            .compare_exchange(
+                current.to_u8(),
+                new.to_u8(),
+                Ordering::AcqRel,
+                Ordering::Acquire,
+            )
+            .is_ok()
+    }
+
+    /// Marks the handle as cancelled, returning false if it has already finished.
+    pub(crate) fn try_cancel(&self) -> bool {
+        self.status
+            .fetch_update(Ordering::AcqRel, Ordering::Acquire, |status| {
+                (!FutureStatus::from_u8(status).is_finished())
+                    .then_some(FutureStatus::Cancelled.to_u8())
+            })
+            .is_ok()
+    }
+}
+
+/// A sharded map of [`FutureHandle`] to [`HandleEntry`].
+pub(crate) struct HandleRegistry {
+    shards: Box<[RwLock<HashMap<FutureHandle, Arc<HandleEntry>>>]>,
+}
+
+impl HandleRegistry {
+    pub(crate) fn new() -> Self {
+        Self {
+            shards: (0..SHARD_COUNT)
+                .map(|_| RwLock::new(HashMap::new()))
+                .collect(),
+        }
+    }
+
+    fn shard(&self, handle: &FutureHandle) -> &RwLock<HashMap<FutureHandle, Arc<HandleEntry>>> {
+        &self.shards[handle.id as usize % SHARD_COUNT]
+    }
+
+    pub(crate) fn insert(&self, handle: FutureHandle, entry: Arc<HandleEntry>) {
+        self.shard(&handle).write().insert(handle, entry);
+    }
+
+    pub(crate) fn get(&self, handle: &FutureHandle) -> Option<Arc<HandleEntry>> {
+        self.shard(handle).read().get(handle).cloned()
+    }
+
+    /// Removes every handle that has finished, locking one shard at a time.
+    pub(crate) fn remove_finished(&self) {
+        for shard in self.shards.iter() {
+            let has_finished = shard
+                .read()
+                .values()
+                .any(|entry| entry.status().is_finished());
+            if has_finished {
+                shard
+                    .write()
+                    .retain(|_, entry| !entry.status().is_finished());
+            }
+        }
+    }
+}
@@ -174,7 +174,7 @@ async fn main() {
     let runtime_scene = Rc::new(RwLock::new(
         PlayMode::new(Some(scene_config.initial_scene)).unwrap(),
     ));
-    let future_queue = Arc::new(FutureQueue::new());
+    let future_queue = Arc::new(FutureQueue::with_job_system_or_fallback());
 
     let authors = scene_config.authors.developer.clone();
     let project_name = scene_config.project_name.clone();
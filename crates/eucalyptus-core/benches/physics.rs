@@ -0,0 +1,266 @@
+//! Steps canned physics scenes on a growing amount of solver threads and reports how long a step
+//! takes with each, to see how well [`PhysicsState::step`] scales with [`PhysicsWorkers`].
+//!
+//! Every run rebuilds the scene from the same layout and steps it at a fixed rate, so each thread
+//! count simulates exactly the same thing.
+//!
+//! Each scene is also captured into and restored from a [`SnapshotRing`], to keep an eye on how
+//! long rollback costs.
+//!
+//! Run with `cargo bench -p eucalyptus-core --bench physics`, optionally followed by the names of
+//! the scenes to run.
+
+use dropbear_engine::entity::EntityTransform;
+use eucalyptus_core::physics::PhysicsState;
+use eucalyptus_core::physics::snapshot::SnapshotRing;
+use eucalyptus_core::physics::workers::PhysicsWorkers;
+use rapier3d::prelude::*;
+use std::time::{Duration, Instant};
+
+const WARMUP_STEPS: usize = 10;
+const STEPS: usize = 240;
+/// How many ticks the snapshot ring holds, a second at 60 ticks per second.
+const SNAPSHOT_TICKS: usize = 60;
+
+struct Scenario {
+    name: &'static str,
+    /// Towers of `stack_height` boxes.
+    stacks: usize,
+    stack_height: usize,
+    ragdolls: usize,
+}
+
+const SCENARIOS: [Scenario; 3] = [
+    Scenario {
+        name: "stacks",
+        stacks: 64,
+        stack_height: 20,
+        ragdolls: 0,
+    },
+    Scenario {
+        name: "ragdolls",
+        stacks: 0,
+        stack_height: 0,
+        ragdolls: 256,
+    },
+    Scenario {
+        name: "destruction",
+        stacks: 128,
+        stack_height: 24,
+        ragdolls: 128,
+    },
+];
+
+/// Where the `i`th of `count` objects goes on a square grid `spacing` apart.
+fn grid_position(i: usize, count: usize, spacing: f32) -> (f32, f32) {
+    let side = (count as f32).sqrt().ceil().max(1.0) as usize;
+    let offset = (side as f32 - 1.0) * spacing * 0.5;
+    (
+        (i % side) as f32 * spacing - offset,
+        (i / side) as f32 * spacing - offset,
+    )
+}
+
+fn spawn_ground(state: &mut PhysicsState) {
+    state.colliders.insert(
+        ColliderBuilder::cuboid(500.0, 0.5, 500.0).translation(Vector::new(0.0, -0.5, 0.0)),
+    );
+}
+
+fn spawn_stacks(state: &mut PhysicsState, stacks: usize, height: usize) {
+    for stack in 0..stacks {
+        let (x, z) = grid_position(stack, stacks, 4.0);
+        for level in 0..height {
+            // every other box is nudged so the towers topple into each other
+            let nudge = if level % 2 == 0 { 0.0 } else { 0.05 };
+            let body = RigidBodyBuilder::dynamic()
+                .translation(Vector::new(x + nudge, 0.5 + level as f32 * 1.01, z))
+                .build();
+            let handle = state.bodies.insert(body);
+            state.colliders.insert_with_parent(
+                ColliderBuilder::cuboid(0.5, 0.5, 0.5),
+                handle,
+                &mut state.bodies,
+            );
+        }
+    }
+}
+
+/// Spawns ragdolls of a torso, a head, and two-part arms and legs joined by ball joints.
+fn spawn_ragdolls(state: &mut PhysicsState, ragdolls: usize, offset: f32) {
+    // (parent, position relative to the torso, capsule half height, capsule radius)
+    const PARTS: [(Option<usize>, [f32; 3], f32, f32); 10] = [
+        (None, [0.0, 0.0, 0.0], 0.3, 0.25),
+        (Some(0), [0.0, 0.75, 0.0], 0.05, 0.2),
+        (Some(0), [-0.5, 0.3, 0.0], 0.2, 0.08),
+        (Some(2), [-0.5, -0.2, 0.0], 0.2, 0.07),
+        (Some(0), [0.5, 0.3, 0.0], 0.2, 0.08),
+        (Some(4), [0.5, -0.2, 0.0], 0.2, 0.07),
+        (Some(0), [-0.15, -0.8, 0.0], 0.25, 0.1),
+        (Some(6), [-0.15, -1.5, 0.0], 0.25, 0.08),
+        (Some(0), [0.15, -0.8, 0.0], 0.25, 0.1),
+        (Some(8), [0.15, -1.5, 0.0], 0.25, 0.08),
+    ];
+
+    for ragdoll in 0..ragdolls {
+        let (x, z) = grid_position(ragdoll, ragdolls, 2.5);
+        let origin = Vector::new(x + offset, 4.0 + (ragdoll % 4) as f32, z);
+
+        let mut handles: Vec<(RigidBodyHandle, Vector)> = Vec::with_capacity(PARTS.len());
+        for (parent, position, half_height, radius) in PARTS {
+            let position = origin + Vector::from_array(position);
+            let body = RigidBodyBuilder::dynamic().translation(position).build();
+            let handle = state.bodies.insert(body);
+            state.colliders.insert_with_parent(
+                ColliderBuilder::capsule_y(half_height, radius),
+                handle,
+                &mut state.bodies,
+            );
+
+            if let Some(parent) = parent {
+                let (parent_handle, parent_position) = handles[parent];
+                let anchor = (parent_position + position) * 0.5;
+                let joint = SphericalJointBuilder::new()
+                    .local_anchor1(anchor - parent_position)
+                    .local_anchor2(anchor - position);
+                state
+                    .impulse_joints
+                    .insert(parent_handle, handle, joint, true);
+            }
+            handles.push((handle, position));
+        }
+    }
+}
+
+fn build(scenario: &Scenario) -> PhysicsState {
+    let mut state = PhysicsState::new();
+    spawn_ground(&mut state);
+    spawn_stacks(&mut state, scenario.stacks, scenario.stack_height);
+    // ragdolls are dropped next to the stacks rather than inside of them
+    let offset = if scenario.stacks > 0 {
+        (scenario.stacks as f32).sqrt().ceil() * 2.0 + 4.0
+    } else {
+        0.0
+    };
+    spawn_ragdolls(&mut state, scenario.ragdolls, offset);
+    state
+}
+
+fn milliseconds(duration: Duration) -> f64 {
+    duration.as_secs_f64() * 1000.0
+}
+
+/// 1, 2, 4, ... up to the amount of cores, always including the amount of cores itself.
+fn thread_counts() -> Vec<u32> {
+    let cores = std::thread::available_parallelism()
+        .map(|n| n.get())
+        .unwrap_or(1) as u32;
+    let mut counts: Vec<u32> = std::iter::successors(Some(1u32), |n| Some(n * 2))
+        .take_while(|n| *n < cores)
+        .collect();
+    counts.push(cores);
+    counts
+}
+
+/// Captures a snapshot after every step and restores one from half a second back, the way a
+/// rollback would, and prints how long each took.
+fn bench_snapshots(scenario: &Scenario) {
+    let workers = PhysicsWorkers::new(None, None).expect("Unable to create the physics workers");
+    let mut state = build(scenario);
+    let mut pipeline = PhysicsPipeline::new();
+
+    // an entity with a transform per body, which the ring captures alongside the physics
+    let mut world = hecs::World::new();
+    let entities: Vec<(hecs::Entity, RigidBodyHandle)> = state
+        .bodies
+        .iter()
+        .map(|(handle, _)| (world.spawn((EntityTransform::default(),)), handle))
+        .collect();
+
+    let mut ring = SnapshotRing::new(SNAPSHOT_TICKS);
+    let mut captures = Vec::with_capacity(STEPS);
+    for tick in 0..STEPS as u64 {
+        state.step(&mut pipeline, &workers, &(), &());
+        for (entity, handle) in &entities {
+            let p = state.bodies[*handle].translation();
+            if let Ok(mut transform) = world.get::<&mut EntityTransform>(*entity) {
+                transform.world_mut().position =
+                    glam::DVec3::new(p.x as f64, p.y as f64, p.z as f64);
+            }
+        }
+
+        let start = Instant::now();
+        ring.capture(tick, &state, &world);
+        captures.push(start.elapsed());
+    }
+
+    let rewind_to = STEPS as u64 - (SNAPSHOT_TICKS as u64 / 2);
+    let start = Instant::now();
+    ring.restore(rewind_to, &mut state, &world)
+        .expect("The rewound tick should still be in the ring");
+    let restore = start.elapsed();
+
+    captures.sort_unstable();
+    let mean = captures.iter().sum::<Duration>() / captures.len() as u32;
+    println!(
+        "snapshot: capture mean {:.3} ms, p95 {:.3} ms, restore {:.3} ms",
+        milliseconds(mean),
+        milliseconds(captures[((captures.len() - 1) as f64 * 0.95).round() as usize]),
+        milliseconds(restore),
+    );
+}
+
+fn main() {
+    let _ = env_logger::builder().is_test(true).try_init();
+
+    let filters: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with('-'))
+        .collect();
+
+    for scenario in &SCENARIOS {
+        if !filters.is_empty() && !filters.iter().any(|f| scenario.name.contains(f.as_str())) {
+            continue;
+        }
+
+        let bodies = build(scenario).bodies.len();
+        println!("\n{} ({} bodies, {} steps)", scenario.name, bodies, STEPS);
+        println!(
+            "{:>8} {:>10} {:>10} {:>10} {:>8}",
+            "threads", "mean (ms)", "p50 (ms)", "p95 (ms)", "speedup"
+        );
+
+        let mut single_threaded = None;
+        for threads in thread_counts() {
+            let workers = PhysicsWorkers::new(Some(threads), None)
+                .expect("Unable to create the physics workers");
+            let mut state = build(scenario);
+            let mut pipeline = PhysicsPipeline::new();
+
+            let mut step = |state: &mut PhysicsState| {
+                let start = Instant::now();
+                state.step(&mut pipeline, &workers, &(), &());
+                start.elapsed()
+            };
+            for _ in 0..WARMUP_STEPS {
+                step(&mut state);
+            }
+            let mut samples: Vec<Duration> = (0..STEPS).map(|_| step(&mut state)).collect();
+
+            samples.sort_unstable();
+            let mean = samples.iter().sum::<Duration>() / samples.len() as u32;
+            let percentile = |p: f64| samples[((samples.len() - 1) as f64 * p).round() as usize];
+            let baseline = *single_threaded.get_or_insert(mean);
+            println!(
+                "{:>8} {:>10.3} {:>10.3} {:>10.3} {:>7.2}x",
+                threads,
+                milliseconds(mean),
+                milliseconds(percentile(0.5)),
+                milliseconds(percentile(0.95)),
+                baseline.as_secs_f64() / mean.as_secs_f64(),
+            );
+        }
+
+        bench_snapshots(scenario);
+    }
+}
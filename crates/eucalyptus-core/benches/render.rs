@@ -0,0 +1,633 @@
+//! Renders canned scenes offscreen through [`RendererCommon::scene_graph`], and reports how long
+//! each stage and pass takes on the CPU, and how long each pass takes on the GPU.
+//!
+//! The scenes are built from procedural meshes with fixed layouts and a fixed timestep, so two
+//! runs on the same machine render exactly the same frames. No display or GPU is needed, a
+//! software adapter is used when there is no hardware one.
+//!
+//! GPU passes are timed with timestamp queries. On adapters without them, the GPU is only timed
+//! as a whole, by the wall time from submitting a frame until the GPU is idle.
+//!
+//! Run with `cargo bench -p eucalyptus-core --bench render`, optionally followed by the names of
+//! the scenes to run. Set `DROPBEAR_BENCH_FALLBACK=1` to always use the software adapter.
+
+use dropbear_engine::animation::{AnimationComponent, MorphTargetInfo};
+use dropbear_engine::asset::{ASSET_REGISTRY, Handle};
+use dropbear_engine::billboarding::BillboardPipeline;
+use dropbear_engine::buffer::DynamicBuffer;
+use dropbear_engine::camera::{Camera, CameraBuilder, CameraSettings};
+use dropbear_engine::entity::{EntityTransform, MeshRenderer, Transform};
+use dropbear_engine::future::{FutureQueue, JobSystemConfig};
+use dropbear_engine::gpu_profiler::GpuFrameTimings;
+use dropbear_engine::graphics::{CommandEncoder, InstanceRaw, SharedGraphicsContext};
+use dropbear_engine::headless::HeadlessOptions;
+use dropbear_engine::ibl::EnvironmentMaps;
+use dropbear_engine::lighting::{Light, LightComponent};
+use dropbear_engine::model::{
+    Animation, AnimationChannel, AnimationInterpolation, ChannelValues, Model, Node, NodeTransform,
+    Skin,
+};
+use dropbear_engine::pipelines::animation::AnimationDefaults;
+use dropbear_engine::pipelines::light_cube::LightCubePipeline;
+use dropbear_engine::pipelines::shader::MainRenderPipeline;
+use dropbear_engine::pipelines::{DropbearShaderPipeline, GlobalsUniform};
+use dropbear_engine::procedural::ProcedurallyGeneratedObject;
+use dropbear_engine::shadows::{ShadowRenderer, ShadowSettings};
+use dropbear_engine::sky::{DEFAULT_SKY_TEXTURE, SkyPipeline};
+use eucalyptus_core::billboard::BillboardComponent;
+use eucalyptus_core::change::mark_changed;
+use eucalyptus_core::rendering::{LightChangeCursor, RendererCache, RendererCommon, SceneFrame};
+use glam::{DQuat, DVec3, Mat4, Quat, Vec3};
+use hecs::{Entity, World};
+use std::collections::HashMap;
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+const WARMUP_FRAMES: usize = 16;
+const FRAMES: usize = 120;
+const FRAME_DT: f32 = 1.0 / 60.0;
+
+struct Scenario {
+    name: &'static str,
+    props: usize,
+    characters: usize,
+    lights: usize,
+    billboards: usize,
+}
+
+const SCENARIOS: [Scenario; 5] = [
+    Scenario {
+        name: "props",
+        props: 2_000,
+        characters: 0,
+        lights: 1,
+        billboards: 0,
+    },
+    Scenario {
+        name: "characters",
+        props: 0,
+        characters: 64,
+        lights: 1,
+        billboards: 0,
+    },
+    Scenario {
+        name: "lights",
+        props: 500,
+        characters: 0,
+        lights: 8,
+        billboards: 0,
+    },
+    Scenario {
+        name: "billboards",
+        props: 0,
+        characters: 0,
+        lights: 1,
+        billboards: 256,
+    },
+    Scenario {
+        name: "mixed",
+        props: 1_000,
+        characters: 32,
+        lights: 8,
+        billboards: 64,
+    },
+];
+
+/// How long the parts of one frame took.
+#[derive(Default)]
+struct FrameTimes {
+    /// Each stage on the CPU, in the order they ran. The passes of the scene graph are stages of
+    /// their own, and a name can come up more than once, such as `"submit"`.
+    cpu: Vec<(&'static str, Duration)>,
+    /// Each timed pass on the GPU from the [`GpuProfiler`](dropbear_engine::gpu_profiler::GpuProfiler),
+    /// then the whole frame under [`GPU_TOTAL`]. Without timestamp queries only the total is
+    /// there, as the wall time from submitting the frame until the GPU is idle.
+    gpu: Vec<(String, Duration)>,
+}
+
+const GPU_TOTAL: &str = "total";
+
+/// Times consecutive stages of a frame.
+struct Lap(Instant);
+
+impl Lap {
+    fn next(&mut self) -> Duration {
+        let now = Instant::now();
+        let elapsed = now - self.0;
+        self.0 = now;
+        elapsed
+    }
+}
+
+/// Everything the runtime keeps between frames to render a scene.
+struct SceneRenderer {
+    world: World,
+    camera: Camera,
+    main_pipeline: MainRenderPipeline,
+    globals: GlobalsUniform,
+    light_pipeline: LightCubePipeline,
+    light_changes: LightChangeCursor,
+    shadows: ShadowRenderer,
+    animation_defaults: AnimationDefaults,
+    sky: SkyPipeline,
+    billboard_pipeline: BillboardPipeline,
+    billboard_views: HashMap<u64, wgpu::TextureView>,
+
+    instance_buffer_cache: HashMap<u64, DynamicBuffer<InstanceRaw>>,
+    renderer_cache: RendererCache,
+    animated_instance_buffers: HashMap<Entity, DynamicBuffer<InstanceRaw>>,
+    animated_bind_group_cache: HashMap<Entity, (u64, wgpu::BindGroup)>,
+    static_bind_group_cache: HashMap<u64, wgpu::BindGroup>,
+    last_morph_info_per_mesh: HashMap<u32, MorphTargetInfo>,
+    /// The GPU timings reported last, so a frame whose timings did not arrive is not counted twice.
+    last_gpu_timings: Option<Arc<GpuFrameTimings>>,
+}
+
+impl SceneRenderer {
+    fn new(
+        graphics: &Arc<SharedGraphicsContext>,
+        scenario: &Scenario,
+        environment: EnvironmentMaps,
+    ) -> Self {
+        let mut world = World::new();
+        spawn_props(graphics, &mut world, scenario.props);
+        spawn_characters(graphics, &mut world, scenario.characters);
+        spawn_lights(graphics, &mut world, scenario.lights);
+        spawn_billboards(&mut world, scenario.billboards);
+
+        let size = graphics.viewport_texture.size;
+        let mut camera = Camera::new(
+            graphics.clone(),
+            CameraBuilder {
+                eye: DVec3::new(0.0, 25.0, -70.0),
+                target: DVec3::ZERO,
+                up: DVec3::Y,
+                aspect: size.width as f64 / size.height.max(1) as f64,
+                znear: 0.1,
+                zfar: 500.0,
+                settings: CameraSettings::default(),
+            },
+            Some("bench camera"),
+        );
+        camera.update(graphics.clone());
+
+        let mut main_pipeline = MainRenderPipeline::new(graphics.clone());
+        let globals = GlobalsUniform::new(graphics.clone(), Some("bench shader globals"));
+        let light_pipeline = LightCubePipeline::new(graphics.clone());
+        let shadows = ShadowRenderer::new(graphics, ShadowSettings::default());
+        main_pipeline.per_frame_bind_group(
+            graphics.clone(),
+            globals.buffer.buffer(),
+            camera.buffer(),
+            light_pipeline.light_buffer(),
+            &shadows,
+        );
+
+        let sky = SkyPipeline::new(graphics.clone(), environment, camera.buffer());
+
+        // every billboard shows the same texture, as the kino targets would need a window
+        let billboard_texture = graphics.device.create_texture(&wgpu::TextureDescriptor {
+            label: Some("bench billboard texture"),
+            size: wgpu::Extent3d {
+                width: 256,
+                height: 256,
+                depth_or_array_layers: 1,
+            },
+            mip_level_count: 1,
+            sample_count: 1,
+            dimension: wgpu::TextureDimension::D2,
+            format: wgpu::TextureFormat::Rgba8UnormSrgb,
+            usage: wgpu::TextureUsages::TEXTURE_BINDING | wgpu::TextureUsages::RENDER_ATTACHMENT,
+            view_formats: &[],
+        });
+        let billboard_views = HashMap::from([(
+            0,
+            billboard_texture.create_view(&wgpu::TextureViewDescriptor::default()),
+        )]);
+
+        Self {
+            world,
+            camera,
+            main_pipeline,
+            globals,
+            light_pipeline,
+            light_changes: LightChangeCursor::default(),
+            shadows,
+            animation_defaults: AnimationDefaults::new(graphics.clone()),
+            sky,
+            billboard_pipeline: BillboardPipeline::new(graphics.clone()),
+            billboard_views,
+            instance_buffer_cache: HashMap::new(),
+            renderer_cache: RendererCache::default(),
+            animated_instance_buffers: HashMap::new(),
+            animated_bind_group_cache: HashMap::new(),
+            static_bind_group_cache: HashMap::new(),
+            last_morph_info_per_mesh: HashMap::new(),
+            last_gpu_timings: None,
+        }
+    }
+
+    /// Renders one frame the same way the runtime does, through [`RendererCommon::scene_graph`],
+    /// and waits for the GPU to finish it.
+    fn frame(&mut self, graphics: &Arc<SharedGraphicsContext>) -> FrameTimes {
+        let mut times = FrameTimes::default();
+        let mut lap = Lap(Instant::now());
+
+        {
+            let registry = ASSET_REGISTRY.read();
+            for (entity, renderer, animation) in self
+                .world
+                .query::<(Entity, &MeshRenderer, &mut AnimationComponent)>()
+                .iter()
+            {
+                if let Some(model) = registry.get_model(renderer.model()) {
+                    animation.update(FRAME_DT, &model);
+                    mark_changed::<AnimationComponent>(entity);
+                }
+            }
+        }
+        times.cpu.push(("animation", lap.next()));
+
+        let hdr = graphics.hdr.read();
+
+        self.shadows.assign(&self.world, &self.camera);
+        let changes = self.light_changes.changed(&self.world, Some(&self.shadows));
+        self.light_pipeline
+            .update(graphics.clone(), &self.world, &self.camera, changes);
+        self.globals
+            .set_num_lights(self.light_pipeline.light_count());
+        self.globals.write(&graphics.queue);
+        times.cpu.push(("lights", lap.next()));
+
+        let default_skinning = Some(self.animation_defaults.skinning_buffer.buffer().clone());
+        RendererCommon::locate_renderers(
+            &self.world,
+            &mut self.renderer_cache,
+            graphics.clone(),
+            &self.camera,
+            &default_skinning,
+        );
+        times.cpu.push(("locate renderers", lap.next()));
+
+        let (_, model_cache) = RendererCommon::prepare_models(
+            graphics,
+            &self.renderer_cache.batches,
+            &mut self.instance_buffer_cache,
+        );
+        times.cpu.push(("prepare models", lap.next()));
+
+        let per_frame_bind_group = self
+            .main_pipeline
+            .per_frame
+            .clone()
+            .expect("Per-frame bind group not initialised");
+        let mut frame = SceneFrame {
+            graphics,
+            hdr: &hdr,
+            world: &self.world,
+            camera: &self.camera,
+            current_scene_name: None,
+            batches: &self.renderer_cache.batches,
+            model_cache: &model_cache,
+            per_frame_bind_group: &per_frame_bind_group,
+            pipeline: &self.main_pipeline,
+            animation_defaults: &self.animation_defaults,
+            sky: &self.sky,
+            light_cube_pipeline: Some(&self.light_pipeline),
+            billboard_pipeline: Some(&self.billboard_pipeline),
+            shadows: Some(&mut self.shadows),
+            kino: None,
+            instance_buffer_cache: &self.instance_buffer_cache,
+            animated_instance_buffers: &mut self.animated_instance_buffers,
+            animated_bind_group_cache: &mut self.animated_bind_group_cache,
+            static_bind_group_cache: &mut self.static_bind_group_cache,
+            last_morph_info_per_mesh: &mut self.last_morph_info_per_mesh,
+            billboard_views: self.billboard_views.clone(),
+        };
+        RendererCommon::scene_graph()
+            .execute_timed(graphics, &mut frame, |name, elapsed| {
+                times.cpu.push((name, elapsed))
+            })
+            .unwrap_or_else(|e| panic!("Unable to render the scene: {}", e));
+        lap.next();
+
+        // as at the end of a runtime frame, the profiler resolves into the last encoder
+        let mut encoder = CommandEncoder::new(graphics.clone(), Some("bench encoder"));
+        graphics.gpu_profiler.resolve(&mut encoder);
+        if let Err(e) = encoder.submit() {
+            panic!("Unable to submit frame: {}", e);
+        }
+        graphics.gpu_profiler.after_submit();
+        times.cpu.push(("submit", lap.next()));
+
+        graphics
+            .device
+            .poll(wgpu::PollType::wait_indefinitely())
+            .expect("Device lost while waiting for the frame");
+        let waited = lap.next();
+
+        // the GPU is idle, so the readback of this frame is mapped by now
+        graphics.gpu_profiler.collect(&graphics.device);
+        if !graphics.gpu_profiler.is_enabled() {
+            times.gpu.push((GPU_TOTAL.to_string(), waited));
+        } else if let Some(timings) = graphics.gpu_profiler.latest()
+            && !self
+                .last_gpu_timings
+                .as_ref()
+                .is_some_and(|last| Arc::ptr_eq(last, &timings))
+        {
+            let duration = |ms: f64| Duration::from_secs_f64(ms / 1000.0);
+            for pass in &timings.passes {
+                times.gpu.push((pass.label.clone(), duration(pass.milliseconds)));
+            }
+            times.gpu.push((GPU_TOTAL.to_string(), duration(timings.total_milliseconds)));
+            self.last_gpu_timings = Some(timings);
+        }
+
+        times
+    }
+}
+
+/// Lays `count` objects out on a square grid centred on the origin.
+fn grid_position(index: usize, count: usize, spacing: f64) -> DVec3 {
+    let side = (count as f64).sqrt().ceil().max(1.0) as usize;
+    let offset = (side as f64 - 1.0) * spacing * 0.5;
+    DVec3::new(
+        (index % side) as f64 * spacing - offset,
+        0.0,
+        (index / side) as f64 * spacing - offset,
+    )
+}
+
+fn spawn_mesh(world: &mut World, model: Handle<Model>, transform: Transform) -> Entity {
+    let mut renderer = MeshRenderer::from_handle(model);
+    renderer.update(&transform);
+    world.spawn((renderer, EntityTransform::new_from_world(transform)))
+}
+
+fn spawn_props(graphics: &Arc<SharedGraphicsContext>, world: &mut World, count: usize) {
+    // a handful of different meshes, so the props end up in several batches
+    let models: Vec<Handle<Model>> = (0..4)
+        .map(|i| {
+            ProcedurallyGeneratedObject::cuboid(DVec3::new(1.0, 1.0 + i as f64 * 0.5, 1.0))
+                .build_model(
+                    graphics.clone(),
+                    None,
+                    Some(&format!("bench prop {}", i)),
+                    ASSET_REGISTRY.clone(),
+                )
+        })
+        .collect();
+
+    for i in 0..count {
+        let transform = Transform {
+            position: grid_position(i, count, 2.0),
+            rotation: DQuat::from_rotation_y(i as f64 * 0.37),
+            scale: DVec3::ONE,
+        };
+        spawn_mesh(world, models[i % models.len()], transform);
+    }
+}
+
+/// A cuboid skinned to two joints, with the upper half swaying back and forth.
+fn skinned_model(graphics: &Arc<SharedGraphicsContext>) -> Handle<Model> {
+    let mut mesh = ProcedurallyGeneratedObject::cuboid(DVec3::new(0.6, 1.8, 0.4));
+    for vertex in &mut mesh.vertices {
+        if vertex.position[1] > 0.0 {
+            vertex.joints0 = [1, 0, 0, 0];
+        }
+    }
+
+    let mut model = mesh.construct(
+        graphics.clone(),
+        None,
+        Some("bench character"),
+        None,
+        ASSET_REGISTRY.clone(),
+    );
+    model.nodes = vec![
+        Node {
+            name: "hips".to_string(),
+            parent: None,
+            children: vec![1],
+            transform: NodeTransform::identity(),
+        },
+        Node {
+            name: "spine".to_string(),
+            parent: Some(0),
+            children: Vec::new(),
+            transform: NodeTransform::identity(),
+        },
+    ];
+    model.skins = vec![Skin {
+        name: "bench skeleton".to_string(),
+        joints: vec![0, 1],
+        inverse_bind_matrices: vec![Mat4::IDENTITY; 2],
+        skeleton_root: Some(0),
+    }];
+    model.animations = vec![Animation {
+        name: "sway".to_string(),
+        channels: vec![AnimationChannel {
+            target_node: 1,
+            times: vec![0.0, 0.5, 1.0],
+            values: ChannelValues::Rotations(vec![
+                Quat::IDENTITY,
+                Quat::from_rotation_z(0.6),
+                Quat::IDENTITY,
+            ]),
+            interpolation: AnimationInterpolation::Linear,
+        }],
+        duration: 1.0,
+    }];
+
+    ASSET_REGISTRY
+        .write()
+        .add_model_with_label("bench character", model)
+}
+
+fn spawn_characters(graphics: &Arc<SharedGraphicsContext>, world: &mut World, count: usize) {
+    if count == 0 {
+        return;
+    }
+    let model = skinned_model(graphics);
+    for i in 0..count {
+        let transform = Transform {
+            position: grid_position(i, count, 3.0) + DVec3::new(0.0, 0.0, -20.0),
+            rotation: DQuat::IDENTITY,
+            scale: DVec3::ONE,
+        };
+        let entity = spawn_mesh(world, model, transform);
+
+        // offset so the characters are not all in the same pose
+        let mut animation = AnimationComponent::new();
+        animation.active_animation_index = Some(0);
+        animation.time = i as f32 * 0.13;
+        world
+            .insert_one(entity, animation)
+            .expect("Character was just spawned");
+    }
+}
+
+fn spawn_lights(graphics: &Arc<SharedGraphicsContext>, world: &mut World, count: usize) {
+    for i in 0..count {
+        let (component, label) = if i == 0 {
+            (
+                LightComponent::directional(DVec3::ONE, 1.0),
+                "sun".to_string(),
+            )
+        } else {
+            let angle = i as f64 / count as f64 * std::f64::consts::TAU;
+            let mut component =
+                LightComponent::point(DVec3::new(1.0, 0.8, 0.6), 2.0, Default::default());
+            component.position = DVec3::new(angle.cos() * 20.0, 4.0, angle.sin() * 20.0);
+            (component, format!("point light {}", i))
+        };
+
+        let light = pollster::block_on(Light::new(graphics.clone(), component, Some(&label)));
+        world.spawn((light,));
+    }
+}
+
+fn spawn_billboards(world: &mut World, count: usize) {
+    for i in 0..count {
+        let transform = Transform {
+            position: grid_position(i, count, 4.0) + DVec3::new(0.0, 3.0, 10.0),
+            ..Transform::new()
+        };
+        let billboard = BillboardComponent {
+            world_size: glam::Vec2::new(2.0, 1.0),
+            offset: Vec3::ZERO,
+            ..Default::default()
+        };
+        world.spawn((billboard, EntityTransform::new_from_world(transform)));
+    }
+}
+
+fn milliseconds(duration: Duration) -> f64 {
+    duration.as_secs_f64() * 1000.0
+}
+
+fn print_row(name: &str, mut samples: Vec<Duration>) {
+    samples.sort_unstable();
+    let mean = samples.iter().sum::<Duration>() / samples.len().max(1) as u32;
+    let percentile = |p: f64| samples[((samples.len() - 1) as f64 * p).round() as usize];
+    println!(
+        "{:>18} {:>10.3} {:>10.3} {:>10.3}",
+        name,
+        milliseconds(mean),
+        milliseconds(percentile(0.5)),
+        milliseconds(percentile(0.95)),
+    );
+}
+
+/// Prints a row per name, in the order the names first came up. A name that came up more than
+/// once in a frame is summed.
+fn print_rows<N: AsRef<str>>(frames: &[&[(N, Duration)]]) {
+    let mut names: Vec<&str> = Vec::new();
+    for (name, _) in frames.iter().copied().flatten() {
+        if !names.contains(&name.as_ref()) {
+            names.push(name.as_ref());
+        }
+    }
+
+    for name in names {
+        let samples = frames
+            .iter()
+            .map(|frame| {
+                frame
+                    .iter()
+                    .filter(|(n, _)| n.as_ref() == name)
+                    .map(|(_, elapsed)| *elapsed)
+                    .sum()
+            })
+            .collect();
+        print_row(name, samples);
+    }
+}
+
+fn report(scenario: &Scenario, frames: &[FrameTimes], timestamps: bool) {
+    println!(
+        "\n{} ({} props, {} characters, {} lights, {} billboards, {} frames)",
+        scenario.name,
+        scenario.props,
+        scenario.characters,
+        scenario.lights,
+        scenario.billboards,
+        frames.len()
+    );
+    println!(
+        "{:>18} {:>10} {:>10} {:>10}",
+        "cpu stage", "mean (ms)", "p50 (ms)", "p95 (ms)"
+    );
+    let cpu: Vec<&[(&str, Duration)]> = frames.iter().map(|f| f.cpu.as_slice()).collect();
+    print_rows(&cpu);
+    print_row(
+        "cpu total",
+        frames
+            .iter()
+            .map(|f| f.cpu.iter().map(|(_, elapsed)| *elapsed).sum())
+            .collect(),
+    );
+
+    // the frames whose timings never arrived are left out rather than counted as zero
+    let gpu: Vec<&[(String, Duration)]> = frames
+        .iter()
+        .map(|f| f.gpu.as_slice())
+        .filter(|gpu| !gpu.is_empty())
+        .collect();
+    if timestamps {
+        println!("{:>18} ({} of {} frames timed)", "gpu pass", gpu.len(), frames.len());
+    } else {
+        println!("{:>18} (no timestamp queries, wall time until idle)", "gpu");
+    }
+    if !gpu.is_empty() {
+        print_rows(&gpu);
+    }
+}
+
+fn main() {
+    let _ = env_logger::builder().is_test(true).try_init();
+
+    let filters: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with('-'))
+        .collect();
+
+    let future_queue = Arc::new(
+        FutureQueue::with_job_system(JobSystemConfig::default())
+            .expect("Unable to create job system"),
+    );
+    let options = HeadlessOptions {
+        force_fallback_adapter: std::env::var_os("DROPBEAR_BENCH_FALLBACK").is_some(),
+        ..Default::default()
+    };
+    let graphics = Arc::new(
+        pollster::block_on(SharedGraphicsContext::headless(options, future_queue))
+            .expect("Unable to create a headless graphics context"),
+    );
+
+    for scenario in &SCENARIOS {
+        if !filters.is_empty() && !filters.iter().any(|f| scenario.name.contains(f.as_str())) {
+            continue;
+        }
+
+        // a small sky keeps the bake cheap on software adapters
+        let environment = EnvironmentMaps::load_or_bake(
+            &graphics.device,
+            &graphics.queue,
+            DEFAULT_SKY_TEXTURE,
+            256,
+            None,
+            Some("bench sky"),
+        )
+        .expect("Unable to bake the sky");
+
+        let mut renderer = SceneRenderer::new(&graphics, scenario, environment);
+        for _ in 0..WARMUP_FRAMES {
+            renderer.frame(&graphics);
+        }
+        let frames: Vec<FrameTimes> = (0..FRAMES).map(|_| renderer.frame(&graphics)).collect();
+
+        report(scenario, &frames, graphics.gpu_profiler.is_enabled());
+    }
+}
@@ -1,3 +1,4 @@
+use crate::change::mark_changed;
 use crate::component::{
     Component, ComponentDescriptor, DisabilityFlags, InspectableComponent, SerializedComponent,
 };
@@ -57,8 +58,12 @@ impl Component for AnimationComponent {
         };
 
         self.update(dt, &model);
+        if self.is_playing {
+            mark_changed::<AnimationComponent>(entity);
+        }
 
         if let Ok(mut entity_transform) = world.get::<&mut EntityTransform>(entity) {
+            let previous = *entity_transform;
             if model.skins.is_empty() {
                 let target_node = self
                     .active_animation_index
@@ -95,6 +100,9 @@ impl Component for AnimationComponent {
             } else {
                 entity_transform.clear_animation();
             }
+            if *entity_transform != previous {
+                mark_changed::<EntityTransform>(entity);
+            }
         }
 
         self.prepare_gpu_resources(graphics.clone());
@@ -0,0 +1,483 @@
+//! The project's asset database, an in-memory map of asset UUIDs to their [`AssetEntry`].
+//!
+//! Every asset has a `.eucmeta` sidecar (see [`crate::metadata`]), and scanning and parsing all of
+//! them for every lookup gets slow on large projects. Instead, the index is loaded once when a
+//! project opens and kept up to date as assets are imported, moved or deleted. The index is
+//! cached at `<project>/.eucalyptus/asset_index.bin`, so on startup only the sidecars that
+//! changed since the last session are parsed again.
+//!
+//! The sidecars are still the source of truth, and the cache can be deleted at any time.
+
+use crate::metadata::{AssetEntry, read_eucmeta, write_eucmeta};
+use crate::resource::ResourceReference;
+use once_cell::sync::Lazy;
+use parking_lot::RwLock;
+use serde::{Deserialize, Serialize};
+use std::collections::{HashMap, HashSet};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+use uuid::Uuid;
+
+/// The asset index of the currently open project.
+pub static ASSET_INDEX: Lazy<RwLock<AssetIndex>> = Lazy::new(|| RwLock::new(AssetIndex::default()));
+
+/// Bump when the layout of [`IndexedAsset`] or [`AssetEntry`] changes, which discards old caches.
+const INDEX_VERSION: u32 = 2;
+const INDEX_MAGIC: [u8; 4] = *b"EUCI";
+
+/// An asset and the state of its sidecar when it was indexed.
+#[derive(Clone, Debug, Serialize, Deserialize)]
+pub struct IndexedAsset {
+    pub entry: AssetEntry,
+    /// The `.eucmeta` sidecar, relative to the project root.
+    pub meta_path: PathBuf,
+    /// Modification time of the sidecar, used to tell whether it needs to be parsed again.
+    pub meta_modified: Option<SystemTime>,
+}
+
+#[derive(Serialize, Deserialize)]
+struct IndexFile {
+    magic: [u8; 4],
+    version: u32,
+    assets: Vec<IndexedAsset>,
+}
+
+#[derive(Default)]
+pub struct AssetIndex {
+    /// Canonicalised, so the project is recognised however its path is spelled.
+    project_root: PathBuf,
+    /// The root as it was passed to [`Self::load`], if that differs from `project_root`.
+    given_root: Option<PathBuf>,
+    assets: HashMap<Uuid, IndexedAsset>,
+    /// Source path (relative to the project root) to UUID.
+    by_path: HashMap<PathBuf, Uuid>,
+    /// UUIDs that were still missing after a refresh, so looking them up again does not walk
+    /// `resources/` again. Forgotten once the asset is indexed, or when the files on disk change.
+    unresolved: HashSet<Uuid>,
+    /// Whether a lookup that missed already refreshed the index since it was loaded, or since
+    /// the files on disk last changed.
+    refreshed_for_miss: bool,
+    dirty: bool,
+}
+
+impl AssetIndex {
+    /// Where the index of a project is cached.
+    pub fn cache_path(project_root: &Path) -> PathBuf {
+        project_root.join(".eucalyptus").join("asset_index.bin")
+    }
+
+    /// Loads the cached index of a project and brings it up to date with the sidecars on disk.
+    ///
+    /// A missing or outdated cache is not an error, the index is just rebuilt from the sidecars.
+    pub fn load(project_root: &Path) -> Self {
+        puffin::profile_function!();
+        let canonical = fs::canonicalize(project_root).unwrap_or_else(|_| project_root.into());
+        let mut index = Self {
+            given_root: (canonical != project_root).then(|| project_root.to_path_buf()),
+            project_root: canonical,
+            ..Default::default()
+        };
+
+        match Self::read_cache(&Self::cache_path(&index.project_root)) {
+            Ok(assets) => {
+                for asset in assets {
+                    index.insert_indexed(asset);
+                }
+            }
+            Err(e) => {
+                log::debug!(
+                    "Rebuilding asset index for {}: {}",
+                    project_root.display(),
+                    e
+                );
+                index.dirty = true;
+            }
+        }
+
+        index.refresh();
+        if let Err(e) = index.flush() {
+            log::warn!("Unable to save asset index: {}", e);
+        }
+
+        log::info!("Asset index ready with {} assets", index.assets.len());
+        index
+    }
+
+    fn read_cache(path: &Path) -> anyhow::Result<Vec<IndexedAsset>> {
+        let bytes = fs::read(path)?;
+        let file: IndexFile = postcard::from_bytes(&bytes)?;
+        if file.magic != INDEX_MAGIC || file.version != INDEX_VERSION {
+            anyhow::bail!("cache is from another version");
+        }
+        Ok(file.assets)
+    }
+
+    /// Walks `resources/` and re-parses every sidecar that was added or modified since it was
+    /// indexed, and forgets the assets whose sidecar is gone.
+    ///
+    /// Unchanged sidecars only cost a `stat`.
+    pub fn refresh(&mut self) {
+        puffin::profile_function!();
+        let mut found = HashMap::new();
+        collect_sidecars(&self.project_root.join("resources"), &mut found);
+
+        let mut known: HashMap<PathBuf, (Uuid, Option<SystemTime>)> = self
+            .assets
+            .iter()
+            .map(|(uuid, asset)| (asset.meta_path.clone(), (*uuid, asset.meta_modified)))
+            .collect();
+
+        for (meta_path, modified) in found {
+            let relative = self.relative(&meta_path);
+            if let Some((_, indexed_modified)) = known.remove(&relative) {
+                if modified.is_some() && indexed_modified == modified {
+                    continue;
+                }
+            }
+
+            match read_eucmeta(&meta_path) {
+                Ok(entry) => self.insert(&meta_path, entry),
+                Err(e) => log::warn!("Skipping asset {}: {}", meta_path.display(), e),
+            }
+        }
+
+        // anything left over no longer has a sidecar
+        for (_, (uuid, _)) in known {
+            self.remove_uuid(uuid);
+        }
+    }
+
+    pub fn project_root(&self) -> &Path {
+        &self.project_root
+    }
+
+    /// Whether this is the index of the project at `project_root`, however its path is spelled.
+    pub fn belongs_to(&self, project_root: &Path) -> bool {
+        if self.project_root.as_os_str().is_empty() {
+            return false;
+        }
+        self.project_root == project_root
+            || self.given_root.as_deref() == Some(project_root)
+            || fs::canonicalize(project_root).is_ok_and(|root| root == self.project_root)
+    }
+
+    pub fn len(&self) -> usize {
+        self.assets.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.assets.is_empty()
+    }
+
+    /// Looks up an asset by its UUID.
+    pub fn get(&self, uuid: Uuid) -> Option<&AssetEntry> {
+        self.assets.get(&uuid).map(|asset| &asset.entry)
+    }
+
+    /// Whether `uuid` was already missing after a [`Self::refresh_for_miss`].
+    pub fn is_unresolved(&self, uuid: Uuid) -> bool {
+        self.unresolved.contains(&uuid)
+    }
+
+    /// Remembers that `uuid` is missing even after a refresh, until its asset is indexed or the
+    /// files on disk change.
+    pub fn mark_unresolved(&mut self, uuid: Uuid) {
+        self.unresolved.insert(uuid);
+    }
+
+    /// Refreshes the index for a lookup that missed, unless an earlier miss already did since
+    /// the index was loaded or the files on disk last changed. Returns whether it refreshed.
+    pub fn refresh_for_miss(&mut self) -> bool {
+        if self.refreshed_for_miss {
+            return false;
+        }
+        self.refreshed_for_miss = true;
+        self.refresh();
+        true
+    }
+
+    /// Lets the next lookup that misses refresh the index again, and forgets which UUIDs were
+    /// missing. Call when the watcher sees files under `resources/` change.
+    pub fn files_changed(&mut self) {
+        self.refreshed_for_miss = false;
+        self.unresolved.clear();
+    }
+
+    /// Looks up the UUID of the asset at `source_path`, which can be absolute or relative to the
+    /// project root.
+    pub fn uuid_for_path(&self, source_path: &Path) -> Option<Uuid> {
+        self.by_path.get(&self.relative(source_path)).copied()
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = &AssetEntry> {
+        self.assets.values().map(|asset| &asset.entry)
+    }
+
+    /// Adds or updates the asset described by the sidecar at `meta_path`.
+    ///
+    /// The location of the entry is always taken from where its sidecar lives, so an asset that
+    /// was moved outside the editor still resolves to the right file.
+    pub fn insert(&mut self, meta_path: &Path, mut entry: AssetEntry) {
+        let meta_relative = self.relative(meta_path);
+        let source_relative = source_of(&meta_relative);
+        if matches!(entry.location, ResourceReference::File(_)) {
+            entry.location = ResourceReference::File(source_relative);
+        }
+
+        let meta_modified = fs::metadata(self.project_root.join(&meta_relative))
+            .and_then(|m| m.modified())
+            .ok();
+
+        self.insert_indexed(IndexedAsset {
+            entry,
+            meta_path: meta_relative,
+            meta_modified,
+        });
+        self.dirty = true;
+    }
+
+    fn insert_indexed(&mut self, asset: IndexedAsset) {
+        let uuid = asset.entry.uuid;
+        if let Some(previous) = self.assets.get(&uuid) {
+            if previous.meta_path != asset.meta_path {
+                // copied sidecars share a UUID, the most recently seen one wins
+                let previous_source = source_of(&previous.meta_path);
+                self.by_path.remove(&previous_source);
+            }
+        }
+        self.by_path.insert(source_of(&asset.meta_path), uuid);
+        self.unresolved.remove(&uuid);
+        self.assets.insert(uuid, asset);
+    }
+
+    /// Updates the index after the file or folder at `from` was moved to `to`, along with the
+    /// sidecars. The sidecars are rewritten so their location matches.
+    pub fn moved(&mut self, from: &Path, to: &Path) {
+        let from = self.relative(from);
+        let to = self.relative(to);
+
+        let affected: Vec<(PathBuf, Uuid)> = self
+            .by_path
+            .iter()
+            .filter(|(path, _)| path.starts_with(&from))
+            .map(|(path, uuid)| (path.clone(), *uuid))
+            .collect();
+
+        for (old_source, uuid) in affected {
+            let Ok(suffix) = old_source.strip_prefix(&from) else {
+                continue;
+            };
+            let new_source = if suffix.as_os_str().is_empty() {
+                to.clone()
+            } else {
+                to.join(suffix)
+            };
+            let Some(mut asset) = self.assets.get(&uuid).cloned() else {
+                continue;
+            };
+
+            let meta_path = self.project_root.join(meta_of(&new_source));
+            if matches!(asset.entry.location, ResourceReference::File(_)) {
+                asset.entry.location = ResourceReference::File(new_source.clone());
+                if let Err(e) = write_eucmeta(&meta_path, &asset.entry) {
+                    log::warn!("Unable to update {}: {}", meta_path.display(), e);
+                }
+            }
+
+            self.by_path.remove(&old_source);
+            self.insert(&meta_path, asset.entry);
+        }
+    }
+
+    /// Forgets the file or every asset in the folder at `path`, after it was deleted.
+    pub fn removed(&mut self, path: &Path) {
+        let path = self.relative(path);
+        let removed: Vec<Uuid> = self
+            .by_path
+            .iter()
+            .filter(|(source, _)| source.starts_with(&path))
+            .map(|(_, uuid)| *uuid)
+            .collect();
+
+        for uuid in removed {
+            self.remove_uuid(uuid);
+        }
+    }
+
+    fn remove_uuid(&mut self, uuid: Uuid) {
+        if let Some(asset) = self.assets.remove(&uuid) {
+            self.by_path.remove(&source_of(&asset.meta_path));
+            self.dirty = true;
+        }
+    }
+
+    /// Saves the index to its cache if it changed.
+    pub fn flush(&mut self) -> anyhow::Result<()> {
+        if !self.dirty || self.project_root.as_os_str().is_empty() {
+            return Ok(());
+        }
+        puffin::profile_function!();
+
+        let file = IndexFile {
+            magic: INDEX_MAGIC,
+            version: INDEX_VERSION,
+            assets: self.assets.values().cloned().collect(),
+        };
+        let bytes = postcard::to_stdvec(&file)?;
+
+        let path = Self::cache_path(&self.project_root);
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        // written to the side and renamed, so a crash never leaves a half written cache
+        let temp = path.with_extension("bin.tmp");
+        fs::write(&temp, bytes)?;
+        fs::rename(&temp, &path)?;
+
+        self.dirty = false;
+        Ok(())
+    }
+
+    fn relative(&self, path: &Path) -> PathBuf {
+        // the spelling the project was opened with first, as that is what callers build on
+        self.given_root
+            .iter()
+            .chain(std::iter::once(&self.project_root))
+            .find_map(|root| path.strip_prefix(root).ok())
+            .unwrap_or(path)
+            .to_path_buf()
+    }
+}
+
+fn meta_of(source: &Path) -> PathBuf {
+    PathBuf::from(format!("{}.eucmeta", source.display()))
+}
+
+fn source_of(meta_path: &Path) -> PathBuf {
+    meta_path.with_extension("")
+}
+
+fn collect_sidecars(dir: &Path, found: &mut HashMap<PathBuf, Option<SystemTime>>) {
+    let Ok(read) = fs::read_dir(dir) else {
+        return;
+    };
+    for entry in read.flatten() {
+        let path = entry.path();
+        let Ok(file_type) = entry.file_type() else {
+            continue;
+        };
+        if file_type.is_dir() {
+            collect_sidecars(&path, found);
+        } else if path.extension().and_then(|e| e.to_str()) == Some("eucmeta") {
+            let modified = entry.metadata().and_then(|m| m.modified()).ok();
+            found.insert(path, modified);
+        }
+    }
+}
+
+#[cfg(test)]
+pub(crate) mod tests {
+    use super::*;
+    use crate::metadata::generate_eucmeta;
+
+    /// A scratch project that is deleted when dropped.
+    pub(crate) struct TempProject {
+        pub root: PathBuf,
+    }
+
+    impl TempProject {
+        pub fn new() -> Self {
+            let root = std::env::temp_dir().join(format!("eucalyptus-test-{}", Uuid::new_v4()));
+            fs::create_dir_all(root.join("resources")).unwrap();
+            Self { root }
+        }
+
+        /// Writes a file under `resources/` and returns its absolute path.
+        pub fn resource(&self, relative: &str, contents: &[u8]) -> PathBuf {
+            let path = self.root.join("resources").join(relative);
+            fs::create_dir_all(path.parent().unwrap()).unwrap();
+            fs::write(&path, contents).unwrap();
+            path
+        }
+    }
+
+    impl Drop for TempProject {
+        fn drop(&mut self) {
+            let _ = fs::remove_dir_all(&self.root);
+        }
+    }
+
+    #[test]
+    fn insert_move_and_remove() {
+        let project = TempProject::new();
+        let source = project.resource("textures/a.png", b"a");
+        let entry = generate_eucmeta(&source, &project.root).unwrap();
+
+        let mut index = AssetIndex::load(&project.root);
+        assert_eq!(index.uuid_for_path(&source), Some(entry.uuid));
+        assert_eq!(index.len(), 1);
+
+        let from = project.root.join("resources/textures");
+        let to = project.root.join("resources/moved");
+        fs::rename(&from, &to).unwrap();
+        index.moved(&from, &to);
+
+        let moved = PathBuf::from("resources/moved/a.png");
+        assert_eq!(index.uuid_for_path(&source), None);
+        assert_eq!(index.uuid_for_path(&moved), Some(entry.uuid));
+        let location = ResourceReference::File(moved.clone());
+        assert_eq!(index.get(entry.uuid).unwrap().location, location);
+        let sidecar = read_eucmeta(&project.root.join(meta_of(&moved))).unwrap();
+        assert_eq!(sidecar.location, location);
+
+        index.removed(&to);
+        assert!(index.get(entry.uuid).is_none());
+        assert!(index.is_empty());
+    }
+
+    #[test]
+    fn cache_round_trip() {
+        let project = TempProject::new();
+        let a = generate_eucmeta(&project.resource("a.png", b"a"), &project.root).unwrap();
+        let b = generate_eucmeta(&project.resource("b.wav", b"b"), &project.root).unwrap();
+
+        let index = AssetIndex::load(&project.root);
+        let cached = AssetIndex::read_cache(&AssetIndex::cache_path(&project.root)).unwrap();
+        let mut uuids: Vec<_> = cached.iter().map(|asset| asset.entry.uuid).collect();
+        uuids.sort();
+        let mut expected = vec![a.uuid, b.uuid];
+        expected.sort();
+        assert_eq!(uuids, expected);
+        drop(index);
+
+        // a sidecar deleted while the project was closed is forgotten on the next load
+        fs::remove_file(project.root.join("resources/b.wav.eucmeta")).unwrap();
+        let index = AssetIndex::load(&project.root);
+        assert_eq!(index.get(a.uuid).unwrap().content_hash, a.content_hash);
+        assert!(index.get(b.uuid).is_none());
+        assert_eq!(index.len(), 1);
+    }
+
+    #[test]
+    fn recognises_the_root_however_it_is_spelled() {
+        let project = TempProject::new();
+        let entry = generate_eucmeta(&project.resource("a.png", b"a"), &project.root).unwrap();
+
+        let spelled = project.root.join("resources").join("..");
+        let index = AssetIndex::load(&spelled);
+        assert!(index.belongs_to(&project.root));
+        assert!(index.belongs_to(&spelled));
+        assert!(!index.belongs_to(&project.root.join("resources")));
+        assert!(!AssetIndex::default().belongs_to(&project.root));
+
+        assert_eq!(
+            index.uuid_for_path(&spelled.join("resources/a.png")),
+            Some(entry.uuid)
+        );
+        assert_eq!(
+            index.uuid_for_path(&project.root.join("resources/a.png")),
+            Some(entry.uuid)
+        );
+    }
+}
@@ -0,0 +1,378 @@
+//! Change detection.
+//!
+//! hecs does not know which components were written to, so without help every per-frame system
+//! walks (and often clones) its whole query to find the handful of entities that moved. This keeps
+//! a log for each tracked component type of the entities whose component was changed, and a
+//! [`ChangeCursor`] hands a system only what changed since it last looked.
+//!
+//! Writes are recorded with [`mark_changed`] by whatever mutates the component: the script
+//! setters, the physics transform sync, the inspector and the component updaters.
+//!
+//! Spawning, despawning, inserting and removing components goes through [`spawn`], [`despawn`],
+//! [`insert`], [`insert_one`] and [`remove_one`], which log the entity under every component type
+//! it gained or lost, so a cursor hands those out like any other change. A cursor also counts the
+//! entities holding its component (per archetype, not per entity), and asks for a full rescan when
+//! the count moved by more than the logged changes account for, such as after [`World::clear`].
+//!
+//! The readers are the physics label index, the script tag database,
+//! [`LightChangeCursor`](crate::rendering::LightChangeCursor) and
+//! [`RendererCache`](crate::rendering::RendererCache).
+
+use hecs::{Component, ComponentError, DynamicBundle, Entity, NoSuchEntity, World};
+use parking_lot::Mutex;
+use std::any::TypeId;
+use std::collections::HashMap;
+use std::marker::PhantomData;
+use std::sync::LazyLock;
+
+/// The most entries kept in the log of one component type. A cursor that falls further behind
+/// than this rescans everything.
+///
+/// Logs are kept whether or not any cursor reads them, so this is also what a type that is marked
+/// but never read costs: at most this many entities (128 KiB), as half of a full log is dropped
+/// before the next entry goes in.
+const LOG_CAPACITY: usize = 16384;
+
+pub static CHANGES: LazyLock<Mutex<ChangeTracker>> =
+    LazyLock::new(|| Mutex::new(ChangeTracker::default()));
+
+/// Records that `entity`'s `T` was changed.
+pub fn mark_changed<T: Component>(entity: Entity) {
+    CHANGES.lock().mark::<T>(entity);
+}
+
+/// Spawns `components`, logging the new entity under each of them.
+pub fn spawn(world: &mut World, components: impl DynamicBundle) -> Entity {
+    let entity = world.spawn(components);
+    CHANGES.lock().restructured(entity, &[], &component_types(world, entity));
+    entity
+}
+
+/// Despawns `entity`, logging it under every component it held.
+pub fn despawn(world: &mut World, entity: Entity) -> Result<(), NoSuchEntity> {
+    let before = component_types(world, entity);
+    world.despawn(entity)?;
+    CHANGES.lock().restructured(entity, &before, &[]);
+    Ok(())
+}
+
+/// Inserts `components` into `entity`, logging it under the components it did not hold before.
+/// Components that were overwritten are not logged, so mark those with [`mark_changed`].
+pub fn insert(
+    world: &mut World,
+    entity: Entity,
+    components: impl DynamicBundle,
+) -> Result<(), NoSuchEntity> {
+    let before = component_types(world, entity);
+    world.insert(entity, components)?;
+    CHANGES.lock().restructured(entity, &before, &component_types(world, entity));
+    Ok(())
+}
+
+/// Inserts `component` into `entity`, logging it under `T`, whether it was new or overwritten.
+pub fn insert_one<T: Component>(
+    world: &mut World,
+    entity: Entity,
+    component: T,
+) -> Result<(), NoSuchEntity> {
+    insert(world, entity, (component,))?;
+    mark_changed::<T>(entity);
+    Ok(())
+}
+
+/// Removes `entity`'s `T`, logging it under `T`.
+pub fn remove_one<T: Component>(world: &mut World, entity: Entity) -> Result<T, ComponentError> {
+    let component = world.remove_one::<T>(entity)?;
+    CHANGES.lock().restructured(entity, &[TypeId::of::<T>()], &[]);
+    Ok(component)
+}
+
+fn component_types(world: &World, entity: Entity) -> Vec<TypeId> {
+    world
+        .entity(entity)
+        .map(|entity| entity.component_types().collect())
+        .unwrap_or_default()
+}
+
+/// How many entities of `world` hold a `T`, counted per archetype.
+fn holders<T: Component>(world: &World) -> i64 {
+    world
+        .archetypes()
+        .filter(|archetype| archetype.has::<T>())
+        .map(|archetype| archetype.len() as i64)
+        .sum()
+}
+
+/// The entities whose component was changed, in the order they were marked.
+#[derive(Default)]
+struct ChangeLog {
+    /// The sequence number of the first entry.
+    start: u64,
+    entries: Vec<Entity>,
+    /// How many entities gained the component through [`spawn`] and friends, less how many lost
+    /// it. Shared by every world, so it only means something as a difference over time.
+    held: i64,
+}
+
+impl ChangeLog {
+    fn end(&self) -> u64 {
+        self.start + self.entries.len() as u64
+    }
+
+    fn push(&mut self, entity: Entity) {
+        // a component written to many times in a row only needs to be looked at once
+        if self.entries.last() == Some(&entity) {
+            return;
+        }
+        if self.entries.len() >= LOG_CAPACITY {
+            let dropped = LOG_CAPACITY / 2;
+            self.entries.drain(..dropped);
+            self.start += dropped as u64;
+        }
+        self.entries.push(entity);
+    }
+}
+
+/// The change logs of every tracked component type. Use [`CHANGES`] rather than making your own.
+#[derive(Default)]
+pub struct ChangeTracker {
+    logs: HashMap<TypeId, ChangeLog>,
+}
+
+impl ChangeTracker {
+    /// Records that `entity`'s `T` was changed.
+    pub fn mark<T: Component>(&mut self, entity: Entity) {
+        self.log(TypeId::of::<T>()).push(entity);
+    }
+
+    fn log(&mut self, type_id: TypeId) -> &mut ChangeLog {
+        self.logs.entry(type_id).or_default()
+    }
+
+    /// Logs `entity` under the component types it gained or lost.
+    fn restructured(&mut self, entity: Entity, before: &[TypeId], after: &[TypeId]) {
+        for type_id in before.iter().filter(|type_id| !after.contains(type_id)) {
+            let log = self.log(*type_id);
+            log.held -= 1;
+            log.push(entity);
+        }
+        for type_id in after.iter().filter(|type_id| !before.contains(type_id)) {
+            let log = self.log(*type_id);
+            log.held += 1;
+            log.push(entity);
+        }
+    }
+}
+
+/// What changed in a component since a [`ChangeCursor`] last looked.
+pub enum Changes<'a> {
+    /// Entities gained or lost the component without it being logged (or the cursor has never
+    /// looked, or fell too far behind), so everything has to be looked at again.
+    All,
+    /// Only these entities had their component changed, sorted and without duplicates. This
+    /// includes entities that gained or lost the component, and ones that were despawned.
+    Only(&'a [Entity]),
+}
+
+/// One system's place in the change log of `T`.
+///
+/// ```ignore
+/// match self.light_changes.changed(world) {
+///     Changes::All => rebuild_everything(world),
+///     Changes::Only(entities) => entities.iter().for_each(|e| refresh(world, *e)),
+/// }
+/// ```
+pub struct ChangeCursor<T> {
+    position: u64,
+    /// How many entities held the component when the cursor last looked, less
+    /// [`ChangeLog::held`], so entities that came and went without being logged.
+    unlogged: Option<i64>,
+    changed: Vec<Entity>,
+    _component: PhantomData<fn() -> T>,
+}
+
+impl<T> Default for ChangeCursor<T> {
+    fn default() -> Self {
+        Self {
+            position: 0,
+            unlogged: None,
+            changed: Vec::new(),
+            _component: PhantomData,
+        }
+    }
+}
+
+impl<T: Component> ChangeCursor<T> {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Forgets what was seen, so that the next call to [`Self::changed`] returns [`Changes::All`].
+    pub fn reset(&mut self) {
+        self.unlogged = None;
+    }
+
+    /// Returns what changed in `T` since the last call, and moves the cursor to now.
+    pub fn changed(&mut self, world: &World) -> Changes<'_> {
+        puffin::profile_function!();
+        let holders = holders::<T>(world);
+        self.changed.clear();
+
+        let caught_up = {
+            let tracker = CHANGES.lock();
+            let log = tracker.logs.get(&TypeId::of::<T>());
+            let unlogged = holders - log.map_or(0, |log| log.held);
+            let caught_up = self.unlogged.replace(unlogged) == Some(unlogged)
+                && log.is_none_or(|log| self.position >= log.start);
+            if let Some(log) = log {
+                if caught_up {
+                    let from = (self.position - log.start) as usize;
+                    self.changed.extend_from_slice(&log.entries[from..]);
+                }
+                self.position = log.end();
+            }
+            caught_up
+        };
+
+        if !caught_up {
+            return Changes::All;
+        }
+        self.changed.sort_unstable();
+        self.changed.dedup();
+        Changes::Only(&self.changed)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // every test tracks its own component type, as the change log is shared between them
+
+    fn only(changes: Changes<'_>) -> Vec<Entity> {
+        match changes {
+            Changes::Only(entities) => entities.to_vec(),
+            Changes::All => panic!("expected only some entities to have changed"),
+        }
+    }
+
+    #[test]
+    fn the_first_look_sees_everything() {
+        struct Tracked;
+        let mut world = World::new();
+        world.spawn((Tracked,));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        assert!(matches!(cursor.changed(&world), Changes::All));
+        assert!(only(cursor.changed(&world)).is_empty());
+    }
+
+    #[test]
+    fn marked_entities_are_sorted_and_deduplicated() {
+        struct Tracked;
+        let mut world = World::new();
+        let a = world.spawn((Tracked,));
+        let b = world.spawn((Tracked,));
+        let c = world.spawn((Tracked,));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+
+        for entity in [c, a, c, a, a] {
+            mark_changed::<Tracked>(entity);
+        }
+        let mut expected = vec![a, c];
+        expected.sort_unstable();
+        assert_eq!(only(cursor.changed(&world)), expected);
+
+        // a second cursor only sees what was marked after it first looked
+        let mut late = ChangeCursor::<Tracked>::new();
+        late.changed(&world);
+        mark_changed::<Tracked>(b);
+        assert_eq!(only(late.changed(&world)), vec![b]);
+        assert_eq!(only(cursor.changed(&world)), vec![b]);
+    }
+
+    #[test]
+    fn logged_structural_changes_are_only_those_entities() {
+        struct Tracked;
+        struct Other;
+        let mut world = World::new();
+        let a = spawn(&mut world, (Tracked,));
+        let b = spawn(&mut world, (Tracked, Other));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+
+        // gaining some other component does not concern `Tracked`
+        let c = spawn(&mut world, (Other,));
+        insert_one(&mut world, a, Other).unwrap();
+        assert!(only(cursor.changed(&world)).is_empty());
+
+        insert_one(&mut world, c, Tracked).unwrap();
+        assert_eq!(only(cursor.changed(&world)), vec![c]);
+
+        // the same amount of entities, but not the same ones
+        despawn(&mut world, b).unwrap();
+        let d = spawn(&mut world, (Tracked,));
+        let mut expected = vec![b, d];
+        expected.sort_unstable();
+        assert_eq!(only(cursor.changed(&world)), expected);
+
+        remove_one::<Tracked>(&mut world, a).unwrap();
+        assert_eq!(only(cursor.changed(&world)), vec![a]);
+    }
+
+    #[test]
+    fn unlogged_population_changes_see_everything() {
+        struct Tracked;
+        let mut world = World::new();
+        let a = world.spawn((Tracked,));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+
+        world.spawn((Tracked,));
+        assert!(matches!(cursor.changed(&world), Changes::All));
+
+        world.remove_one::<Tracked>(a).unwrap();
+        assert!(matches!(cursor.changed(&world), Changes::All));
+
+        world.clear();
+        assert!(matches!(cursor.changed(&world), Changes::All));
+        assert!(only(cursor.changed(&world)).is_empty());
+    }
+
+    #[test]
+    fn falling_behind_the_log_sees_everything() {
+        struct Tracked;
+        let mut world = World::new();
+        let a = world.spawn((Tracked,));
+        let b = world.spawn((Tracked,));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+
+        // alternating, so consecutive marks of the same entity do not get folded together
+        for i in 0..=LOG_CAPACITY {
+            mark_changed::<Tracked>(if i % 2 == 0 { a } else { b });
+        }
+        assert!(matches!(cursor.changed(&world), Changes::All));
+
+        // the log ended on `a`, so `b` is a new entry
+        mark_changed::<Tracked>(b);
+        assert_eq!(only(cursor.changed(&world)), vec![b]);
+    }
+
+    #[test]
+    fn reset_sees_everything() {
+        struct Tracked;
+        let mut world = World::new();
+        world.spawn((Tracked,));
+
+        let mut cursor = ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+        cursor.reset();
+        assert!(matches!(cursor.changed(&world), Changes::All));
+    }
+}
@@ -1,4 +1,6 @@
-use crate::hierarchy::EntityTransformExt;
+use crate::change::{ChangeCursor, Changes};
+use crate::entity_status::EntityStatus;
+use crate::hierarchy::{Children, EntityTransformExt, Parent};
 use crate::physics::PhysicsState;
 use crate::scripting::types::KotlinComponents;
 use crate::ser::model::EucalyptusModel;
@@ -17,8 +19,8 @@ use hecs::{Entity, World};
 use parking_lot::Mutex;
 pub use serde::{Deserialize, Serialize};
 use std::any::TypeId;
-use std::collections::HashMap;
 use std::collections::hash_map::DefaultHasher;
+use std::collections::{HashMap, HashSet};
 use std::future::Future;
 use std::hash::{Hash, Hasher};
 use std::pin::Pin;
@@ -218,7 +220,7 @@ impl ComponentRegistry {
         self.removers.insert(
             type_id.clone(),
             Box::new(|world, entity| {
-                let _ = world.remove_one::<T>(entity);
+                let _ = crate::change::remove_one::<T>(world, entity);
             }),
         );
 
@@ -237,25 +239,7 @@ impl ComponentRegistry {
         self.updaters.insert(
             type_id.clone(),
             Box::new(move |world, physics, dt, graphics| {
-                let world_ptr = world as *mut hecs::World; // safe assuming world is kept at the DropbearAppBuilder application level (lifetime)
-                let mut query = world.query::<(hecs::Entity, &mut T)>();
-                for (entity, component) in query.iter() {
-                    let world_ref = unsafe { &*world_ptr };
-                    // skip update on DisabledFlags::Hidden
-                    if !matches!(disabled_flags, DisabilityFlags::Never) {
-                        if let Ok(status) =
-                            world_ref.get::<&crate::entity_status::EntityStatus>(entity)
-                        {
-                            if status.disabled {
-                                continue;
-                            }
-                            if status.hidden && matches!(disabled_flags, DisabilityFlags::Hidden) {
-                                continue;
-                            }
-                        }
-                    }
-                    component.update_component(world_ref, physics, entity, dt, graphics.clone());
-                }
+                T::update_all(world, physics, dt, graphics, &disabled_flags);
             }),
         );
 
@@ -269,6 +253,8 @@ impl ComponentRegistry {
                         return;
                     }
                     comp.inspect(world_ref, entity, ui, graphics);
+                    // the inspector has no way of telling whether anything was edited
+                    crate::change::mark_changed::<T>(entity);
                 }
             }),
         );
@@ -453,7 +439,12 @@ impl ComponentRegistry {
         if let Ok(mut label) = world.get::<&mut crate::states::Label>(entity) {
             ui.horizontal(|ui| {
                 ui.label("Label");
-                ui.add(egui::TextEdit::singleline(label.as_mut_string()));
+                if ui
+                    .add(egui::TextEdit::singleline(label.as_mut_string()))
+                    .changed()
+                {
+                    crate::change::mark_changed::<crate::states::Label>(entity);
+                }
             });
             ui.separator();
         }
@@ -631,6 +622,39 @@ impl Default for ComponentRegistry {
     }
 }
 
+/// Calls [`Component::update_component`] on every `T` in `world` that `disabled_flags` does not
+/// skip. This is what [`Component::update_all`] does unless it is overridden.
+pub fn update_each<T: Component + 'static>(
+    world: &mut hecs::World,
+    physics: &mut PhysicsState,
+    dt: f32,
+    graphics: Arc<SharedGraphicsContext>,
+    disabled_flags: &DisabilityFlags,
+) {
+    let world_ptr = world as *mut hecs::World; // safe assuming world is kept at the DropbearAppBuilder application level (lifetime)
+    let mut query = world.query::<(hecs::Entity, &mut T)>();
+    for (entity, component) in query.iter() {
+        let world_ref = unsafe { &*world_ptr };
+        if is_update_skipped(world_ref, entity, disabled_flags) {
+            continue;
+        }
+        component.update_component(world_ref, physics, entity, dt, graphics.clone());
+    }
+}
+
+/// Whether `entity`'s [`EntityStatus`] skips the update of a component with `disabled_flags`.
+pub fn is_update_skipped(world: &World, entity: Entity, disabled_flags: &DisabilityFlags) -> bool {
+    // skip update on DisabledFlags::Hidden
+    if matches!(disabled_flags, DisabilityFlags::Never) {
+        return false;
+    }
+    world
+        .get::<&EntityStatus>(entity)
+        .is_ok_and(|status| {
+            status.disabled || (status.hidden && matches!(disabled_flags, DisabilityFlags::Hidden))
+        })
+}
+
 /// A blanket trait for types that can be serialized as a component.
 #[typetag::serde(tag = "type")]
 pub trait SerializedComponent: Downcast + dyn_clone::DynClone + Send + Sync {}
@@ -742,6 +766,21 @@ pub trait Component: Sync + Send {
         _graphics: Arc<SharedGraphicsContext>,
     ) -> ComponentInitFuture<'_, Self>;
 
+    /// Updates every `Self` in `world`, once a frame. The default calls
+    /// [`Self::update_component`] on each of them (see [`update_each`]); override it for
+    /// components that can tell which of them need updating.
+    fn update_all(
+        world: &mut hecs::World,
+        physics: &mut PhysicsState,
+        dt: f32,
+        graphics: Arc<SharedGraphicsContext>,
+        disabled_flags: &DisabilityFlags,
+    ) where
+        Self: Sized + 'static,
+    {
+        update_each::<Self>(world, physics, dt, graphics, disabled_flags);
+    }
+
     /// Called every frame to update the component's state.
     fn update_component(
         &mut self,
@@ -771,8 +810,7 @@ pub trait Component: Sync + Send {
     {
         let mut builder = hecs::EntityBuilder::new();
         builder.add_bundle(bundle);
-        world
-            .insert(entity, builder.build())
+        crate::change::insert(world, entity, builder.build())
             .map_err(|e| anyhow::anyhow!("{e}"))
     }
 }
@@ -792,6 +830,64 @@ pub trait InspectableComponent: Send + Sync {
 impl SerializedComponent for SerializedMeshRenderer {}
 
 // sample for MeshRenderer
+/// Where [`MeshRenderer::update_all`] is in the change logs, as there is one world to update per
+/// process.
+static RENDERER_UPDATES: LazyLock<Mutex<RendererUpdates>> =
+    LazyLock::new(|| Mutex::new(RendererUpdates::default()));
+
+#[derive(Default)]
+struct RendererUpdates {
+    renderers: ChangeCursor<MeshRenderer>,
+    statuses: ChangeCursor<EntityStatus>,
+    transforms: ChangeCursor<EntityTransform>,
+    parents: ChangeCursor<Parent>,
+    moved: Vec<Entity>,
+    seen: HashSet<Entity>,
+    pending: Vec<Entity>,
+}
+
+impl RendererUpdates {
+    /// The entities whose renderer has to be updated, or `None` if every renderer has to be.
+    fn collect(&mut self, world: &World) -> Option<&[Entity]> {
+        self.pending.clear();
+        self.moved.clear();
+        // every cursor has to look, so that none of them falls behind
+        let mut all = false;
+        for changes in [self.renderers.changed(world), self.statuses.changed(world)] {
+            match changes {
+                Changes::All => all = true,
+                Changes::Only(entities) => self.pending.extend_from_slice(entities),
+            }
+        }
+        for changes in [self.transforms.changed(world), self.parents.changed(world)] {
+            match changes {
+                Changes::All => all = true,
+                Changes::Only(entities) => self.moved.extend_from_slice(entities),
+            }
+        }
+        if all {
+            return None;
+        }
+
+        // an entity that moved takes everything below it along
+        self.seen.clear();
+        let mut next = 0;
+        while let Some(entity) = self.moved.get(next).copied() {
+            next += 1;
+            if !self.seen.insert(entity) {
+                continue;
+            }
+            if let Ok(children) = world.get::<&Children>(entity) {
+                self.moved.extend_from_slice(children.children());
+            }
+        }
+        self.pending.extend(self.seen.drain());
+        self.pending.sort_unstable();
+        self.pending.dedup();
+        Some(&self.pending)
+    }
+}
+
 impl Component for MeshRenderer {
     type SerializedForm = SerializedMeshRenderer;
     type RequiredComponentTypes = (Self,);
@@ -997,6 +1093,32 @@ impl Component for MeshRenderer {
         })
     }
 
+    /// Only updates the renderers whose [`MeshRenderer`] or [`EntityStatus`] changed, or that
+    /// moved because the [`EntityTransform`] or [`Parent`] of them or of an ancestor did.
+    fn update_all(
+        world: &mut World,
+        physics: &mut PhysicsState,
+        dt: f32,
+        graphics: Arc<SharedGraphicsContext>,
+        disabled_flags: &DisabilityFlags,
+    ) {
+        puffin::profile_function!();
+        let mut updates = RENDERER_UPDATES.lock();
+        let Some(entities) = updates.collect(world) else {
+            update_each::<Self>(world, physics, dt, graphics, disabled_flags);
+            return;
+        };
+        for entity in entities {
+            if is_update_skipped(world, *entity, disabled_flags) {
+                continue;
+            }
+            let Ok(mut renderer) = world.get::<&mut MeshRenderer>(*entity) else {
+                continue;
+            };
+            renderer.update_component(world, physics, *entity, dt, graphics.clone());
+        }
+    }
+
     fn update_component(
         &mut self,
         world: &World,
@@ -1005,11 +1127,15 @@ impl Component for MeshRenderer {
         _dt: f32,
         graphics: Arc<SharedGraphicsContext>,
     ) {
+        let previous = self.instance.clone();
         if let Ok(transform) = world.query_one::<&EntityTransform>(entity).get() {
             self.update(&transform.propagate(&world, entity));
         } else {
             self.update(&Transform::new());
         }
+        if self.instance != previous {
+            crate::change::mark_changed::<MeshRenderer>(entity);
+        }
 
         for (_, v) in self.material_snapshot.iter() {
             v.sync_uniform(&graphics);
@@ -2257,3 +2383,33 @@ impl InspectableComponent for MeshRenderer {
         });
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::change::mark_changed;
+
+    #[test]
+    fn renderers_below_a_moved_entity_are_updated() {
+        let mut world = World::new();
+        let renderer = || MeshRenderer::from_handle(Handle::NULL);
+        let parent = world.spawn((EntityTransform::default(),));
+        let child = world.spawn((renderer(), EntityTransform::default(), Parent::new(parent)));
+        let grandchild = world.spawn((renderer(), Parent::new(child)));
+        let unrelated = world.spawn((renderer(), EntityTransform::default()));
+        world.insert_one(parent, Children::new(vec![child])).unwrap();
+        world.insert_one(child, Children::new(vec![grandchild])).unwrap();
+
+        let mut updates = RendererUpdates::default();
+        assert!(updates.collect(&world).is_none());
+
+        // other tests mark entities of their own worlds too, which can have the same ids, so
+        // only what has to be there is checked
+        mark_changed::<EntityTransform>(parent);
+        let pending = updates.collect(&world).unwrap().to_vec();
+        assert!(pending.contains(&child) && pending.contains(&grandchild));
+
+        mark_changed::<MeshRenderer>(unrelated);
+        assert!(updates.collect(&world).unwrap().contains(&unrelated));
+    }
+}
@@ -307,7 +307,12 @@ impl ProjectConfig {
             self.last_opened_scene = Some(first.scene_name.clone());
         }
 
-        crate::metadata::scan_and_generate_eucmeta(&project_root);
+        *crate::asset_index::ASSET_INDEX.write() =
+            crate::asset_index::AssetIndex::load(&project_root);
+        crate::metadata::scan_project_assets(&project_root);
+        if let Err(e) = crate::asset_index::ASSET_INDEX.write().flush() {
+            log::warn!("Unable to save asset index: {}", e);
+        }
 
         Ok(())
     }
@@ -329,6 +334,10 @@ impl ProjectConfig {
             }
         }
 
+        if let Err(e) = crate::asset_index::ASSET_INDEX.write().flush() {
+            log::warn!("Unable to save asset index: {}", e);
+        }
+
         self.write_to(&path)?;
         Ok(())
     }
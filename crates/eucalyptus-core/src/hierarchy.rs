@@ -1,5 +1,6 @@
 //! The hierarchy of an entity and a scene.
 
+use crate::change;
 use crate::states::Label;
 use dropbear_engine::entity::{EntityTransform, Transform};
 use serde::{Deserialize, Serialize};
@@ -78,12 +79,12 @@ impl Hierarchy {
             }
         }
 
-        let _ = world.insert_one(child, Parent::new(parent));
+        let _ = change::insert_one(world, child, Parent::new(parent));
 
         if let Ok(mut children) = world.get::<&mut Children>(parent) {
             children.push(child);
         } else {
-            let _ = world.insert_one(parent, Children::new(vec![child]));
+            let _ = change::insert_one(world, parent, Children::new(vec![child]));
         }
     }
 
@@ -101,7 +102,7 @@ impl Hierarchy {
         }
 
         if local_remove_signal {
-            let _ = world.remove_one::<Parent>(child);
+            let _ = change::remove_one::<Parent>(world, child);
         }
     }
 
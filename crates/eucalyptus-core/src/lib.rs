@@ -1,6 +1,8 @@
 pub mod animation;
+pub mod asset_index;
 pub mod billboard;
 pub mod camera;
+pub mod change;
 pub mod command;
 pub mod component;
 pub mod config;
@@ -36,6 +38,7 @@ use crate::component::ComponentRegistry;
 use crate::entity_status::EntityStatus;
 use crate::physics::collider::ColliderGroup;
 use crate::physics::kcc::KCC;
+use crate::physics::lod::SimulationAnchor;
 use crate::physics::rigidbody::RigidBody;
 use crate::scripting::types::KotlinComponents;
 use crate::states::Script;
@@ -69,6 +72,7 @@ pub fn register_components(component_registry: &mut ComponentRegistry) {
     component_registry.register::<RigidBody>();
     component_registry.register::<ColliderGroup>();
     component_registry.register::<KCC>();
+    component_registry.register::<SimulationAnchor>();
     component_registry.register::<AnimationComponent>();
     component_registry.register::<BillboardComponent>();
     component_registry.register::<HUDComponent>();
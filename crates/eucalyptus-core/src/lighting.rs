@@ -1,3 +1,4 @@
+use crate::change::mark_changed;
 use crate::component::{
     Component, ComponentDescriptor, ComponentInitFuture, DisabilityFlags, InspectableComponent,
     SerializedComponent,
@@ -60,6 +61,7 @@ impl Component for Light {
         graphics: Arc<SharedGraphicsContext>,
     ) {
         let synced = &mut self.component;
+        let previous = (synced.position, synced.direction);
         if let Ok(entity_transform) = world.query_one::<&EntityTransform>(entity).get() {
             let transform = entity_transform.propagate(world, entity);
             synced.position = transform.position;
@@ -68,6 +70,9 @@ impl Component for Light {
             synced.position = transform.position;
             synced.direction = (transform.rotation * LIGHT_FORWARD_AXIS).normalize_or_zero();
         }
+        if (synced.position, synced.direction) != previous {
+            mark_changed::<Light>(entity);
+        }
 
         self.update(&graphics);
     }
@@ -246,6 +251,7 @@ impl InspectableComponent for Light {
                         world.query_one::<&mut EntityTransform>(entity).get()
                     {
                         entity_transform.local_mut().position = self.component.position;
+                        mark_changed::<EntityTransform>(entity);
                     } else if let Ok(transform) = world.query_one::<&mut Transform>(entity).get() {
                         transform.position = self.component.position;
                     }
@@ -261,6 +267,7 @@ impl InspectableComponent for Light {
                             world.query_one::<&mut EntityTransform>(entity).get()
                         {
                             entity_transform.local_mut().rotation = rotation;
+                            mark_changed::<EntityTransform>(entity);
                         } else if let Ok(transform) =
                             world.query_one::<&mut Transform>(entity).get()
                         {
@@ -1,14 +1,19 @@
+use crate::asset_index::{ASSET_INDEX, AssetIndex};
 use crate::resource::ResourceReference;
 use crate::uuid::UuidV4;
+use parking_lot::Mutex;
+use rayon::prelude::*;
 use rkyv::Archive;
 use ron::ser::PrettyConfig;
 use serde::{Deserialize, Serialize};
 use sha2::{Digest, Sha256};
 use std::fs;
+use std::io::Read;
 use std::path::{Path, PathBuf};
 use std::sync::Arc;
 use std::time::SystemTime;
 use uuid::Uuid;
+use xxhash_rust::xxh3::Xxh3;
 
 /// The type of asset, used for filtering in the asset browser
 /// and determining which importer to invoke.
@@ -25,7 +30,7 @@ pub enum AssetType {
 /// A single entry in the editor's asset registry.
 ///
 /// This is an editor-only struct — it is never rkyv-archived or packed.
-/// It is rebuilt at editor startup by scanning `.eucmeta` files.
+/// It is kept in the [`ASSET_INDEX`], which is rebuilt from the `.eucmeta` files.
 /// The serialized form of this struct (written to `.eucmeta`) uses serde.
 #[derive(Clone, Debug, Serialize, Deserialize)]
 pub struct AssetEntry {
@@ -48,14 +53,27 @@ pub struct AssetEntry {
     /// relative to the project root.
     pub compiled_path: Option<PathBuf>,
 
-    /// SHA-256 (or xxHash) of the source file at last successful import.
+    /// SHA-256 of the source file, as recorded by older versions of the editor.
     ///
-    /// On editor startup, the source is rehashed and compared.
+    /// Superseded by `content_hash`, and left zeroed by new imports. Kept so that
+    /// existing sidecars still parse.
+    #[serde(default)]
+    pub source_hash: [u8; 32],
+
+    /// xxh3-128 of the source file at last successful import (see [`hash_file`]).
     ///
-    /// If it differs, the asset is marked dirty and recompilation is triggered.
+    /// If the source is rehashed and this differs, the asset has changed and
+    /// needs to be reimported.
     ///
     /// More reliable than `import_time` — timestamps can lie (e.g. git checkouts).
-    pub source_hash: [u8; 32],
+    #[serde(default)]
+    pub content_hash: [u8; 16],
+
+    /// Size, modification time and inode of the source file at last import.
+    ///
+    /// While these still match, the file is assumed unchanged and is not hashed again.
+    #[serde(default)]
+    pub source_stamp: Option<SourceStamp>,
 
     /// When the asset was last successfully imported.
     ///
@@ -95,9 +113,75 @@ impl AssetEntry {
     }
 
     /// Returns true if the asset's source file needs to be reimported.
-    /// Call this on editor startup after rehashing the source file.
-    pub fn is_stale(&self, current_hash: &[u8; 32]) -> bool {
-        &self.source_hash != current_hash
+    ///
+    /// The file is only hashed if its [`SourceStamp`] differs from the recorded one.
+    pub fn is_stale(&self, source_path: &Path) -> anyhow::Result<bool> {
+        Ok(matches!(
+            self.check_source(source_path)?,
+            SourceStatus::Changed { .. }
+        ))
+    }
+
+    /// Compares the source file against what was recorded at import.
+    pub fn check_source(&self, source_path: &Path) -> anyhow::Result<SourceStatus> {
+        let stamp = SourceStamp::read(source_path)?;
+        if self.source_stamp == Some(stamp) {
+            return Ok(SourceStatus::Unchanged);
+        }
+
+        let hash = hash_file(source_path)?;
+        // entries from before `content_hash` existed can only be compared by their SHA-256, and
+        // the ones without even that adopt the current contents
+        let legacy = self.source_stamp.is_none() && self.content_hash == [0; 16];
+        let unchanged = if legacy && self.source_hash != [0; 32] {
+            sha256_file(source_path)? == self.source_hash
+        } else {
+            legacy || hash == self.content_hash
+        };
+        if unchanged {
+            Ok(SourceStatus::Touched { stamp, hash })
+        } else {
+            Ok(SourceStatus::Changed { stamp, hash })
+        }
+    }
+}
+
+/// The result of [`AssetEntry::check_source`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum SourceStatus {
+    /// The stamp matches, so the file was not even hashed.
+    Unchanged,
+    /// The stamp changed but the contents did not (e.g. the file was touched or checked out again).
+    Touched { stamp: SourceStamp, hash: [u8; 16] },
+    /// The contents changed.
+    Changed { stamp: SourceStamp, hash: [u8; 16] },
+}
+
+/// The cheap-to-read identity of a source file, used to skip hashing files that were not touched.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub struct SourceStamp {
+    pub size: u64,
+    pub modified: Option<SystemTime>,
+    /// Zero on platforms that do not expose inodes.
+    pub inode: u64,
+}
+
+impl SourceStamp {
+    pub fn read(path: &Path) -> std::io::Result<Self> {
+        Ok(Self::from_metadata(&fs::metadata(path)?))
+    }
+
+    pub fn from_metadata(metadata: &fs::Metadata) -> Self {
+        #[cfg(unix)]
+        let inode = std::os::unix::fs::MetadataExt::ino(metadata);
+        #[cfg(not(unix))]
+        let inode = 0;
+
+        Self {
+            size: metadata.len(),
+            modified: metadata.modified().ok(),
+            inode,
+        }
     }
 }
 
@@ -114,14 +198,81 @@ pub fn detect_asset_type(path: &Path) -> Option<AssetType> {
     }
 }
 
-fn hash_file(path: &Path) -> anyhow::Result<[u8; 32]> {
-    let bytes = fs::read(path)?;
-    let digest = Sha256::digest(&bytes);
+/// Files smaller than this are read directly, as mapping them costs more than it saves.
+const MMAP_THRESHOLD: u64 = 256 * 1024;
+const HASH_CHUNK: usize = 1024 * 1024;
+
+/// Hashes the contents of a file with xxh3-128.
+///
+/// Large files are memory mapped and streamed through the hasher a chunk at a time, so
+/// they are never copied into memory as a whole.
+pub fn hash_file(path: &Path) -> anyhow::Result<[u8; 16]> {
+    let mut file = fs::File::open(path)?;
+    let mut hasher = Xxh3::new();
+
+    if file.metadata()?.len() >= MMAP_THRESHOLD {
+        // SAFETY: the mapping is only read. If another process truncates the file while it is
+        // hashed the read can fault, which is the same risk every mmap based tool takes.
+        match unsafe { memmap2::Mmap::map(&file) } {
+            Ok(map) => {
+                #[cfg(unix)]
+                let _ = map.advise(memmap2::Advice::Sequential);
+                for chunk in map.chunks(HASH_CHUNK) {
+                    hasher.update(chunk);
+                }
+                return Ok(hasher.digest128().to_le_bytes());
+            }
+            Err(e) => log::debug!(
+                "Unable to map {}, reading it instead: {}",
+                path.display(),
+                e
+            ),
+        }
+    }
+
+    let mut buffer = vec![0u8; 64 * 1024];
+    loop {
+        let read = file.read(&mut buffer)?;
+        if read == 0 {
+            break;
+        }
+        hasher.update(&buffer[..read]);
+    }
+    Ok(hasher.digest128().to_le_bytes())
+}
+
+/// Hashes the contents of a file with SHA-256, as older versions of the editor recorded in
+/// [`AssetEntry::source_hash`]. Only needed once per asset, to bring such sidecars up to date.
+fn sha256_file(path: &Path) -> anyhow::Result<[u8; 32]> {
+    let mut file = fs::File::open(path)?;
+    let mut hasher = Sha256::new();
+    let mut buffer = vec![0u8; 64 * 1024];
+    loop {
+        let read = file.read(&mut buffer)?;
+        if read == 0 {
+            break;
+        }
+        hasher.update(&buffer[..read]);
+    }
     let mut hash = [0u8; 32];
-    hash.copy_from_slice(&digest);
+    hash.copy_from_slice(&hasher.finalize());
     Ok(hash)
 }
 
+/// Writes `entry` to the `.eucmeta` sidecar at `meta_path`.
+pub fn write_eucmeta(meta_path: &Path, entry: &AssetEntry) -> anyhow::Result<()> {
+    let ron_str = ron::ser::to_string_pretty(entry, PrettyConfig::default())
+        .map_err(|e| anyhow::anyhow!("RON serialization error: {}", e))?;
+    fs::write(meta_path, &ron_str)?;
+    Ok(())
+}
+
+pub(crate) fn read_eucmeta(meta_path: &Path) -> anyhow::Result<AssetEntry> {
+    let ron_str = fs::read_to_string(meta_path)?;
+    ron::de::from_str(&ron_str)
+        .map_err(|e| anyhow::anyhow!("Failed to parse {}: {}", meta_path.display(), e))
+}
+
 /// Writes a `.eucmeta` sidecar next to `source_path` and returns the created `AssetEntry`.
 ///
 /// If a sidecar already exists it is read and returned unchanged —
@@ -134,9 +285,8 @@ pub fn generate_eucmeta(source_path: &Path, project_root: &Path) -> anyhow::Resu
     let meta_path = PathBuf::from(format!("{}.eucmeta", source_path.display()));
 
     if meta_path.exists() {
-        let ron_str = fs::read_to_string(&meta_path)?;
-        let entry: AssetEntry = ron::de::from_str(&ron_str)
-            .map_err(|e| anyhow::anyhow!("Failed to parse {}: {}", meta_path.display(), e))?;
+        let entry = read_eucmeta(&meta_path)?;
+        register(project_root, &meta_path, &entry);
         return Ok(entry);
     }
 
@@ -154,7 +304,8 @@ pub fn generate_eucmeta(source_path: &Path, project_root: &Path) -> anyhow::Resu
         .unwrap_or(source_path)
         .to_path_buf();
 
-    let source_hash = hash_file(source_path)?;
+    let source_stamp = SourceStamp::read(source_path)?;
+    let content_hash = hash_file(source_path)?;
 
     let entry = AssetEntry {
         uuid: Uuid::new_v4(),
@@ -162,18 +313,29 @@ pub fn generate_eucmeta(source_path: &Path, project_root: &Path) -> anyhow::Resu
         asset_type,
         location: ResourceReference::File(relative),
         compiled_path: None,
-        source_hash,
+        source_hash: [0; 32],
+        content_hash,
+        source_stamp: Some(source_stamp),
         import_time: SystemTime::now(),
         dependencies: vec![],
     };
 
-    let ron_str = ron::ser::to_string_pretty(&entry, PrettyConfig::default())
-        .map_err(|e| anyhow::anyhow!("RON serialization error: {}", e))?;
-    fs::write(&meta_path, &ron_str)?;
+    write_eucmeta(&meta_path, &entry)?;
     log::info!("Generated .eucmeta for {}", source_path.display());
+    register(project_root, &meta_path, &entry);
     Ok(entry)
 }
 
+/// Adds an imported asset to the [`ASSET_INDEX`], if the index belongs to the same project.
+fn register(project_root: &Path, meta_path: &Path, entry: &AssetEntry) {
+    let mut index = ASSET_INDEX.write();
+    if index.belongs_to(project_root)
+        && index.uuid_for_path(&meta_path.with_extension("")) != Some(entry.uuid)
+    {
+        index.insert(meta_path, entry.clone());
+    }
+}
+
 /// The asset type, duplicated here as a lean copy without editor-only variants.
 /// Must stay in sync with `AssetType` in the editor crate.
 #[derive(Clone, Debug, PartialEq, Eq, Archive, rkyv::Serialize, rkyv::Deserialize)]
@@ -219,79 +381,386 @@ pub struct PackedAssetEntry {
     pub dependencies: Vec<UuidV4>,
 }
 
-/// generates `.eucmeta` files for resources
-pub fn scan_and_generate_eucmeta(project_root: &Path) -> usize {
-    let resources_dir = project_root.join("resources");
-    let mut created = 0usize;
-    fn walk(dir: &Path, project_root: &Path, created: &mut usize) {
-        let Ok(read) = std::fs::read_dir(dir) else {
-            return;
-        };
-        for entry in read.flatten() {
-            let path = entry.path();
-            if path.is_dir() {
-                walk(&path, project_root, created);
-                continue;
-            }
-            // skip sidecars themselves
-            if path.extension().and_then(|e| e.to_str()) == Some("eucmeta") {
-                continue;
-            }
-            // only generate for known asset types
-            if detect_asset_type(&path).is_none() {
-                continue;
-            }
-            let meta_path = PathBuf::from(format!("{}.eucmeta", path.display()));
-            if meta_path.exists() {
-                continue;
-            }
-            match generate_eucmeta(&path, project_root) {
-                Ok(_) => *created += 1,
-                Err(e) => log::warn!(
-                    "Failed to generate .eucmeta for '{}': {}",
-                    path.display(),
-                    e
-                ),
-            }
+/// The result of [`scan_project_assets`].
+#[derive(Default, Debug)]
+pub struct ImportScan {
+    /// Assets that had no sidecar yet.
+    pub created: usize,
+    /// Assets whose contents changed since they were imported, which need to be reimported.
+    pub changed: Vec<Uuid>,
+    /// Assets that were touched without their contents changing, which only had their stamp
+    /// updated.
+    pub touched: usize,
+    pub unchanged: usize,
+    pub failed: usize,
+}
+
+/// What [`import_asset`] did with a source file.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ImportOutcome {
+    /// A sidecar was generated for a new asset.
+    Created,
+    /// The contents of the asset changed.
+    Changed(Uuid),
+    /// The file was touched without its contents changing.
+    Touched,
+    Unchanged,
+}
+
+/// Brings the sidecars of every resource in the project up to date.
+///
+/// The resource tree is walked and checked in parallel on the rayon pool. Files whose
+/// [`SourceStamp`] matches their sidecar are skipped without being read, and only the rest
+/// are hashed. New files get a sidecar, and every change is registered in the [`ASSET_INDEX`],
+/// which should be loaded beforehand so existing sidecars do not need to be parsed.
+pub fn scan_project_assets(project_root: &Path) -> ImportScan {
+    puffin::profile_function!();
+    let sources = collect_sources(&project_root.join("resources"));
+
+    let outcomes: Vec<Option<ImportOutcome>> = sources
+        .par_iter()
+        .map(|path| {
+            import_asset(path, project_root)
+                .inspect_err(|e| log::warn!("Failed to scan asset '{}': {}", path.display(), e))
+                .ok()
+        })
+        .collect();
+
+    let mut scan = ImportScan::default();
+    for outcome in outcomes {
+        match outcome {
+            Some(ImportOutcome::Created) => scan.created += 1,
+            Some(ImportOutcome::Changed(uuid)) => scan.changed.push(uuid),
+            Some(ImportOutcome::Touched) => scan.touched += 1,
+            Some(ImportOutcome::Unchanged) => scan.unchanged += 1,
+            None => scan.failed += 1,
         }
     }
-    walk(&resources_dir, project_root, &mut created);
-    if created > 0 {
-        log::info!(
-            "Generated {} .eucmeta sidecar(s) during project scan",
-            created
-        );
+
+    log::info!(
+        "Scanned {} assets: {} new, {} changed, {} touched, {} unchanged",
+        sources.len(),
+        scan.created,
+        scan.changed.len(),
+        scan.touched,
+        scan.unchanged
+    );
+    scan
+}
+
+/// Imports a single source file, generating its sidecar if it is new, or updating its
+/// sidecar and [`ASSET_INDEX`] entry if the file changed since it was last imported.
+pub fn import_asset(path: &Path, project_root: &Path) -> anyhow::Result<ImportOutcome> {
+    let meta_path = PathBuf::from(format!("{}.eucmeta", path.display()));
+
+    let indexed = {
+        let index = ASSET_INDEX.read();
+        index
+            .uuid_for_path(path)
+            .and_then(|uuid| index.get(uuid).cloned())
+    };
+    let is_indexed = indexed.is_some();
+    let mut entry = match indexed {
+        Some(entry) => entry,
+        None if meta_path.exists() => read_eucmeta(&meta_path)?,
+        None => {
+            generate_eucmeta(path, project_root)?;
+            return Ok(ImportOutcome::Created);
+        }
+    };
+
+    let outcome = match entry.check_source(path)? {
+        SourceStatus::Unchanged => ImportOutcome::Unchanged,
+        SourceStatus::Touched { stamp, hash } => {
+            entry.source_stamp = Some(stamp);
+            entry.content_hash = hash;
+            ImportOutcome::Touched
+        }
+        SourceStatus::Changed { stamp, hash } => {
+            entry.source_stamp = Some(stamp);
+            entry.content_hash = hash;
+            entry.import_time = SystemTime::now();
+            ImportOutcome::Changed(entry.uuid)
+        }
+    };
+
+    if outcome == ImportOutcome::Unchanged {
+        // a sidecar that was moved in from elsewhere still needs to be indexed
+        if !is_indexed {
+            register(project_root, &meta_path, &entry);
+        }
+        return Ok(outcome);
     }
-    created
+
+    write_eucmeta(&meta_path, &entry)?;
+    let mut index = ASSET_INDEX.write();
+    if index.belongs_to(project_root) {
+        index.insert(&meta_path, entry);
+    }
+    Ok(outcome)
+}
+
+/// Collects every file with a known asset type under `dir`, with one rayon task per directory.
+fn collect_sources(dir: &Path) -> Vec<PathBuf> {
+    let found = Mutex::new(Vec::new());
+    rayon::scope(|scope| walk_sources(scope, dir.to_path_buf(), &found));
+    found.into_inner()
 }
 
-/// Scans all `.eucmeta` files under `<project_root>/resources/` and returns
-/// the [`AssetEntry`] whose UUID matches `uuid`.
+fn walk_sources<'s>(scope: &rayon::Scope<'s>, dir: PathBuf, found: &'s Mutex<Vec<PathBuf>>) {
+    let Ok(read) = fs::read_dir(&dir) else {
+        return;
+    };
+
+    let mut sources = Vec::new();
+    for entry in read.flatten() {
+        let Ok(file_type) = entry.file_type() else {
+            continue;
+        };
+        let path = entry.path();
+        if file_type.is_dir() {
+            scope.spawn(move |scope| walk_sources(scope, path, found));
+        } else if detect_asset_type(&path).is_some() {
+            // sidecars themselves have no asset type
+            sources.push(path);
+        }
+    }
+    found.lock().extend(sources);
+}
+
+/// Returns the [`AssetEntry`] whose UUID matches `uuid`, from the [`ASSET_INDEX`].
+///
+/// The index is loaded on first use if it belongs to another project (or none yet). If the
+/// UUID is missing, the index is refreshed in case its sidecar was added outside the editor,
+/// but only for the first miss since the index was loaded or the files on disk last changed
+/// (see [`AssetIndex::files_changed`]). UUIDs that are still missing are remembered, so a scene
+/// full of dangling references does not walk `resources/` once per reference.
 ///
 /// Returns an error if no matching entry is found.
 pub fn find_asset_by_uuid(project_root: &Path, uuid: Uuid) -> anyhow::Result<AssetEntry> {
-    fn scan_dir(dir: &Path, uuid: Uuid) -> Option<AssetEntry> {
-        let read = std::fs::read_dir(dir).ok()?;
-        for entry in read.flatten() {
-            let path = entry.path();
-            if path.is_dir() {
-                if let Some(found) = scan_dir(&path, uuid) {
-                    return Some(found);
-                }
-            } else if path.extension().and_then(|e| e.to_str()) == Some("eucmeta") {
-                if let Ok(s) = std::fs::read_to_string(&path) {
-                    if let Ok(entry) = ron::de::from_str::<AssetEntry>(&s) {
-                        if entry.uuid == uuid {
-                            return Some(entry);
-                        }
-                    }
-                }
+    {
+        let index = ASSET_INDEX.read();
+        if index.belongs_to(project_root) {
+            if let Some(entry) = index.get(uuid) {
+                return Ok(entry.clone());
+            }
+            if index.is_unresolved(uuid) {
+                anyhow::bail!("No asset indexed for UUID {}", uuid);
             }
         }
-        None
     }
 
-    let resources_dir = project_root.join("resources");
-    scan_dir(&resources_dir, uuid)
-        .ok_or_else(|| anyhow::anyhow!("No .eucmeta file found for UUID {}", uuid))
+    let mut index = ASSET_INDEX.write();
+    if !index.belongs_to(project_root) {
+        *index = AssetIndex::load(project_root);
+    } else if index.get(uuid).is_none() && !index.is_unresolved(uuid) {
+        index.refresh_for_miss();
+    }
+    match index.get(uuid) {
+        Some(entry) => Ok(entry.clone()),
+        None => {
+            index.mark_unresolved(uuid);
+            Err(anyhow::anyhow!("No asset indexed for UUID {}", uuid))
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::asset_index::tests::TempProject;
+    use std::time::Duration;
+
+    /// Held by tests that look assets up, as each one points the shared [`ASSET_INDEX`] at its
+    /// own project.
+    static INDEX_USERS: Mutex<()> = Mutex::new(());
+
+    #[test]
+    fn lookup_refreshes_index_for_sidecars_added_outside_the_editor() {
+        let _index = INDEX_USERS.lock();
+        let project = TempProject::new();
+        let a = generate_eucmeta(&project.resource("a.png", b"a"), &project.root).unwrap();
+        assert_eq!(
+            find_asset_by_uuid(&project.root, a.uuid).unwrap().uuid,
+            a.uuid
+        );
+
+        // written straight to disk, so the index never hears about it
+        project.resource("b.png", b"b");
+        let mut b = a.clone();
+        b.uuid = Uuid::new_v4();
+        write_eucmeta(&project.root.join("resources/b.png.eucmeta"), &b).unwrap();
+
+        let found = find_asset_by_uuid(&project.root, b.uuid).unwrap();
+        assert_eq!(
+            found.location,
+            ResourceReference::File("resources/b.png".into())
+        );
+        assert!(find_asset_by_uuid(&project.root, Uuid::new_v4()).is_err());
+    }
+
+    /// Writes a sidecar for a new asset straight to disk, so the index never hears about it.
+    fn sidecar_behind_the_index(project: &TempProject, name: &str, like: &AssetEntry) -> AssetEntry {
+        project.resource(name, name.as_bytes());
+        let mut entry = like.clone();
+        entry.uuid = Uuid::new_v4();
+        let meta_path = project.root.join("resources").join(format!("{}.eucmeta", name));
+        write_eucmeta(&meta_path, &entry).unwrap();
+        entry
+    }
+
+    #[test]
+    fn unresolved_uuids_do_not_refresh_again_until_indexed() {
+        let _index = INDEX_USERS.lock();
+        let project = TempProject::new();
+        let a = generate_eucmeta(&project.resource("a.png", b"a"), &project.root).unwrap();
+        let mut b = a.clone();
+        b.uuid = Uuid::new_v4();
+        assert!(find_asset_by_uuid(&project.root, b.uuid).is_err());
+
+        // the miss was remembered, so a sidecar written behind the index's back stays unseen
+        project.resource("b.png", b"b");
+        let meta_path = project.root.join("resources/b.png.eucmeta");
+        write_eucmeta(&meta_path, &b).unwrap();
+        assert!(find_asset_by_uuid(&project.root, b.uuid).is_err());
+
+        // until the asset is indexed
+        ASSET_INDEX.write().insert(&meta_path, b.clone());
+        assert_eq!(find_asset_by_uuid(&project.root, b.uuid).unwrap().uuid, b.uuid);
+    }
+
+    #[test]
+    fn only_the_first_miss_refreshes_until_files_change() {
+        let _index = INDEX_USERS.lock();
+        let project = TempProject::new();
+        let a = generate_eucmeta(&project.resource("a.png", b"a"), &project.root).unwrap();
+        assert!(find_asset_by_uuid(&project.root, a.uuid).is_ok());
+
+        // the first dangling UUID refreshes the index
+        assert!(find_asset_by_uuid(&project.root, Uuid::new_v4()).is_err());
+
+        // so a second, different one does not, and neither do the first ones again
+        let b = sidecar_behind_the_index(&project, "b.png", &a);
+        assert!(find_asset_by_uuid(&project.root, b.uuid).is_err());
+        assert!(find_asset_by_uuid(&project.root, Uuid::new_v4()).is_err());
+        assert!(find_asset_by_uuid(&project.root, b.uuid).is_err());
+
+        // once the watcher reports changes, the next miss refreshes again
+        ASSET_INDEX.write().files_changed();
+        assert_eq!(find_asset_by_uuid(&project.root, b.uuid).unwrap().uuid, b.uuid);
+        let c = sidecar_behind_the_index(&project, "c.png", &a);
+        assert!(find_asset_by_uuid(&project.root, c.uuid).is_err());
+    }
+
+    fn set_modified(path: &Path, modified: SystemTime) {
+        let file = fs::File::options().write(true).open(path).unwrap();
+        file.set_modified(modified).unwrap();
+    }
+
+    #[test]
+    fn unchanged_stamp_skips_hashing() {
+        let project = TempProject::new();
+        let source = project.resource("a.png", b"contents");
+        let mut entry = generate_eucmeta(&source, &project.root).unwrap();
+
+        // a wrong hash behind a matching stamp goes unnoticed, as the file is never read
+        entry.content_hash = [1; 16];
+        assert_eq!(
+            entry.check_source(&source).unwrap(),
+            SourceStatus::Unchanged
+        );
+        assert!(!entry.is_stale(&source).unwrap());
+    }
+
+    #[test]
+    fn legacy_sidecars_are_compared_by_their_sha256() {
+        let project = TempProject::new();
+        let source = project.resource("a.png", b"contents");
+        let mut entry = generate_eucmeta(&source, &project.root).unwrap();
+
+        // as written before the stamp and xxh3 hash existed
+        entry.source_stamp = None;
+        entry.content_hash = [0; 16];
+        entry.source_hash = sha256_file(&source).unwrap();
+        assert!(matches!(
+            entry.check_source(&source).unwrap(),
+            SourceStatus::Touched { .. }
+        ));
+
+        fs::write(&source, b"edited since the last import").unwrap();
+        assert!(matches!(
+            entry.check_source(&source).unwrap(),
+            SourceStatus::Changed { .. }
+        ));
+
+        // without a SHA-256 either, there is nothing to compare against
+        entry.source_hash = [0; 32];
+        assert!(matches!(
+            entry.check_source(&source).unwrap(),
+            SourceStatus::Touched { .. }
+        ));
+    }
+
+    #[test]
+    fn changed_size_or_mtime_is_hashed_again() {
+        let project = TempProject::new();
+        let source = project.resource("a.png", b"contents");
+        let entry = generate_eucmeta(&source, &project.root).unwrap();
+        let imported = entry.source_stamp.unwrap().modified.unwrap();
+
+        // same contents with a new mtime only refreshes the stamp
+        set_modified(&source, imported + Duration::from_secs(10));
+        let SourceStatus::Touched { stamp, hash } = entry.check_source(&source).unwrap() else {
+            panic!("touched file was not rehashed");
+        };
+        assert_eq!(hash, entry.content_hash);
+        assert_ne!(Some(stamp), entry.source_stamp);
+
+        // same size, new contents and mtime
+        fs::write(&source, b"CONTENTS").unwrap();
+        set_modified(&source, imported + Duration::from_secs(20));
+        assert!(matches!(
+            entry.check_source(&source).unwrap(),
+            SourceStatus::Changed { .. }
+        ));
+
+        // new size, with the mtime put back
+        fs::write(&source, b"longer contents").unwrap();
+        set_modified(&source, imported);
+        assert!(entry.is_stale(&source).unwrap());
+    }
+
+    #[test]
+    fn scan_only_reimports_changed_sources() {
+        let project = TempProject::new();
+        let a = project.resource("a.png", b"a");
+        let b = project.resource("nested/b.wav", b"b");
+
+        let scan = scan_project_assets(&project.root);
+        assert_eq!((scan.created, scan.failed), (2, 0));
+        let scan = scan_project_assets(&project.root);
+        assert_eq!(
+            (scan.unchanged, scan.touched, scan.changed.len()),
+            (2, 0, 0)
+        );
+
+        let b_uuid = read_eucmeta(&project.root.join("resources/nested/b.wav.eucmeta"))
+            .unwrap()
+            .uuid;
+        let a_modified = SourceStamp::read(&a).unwrap().modified.unwrap();
+        set_modified(&a, a_modified + Duration::from_secs(10));
+        fs::write(&b, b"bigger").unwrap();
+
+        let scan = scan_project_assets(&project.root);
+        assert_eq!(scan.touched, 1);
+        assert_eq!(scan.changed, vec![b_uuid]);
+        assert_eq!(scan.unchanged, 0);
+
+        // the new stamps were written back, so nothing is hashed on the next scan
+        let scan = scan_project_assets(&project.root);
+        assert_eq!(
+            (scan.unchanged, scan.touched, scan.changed.len()),
+            (2, 0, 0)
+        );
+    }
 }
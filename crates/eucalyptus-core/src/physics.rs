@@ -1,22 +1,29 @@
 //! Components in the eucalyptus-editor and redback-runtime that relate to rapier3d based physics.
 
+use crate::change::{ChangeCursor, Changes};
+use crate::entity_status::EntityStatus;
 use crate::physics::rigidbody::RigidBodyMode;
+use crate::physics::workers::PhysicsWorkers;
 use crate::states::Label;
 use dropbear_engine::entity::Transform;
-use hecs::Entity;
-use rapier3d::control::CharacterCollision;
+use hecs::{Entity, World};
 use rapier3d::na::{Quaternion, UnitQuaternion};
 use rapier3d::prelude::*;
 use serde::{Deserialize, Serialize};
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 
 pub mod collider;
+pub mod interpolation;
 pub mod kcc;
+pub mod lod;
+pub mod query;
 pub mod rigidbody;
+pub mod snapshot;
+pub mod workers;
 
 /// A serializable [rapier3d] state that shows all the different actions and types related
 /// to physics rendering.
-#[derive(Serialize, Deserialize, Clone)]
+#[derive(Serialize, Deserialize)]
 pub struct PhysicsState {
     #[serde(default)]
     pub islands: IslandManager,
@@ -46,8 +53,161 @@ pub struct PhysicsState {
     #[serde(default)]
     pub entity_label_map: HashMap<Entity, Label>,
 
+    /// Character moves requested by scripts this tick, solved together by
+    /// [`kcc::solve_character_moves`].
     #[serde(skip)]
-    pub collision_events_to_deal_with: HashMap<Entity, Vec<CharacterCollision>>,
+    pub character_moves: Vec<kcc::CharacterMove>,
+
+    #[serde(skip)]
+    collider_index: ColliderIndex,
+
+    #[serde(skip)]
+    label_changes: EntityLabelChanges,
+
+    /// The workers of the last step, which batched queries also run on.
+    #[serde(skip)]
+    workers: Option<PhysicsWorkers>,
+}
+
+/// Which entity owns each collider, so hits resolve without searching. Kept up to date as
+/// colliders are registered and removed and as entities change label, rather than rebuilt.
+#[derive(Clone)]
+struct ColliderIndex {
+    entities: HashMap<ColliderHandle, Entity>,
+    /// Labels that gained colliders since the last step. Their owners are looked up then, in one
+    /// pass over the label map.
+    added: HashSet<Label>,
+    /// Set when the label map was rebuilt (or never indexed), so the whole index is too.
+    rebuild: bool,
+}
+
+impl Default for ColliderIndex {
+    fn default() -> Self {
+        Self {
+            entities: HashMap::new(),
+            added: HashSet::new(),
+            rebuild: true,
+        }
+    }
+}
+
+impl ColliderIndex {
+    /// Moves the colliders of `entity` from its `old` label over to its `new` one.
+    fn relabel(
+        &mut self,
+        colliders: &HashMap<Label, Vec<(u32, ColliderHandle)>>,
+        entity: Entity,
+        old: Option<&Label>,
+        new: Option<&Label>,
+    ) {
+        if let Some(handles) = old.and_then(|label| colliders.get(label)) {
+            for (_, handle) in handles {
+                if self.entities.get(handle) == Some(&entity) {
+                    self.entities.remove(handle);
+                }
+            }
+        }
+        if let Some(handles) = new.and_then(|label| colliders.get(label)) {
+            for (_, handle) in handles {
+                self.entities.insert(*handle, entity);
+            }
+        }
+    }
+
+    fn forget(&mut self, handles: &[(u32, ColliderHandle)]) {
+        for (_, handle) in handles {
+            self.entities.remove(handle);
+        }
+    }
+}
+
+/// Where [`PhysicsState::update_entity_labels`] is in the change logs of the components the
+/// label map is built from.
+#[derive(Default)]
+struct EntityLabelChanges {
+    labels: ChangeCursor<Label>,
+    statuses: ChangeCursor<EntityStatus>,
+}
+
+/// Rebuilds `map` from every labelled entity in `world`, only cloning the labels that changed.
+fn rescan_entity_labels(world: &World, map: &mut HashMap<Entity, Label>) {
+    let mut previous = std::mem::take(map);
+    let mut query = world.query::<(Entity, &Label, Option<&EntityStatus>)>();
+    for (entity, label, status) in query.iter() {
+        if status.is_some_and(|status| status.disabled) {
+            continue;
+        }
+        let label = match previous.remove(&entity) {
+            Some(kept) if kept == *label => kept,
+            _ => label.clone(),
+        };
+        map.insert(entity, label);
+    }
+}
+
+/// Updates the entry of a single `entity` in `map`.
+fn refresh_entity_label(world: &World, map: &mut HashMap<Entity, Label>, entity: Entity) {
+    let disabled = world
+        .get::<&EntityStatus>(entity)
+        .is_ok_and(|status| status.disabled);
+    match world.get::<&Label>(entity) {
+        Ok(label) if !disabled => {
+            if map.get(&entity) != Some(&*label) {
+                map.insert(entity, label.clone());
+            }
+        }
+        _ => {
+            map.remove(&entity);
+        }
+    }
+}
+
+impl Clone for PhysicsState {
+    fn clone(&self) -> Self {
+        Self {
+            islands: self.islands.clone(),
+            broad_phase: self.broad_phase.clone(),
+            narrow_phase: self.narrow_phase.clone(),
+            bodies: self.bodies.clone(),
+            colliders: self.colliders.clone(),
+            impulse_joints: self.impulse_joints.clone(),
+            multibody_joints: self.multibody_joints.clone(),
+            ccd_solver: self.ccd_solver.clone(),
+            integration_parameters: self.integration_parameters,
+            gravity: self.gravity,
+            bodies_entity_map: self.bodies_entity_map.clone(),
+            colliders_entity_map: self.colliders_entity_map.clone(),
+            entity_label_map: self.entity_label_map.clone(),
+            character_moves: self.character_moves.clone(),
+            collider_index: self.collider_index.clone(),
+            // the copy has never looked at a world, so it rescans on its first update
+            label_changes: EntityLabelChanges::default(),
+            workers: self.workers.clone(),
+        }
+    }
+
+    /// Clones field by field, so that fields which support it (the entity maps and pending moves)
+    /// reuse their allocations when a snapshot slot is overwritten.
+    fn clone_from(&mut self, source: &Self) {
+        self.islands.clone_from(&source.islands);
+        self.broad_phase.clone_from(&source.broad_phase);
+        self.narrow_phase.clone_from(&source.narrow_phase);
+        self.bodies.clone_from(&source.bodies);
+        self.colliders.clone_from(&source.colliders);
+        self.impulse_joints.clone_from(&source.impulse_joints);
+        self.multibody_joints.clone_from(&source.multibody_joints);
+        self.ccd_solver.clone_from(&source.ccd_solver);
+        self.integration_parameters = source.integration_parameters;
+        self.gravity = source.gravity;
+        self.bodies_entity_map.clone_from(&source.bodies_entity_map);
+        self.colliders_entity_map.clone_from(&source.colliders_entity_map);
+        self.entity_label_map.clone_from(&source.entity_label_map);
+        self.character_moves.clone_from(&source.character_moves);
+        self.collider_index.clone_from(&source.collider_index);
+        // the label map now comes from `source`, so it has to be checked against the world again
+        self.label_changes = EntityLabelChanges::default();
+        self.workers.clone_from(&source.workers);
+    }
 }
 
 impl PhysicsState {
@@ -66,32 +226,134 @@ impl PhysicsState {
             bodies_entity_map: Default::default(),
             colliders_entity_map: Default::default(),
             entity_label_map: Default::default(),
-            collision_events_to_deal_with: Default::default(),
+            character_moves: Default::default(),
+            collider_index: Default::default(),
+            label_changes: Default::default(),
+            workers: None,
         }
     }
 
+    /// Steps the simulation once, solving islands in parallel on `workers`.
+    ///
+    /// Keep [`Self::entity_label_map`] up to date with [`Self::update_entity_labels`] beforehand.
     pub fn step(
         &mut self,
-        entity_label_map: HashMap<Entity, Label>,
         pipeline: &mut PhysicsPipeline,
+        workers: &PhysicsWorkers,
         physics_hooks: &dyn PhysicsHooks,
         event_handler: &dyn EventHandler,
     ) {
-        self.entity_label_map = entity_label_map;
-        pipeline.step(
-            Vector::new(self.gravity[0], self.gravity[1], self.gravity[2]), // a panic is deserved for those who don't specify a 3rd type in a vector array
-            &self.integration_parameters,
-            &mut self.islands,
-            &mut self.broad_phase,
-            &mut self.narrow_phase,
-            &mut self.bodies,
-            &mut self.colliders,
-            &mut self.impulse_joints,
-            &mut self.multibody_joints,
-            &mut self.ccd_solver,
-            physics_hooks,
-            event_handler,
-        );
+        puffin::profile_function!();
+        self.index_collider_entities();
+        self.workers = Some(workers.clone());
+        workers.install(|| {
+            pipeline.step(
+                Vector::new(self.gravity[0], self.gravity[1], self.gravity[2]), // a panic is deserved for those who don't specify a 3rd type in a vector array
+                &self.integration_parameters,
+                &mut self.islands,
+                &mut self.broad_phase,
+                &mut self.narrow_phase,
+                &mut self.bodies,
+                &mut self.colliders,
+                &mut self.impulse_joints,
+                &mut self.multibody_joints,
+                &mut self.ccd_solver,
+                physics_hooks,
+                event_handler,
+            )
+        });
+    }
+
+    /// Indexes the colliders registered since the last step, or everything after the label map
+    /// was rebuilt.
+    fn index_collider_entities(&mut self) {
+        let index = &mut self.collider_index;
+        if index.rebuild {
+            index.entities.clear();
+        } else if index.added.is_empty() {
+            return;
+        }
+
+        for (entity, label) in &self.entity_label_map {
+            if !index.rebuild && !index.added.contains(label) {
+                continue;
+            }
+            if let Some(handles) = self.colliders_entity_map.get(label) {
+                index
+                    .entities
+                    .extend(handles.iter().map(|(_, handle)| (*handle, *entity)));
+            }
+        }
+        index.added.clear();
+        index.rebuild = false;
+    }
+
+    /// The entity that owns the collider.
+    ///
+    /// Colliders registered since the last step are not indexed yet, so those fall back to
+    /// searching the label maps.
+    pub fn collider_entity(&self, handle: ColliderHandle) -> Option<Entity> {
+        if let Some(entity) = self.collider_index.entities.get(&handle) {
+            return Some(*entity);
+        }
+
+        let label = self.colliders_entity_map.iter().find_map(|(label, handles)| {
+            handles
+                .iter()
+                .any(|(_, h)| *h == handle)
+                .then_some(label)
+        })?;
+        self.entity_label_map
+            .iter()
+            .find_map(|(entity, l)| (l == label).then_some(*entity))
+    }
+
+    /// The entity that owns the rigid body labelled `label`, found through the body's colliders.
+    ///
+    /// Bodies without any indexed collider fall back to searching the label map.
+    pub fn body_entity(&self, label: &Label, body: &RigidBody) -> Option<Entity> {
+        if let Some(entity) = body
+            .colliders()
+            .iter()
+            .find_map(|handle| self.collider_index.entities.get(handle))
+        {
+            return Some(*entity);
+        }
+        self.entity_label_map
+            .iter()
+            .find_map(|(entity, l)| (l == label).then_some(*entity))
+    }
+
+    /// Brings [`Self::entity_label_map`] up to date with the label of every entity in `world`
+    /// that is not disabled, for passing to [`Self::step`].
+    ///
+    /// Only the entities whose [`Label`] or [`EntityStatus`] were marked as changed are looked
+    /// at. Everything is rescanned when entities gained or lost either component without it
+    /// being logged.
+    pub fn update_entity_labels(&mut self, world: &World) {
+        puffin::profile_function!();
+        let map = &mut self.entity_label_map;
+        let labels = self.label_changes.labels.changed(world);
+        let statuses = self.label_changes.statuses.changed(world);
+
+        match (labels, statuses) {
+            (Changes::Only(labels), Changes::Only(statuses)) => {
+                for entity in labels.iter().chain(statuses) {
+                    let old = map.get(entity).cloned();
+                    refresh_entity_label(world, map, *entity);
+                    let new = map.get(entity);
+                    if old.as_ref() != new {
+                        let colliders = &self.colliders_entity_map;
+                        self.collider_index
+                            .relabel(colliders, *entity, old.as_ref(), new);
+                    }
+                }
+            }
+            _ => {
+                rescan_entity_labels(world, map);
+                self.collider_index.rebuild = true;
+            }
+        }
     }
 
     pub fn register_rigidbody(&mut self, rigid_body: &rigidbody::RigidBody, transform: Transform) {
@@ -223,6 +485,9 @@ impl PhysicsState {
             .entry(collider_component.entity.clone())
             .or_insert_with(Vec::new)
             .push((handle.into_raw_parts().0, handle));
+        self.collider_index
+            .added
+            .insert(collider_component.entity.clone());
 
         handle
     }
@@ -230,6 +495,7 @@ impl PhysicsState {
     /// Remove all colliders associated with an entity
     pub fn remove_colliders(&mut self, entity: &Label) {
         if let Some(handles) = self.colliders_entity_map.remove(entity) {
+            self.collider_index.forget(&handles);
             for (_id, handle) in handles {
                 self.colliders
                     .remove(handle, &mut self.islands, &mut self.bodies, false);
@@ -249,7 +515,9 @@ impl PhysicsState {
                 false,
             );
         }
-        self.colliders_entity_map.remove(entity);
+        if let Some(handles) = self.colliders_entity_map.remove(entity) {
+            self.collider_index.forget(&handles);
+        }
     }
 }
 
@@ -258,3 +526,41 @@ impl Default for PhysicsState {
         Self::new()
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::change::mark_changed;
+
+    fn collider_for(physics: &mut PhysicsState, label: &str) -> ColliderHandle {
+        let mut collider = collider::Collider::new();
+        collider.entity = Label::new(label);
+        physics.register_collider(&collider)
+    }
+
+    #[test]
+    fn collider_index_follows_registration_and_labels() {
+        let mut world = World::new();
+        let entity = world.spawn((Label::new("a"),));
+        let mut physics = PhysicsState::new();
+        physics.update_entity_labels(&world);
+
+        let a = collider_for(&mut physics, "a");
+        let b = collider_for(&mut physics, "b");
+        physics.index_collider_entities();
+        assert_eq!(physics.collider_index.entities.get(&a), Some(&entity));
+        assert!(!physics.collider_index.entities.contains_key(&b));
+
+        // renaming the entity hands it the colliders of its new label
+        *world.get::<&mut Label>(entity).unwrap() = Label::new("b");
+        mark_changed::<Label>(entity);
+        physics.update_entity_labels(&world);
+        physics.index_collider_entities();
+        assert!(!physics.collider_index.entities.contains_key(&a));
+        assert_eq!(physics.collider_entity(b), Some(entity));
+        assert_eq!(physics.collider_entity(a), None);
+
+        physics.remove_colliders(&Label::new("b"));
+        assert!(physics.collider_index.entities.is_empty());
+    }
+}
@@ -25,6 +25,7 @@ use egui::{CollapsingHeader, ComboBox, Ui};
 use glam::{DQuat, Vec3};
 use hecs::{Entity, World};
 use rapier3d::prelude::ColliderBuilder;
+use rapier3d::prelude::SharedShape;
 use rapier3d::prelude::Vector;
 use serde::{Deserialize, Serialize};
 use std::sync::Arc;
@@ -483,6 +484,30 @@ pub enum ColliderShape {
     Cone { half_height: f32, radius: f32 },
 }
 
+impl ColliderShape {
+    /// The shape on its own, such as for casting it through the scene.
+    pub fn to_shared_shape(&self) -> SharedShape {
+        match *self {
+            ColliderShape::Box { half_extents } => {
+                SharedShape::cuboid(half_extents.x, half_extents.y, half_extents.z)
+            }
+            ColliderShape::Sphere { radius } => SharedShape::ball(radius),
+            ColliderShape::Capsule {
+                half_height,
+                radius,
+            } => SharedShape::capsule_y(half_height, radius),
+            ColliderShape::Cylinder {
+                half_height,
+                radius,
+            } => SharedShape::cylinder(half_height, radius),
+            ColliderShape::Cone {
+                half_height,
+                radius,
+            } => SharedShape::cone(half_height, radius),
+        }
+    }
+}
+
 impl Default for ColliderShape {
     fn default() -> Self {
         ColliderShape::Box {
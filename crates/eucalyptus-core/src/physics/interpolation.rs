@@ -0,0 +1,224 @@
+//! Blending of rendered poses between fixed physics steps.
+//!
+//! Physics is stepped at a fixed rate that rarely lines up with the frame rate, so a frame can
+//! land anywhere between two steps. Drawing bodies where the last step left them makes them
+//! stutter, so [`PoseHistory`] keeps the last two poses of each body and draws them blended by how
+//! far the frame is between the two steps.
+
+use crate::change::CHANGES;
+use dropbear_engine::entity::MeshRenderer;
+use glam::{DQuat, DVec3};
+use hecs::{Entity, World};
+use std::collections::HashMap;
+
+/// Where a rigid body was in world space after a physics step.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct PhysicsPose {
+    pub position: DVec3,
+    pub rotation: DQuat,
+}
+
+impl PhysicsPose {
+    pub fn new(position: DVec3, rotation: DQuat) -> Self {
+        Self { position, rotation }
+    }
+
+    /// The pose `alpha` of the way from `self` to `next`.
+    pub fn lerp(&self, next: &Self, alpha: f64) -> Self {
+        Self {
+            position: self.position.lerp(next.position, alpha),
+            rotation: self.rotation.slerp(next.rotation, alpha),
+        }
+    }
+}
+
+/// The previous and current pose of every rigid body, as of the last physics step.
+#[derive(Default)]
+pub struct PoseHistory {
+    poses: HashMap<Entity, (PhysicsPose, PhysicsPose)>,
+}
+
+impl PoseHistory {
+    /// Records the poses the last physics step left the bodies in. Whatever was current becomes
+    /// the previous pose, and bodies that are no longer stepped (or are asleep) are forgotten.
+    pub fn record(&mut self, poses: impl IntoIterator<Item = (Entity, PhysicsPose)>) {
+        let mut previous = std::mem::take(&mut self.poses);
+        self.poses = poses
+            .into_iter()
+            .map(|(entity, current)| {
+                let last = previous
+                    .remove(&entity)
+                    .map(|(_, last)| last)
+                    .unwrap_or(current);
+                (entity, (last, current))
+            })
+            .collect();
+    }
+
+    /// The pose `entity`'s body was left in by the last step it was recorded for.
+    pub fn current(&self, entity: Entity) -> Option<&PhysicsPose> {
+        self.poses.get(&entity).map(|(_, current)| current)
+    }
+
+    /// Forgets every pose, such as when the world is replaced.
+    pub fn clear(&mut self) {
+        self.poses.clear();
+    }
+
+    /// Moves the [`MeshRenderer`] of every body that moved in the last step from its current pose
+    /// back towards its previous one, so it is drawn `alpha` of the way between the two steps.
+    ///
+    /// This has to run after the renderers were updated from their transforms this frame.
+    pub fn apply(&self, world: &World, alpha: f32) {
+        puffin::profile_function!();
+        let alpha = alpha.clamp(0.0, 1.0) as f64;
+        let mut changes = CHANGES.lock();
+        for (entity, (previous, current)) in &self.poses {
+            if previous == current {
+                continue;
+            }
+            let Ok(mut renderer) = world.get::<&mut MeshRenderer>(*entity) else {
+                continue;
+            };
+
+            // the renderer can be offset from the body (and scaled), so the blend is applied as
+            // a correction of where the current pose put it
+            let blended = previous.lerp(current, alpha);
+            let correction = blended.rotation * current.rotation.inverse();
+            let position =
+                blended.position + correction * (renderer.instance.position - current.position);
+            let rotation = correction * renderer.instance.rotation;
+            renderer.set_render_pose(position, rotation);
+            changes.mark::<MeshRenderer>(*entity);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use dropbear_engine::asset::Handle;
+    use std::f64::consts::FRAC_PI_2;
+
+    const EPSILON: f64 = 1e-9;
+
+    fn pose(x: f64, yaw: f64) -> PhysicsPose {
+        PhysicsPose::new(DVec3::new(x, 0.0, 0.0), DQuat::from_rotation_y(yaw))
+    }
+
+    /// Spawns a renderer where the current pose of a body put it.
+    fn spawn_renderer(world: &mut World, at: &PhysicsPose) -> Entity {
+        let mut renderer = MeshRenderer::from_handle(Handle::NULL);
+        renderer.set_render_pose(at.position, at.rotation);
+        world.spawn((renderer,))
+    }
+
+    fn rendered(world: &World, entity: Entity) -> PhysicsPose {
+        let renderer = world.get::<&MeshRenderer>(entity).unwrap();
+        PhysicsPose::new(renderer.instance.position, renderer.instance.rotation)
+    }
+
+    /// The angle of the rotation from `a` to `b`.
+    fn angle(a: DQuat, b: DQuat) -> f64 {
+        2.0 * a.dot(b).abs().min(1.0).acos()
+    }
+
+    fn assert_pose_eq(actual: PhysicsPose, expected: PhysicsPose) {
+        assert!(
+            actual.position.abs_diff_eq(expected.position, EPSILON)
+                && actual.rotation.abs_diff_eq(expected.rotation, EPSILON),
+            "{actual:?} != {expected:?}"
+        );
+    }
+
+    #[test]
+    fn lerp_goes_from_one_pose_to_the_next() {
+        let (from, to) = (pose(0.0, 0.0), pose(10.0, FRAC_PI_2));
+        assert_pose_eq(from.lerp(&to, 0.0), from);
+        assert_pose_eq(from.lerp(&to, 0.5), pose(5.0, FRAC_PI_2 / 2.0));
+        assert_pose_eq(from.lerp(&to, 1.0), to);
+    }
+
+    #[test]
+    fn rotations_take_the_shortest_way_at_a_constant_rate() {
+        // 135 degrees either way are a quarter turn apart going the short way, through 180
+        let (from, to) = (
+            pose(0.0, 0.75 * std::f64::consts::PI),
+            pose(0.0, -0.75 * std::f64::consts::PI),
+        );
+        let halfway = from.lerp(&to, 0.5).rotation;
+        assert!(angle(halfway, DQuat::from_rotation_y(std::f64::consts::PI)) < 1e-6);
+
+        for alpha in [0.25, 0.5, 0.75] {
+            let blended = from.lerp(&to, alpha).rotation;
+            let travelled = angle(from.rotation, blended);
+            assert!((travelled - alpha * FRAC_PI_2).abs() < EPSILON);
+        }
+    }
+
+    #[test]
+    fn apply_draws_bodies_between_their_last_two_steps() {
+        let mut world = World::new();
+        let (previous, current) = (pose(0.0, 0.0), pose(4.0, FRAC_PI_2));
+        let entity = spawn_renderer(&mut world, &current);
+
+        let mut history = PoseHistory::default();
+        history.record([(entity, previous)]);
+        history.record([(entity, current)]);
+
+        for alpha in [0.0, 0.5, 1.0] {
+            // every frame starts from where the renderer update put the renderer
+            world
+                .get::<&mut MeshRenderer>(entity)
+                .unwrap()
+                .set_render_pose(current.position, current.rotation);
+            history.apply(&world, alpha as f32);
+            assert_pose_eq(rendered(&world, entity), previous.lerp(&current, alpha));
+        }
+    }
+
+    #[test]
+    fn apply_keeps_the_offset_of_the_renderer_from_its_body() {
+        let mut world = World::new();
+        let (previous, current) = (pose(0.0, 0.0), pose(0.0, FRAC_PI_2));
+        // the renderer sits one unit in front of the body
+        let offset = PhysicsPose::new(
+            current.position + current.rotation * DVec3::Z,
+            current.rotation,
+        );
+        let entity = spawn_renderer(&mut world, &offset);
+
+        let mut history = PoseHistory::default();
+        history.record([(entity, previous)]);
+        history.record([(entity, current)]);
+        history.apply(&world, 0.0);
+
+        assert_pose_eq(
+            rendered(&world, entity),
+            PhysicsPose::new(DVec3::Z, DQuat::IDENTITY),
+        );
+    }
+
+    #[test]
+    fn new_bodies_start_where_they_are_and_despawned_ones_are_forgotten() {
+        let mut world = World::new();
+        let current = pose(2.0, 0.0);
+        let stays = spawn_renderer(&mut world, &current);
+        let despawned = spawn_renderer(&mut world, &current);
+
+        let mut history = PoseHistory::default();
+        history.record([(stays, current), (despawned, pose(-2.0, 0.0))]);
+        assert_eq!(history.poses[&stays], (current, current));
+
+        // a body that was not stepped in the last step is no longer drawn blended
+        world.despawn(despawned).unwrap();
+        history.record([(stays, current)]);
+        assert!(!history.poses.contains_key(&despawned));
+
+        // applying to a body whose entity is gone does nothing rather than panic
+        history.record([(stays, current), (despawned, pose(-2.0, 0.0))]);
+        history.record([(stays, current), (despawned, pose(-4.0, 0.0))]);
+        history.apply(&world, 0.5);
+        assert_pose_eq(rendered(&world, stays), current);
+    }
+}
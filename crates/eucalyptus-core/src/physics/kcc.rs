@@ -5,15 +5,23 @@ use crate::component::{
     Component, ComponentDescriptor, DisabilityFlags, InspectableComponent, SerializedComponent,
 };
 use crate::physics::PhysicsState;
+use crate::physics::workers::PhysicsWorkers;
 use crate::states::Label;
+use crate::types::NVector3;
 use dropbear_engine::graphics::SharedGraphicsContext;
 use egui::{ComboBox, DragValue, Ui};
 use hecs::{Entity, World};
 use rapier3d::control::{
     CharacterAutostep, CharacterCollision, CharacterLength, KinematicCharacterController,
 };
+use rapier3d::dynamics::{RigidBodyHandle, RigidBodyType};
+use rapier3d::geometry::ColliderHandle;
 use rapier3d::na::{UnitVector3, Vector3};
+use rapier3d::pipeline::QueryFilter;
+use rapier3d::prelude::Vector;
+use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
 use std::sync::Arc;
 use glam::Vec3;
 
@@ -36,6 +44,16 @@ pub struct CharacterMovementResult {
     pub is_sliding_down_slope: bool,
 }
 
+/// A request from a script to move a character, queued on [`PhysicsState::character_moves`]
+/// until [`solve_character_moves`] runs.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct CharacterMove {
+    pub entity_id: u64,
+    pub translation: NVector3,
+    pub delta_time: f64,
+}
+
 #[typetag::serde]
 impl SerializedComponent for KCC {}
 
@@ -239,4 +257,207 @@ impl KCC {
             movement: None,
         }
     }
-}
\ No newline at end of file
+}
+
+/// A queued move with everything the solve needs looked up ahead of time.
+struct PreparedMove {
+    entity: Entity,
+    controller: KinematicCharacterController,
+    body: RigidBodyHandle,
+    collider: ColliderHandle,
+    translation: Vector,
+    delta_time: f32,
+}
+
+/// Keeps the last move queued for each character, in the order the characters were first moved,
+/// so that the moves are applied in the same order every run.
+fn latest_moves(requests: impl IntoIterator<Item = CharacterMove>) -> Vec<CharacterMove> {
+    let mut slots: HashMap<u64, usize> = HashMap::new();
+    let mut latest = Vec::new();
+    for request in requests {
+        match slots.get(&request.entity_id) {
+            Some(&slot) => latest[slot] = request,
+            None => {
+                slots.insert(request.entity_id, latest.len());
+                latest.push(request);
+            }
+        }
+    }
+    latest
+}
+
+/// Moves every character queued on [`PhysicsState::character_moves`] this tick.
+///
+/// The move-shape solves only read the scene, so they run in parallel on `workers` against the
+/// same broad phase. The results are then applied one after the other: the bodies are given their
+/// next kinematic position, [`KCC::movement`] and [`KCC::collisions`] are filled in, and the
+/// characters push whatever dynamic bodies they ran into.
+///
+/// A character moved more than once in a tick only keeps its last move. Each move starts from
+/// where the body was at the start of the tick, so the earlier moves would be overwritten anyway.
+pub fn solve_character_moves(
+    world: &World,
+    physics: &mut PhysicsState,
+    workers: &PhysicsWorkers,
+    dt: f32,
+) {
+    puffin::profile_function!();
+
+    for kcc in world.query::<&mut KCC>().iter() {
+        kcc.collisions.clear();
+    }
+
+    if physics.character_moves.is_empty() {
+        return;
+    }
+
+    let prepared: Vec<PreparedMove> = latest_moves(physics.character_moves.drain(..))
+        .into_iter()
+        .filter_map(|request| {
+            let entity = Entity::from_bits(request.entity_id)?;
+            let label = world.get::<&Label>(entity).ok()?;
+            let controller = world.get::<&KCC>(entity).ok()?.controller;
+            let body = physics.bodies_entity_map.get(&*label).copied()?;
+            if physics.bodies.get(body)?.body_type() != RigidBodyType::KinematicPositionBased {
+                log_once::debug_once!(
+                    "Character {} is not kinematic position based, so it is not moved",
+                    *label
+                );
+                return None;
+            }
+            let (_, collider) = physics
+                .colliders_entity_map
+                .get(&*label)?
+                .first()
+                .copied()?;
+            Some(PreparedMove {
+                entity,
+                controller,
+                body,
+                collider,
+                translation: Vector::new(
+                    request.translation.x as f32,
+                    request.translation.y as f32,
+                    request.translation.z as f32,
+                ),
+                delta_time: request.delta_time as f32,
+            })
+        })
+        .collect();
+
+    let solved: Vec<_> = {
+        puffin::profile_scope!("move shapes");
+        let physics = &*physics;
+        workers.install(|| {
+            prepared
+                .par_iter()
+                .map(|prepared| {
+                    let body = physics.bodies.get(prepared.body)?;
+                    let collider = physics.colliders.get(prepared.collider)?;
+                    let character_pos = match collider.position_wrt_parent() {
+                        Some(pos_wrt_parent) => *body.position() * *pos_wrt_parent,
+                        None => *collider.position(),
+                    };
+                    let query_pipeline = physics.broad_phase.as_query_pipeline(
+                        physics.narrow_phase.query_dispatcher(),
+                        &physics.bodies,
+                        &physics.colliders,
+                        QueryFilter::default()
+                            .exclude_rigid_body(prepared.body)
+                            .exclude_sensors(),
+                    );
+
+                    let mut collisions = Vec::new();
+                    let movement = prepared.controller.move_shape(
+                        prepared.delta_time,
+                        &query_pipeline,
+                        collider.shape(),
+                        &character_pos,
+                        prepared.translation,
+                        |collision| collisions.push(collision),
+                    );
+                    Some((movement, collisions))
+                })
+                .collect()
+        })
+    };
+
+    puffin::profile_scope!("apply character moves");
+    for (prepared, solved) in prepared.iter().zip(solved) {
+        let Some((movement, collisions)) = solved else {
+            continue;
+        };
+
+        if let Some(body) = physics.bodies.get_mut(prepared.body) {
+            let new_pos = body.translation() + movement.translation;
+            body.set_next_kinematic_translation(new_pos);
+        }
+
+        if !collisions.is_empty()
+            && let Some(collider) = physics.colliders.get(prepared.collider)
+        {
+            let character_shape = collider.shared_shape().clone();
+            let character_mass = if collider.mass() > 0.0 {
+                collider.mass()
+            } else {
+                1.0
+            };
+
+            let filter = QueryFilter::default()
+                .exclude_rigid_body(prepared.body)
+                .exclude_sensors();
+            let mut query_pipeline_mut = physics.broad_phase.as_query_pipeline_mut(
+                physics.narrow_phase.query_dispatcher(),
+                &mut physics.bodies,
+                &mut physics.colliders,
+                filter,
+            );
+            prepared.controller.solve_character_collision_impulses(
+                dt,
+                &mut query_pipeline_mut,
+                character_shape.as_ref(),
+                character_mass,
+                &collisions,
+            );
+        }
+
+        if let Ok(mut kcc) = world.get::<&mut KCC>(prepared.entity) {
+            kcc.movement = Some(CharacterMovementResult {
+                translation: movement.translation.into(),
+                grounded: movement.grounded,
+                is_sliding_down_slope: movement.is_sliding_down_slope,
+            });
+            kcc.collisions = collisions;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn request(entity_id: u64, x: f64) -> CharacterMove {
+        CharacterMove {
+            entity_id,
+            translation: NVector3::new(x, 0.0, 0.0),
+            delta_time: 1.0 / 60.0,
+        }
+    }
+
+    #[test]
+    fn the_last_move_wins_in_first_seen_order() {
+        let moves = latest_moves([
+            request(3, 1.0),
+            request(1, 2.0),
+            request(3, 3.0),
+            request(2, 4.0),
+            request(1, 5.0),
+        ]);
+
+        let order: Vec<(u64, f64)> = moves
+            .iter()
+            .map(|m| (m.entity_id, m.translation.x))
+            .collect();
+        assert_eq!(order, vec![(3, 3.0), (1, 5.0), (2, 4.0)]);
+    }
+}
@@ -0,0 +1,316 @@
+//! Simulation level of detail.
+//!
+//! Large levels can have far more dynamic bodies than anyone can see at once. [`SimulationLod`]
+//! puts the ones further than a set distance from every relevance anchor to sleep, so the solver
+//! skips them and they stay where they were left until an anchor comes back into range. Sleeping
+//! bodies are still there to collide with, and their velocities are given back when they wake.
+//!
+//! Anchors are the active camera, plus every entity with a [`SimulationAnchor`], such as the
+//! player or anything else that has to keep simulating while the camera looks elsewhere.
+
+use crate::component::{
+    Component, ComponentDescriptor, ComponentInitFuture, DisabilityFlags, InspectableComponent,
+    SerializedComponent,
+};
+use crate::entity_status::EntityStatus;
+use crate::physics::PhysicsState;
+use dropbear_engine::entity::EntityTransform;
+use dropbear_engine::graphics::SharedGraphicsContext;
+use egui::Ui;
+use hecs::{Entity, World};
+use rapier3d::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::sync::Arc;
+
+/// How much closer than the sleep distance an anchor has to come to wake a body back up, so
+/// bodies right at the edge do not flicker between the two.
+const WAKE_FRACTION: f32 = 0.9;
+
+/// The velocities a body had when it was put to sleep.
+struct FrozenBody {
+    linvel: Vector,
+    angvel: Vector,
+}
+
+fn default_enabled() -> bool {
+    true
+}
+
+/// Keeps the bodies around an entity simulating while [`SimulationLod`] is enabled, the same way
+/// the active camera does.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SimulationAnchor {
+    #[serde(default = "default_enabled")]
+    pub enabled: bool,
+}
+
+impl Default for SimulationAnchor {
+    fn default() -> Self {
+        Self { enabled: true }
+    }
+}
+
+#[typetag::serde]
+impl SerializedComponent for SimulationAnchor {}
+
+impl Component for SimulationAnchor {
+    type SerializedForm = Self;
+    type RequiredComponentTypes = (Self,);
+
+    fn descriptor() -> ComponentDescriptor {
+        ComponentDescriptor {
+            disabled_flags: DisabilityFlags::Disabled,
+            internal: false,
+            fqtn: "eucalyptus_core::physics::lod::SimulationAnchor".to_string(),
+            type_name: "SimulationAnchor".to_string(),
+            category: Some("Physics".to_string()),
+            description: Some(
+                "Keeps nearby bodies simulating when far from the camera".to_string(),
+            ),
+        }
+    }
+
+    fn init(
+        ser: &'_ Self::SerializedForm,
+        _: Arc<SharedGraphicsContext>,
+    ) -> ComponentInitFuture<'_, Self> {
+        Box::pin(async move { Ok((ser.clone(),)) })
+    }
+
+    fn update_component(
+        &mut self,
+        _world: &World,
+        _physics: &mut PhysicsState,
+        _entity: Entity,
+        _dt: f32,
+        _graphics: Arc<SharedGraphicsContext>,
+    ) {
+    }
+
+    fn save(&self, _world: &World, _entity: Entity) -> Box<dyn SerializedComponent> {
+        Box::new(self.clone())
+    }
+}
+
+impl InspectableComponent for SimulationAnchor {
+    fn inspect(
+        &mut self,
+        _world: &World,
+        entity: Entity,
+        ui: &mut Ui,
+        _graphics: Arc<SharedGraphicsContext>,
+    ) {
+        egui::CollapsingHeader::new("Simulation Anchor")
+            .default_open(true)
+            .id_salt(format!("Simulation Anchor {}", entity.to_bits()))
+            .show(ui, |ui| {
+                ui.checkbox(&mut self.enabled, "Enabled");
+            });
+    }
+}
+
+/// Puts dynamic bodies that are out of range of every anchor to sleep.
+#[derive(Default)]
+pub struct SimulationLod {
+    frozen: HashMap<RigidBodyHandle, FrozenBody>,
+    /// The anchors of the last update, kept to reuse the allocation.
+    anchors: Vec<Vector>,
+}
+
+impl SimulationLod {
+    /// The amount of bodies that are asleep because they are out of range.
+    pub fn frozen(&self) -> usize {
+        self.frozen.len()
+    }
+
+    /// Puts bodies further than `sleep_distance` from every anchor to sleep, and wakes the ones
+    /// that came back into range. With no distance or no anchors, every body is woken.
+    ///
+    /// The anchors are `extra_anchors` (typically the active camera) and every enabled
+    /// [`SimulationAnchor`] in `world`.
+    pub fn update(
+        &mut self,
+        physics: &mut PhysicsState,
+        world: &World,
+        extra_anchors: &[Vector],
+        sleep_distance: Option<f32>,
+    ) {
+        puffin::profile_function!();
+
+        let mut anchors = std::mem::take(&mut self.anchors);
+        anchors.clear();
+        anchors.extend_from_slice(extra_anchors);
+        collect_anchors(world, &mut anchors);
+        self.apply(physics, &anchors, sleep_distance);
+        self.anchors = anchors;
+    }
+
+    fn apply(
+        &mut self,
+        physics: &mut PhysicsState,
+        anchors: &[Vector],
+        sleep_distance: Option<f32>,
+    ) {
+        let Some(sleep_distance) = sleep_distance.filter(|_| !anchors.is_empty()) else {
+            self.wake_all(physics);
+            return;
+        };
+        let sleep_distance_sq = sleep_distance * sleep_distance;
+        let wake_distance_sq = sleep_distance_sq * WAKE_FRACTION * WAKE_FRACTION;
+
+        // only the bodies that change are fetched mutably, as rapier marks those as modified
+        let mut to_freeze = Vec::new();
+        let mut to_wake = Vec::new();
+        let mut to_resleep = Vec::new();
+        for (handle, body) in physics.bodies.iter() {
+            if !body.is_dynamic() || !body.is_enabled() {
+                continue;
+            }
+
+            let position = body.translation();
+            let distance_sq = anchors
+                .iter()
+                .map(|anchor| position.distance_squared(*anchor))
+                .fold(f32::INFINITY, f32::min);
+
+            if self.frozen.contains_key(&handle) {
+                if distance_sq < wake_distance_sq {
+                    to_wake.push(handle);
+                } else if !body.is_sleeping() {
+                    // something bumped into it, but it is still out of range
+                    to_resleep.push(handle);
+                }
+            } else if distance_sq > sleep_distance_sq {
+                to_freeze.push(handle);
+            }
+        }
+
+        for handle in to_freeze {
+            if let Some(body) = physics.bodies.get_mut(handle) {
+                self.frozen.insert(
+                    handle,
+                    FrozenBody {
+                        linvel: body.linvel().clone(),
+                        angvel: body.angvel().clone(),
+                    },
+                );
+                body.sleep();
+            }
+        }
+
+        for handle in to_resleep {
+            if let Some(body) = physics.bodies.get_mut(handle) {
+                body.sleep();
+            }
+        }
+
+        for handle in to_wake {
+            self.wake(physics, handle);
+        }
+
+        self.frozen
+            .retain(|handle, _| physics.bodies.contains(*handle));
+    }
+
+    fn wake(&mut self, physics: &mut PhysicsState, handle: RigidBodyHandle) {
+        let Some(frozen) = self.frozen.remove(&handle) else {
+            return;
+        };
+        if let Some(body) = physics.bodies.get_mut(handle) {
+            body.set_linvel(frozen.linvel, false);
+            body.set_angvel(frozen.angvel, false);
+            body.wake_up(true);
+        }
+    }
+
+    /// Wakes every body this put to sleep.
+    pub fn wake_all(&mut self, physics: &mut PhysicsState) {
+        let handles: Vec<RigidBodyHandle> = self.frozen.keys().copied().collect();
+        for handle in handles {
+            self.wake(physics, handle);
+        }
+    }
+
+    /// Forgets every body without waking them, such as when the physics state is replaced.
+    pub fn clear(&mut self) {
+        self.frozen.clear();
+    }
+}
+
+/// Adds the position of every enabled [`SimulationAnchor`] in `world` onto `anchors`.
+fn collect_anchors(world: &World, anchors: &mut Vec<Vector>) {
+    let mut query = world.query::<(&SimulationAnchor, &EntityTransform, Option<&EntityStatus>)>();
+    for (anchor, transform, status) in query.iter() {
+        if !anchor.enabled || status.is_some_and(|status| status.disabled) {
+            continue;
+        }
+        let position = transform.sync().position;
+        anchors.push(Vector::new(
+            position.x as f32,
+            position.y as f32,
+            position.z as f32,
+        ));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use dropbear_engine::entity::Transform;
+    use glam::DVec3;
+
+    fn at(x: f64) -> EntityTransform {
+        let mut transform = Transform::default();
+        transform.position = DVec3::new(x, 0.0, 0.0);
+        EntityTransform::new_from_world(transform)
+    }
+
+    #[test]
+    fn only_enabled_anchors_are_collected() {
+        let mut world = World::new();
+        world.spawn((SimulationAnchor::default(), at(1.0)));
+        world.spawn((SimulationAnchor { enabled: false }, at(2.0)));
+        world.spawn((
+            SimulationAnchor::default(),
+            at(3.0),
+            EntityStatus {
+                hidden: false,
+                disabled: true,
+            },
+        ));
+        // not an anchor at all
+        world.spawn((at(4.0),));
+
+        let mut anchors = Vec::new();
+        collect_anchors(&world, &mut anchors);
+        assert_eq!(anchors, vec![Vector::new(1.0, 0.0, 0.0)]);
+    }
+
+    #[test]
+    fn anchor_entities_keep_distant_bodies_awake() {
+        let mut physics = PhysicsState::new();
+        let far = physics
+            .bodies
+            .insert(RigidBodyBuilder::dynamic().translation(Vector::new(100.0, 0.0, 0.0)));
+        physics.bodies.insert(RigidBodyBuilder::dynamic());
+
+        let mut world = World::new();
+        let anchor = world.spawn((SimulationAnchor::default(), at(100.0)));
+
+        let camera = [Vector::new(0.0, 0.0, 0.0)];
+        let mut lod = SimulationLod::default();
+        lod.update(&mut physics, &world, &camera, Some(10.0));
+        assert_eq!(lod.frozen(), 0);
+
+        world.get::<&mut SimulationAnchor>(anchor).unwrap().enabled = false;
+        lod.update(&mut physics, &world, &camera, Some(10.0));
+        assert_eq!(lod.frozen(), 1);
+        assert!(physics.bodies[far].is_sleeping());
+
+        world.get::<&mut SimulationAnchor>(anchor).unwrap().enabled = true;
+        lod.update(&mut physics, &world, &camera, Some(10.0));
+        assert_eq!(lod.frozen(), 0);
+        assert!(!physics.bodies[far].is_sleeping());
+    }
+}
@@ -0,0 +1,467 @@
+//! Batched scene queries.
+//!
+//! AI line of sight checks and weapon traces can fire thousands of rays in one tick, so rather
+//! than being asked one at a time, the queries here take a whole batch. The batch is split across
+//! the [`PhysicsWorkers`](crate::physics::workers::PhysicsWorkers) of the last step (or the global
+//! rayon pool before the first step), with every task querying the same broad phase, and the hits
+//! are returned in one flat list where each hit is tagged with the index of the query that made it.
+
+use crate::physics::PhysicsState;
+use crate::physics::collider::ColliderShape;
+use crate::types::{
+    IndexNative, NCollider, NQueryFilter, NQueryHit, NRay, NShapeCastHit, NShapeQueryHit, NVector3,
+};
+use hecs::Entity;
+use rapier3d::parry::query::ShapeCastOptions;
+use rapier3d::prelude::*;
+use rayon::prelude::*;
+
+/// The fewest queries handed to one rayon task, as a task costs more than a few rays.
+const MIN_QUERIES_PER_TASK: usize = 32;
+
+impl PhysicsState {
+    /// The collider as handed to scripts, with the entity that owns it.
+    pub fn collider_ffi(&self, handle: ColliderHandle) -> NCollider {
+        let (index, generation) = handle.into_raw_parts();
+        let entity = self.collider_entity(handle).unwrap_or(Entity::DANGLING);
+        NCollider {
+            index: IndexNative { index, generation },
+            entity_id: entity.to_bits().get(),
+            id: index,
+        }
+    }
+}
+
+impl NShapeCastHit {
+    pub fn from_rapier(collider: NCollider, hit: &rapier3d::parry::query::ShapeCastHit) -> Self {
+        Self {
+            collider,
+            distance: hit.time_of_impact as f64,
+            witness1: NVector3::from([hit.witness1.x, hit.witness1.y, hit.witness1.z]),
+            witness2: NVector3::from([hit.witness2.x, hit.witness2.y, hit.witness2.z]),
+            normal1: NVector3::from([hit.normal1.x, hit.normal1.y, hit.normal1.z]),
+            normal2: NVector3::from([hit.normal2.x, hit.normal2.y, hit.normal2.z]),
+            status: hit.status.into(),
+        }
+    }
+}
+
+/// The unit direction of `direction`, or `None` if it has no length.
+fn unit(direction: &NVector3) -> Option<Vector> {
+    let direction = Vector::new(direction.x as f32, direction.y as f32, direction.z as f32);
+    let length = direction.length();
+    (length > f32::EPSILON).then(|| direction / length)
+}
+
+fn translation(position: &NVector3) -> Pose3 {
+    nalgebra::Isometry3::translation(position.x as f32, position.y as f32, position.z as f32).into()
+}
+
+/// Runs `query` on every item of `items` in parallel and flattens the hits, in order.
+fn batch<T, H, I>(
+    physics: &PhysicsState,
+    items: &[T],
+    filter: &NQueryFilter,
+    query: impl Fn(&QueryPipeline<'_>, u32, &T) -> I + Sync + Send,
+) -> Vec<H>
+where
+    T: Sync,
+    H: Send,
+    I: IntoIterator<Item = H>,
+{
+    puffin::profile_function!();
+    let groups = *filter;
+    // collision groups are compared by hand, so they do not depend on how rapier packs them
+    let in_groups = move |_: ColliderHandle, collider: &Collider| {
+        let collider_groups = collider.collision_groups();
+        (collider_groups.memberships.bits() & groups.filter) != 0
+            && (groups.memberships & collider_groups.filter.bits()) != 0
+    };
+    let excluded_body = Entity::from_bits(filter.exclude_entity)
+        .and_then(|entity| physics.entity_label_map.get(&entity))
+        .and_then(|label| physics.bodies_entity_map.get(label))
+        .copied();
+
+    let mut flags = QueryFilterFlags::empty();
+    flags.set(QueryFilterFlags::EXCLUDE_SENSORS, filter.exclude_sensors);
+    flags.set(QueryFilterFlags::EXCLUDE_FIXED, filter.exclude_fixed);
+    flags.set(QueryFilterFlags::EXCLUDE_DYNAMIC, filter.exclude_dynamic);
+    flags.set(
+        QueryFilterFlags::EXCLUDE_KINEMATIC,
+        filter.exclude_kinematic,
+    );
+
+    let run = || -> Vec<H> {
+        items
+            .par_iter()
+            .enumerate()
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .map_init(
+                || {
+                    let mut query_filter = QueryFilter::from(flags).predicate(&in_groups);
+                    if let Some(body) = excluded_body {
+                        query_filter = query_filter.exclude_rigid_body(body);
+                    }
+                    physics.broad_phase.as_query_pipeline(
+                        physics.narrow_phase.query_dispatcher(),
+                        &physics.bodies,
+                        &physics.colliders,
+                        query_filter,
+                    )
+                },
+                |pipeline, (i, item)| {
+                    query(pipeline, i as u32, item)
+                        .into_iter()
+                        .collect::<Vec<_>>()
+                },
+            )
+            .flat_map_iter(|hits| hits)
+            .collect()
+    };
+
+    // kept off the global pool, which the job system and everything else share
+    match &physics.workers {
+        Some(workers) => workers.install(run),
+        None => run(),
+    }
+}
+
+/// Casts every ray and returns the closest hit of each, or every hit of each (closest first) when
+/// `all_hits` is set. `solid` rays hit the shape they start inside of.
+pub fn cast_rays(
+    physics: &PhysicsState,
+    rays: &[NRay],
+    filter: &NQueryFilter,
+    solid: bool,
+    all_hits: bool,
+) -> Vec<NQueryHit> {
+    batch(physics, rays, filter, |pipeline, query, ray| {
+        let Some(direction) = unit(&ray.direction) else {
+            return Vec::new();
+        };
+        let origin = Vector::new(
+            ray.origin.x as f32,
+            ray.origin.y as f32,
+            ray.origin.z as f32,
+        );
+        let ray_shape = Ray::new(origin, direction);
+        let max_distance = ray.max_distance as f32;
+
+        let hit = |handle: ColliderHandle, distance: f32| NQueryHit {
+            query,
+            collider: physics.collider_ffi(handle),
+            distance: distance as f64,
+        };
+
+        if all_hits {
+            let mut hits: Vec<NQueryHit> = pipeline
+                .intersect_ray(ray_shape, max_distance, solid)
+                .map(|(handle, _, intersection)| hit(handle, intersection.time_of_impact))
+                .collect();
+            hits.sort_by(|a, b| a.distance.total_cmp(&b.distance));
+            hits
+        } else {
+            pipeline
+                .cast_ray(&ray_shape, max_distance, solid)
+                .map(|(handle, distance)| hit(handle, distance))
+                .into_iter()
+                .collect()
+        }
+    })
+}
+
+/// Sweeps `shape` along every ray and returns the first hit of each. `solid` casts stop at shapes
+/// they start inside of.
+pub fn cast_shapes(
+    physics: &PhysicsState,
+    shape: &ColliderShape,
+    casts: &[NRay],
+    filter: &NQueryFilter,
+    solid: bool,
+) -> Vec<NShapeQueryHit> {
+    let shape = shape.to_shared_shape();
+    batch(physics, casts, filter, |pipeline, query, cast| {
+        let direction = unit(&cast.direction)?;
+        let options = ShapeCastOptions {
+            max_time_of_impact: cast.max_distance as f32,
+            target_distance: 0.0,
+            stop_at_penetration: solid,
+            compute_impact_geometry_on_penetration: true,
+        };
+
+        let (handle, hit) = pipeline.cast_shape(
+            &translation(&cast.origin),
+            direction,
+            shape.as_ref(),
+            options,
+        )?;
+        Some(NShapeQueryHit {
+            query,
+            hit: NShapeCastHit::from_rapier(physics.collider_ffi(handle), &hit),
+        })
+    })
+}
+
+/// Places `shape` at every position and returns every collider it overlaps.
+pub fn overlap_shapes(
+    physics: &PhysicsState,
+    shape: &ColliderShape,
+    positions: &[NVector3],
+    filter: &NQueryFilter,
+) -> Vec<NQueryHit> {
+    let shape = shape.to_shared_shape();
+    batch(physics, positions, filter, |pipeline, query, position| {
+        pipeline
+            .intersect_shape(translation(position), shape.as_ref())
+            .map(|(handle, _)| NQueryHit {
+                query,
+                collider: physics.collider_ffi(handle),
+                distance: 0.0,
+            })
+            .collect::<Vec<_>>()
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::physics::collider::Collider;
+    use crate::physics::rigidbody::{RigidBody, RigidBodyMode};
+    use crate::physics::workers::PhysicsWorkers;
+    use crate::states::Label;
+    use dropbear_engine::entity::Transform;
+    use glam::{DVec3, Vec3};
+    use hecs::World;
+
+    /// Unit boxes along +X, each owned by an entity of its own.
+    struct Walls {
+        physics: PhysicsState,
+        /// At x = 2.
+        near: Entity,
+        /// At x = 4, and only a member of the second collision group.
+        grouped: Entity,
+        /// At x = 6, on a rigid body so that it can be excluded.
+        body: Entity,
+        /// At x = 8.
+        far: Entity,
+    }
+
+    impl Walls {
+        fn new() -> Self {
+            let mut world = World::new();
+            let mut physics = PhysicsState::new();
+            physics.gravity = [0.0; 3];
+
+            let mut wall = |name: &str, x: f32| {
+                let entity = world.spawn((Label::new(name),));
+                let mut collider = Collider::new();
+                collider.entity = Label::new(name);
+                collider.shape = ColliderShape::Box {
+                    half_extents: Vec3::splat(0.5),
+                };
+                collider.translation = [x, 0.0, 0.0];
+                (entity, collider)
+            };
+            let (near, near_collider) = wall("near", 2.0);
+            let (grouped, grouped_collider) = wall("grouped", 4.0);
+            let (body, mut body_collider) = wall("body", 6.0);
+            let (far, far_collider) = wall("far", 8.0);
+
+            // the body carries the collider, which sits at its origin
+            body_collider.translation = [0.0; 3];
+            let rigid_body = RigidBody {
+                entity: Label::new("body"),
+                mode: RigidBodyMode::Fixed,
+                ..Default::default()
+            };
+            let mut transform = Transform::default();
+            transform.position = DVec3::new(6.0, 0.0, 0.0);
+            physics.register_rigidbody(&rigid_body, transform);
+
+            for collider in [&near_collider, &body_collider, &far_collider] {
+                physics.register_collider(collider);
+            }
+            let handle = physics.register_collider(&grouped_collider);
+            physics.colliders[handle].set_collision_groups(InteractionGroups {
+                memberships: Group::GROUP_2,
+                filter: Group::ALL,
+                ..InteractionGroups::all()
+            });
+
+            // a step puts the colliders into the broad phase and indexes their entities, and
+            // enough workers make sure that a batch really is split up
+            physics.update_entity_labels(&world);
+            let workers = PhysicsWorkers::new(Some(4), None).unwrap();
+            physics.step(&mut PhysicsPipeline::new(), &workers, &(), &());
+
+            Self {
+                physics,
+                near,
+                grouped,
+                body,
+                far,
+            }
+        }
+    }
+
+    fn ray(origin: f64, direction: f64) -> NRay {
+        NRay {
+            origin: NVector3::new(origin, 0.0, 0.0),
+            direction: NVector3::new(direction, 0.0, 0.0),
+            max_distance: 100.0,
+        }
+    }
+
+    fn entity_of(collider: &NCollider) -> Entity {
+        Entity::from_bits(collider.entity_id).unwrap()
+    }
+
+    fn entities(hits: &[NQueryHit]) -> Vec<Entity> {
+        hits.iter().map(|hit| entity_of(&hit.collider)).collect()
+    }
+
+    /// Only hits colliders in the first collision group, which leaves out `grouped`.
+    fn first_group() -> NQueryFilter {
+        NQueryFilter {
+            filter: Group::GROUP_1.bits(),
+            ..Default::default()
+        }
+    }
+
+    fn excluding(entity: Entity) -> NQueryFilter {
+        NQueryFilter {
+            exclude_entity: entity.to_bits().get(),
+            ..Default::default()
+        }
+    }
+
+    #[test]
+    fn all_ray_hits_are_closest_first() {
+        let walls = Walls::new();
+        let hits = cast_rays(
+            &walls.physics,
+            &[ray(0.0, 1.0)],
+            &NQueryFilter::default(),
+            true,
+            true,
+        );
+
+        assert_eq!(
+            entities(&hits),
+            vec![walls.near, walls.grouped, walls.body, walls.far]
+        );
+        let distances: Vec<f64> = hits.iter().map(|hit| hit.distance).collect();
+        for (distance, expected) in distances.iter().zip([1.5, 3.5, 5.5, 7.5]) {
+            assert!((distance - expected).abs() < 1e-4);
+        }
+
+        // from the other end, the closest is the far wall
+        let closest = cast_rays(
+            &walls.physics,
+            &[ray(20.0, -1.0)],
+            &NQueryFilter::default(),
+            true,
+            false,
+        );
+        assert_eq!(entities(&closest), vec![walls.far]);
+        assert!((closest[0].distance - 11.5).abs() < 1e-4);
+    }
+
+    #[test]
+    fn rays_skip_other_groups_and_the_excluded_entity() {
+        let walls = Walls::new();
+        let rays = [ray(0.0, 1.0)];
+
+        let hits = cast_rays(&walls.physics, &rays, &first_group(), true, true);
+        assert_eq!(entities(&hits), vec![walls.near, walls.body, walls.far]);
+
+        let hits = cast_rays(&walls.physics, &rays, &excluding(walls.body), true, true);
+        assert_eq!(entities(&hits), vec![walls.near, walls.grouped, walls.far]);
+
+        // the closest hit behind the excluded entity is the next wall along
+        let rays = [ray(5.0, 1.0)];
+        let hits = cast_rays(&walls.physics, &rays, &excluding(walls.body), true, false);
+        assert_eq!(entities(&hits), vec![walls.far]);
+    }
+
+    #[test]
+    fn hits_keep_their_query_index_across_parallel_tasks() {
+        let walls = Walls::new();
+        // ray `i` starts `i` further back, and every third ray has no direction and hits nothing
+        let rays: Vec<NRay> = (0..200)
+            .map(|i| ray(-(i as f64), if i % 3 == 0 { 0.0 } else { 1.0 }))
+            .collect();
+
+        let hits = cast_rays(&walls.physics, &rays, &NQueryFilter::default(), true, false);
+        let expected: Vec<u32> = (0..200).filter(|i| i % 3 != 0).collect();
+        assert_eq!(
+            hits.iter().map(|hit| hit.query).collect::<Vec<_>>(),
+            expected
+        );
+        for hit in &hits {
+            assert_eq!(entity_of(&hit.collider), walls.near);
+            assert!((hit.distance - (1.5 + hit.query as f64)).abs() < 1e-3);
+        }
+    }
+
+    #[test]
+    fn shape_casts_stop_at_the_first_allowed_wall() {
+        let walls = Walls::new();
+        let sphere = ColliderShape::Sphere { radius: 0.25 };
+        let casts = [ray(0.0, 1.0), ray(0.0, 0.0), ray(20.0, -1.0)];
+
+        let hits = cast_shapes(
+            &walls.physics,
+            &sphere,
+            &casts,
+            &NQueryFilter::default(),
+            true,
+        );
+        let found: Vec<(u32, Entity)> = hits
+            .iter()
+            .map(|hit| (hit.query, entity_of(&hit.hit.collider)))
+            .collect();
+        assert_eq!(found, vec![(0, walls.near), (2, walls.far)]);
+        assert!((hits[0].hit.distance - 1.25).abs() < 1e-3);
+
+        // starting between the first two walls, the grouped one is skipped over
+        let casts = [ray(3.0, 1.0)];
+        let hits = cast_shapes(&walls.physics, &sphere, &casts, &first_group(), true);
+        assert_eq!(entity_of(&hits[0].hit.collider), walls.body);
+
+        let casts = [ray(5.0, 1.0)];
+        let hits = cast_shapes(&walls.physics, &sphere, &casts, &excluding(walls.body), true);
+        assert_eq!(entity_of(&hits[0].hit.collider), walls.far);
+    }
+
+    #[test]
+    fn overlaps_are_tagged_with_their_position() {
+        let walls = Walls::new();
+        let sphere = ColliderShape::Sphere { radius: 0.25 };
+        let positions: Vec<NVector3> = [2.0, 3.0, 4.0, 6.0, 8.0]
+            .into_iter()
+            .map(|x| NVector3::new(x, 0.0, 0.0))
+            .collect();
+
+        let hits = overlap_shapes(&walls.physics, &sphere, &positions, &NQueryFilter::default());
+        let found: Vec<(u32, Entity)> = hits
+            .iter()
+            .map(|hit| (hit.query, entity_of(&hit.collider)))
+            .collect();
+        assert_eq!(
+            found,
+            vec![
+                (0, walls.near),
+                (2, walls.grouped),
+                (3, walls.body),
+                (4, walls.far)
+            ]
+        );
+
+        let hits = overlap_shapes(&walls.physics, &sphere, &positions, &first_group());
+        assert!(!entities(&hits).contains(&walls.grouped));
+        let hits = overlap_shapes(&walls.physics, &sphere, &positions, &excluding(walls.body));
+        assert!(!entities(&hits).contains(&walls.body));
+        assert_eq!(hits.len(), 3);
+    }
+}
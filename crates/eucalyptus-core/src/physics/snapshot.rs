@@ -0,0 +1,411 @@
+//! Per-tick snapshots of the simulation, for rollback and replays.
+//!
+//! Serialising [`PhysicsState`] with serde is far too slow to do every tick, so a
+//! [`SnapshotRing`] keeps the last few ticks in memory instead. The rapier sets are generational
+//! arenas, so a clone of them is a handful of vector copies, and restoring one puts back every
+//! bit of state the solver reads (contacts, islands and the broad phase included), which keeps a
+//! re-simulation deterministic.
+//!
+//! The components scripts own, [`EntityTransform`] and [`CustomProperties`], are stored as deltas
+//! against the tick before, as most entities do not change between two ticks.
+
+use crate::change::mark_changed;
+use crate::physics::PhysicsState;
+use crate::properties::CustomProperties;
+use dropbear_engine::entity::EntityTransform;
+use hecs::{Component, Entity, World};
+use std::collections::{HashMap, HashSet};
+
+/// The components of one type that changed since the tick before.
+struct ComponentDelta<T> {
+    /// Whether this holds every component rather than the changes, which is always true for the
+    /// oldest snapshot in the ring.
+    keyframe: bool,
+    changed: Vec<(Entity, T)>,
+    removed: Vec<Entity>,
+}
+
+impl<T> ComponentDelta<T> {
+    fn new() -> Self {
+        Self {
+            keyframe: false,
+            changed: Vec::new(),
+            removed: Vec::new(),
+        }
+    }
+
+    fn clear(&mut self) {
+        self.keyframe = false;
+        self.changed.clear();
+        self.removed.clear();
+    }
+
+    fn apply_to(&self, state: &mut HashMap<Entity, T>)
+    where
+        T: Clone,
+    {
+        if self.keyframe {
+            state.clear();
+        }
+        for entity in &self.removed {
+            state.remove(entity);
+        }
+        state.extend(self.changed.iter().cloned());
+    }
+}
+
+/// Tracks one component type across snapshots.
+struct ComponentTrack<T> {
+    /// The components as of the newest snapshot, which new snapshots are compared against.
+    latest: HashMap<Entity, T>,
+    seen: HashSet<Entity>,
+}
+
+impl<T: Component + Clone + PartialEq> ComponentTrack<T> {
+    fn new() -> Self {
+        Self {
+            latest: HashMap::new(),
+            seen: HashSet::new(),
+        }
+    }
+
+    /// Writes whatever changed since the last capture into `delta`, cloning only the changes.
+    fn capture(&mut self, world: &World, delta: &mut ComponentDelta<T>) {
+        self.seen.clear();
+        for (entity, component) in world.query::<(Entity, &T)>().iter() {
+            self.seen.insert(entity);
+            match self.latest.get_mut(&entity) {
+                Some(latest) if latest == component => {}
+                Some(latest) => {
+                    latest.clone_from(component);
+                    delta.changed.push((entity, component.clone()));
+                }
+                None => {
+                    self.latest.insert(entity, component.clone());
+                    delta.changed.push((entity, component.clone()));
+                }
+            }
+        }
+
+        let seen = &self.seen;
+        self.latest.retain(|entity, _| {
+            let keep = seen.contains(entity);
+            if !keep {
+                delta.removed.push(*entity);
+            }
+            keep
+        });
+    }
+
+    /// Writes `state` back onto the entities that still have the component, and marks the ones
+    /// that differed as changed.
+    fn restore(&mut self, world: &World, state: HashMap<Entity, T>) {
+        for (entity, component) in &state {
+            if let Ok(mut current) = world.get::<&mut T>(*entity)
+                && *current != *component
+            {
+                current.clone_from(component);
+                mark_changed::<T>(*entity);
+            }
+        }
+        self.latest = state;
+    }
+}
+
+/// Folds `older` into `newer`, so `newer` holds everything and `older` can be dropped.
+fn rebase<T: Clone>(older: &mut ComponentDelta<T>, newer: &mut ComponentDelta<T>) {
+    let mut state: HashMap<Entity, T> = older.changed.drain(..).collect();
+    newer.apply_to(&mut state);
+    newer.keyframe = true;
+    newer.changed.clear();
+    newer.changed.extend(state);
+    newer.removed.clear();
+}
+
+/// The simulation as it was after one tick.
+struct WorldSnapshot {
+    tick: u64,
+    physics: PhysicsState,
+    transforms: ComponentDelta<EntityTransform>,
+    properties: ComponentDelta<CustomProperties>,
+}
+
+/// A fixed amount of [`WorldSnapshot`]s, where capturing a new one overwrites the oldest.
+///
+/// Snapshots are only restored onto entities that still exist; entities spawned or despawned
+/// since are left alone.
+pub struct SnapshotRing {
+    /// Oldest first once [`Self::capacity`] is reached, starting at `start`.
+    slots: Vec<WorldSnapshot>,
+    start: usize,
+    capacity: usize,
+    transforms: ComponentTrack<EntityTransform>,
+    properties: ComponentTrack<CustomProperties>,
+}
+
+impl SnapshotRing {
+    /// Creates a ring that holds the last `capacity` ticks (at least one).
+    pub fn new(capacity: usize) -> Self {
+        let capacity = capacity.max(1);
+        Self {
+            slots: Vec::with_capacity(capacity),
+            start: 0,
+            capacity,
+            transforms: ComponentTrack::new(),
+            properties: ComponentTrack::new(),
+        }
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    pub fn len(&self) -> usize {
+        self.slots.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.slots.is_empty()
+    }
+
+    /// The ticks that can be restored, oldest first.
+    pub fn ticks(&self) -> impl Iterator<Item = u64> + '_ {
+        (0..self.slots.len()).map(|i| self.slot(i).tick)
+    }
+
+    fn index(&self, i: usize) -> usize {
+        (self.start + i) % self.slots.len()
+    }
+
+    fn slot(&self, i: usize) -> &WorldSnapshot {
+        &self.slots[self.index(i)]
+    }
+
+    /// Stores the state of the simulation after `tick`, overwriting the oldest snapshot when the
+    /// ring is full.
+    pub fn capture(&mut self, tick: u64, physics: &PhysicsState, world: &World) {
+        puffin::profile_function!();
+
+        let slot = if self.slots.len() < self.capacity {
+            self.slots.push(WorldSnapshot {
+                tick,
+                physics: physics.clone(),
+                transforms: ComponentDelta::new(),
+                properties: ComponentDelta::new(),
+            });
+            self.slots.len() - 1
+        } else {
+            // the oldest snapshot is reused, so the one after it becomes the keyframe
+            let oldest = self.start;
+            let next = (oldest + 1) % self.capacity;
+            if next != oldest {
+                let (older, newer) = pair_mut(&mut self.slots, oldest, next);
+                rebase(&mut older.transforms, &mut newer.transforms);
+                rebase(&mut older.properties, &mut newer.properties);
+            }
+            self.start = next;
+
+            let snapshot = &mut self.slots[oldest];
+            snapshot.tick = tick;
+            snapshot.physics.clone_from(physics);
+            snapshot.transforms.clear();
+            snapshot.properties.clear();
+            oldest
+        };
+
+        let first = self.slots.len() == 1;
+        let snapshot = &mut self.slots[slot];
+        if first {
+            // nothing to compare against, so everything is captured
+            self.transforms.latest.clear();
+            self.properties.latest.clear();
+            snapshot.transforms.keyframe = true;
+            snapshot.properties.keyframe = true;
+        }
+        self.transforms.capture(world, &mut snapshot.transforms);
+        self.properties.capture(world, &mut snapshot.properties);
+    }
+
+    /// Puts the simulation back to how it was after `tick`, and forgets every snapshot after it
+    /// so the ticks can be simulated again.
+    pub fn restore(
+        &mut self,
+        tick: u64,
+        physics: &mut PhysicsState,
+        world: &World,
+    ) -> anyhow::Result<()> {
+        puffin::profile_function!();
+
+        let Some(position) = (0..self.slots.len()).find(|i| self.slot(*i).tick == tick) else {
+            anyhow::bail!("No snapshot of tick {} was captured", tick);
+        };
+
+        let mut transforms = HashMap::new();
+        let mut properties = HashMap::new();
+        for i in 0..=position {
+            let snapshot = self.slot(i);
+            snapshot.transforms.apply_to(&mut transforms);
+            snapshot.properties.apply_to(&mut properties);
+        }
+
+        physics.clone_from(&self.slot(position).physics);
+        self.transforms.restore(world, transforms);
+        self.properties.restore(world, properties);
+
+        self.truncate(position + 1);
+        Ok(())
+    }
+
+    /// Keeps only the oldest `len` snapshots.
+    fn truncate(&mut self, len: usize) {
+        if len >= self.slots.len() {
+            return;
+        }
+        self.slots.rotate_left(self.start);
+        self.start = 0;
+        self.slots.truncate(len);
+    }
+
+    /// Forgets every snapshot, such as when the scene is replaced.
+    pub fn clear(&mut self) {
+        self.slots.clear();
+        self.start = 0;
+        self.transforms.latest.clear();
+        self.properties.latest.clear();
+    }
+}
+
+/// Mutable references to two different elements of `slice`.
+fn pair_mut<T>(slice: &mut [T], a: usize, b: usize) -> (&mut T, &mut T) {
+    debug_assert_ne!(a, b);
+    if a < b {
+        let (left, right) = slice.split_at_mut(b);
+        (&mut left[a], &mut right[0])
+    } else {
+        let (left, right) = slice.split_at_mut(a);
+        (&mut right[0], &mut left[b])
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use dropbear_engine::entity::Transform;
+    use glam::DVec3;
+
+    fn transform(x: f64) -> EntityTransform {
+        let mut transform = Transform::default();
+        transform.position = DVec3::new(x, 0.0, 0.0);
+        EntityTransform::new_from_world(transform)
+    }
+
+    fn x_of(world: &World, entity: Entity) -> f64 {
+        world
+            .get::<&EntityTransform>(entity)
+            .unwrap()
+            .world()
+            .position
+            .x
+    }
+
+    /// Captures ticks `0..ticks`, where `a` moves every tick and `b` only on even ticks.
+    fn simulate(ticks: u64, ring: &mut SnapshotRing) -> (World, PhysicsState, Entity, Entity) {
+        let mut world = World::new();
+        let a = world.spawn((transform(0.0),));
+        let b = world.spawn((transform(0.0),));
+        let mut physics = PhysicsState::new();
+
+        for tick in 0..ticks {
+            *world.get::<&mut EntityTransform>(a).unwrap() = transform(tick as f64);
+            if tick % 2 == 0 {
+                *world.get::<&mut EntityTransform>(b).unwrap() = transform(tick as f64);
+            }
+            physics.gravity[0] = tick as f32;
+            ring.capture(tick, &physics, &world);
+        }
+
+        (world, physics, a, b)
+    }
+
+    #[test]
+    fn capturing_past_capacity_drops_the_oldest_ticks() {
+        let mut ring = SnapshotRing::new(3);
+        let (world, mut physics, ..) = simulate(7, &mut ring);
+
+        assert_eq!(ring.len(), 3);
+        assert_eq!(ring.ticks().collect::<Vec<_>>(), vec![4, 5, 6]);
+        assert!(ring.restore(3, &mut physics, &world).is_err());
+    }
+
+    #[test]
+    fn restoring_the_oldest_tick_after_wrapping() {
+        let mut ring = SnapshotRing::new(3);
+        let (world, mut physics, a, b) = simulate(7, &mut ring);
+
+        ring.restore(4, &mut physics, &world).unwrap();
+        assert_eq!(x_of(&world, a), 4.0);
+        assert_eq!(x_of(&world, b), 4.0);
+        assert_eq!(physics.gravity[0], 4.0);
+        assert_eq!(ring.ticks().collect::<Vec<_>>(), vec![4]);
+    }
+
+    #[test]
+    fn restoring_the_newest_tick_after_wrapping() {
+        let mut ring = SnapshotRing::new(3);
+        let (world, mut physics, a, b) = simulate(8, &mut ring);
+
+        // move everything on without capturing, as a re-simulation would
+        *world.get::<&mut EntityTransform>(a).unwrap() = transform(100.0);
+        *world.get::<&mut EntityTransform>(b).unwrap() = transform(100.0);
+        physics.gravity[0] = 100.0;
+
+        ring.restore(7, &mut physics, &world).unwrap();
+        // `b` did not change on tick 7, so it comes from the delta of tick 6
+        assert_eq!(x_of(&world, a), 7.0);
+        assert_eq!(x_of(&world, b), 6.0);
+        assert_eq!(physics.gravity[0], 7.0);
+        assert_eq!(ring.ticks().collect::<Vec<_>>(), vec![5, 6, 7]);
+    }
+
+    #[test]
+    fn restored_components_are_marked_changed() {
+        // a type of its own, as the change log is shared between tests
+        #[derive(Clone, PartialEq)]
+        struct Tracked(u32);
+
+        let mut world = World::new();
+        let moved = world.spawn((Tracked(0),));
+        // left as it was captured, so restoring it writes nothing
+        world.spawn((Tracked(0),));
+        let mut track = ComponentTrack::<Tracked>::new();
+        let mut delta = ComponentDelta::new();
+        track.capture(&world, &mut delta);
+        let mut state = HashMap::new();
+        delta.apply_to(&mut state);
+
+        world.get::<&mut Tracked>(moved).unwrap().0 = 5;
+        let mut cursor = crate::change::ChangeCursor::<Tracked>::new();
+        cursor.changed(&world);
+
+        track.restore(&world, state);
+        assert_eq!(world.get::<&Tracked>(moved).unwrap().0, 0);
+        match cursor.changed(&world) {
+            crate::change::Changes::Only(entities) => assert_eq!(entities, &[moved]),
+            crate::change::Changes::All => panic!("restoring should only mark what it wrote"),
+        }
+    }
+
+    #[test]
+    fn capturing_after_a_restore_continues_from_it() {
+        let mut ring = SnapshotRing::new(4);
+        let (world, mut physics, a, _) = simulate(6, &mut ring);
+
+        ring.restore(3, &mut physics, &world).unwrap();
+        *world.get::<&mut EntityTransform>(a).unwrap() = transform(40.0);
+        ring.capture(4, &physics, &world);
+
+        ring.restore(4, &mut physics, &world).unwrap();
+        assert_eq!(x_of(&world, a), 40.0);
+        assert_eq!(ring.ticks().collect::<Vec<_>>(), vec![2, 3, 4]);
+    }
+}
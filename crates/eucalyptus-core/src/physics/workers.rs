@@ -0,0 +1,122 @@
+//! The threads rapier solves on.
+//!
+//! rapier is built with its `parallel` feature, which solves independent islands with rayon on
+//! whichever pool it is called from. [`PhysicsWorkers`] gives it a pool of its own so the solver
+//! does not fight the engine's job system for the same threads, and so the amount of threads can
+//! be set from [`RuntimeSettings::physics_threads`](crate::runtime::RuntimeSettings::physics_threads).
+//!
+//! When no amount is set, the pool is sized from the job system's compute pool rather than from
+//! the core count, so both pools are taken out of the same budget.
+
+use dropbear_engine::future::{JobSystem, JobSystemConfig};
+use std::sync::Arc;
+
+/// A rayon pool that [`PhysicsState::step`](super::PhysicsState::step) solves on, and that
+/// [batched queries](super::query) run on. Clones share the same pool.
+#[derive(Clone)]
+pub struct PhysicsWorkers {
+    pool: Arc<rayon::ThreadPool>,
+    requested: Option<u32>,
+    /// The compute threads of the job system the pool was sized against.
+    compute_threads: usize,
+}
+
+impl PhysicsWorkers {
+    /// Creates a pool of `threads` workers, or [`Self::auto_threads`] of `jobs` when `None`. A
+    /// single thread solves every island one after the other, like rapier does without `parallel`.
+    ///
+    /// Without a job system, the pool is sized against the one a default
+    /// [`JobSystemConfig`] would create.
+    pub fn new(threads: Option<u32>, jobs: Option<&JobSystem>) -> anyhow::Result<Self> {
+        let compute_threads = Self::compute_threads_of(jobs);
+        let num_threads = match threads {
+            Some(threads) => (threads as usize).max(1),
+            None => Self::auto_threads(compute_threads),
+        };
+        let pool = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .thread_name(|i| format!("dropbear-physics-{i}"))
+            .build()?;
+
+        log::debug!("Solving physics on {} thread(s)", num_threads);
+        Ok(Self {
+            pool: Arc::new(pool),
+            requested: threads,
+            compute_threads,
+        })
+    }
+
+    /// The amount of threads used when none are set, next to a job system with
+    /// `compute_threads` compute threads.
+    ///
+    /// The main thread waits for the step to finish, so the step gets the same cores the job
+    /// system computes on, less one so streaming and loading keep making progress during the step.
+    pub fn auto_threads(compute_threads: usize) -> usize {
+        compute_threads.saturating_sub(1).max(1)
+    }
+
+    fn compute_threads_of(jobs: Option<&JobSystem>) -> usize {
+        jobs.map(JobSystem::compute_threads)
+            .unwrap_or_else(|| JobSystemConfig::default().resolved_compute_threads())
+    }
+
+    /// Rebuilds the pool if `threads`, or the job system it is sized against, differs from what
+    /// it was created with.
+    pub fn configure(
+        &mut self,
+        threads: Option<u32>,
+        jobs: Option<&JobSystem>,
+    ) -> anyhow::Result<()> {
+        let resized_jobs = Self::compute_threads_of(jobs) != self.compute_threads;
+        if threads != self.requested || (threads.is_none() && resized_jobs) {
+            *self = Self::new(threads, jobs)?;
+        }
+        Ok(())
+    }
+
+    /// The amount of threads in the pool.
+    pub fn threads(&self) -> usize {
+        self.pool.current_num_threads()
+    }
+
+    /// Runs `op` inside of the pool, so any rayon work it does stays on the physics threads.
+    pub fn install<R: Send>(&self, op: impl FnOnce() -> R + Send) -> R {
+        self.pool.install(op)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn auto_threads_leave_one_compute_thread_to_the_job_system() {
+        assert_eq!(PhysicsWorkers::auto_threads(1), 1);
+        assert_eq!(PhysicsWorkers::auto_threads(2), 1);
+        assert_eq!(PhysicsWorkers::auto_threads(8), 7);
+    }
+
+    #[test]
+    fn pools_follow_the_job_system() {
+        let jobs = JobSystem::new(JobSystemConfig {
+            compute_threads: 5,
+            io_threads: 1,
+        })
+        .unwrap();
+
+        let mut workers = PhysicsWorkers::new(None, Some(&jobs)).unwrap();
+        assert_eq!(workers.threads(), 4);
+
+        // an explicit amount wins over the job system
+        workers.configure(Some(2), Some(&jobs)).unwrap();
+        assert_eq!(workers.threads(), 2);
+
+        let smaller = JobSystem::new(JobSystemConfig {
+            compute_threads: 4,
+            io_threads: 1,
+        })
+        .unwrap();
+        workers.configure(None, Some(&smaller)).unwrap();
+        assert_eq!(workers.threads(), 3);
+    }
+}
@@ -6,6 +6,7 @@ use crate::physics::PhysicsState;
 use crate::scene::loading::SceneLoader;
 use crossbeam_channel::Sender;
 use dropbear_engine::asset::AssetRegistry;
+use dropbear_engine::audio::AudioEngine;
 use dropbear_engine::graphics::SharedGraphicsContext;
 use hecs::World;
 use parking_lot::{Mutex, RwLock};
@@ -55,6 +56,13 @@ pub type SceneLoaderUnwrapped = Mutex<SceneLoader>;
 /// Defined in `dropbear_common.h` as `PhysicsEngine`
 pub type PhysicsStatePtr = *mut PhysicsState;
 
+/// A non-mutable pointer to a [`parking_lot::Mutex<AudioEngine>`], the
+/// [`dropbear_engine::audio::AUDIO`] global.
+///
+/// Provided to the scripting module as an OpaquePointer, the same as [`SceneLoaderPtr`].
+pub type AudioEnginePtr = *const AudioEngineUnwrapped;
+pub type AudioEngineUnwrapped = Mutex<AudioEngine>;
+
 /// A mutable pointer to the UI command buffer/state.
 ///
 /// This is treated as an opaque pointer by scripting layers.
@@ -1,25 +1,31 @@
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 use std::hash::{DefaultHasher, Hash, Hasher};
 use std::sync::Arc;
 use hecs::{Entity, World};
-use glam::{Mat4, Quat, Vec3};
+use glam::{DVec3, Mat4, Quat, Vec3};
 use dropbear_engine::animation::{AnimationComponent, MorphTargetInfo};
 use dropbear_engine::asset::{Handle, ASSET_REGISTRY};
 use dropbear_engine::billboarding::BillboardPipeline;
 use dropbear_engine::buffer::DynamicBuffer;
+use dropbear_engine::draw_list::{DrawCommand, DrawList, PassTargets};
 use dropbear_engine::camera::Camera;
 use dropbear_engine::entity::{EntityTransform, MeshRenderer, Transform};
 use dropbear_engine::graphics::{CommandEncoder, InstanceRaw, SharedGraphicsContext};
-use dropbear_engine::lighting::Light;
-use dropbear_engine::model::{DrawLight, DrawModel, Material, Mesh, Model};
+use dropbear_engine::model::{DrawLight, Material, Mesh, Model};
 use dropbear_engine::pipelines::DropbearShaderPipeline;
 use dropbear_engine::pipelines::animation::AnimationDefaults;
 use dropbear_engine::pipelines::hdr::HdrPipeline;
-use dropbear_engine::pipelines::light_cube::LightCubePipeline;
+use dropbear_engine::lighting::Light;
+use dropbear_engine::pipelines::light_cube::{LightChanges, LightCubePipeline};
 use dropbear_engine::pipelines::shader::MainRenderPipeline;
+use dropbear_engine::render_graph::RenderGraph;
+use dropbear_engine::shadows::{ShadowCaster, ShadowRenderer};
 use dropbear_engine::sky::SkyPipeline;
+use dropbear_engine::streaming::{TextureStreamer, TEXTURE_STREAMER};
+use dropbear_engine::texture::Texture;
 use kino_ui::KinoState;
 use crate::billboard::BillboardComponent;
+use crate::change::{ChangeCursor, Changes};
 use crate::debug::DebugDrawExt;
 use crate::entity_status::EntityStatus;
 use crate::hierarchy::EntityTransformExt;
@@ -51,10 +57,277 @@ pub struct PreparedModel {
     pub entity: Option<Entity>,
 }
 
+/// Everything the passes of [`RendererCommon::scene_graph`] draw with for one frame.
+pub struct SceneFrame<'a> {
+    pub graphics: &'a Arc<SharedGraphicsContext>,
+    pub hdr: &'a HdrPipeline,
+    pub world: &'a World,
+    pub camera: &'a Camera,
+    pub current_scene_name: Option<&'a str>,
+    pub batches: &'a HashMap<u64, ModelBatch>,
+    pub model_cache: &'a HashMap<u64, Arc<Model>>,
+    pub per_frame_bind_group: &'a wgpu::BindGroup,
+    pub pipeline: &'a MainRenderPipeline,
+    pub animation_defaults: &'a AnimationDefaults,
+    pub sky: &'a SkyPipeline,
+    pub light_cube_pipeline: Option<&'a LightCubePipeline>,
+    pub billboard_pipeline: Option<&'a BillboardPipeline>,
+    pub shadows: Option<&'a mut ShadowRenderer>,
+    pub kino: Option<&'a mut KinoState>,
+    pub instance_buffer_cache: &'a HashMap<u64, DynamicBuffer<InstanceRaw>>,
+    pub animated_instance_buffers: &'a mut HashMap<Entity, DynamicBuffer<InstanceRaw>>,
+    pub animated_bind_group_cache: &'a mut HashMap<Entity, (u64, wgpu::BindGroup)>,
+    pub static_bind_group_cache: &'a mut HashMap<u64, wgpu::BindGroup>,
+    pub last_morph_info_per_mesh: &'a mut HashMap<u32, MorphTargetInfo>,
+    /// The kino billboard targets, filled in by the billboard target pass. Start it empty.
+    pub billboard_views: HashMap<u64, wgpu::TextureView>,
+}
+
+/// The renderers of a world batched by model, kept between frames by
+/// [`RendererCommon::locate_renderers`] so that only the renderers that changed are looked at.
+#[derive(Default)]
+pub struct RendererCache {
+    pub batches: HashMap<u64, ModelBatch>,
+    located: HashMap<Entity, Located>,
+    renderers: ChangeCursor<MeshRenderer>,
+    transforms: ChangeCursor<EntityTransform>,
+    statuses: ChangeCursor<EntityStatus>,
+    animations: ChangeCursor<AnimationComponent>,
+    /// The generation of the render origin the instances were converted relative to.
+    origin: Option<u64>,
+    changed: Vec<Entity>,
+    /// The bounding sphere of each model, by id.
+    model_bounds: HashMap<u64, (Vec3, f32)>,
+}
+
+/// Where a renderer sits in [`RendererCache::batches`], and what texture streaming needs of it.
+struct Located {
+    model_id: u64,
+    index: usize,
+    /// The bounding sphere of the model, placed by the renderer's instance.
+    centre: DVec3,
+    radius: f64,
+    textures: Vec<u64>,
+}
+
+impl RendererCache {
+    /// Forgets every renderer. Call this when the world is swapped for another one, as entities
+    /// of the new world can have the same ids, and model ids can be handed out again.
+    pub fn clear(&mut self) {
+        self.batches.clear();
+        self.located.clear();
+        self.model_bounds.clear();
+        self.origin = None;
+    }
+
+    /// Fills `changed` with the entities to batch again and returns true, or returns false if
+    /// everything has to be batched again.
+    fn collect_changes(&mut self, world: &World, origin: u64, changed: &mut Vec<Entity>) -> bool {
+        changed.clear();
+        // every cursor has to look, so that none of them falls behind
+        let mut caught_up = self.origin.replace(origin) == Some(origin);
+        for changes in [
+            self.renderers.changed(world),
+            self.transforms.changed(world),
+            self.statuses.changed(world),
+            self.animations.changed(world),
+        ] {
+            match changes {
+                Changes::All => caught_up = false,
+                Changes::Only(entities) => changed.extend_from_slice(entities),
+            }
+        }
+        changed.sort_unstable();
+        changed.dedup();
+        caught_up
+    }
+
+    /// Takes `entity` out of its batch.
+    fn forget(&mut self, entity: Entity) {
+        let Some(located) = self.located.remove(&entity) else { return };
+        let Some(batch) = self.batches.get_mut(&located.model_id) else { return };
+        batch.instances.swap_remove(located.index);
+        match batch.instances.get(located.index) {
+            Some(moved) => {
+                if let Some(moved) = self.located.get_mut(&moved.entity) {
+                    moved.index = located.index;
+                }
+            }
+            None if batch.instances.is_empty() => {
+                self.batches.remove(&located.model_id);
+            }
+            None => {}
+        }
+    }
+}
+
+/// Which lights changed since the last frame, for [`LightCubePipeline::update`].
+///
+/// A light has to be read again when the light itself was changed, when its transform was, or
+/// when the [`ShadowRenderer`] moved its shadow map.
+#[derive(Default)]
+pub struct LightChangeCursor {
+    lights: ChangeCursor<Light>,
+    transforms: ChangeCursor<EntityTransform>,
+    changed: Vec<Entity>,
+}
+
+impl LightChangeCursor {
+    /// Makes the next [`Self::changed`] ask for every light. Call this when the world is swapped
+    /// for another one, as entities of the new world can have the same ids.
+    pub fn reset(&mut self) {
+        self.lights.reset();
+    }
+
+    /// Call this once a frame, after [`ShadowRenderer::assign`].
+    pub fn changed(
+        &mut self,
+        world: &World,
+        shadows: Option<&ShadowRenderer>,
+    ) -> LightChanges<'_> {
+        puffin::profile_function!();
+        self.changed.clear();
+        // only the light cursor asks for a rescan, as lights come and go with their `Light`
+        let rescan = match self.lights.changed(world) {
+            Changes::All => true,
+            Changes::Only(entities) => {
+                self.changed.extend_from_slice(entities);
+                false
+            }
+        };
+        match self.transforms.changed(world) {
+            Changes::All => self.changed.extend(
+                world.query::<Entity>().with::<(&Light, &EntityTransform)>().iter(),
+            ),
+            Changes::Only(entities) => self.changed.extend_from_slice(entities),
+        }
+        if rescan {
+            return LightChanges::All;
+        }
+        if let Some(shadows) = shadows {
+            self.changed.extend_from_slice(shadows.reassigned());
+        }
+        self.changed.sort_unstable();
+        self.changed.dedup();
+        LightChanges::Only(&self.changed)
+    }
+}
+
 /// Just common rendering functions that are shared between redback-runtime and eucalyptus-editor.
 pub struct RendererCommon;
 
 impl RendererCommon {
+    /// The passes of a scene viewport, from clearing the HDR target to the HUD on top of it.
+    ///
+    /// The passes all go into one encoder, apart from the HUD: kino uploads the vertices of the
+    /// HUD and of the billboard targets into the same buffers, so the graph submits in between.
+    pub fn scene_graph<'a>() -> RenderGraph<'static, SceneFrame<'a>> {
+        let mut graph = RenderGraph::new();
+        let hdr = graph.import("hdr");
+        let depth = graph.import("depth");
+        let shadow_maps = graph.import("shadow maps");
+        let kino_targets = graph.import("kino billboard targets");
+        let viewport = graph.import("viewport");
+
+        graph.add_pass("clear")
+            .write(hdr).write(depth)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::clear_viewport(frame.graphics, ctx.encoder, frame.hdr);
+            });
+
+        graph.add_pass("shadows")
+            .write(shadow_maps)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::render_shadows(
+                    frame.graphics, ctx.encoder, frame.shadows.as_deref_mut(),
+                    frame.batches, frame.model_cache, frame.instance_buffer_cache,
+                );
+            });
+
+        graph.add_pass("light cubes")
+            .read_write(hdr).read_write(depth)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::render_light_cubes(
+                    frame.graphics, ctx.encoder, frame.hdr,
+                    frame.camera, frame.light_cube_pipeline,
+                );
+            });
+
+        graph.add_pass("models")
+            .read_write(hdr).read_write(depth).read(shadow_maps)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::render_models(
+                    frame.graphics, ctx.encoder, frame.hdr,
+                    frame.world, frame.batches, frame.model_cache,
+                    frame.per_frame_bind_group, &frame.sky.environment_bind_group,
+                    frame.pipeline, frame.animation_defaults,
+                    frame.instance_buffer_cache,
+                    frame.animated_instance_buffers,
+                    frame.animated_bind_group_cache,
+                    frame.static_bind_group_cache,
+                    frame.last_morph_info_per_mesh,
+                );
+            });
+
+        graph.add_pass("sky")
+            .read_write(hdr).read_write(depth)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::render_sky(frame.graphics, ctx.encoder, frame.hdr, frame.sky);
+            });
+
+        graph.add_pass("billboard targets")
+            .write(kino_targets).uploads("kino")
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                let Some(kino) = frame.kino.as_deref_mut() else { return };
+                puffin::profile_scope!("rendering billboard targets");
+                kino.render_billboard_targets(&frame.graphics.device, &frame.graphics.queue, ctx.encoder);
+                frame.billboard_views.extend(kino.billboard_render_target_views());
+            });
+
+        graph.add_pass("billboards")
+            .read_write(hdr).read_write(depth).read(kino_targets)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::draw_billboards(
+                    frame.graphics, ctx.encoder, frame.hdr, frame.camera,
+                    frame.world, &frame.billboard_views, frame.billboard_pipeline,
+                );
+            });
+
+        graph.add_pass("debug draw")
+            .read_write(hdr).read_write(depth)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                Self::render_collider_debug(frame.graphics, frame.world, frame.current_scene_name);
+                if let Some(debug_draw) = frame.graphics.debug_draw.lock().as_mut() {
+                    debug_draw.flush(frame.graphics.clone(), ctx.encoder, frame.camera.world_view_proj());
+                }
+            });
+
+        graph.add_pass("post process")
+            .read(hdr).write(viewport)
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                frame.hdr.process(
+                    ctx.encoder,
+                    &frame.graphics.viewport_texture.view,
+                    frame.graphics.gpu_profiler.timestamp_writes("hdr"),
+                );
+            });
+
+        graph.add_pass("hud")
+            .read_write(hdr).uploads("kino")
+            .build(|frame: &mut SceneFrame<'a>, ctx| {
+                let Some(kino) = frame.kino.as_deref_mut() else { return };
+                kino.render_timed(
+                    &frame.graphics.device,
+                    &frame.graphics.queue,
+                    ctx.encoder,
+                    frame.hdr.view(),
+                    frame.graphics.gpu_profiler.timestamp_writes("kino"),
+                );
+            });
+
+        graph
+    }
+
     pub fn clear_viewport(graphics: &SharedGraphicsContext, encoder: &mut CommandEncoder, hdr: &HdrPipeline) {
         puffin::profile_scope!("Clearing viewport");
         let _ = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
@@ -87,52 +360,137 @@ impl RendererCommon {
         });
     }
 
-    pub fn collect_lights(world: &World) -> (Vec<Light>, u32) {
-        puffin::profile_scope!("Locating lights");
-        let mut lights = Vec::new();
-        let mut enabled = 0u32;
-        for light in world.query::<&Light>().iter() {
-            if light.component.enabled { enabled += 1; }
-            lights.push(light.clone());
-        }
-        (lights, enabled)
-    }
-
+    /// Brings `cache`'s batches up to date with the renderers of `world`, and requests the mips
+    /// their textures need from the [`TextureStreamer`].
+    ///
+    /// Only renderers whose [`MeshRenderer`], [`EntityTransform`], [`EntityStatus`] or
+    /// [`AnimationComponent`] changed are batched again (which is also when an animation is
+    /// uploaded), unless renderers came and went or the render origin moved.
     pub fn locate_renderers(
         world: &World,
-        batches: &mut HashMap<u64, ModelBatch>,
+        cache: &mut RendererCache,
         graphics: Arc<SharedGraphicsContext>,
+        camera: &Camera,
         default_skinning_buffer: &Option<wgpu::Buffer>,
     ) {
         puffin::profile_scope!("finding all renderers");
 
-        let mut query = world.query::<(Entity, &MeshRenderer, Option<&mut AnimationComponent>)>();
+        let swapped = TextureStreamer::tick(graphics.clone());
+        if !swapped.is_empty() {
+            Self::rebind_material_snapshots(world, graphics.clone(), &swapped);
+        }
 
-        for (entity, renderer, animation) in query.iter() {
-            if let Ok(status) = world.get::<&EntityStatus>(entity) {
-                if status.hidden || status.disabled { continue; }
+        let mut changed = std::mem::take(&mut cache.changed);
+        if cache.collect_changes(world, graphics.render_origin.generation(), &mut changed) {
+            for entity in &changed {
+                cache.forget(*entity);
+                let mut query = world
+                    .query_one::<(&mut MeshRenderer, Option<&mut AnimationComponent>)>(*entity);
+                let Ok((renderer, animation)) = query.get() else { continue };
+                Self::locate(
+                    world, cache, *entity, renderer, animation, &graphics, default_skinning_buffer,
+                );
+            }
+        } else {
+            cache.batches.clear();
+            cache.located.clear();
+            let mut query = world.query::<(Entity, &mut MeshRenderer, Option<&mut AnimationComponent>)>();
+            for (entity, renderer, animation) in query.iter() {
+                Self::locate(
+                    world, cache, entity, renderer, animation, &graphics, default_skinning_buffer,
+                );
+            }
+        }
+        cache.changed = changed;
+
+        // how many pixels a unit covers one unit in front of the camera: half of the viewport's
+        // height spans tan(fov / 2) units there
+        let half_height = graphics.viewport_texture.size.height.max(1) as f64 * 0.5;
+        let half_fov = camera.settings.fov_y.to_radians() * 0.5;
+        let pixels_per_unit = half_height / half_fov.tan().max(f64::EPSILON);
+        let camera_position = camera.position();
+
+        let mut streamer = TEXTURE_STREAMER.lock();
+        for located in cache.located.values() {
+            let distance = located.centre.distance(camera_position).max(camera.znear);
+            // the streamer wants the size along the largest axis, so the diameter
+            let screen_pixels = (2.0 * located.radius * pixels_per_unit / distance) as f32;
+            for id in &located.textures {
+                streamer.request(*id, screen_pixels);
             }
+        }
+    }
 
-            let handle = renderer.model();
-            if handle.is_null() { continue; }
-
-            let instance_raw = renderer.instance.to_raw();
-
-            let animation_buffers = Self::resolve_animation_buffers(
-                graphics.clone(),
-                default_skinning_buffer,
-                animation
-            );
-
-            batches
-                .entry(handle.id)
-                .or_insert_with(|| ModelBatch { model_id: handle.id, instances: Vec::new() })
-                .instances
-                .push(RenderInstance {
-                    entity,
-                    instance: instance_raw,
-                    animation: animation_buffers,
-                });
+    /// Adds `entity`'s renderer to the batch of its model, if it is to be drawn.
+    fn locate(
+        world: &World,
+        cache: &mut RendererCache,
+        entity: Entity,
+        renderer: &mut MeshRenderer,
+        animation: Option<&mut AnimationComponent>,
+        graphics: &Arc<SharedGraphicsContext>,
+        default_skinning_buffer: &Option<wgpu::Buffer>,
+    ) {
+        if let Ok(status) = world.get::<&EntityStatus>(entity) {
+            if status.hidden || status.disabled { return; }
+        }
+
+        let handle = renderer.model();
+        if handle.is_null() { return; }
+
+        let (centre, radius) = match cache.model_bounds.get(&handle.id) {
+            Some(bounds) => *bounds,
+            None => match ASSET_REGISTRY.read().get_model(handle) {
+                Some(model) => *cache.model_bounds
+                    .entry(handle.id)
+                    .or_insert(model.bounding_sphere()),
+                // not loaded yet, it is looked up again the next time the renderer changes
+                None => (Vec3::ZERO, 1.0),
+            },
+        };
+        let instance = &renderer.instance;
+        let centre = instance.position + instance.rotation * (instance.scale * centre.as_dvec3());
+        let radius = radius as f64 * instance.scale.abs().max_element();
+
+        let instance_raw = renderer.instance_raw(&graphics.render_origin);
+        let animation_buffers = Self::resolve_animation_buffers(
+            graphics.clone(),
+            default_skinning_buffer,
+            animation
+        );
+
+        let batch = cache.batches
+            .entry(handle.id)
+            .or_insert_with(|| ModelBatch { model_id: handle.id, instances: Vec::new() });
+        cache.located.insert(entity, Located {
+            model_id: handle.id,
+            index: batch.instances.len(),
+            centre,
+            radius,
+            textures: renderer.material_snapshot.values().flat_map(|m| m.texture_ids()).collect(),
+        });
+        batch.instances.push(RenderInstance {
+            entity,
+            instance: instance_raw,
+            animation: animation_buffers,
+        });
+    }
+
+    /// Rebuilds the bind groups of every [`MeshRenderer`]'s material snapshot that samples from a
+    /// texture swapped out by the [`TextureStreamer`].
+    fn rebind_material_snapshots(
+        world: &World,
+        graphics: Arc<SharedGraphicsContext>,
+        swapped: &HashSet<u64>,
+    ) {
+        puffin::profile_function!();
+        let mut registry = ASSET_REGISTRY.write();
+        for renderer in world.query::<&mut MeshRenderer>().iter() {
+            for material in renderer.material_snapshot.values_mut() {
+                if material.uses_any_texture(swapped) {
+                    material.rebuild_bind_group(&mut registry, &graphics);
+                }
+            }
         }
     }
 
@@ -208,7 +566,7 @@ impl RendererCommon {
                     wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST,
                     &format!("resizable buffer<handle={}>", handle_id),
                 ));
-            instance_buffer.write(&graphics.device, &graphics.queue, &instances);
+            instance_buffer.write_changed(&graphics.device, &graphics.queue, &instances);
 
             model_cache.insert(*handle_id, model.clone());
             prepared.push(PreparedModel {
@@ -233,17 +591,50 @@ impl RendererCommon {
         (prepared, model_cache)
     }
 
+    /// Re-renders the shadow maps that are out of date, using the static instance buffers written by
+    /// [`Self::prepare_models`]. Animated instances do not cast shadows.
+    pub fn render_shadows(
+        graphics: &SharedGraphicsContext,
+        encoder: &mut CommandEncoder,
+        shadows: Option<&mut ShadowRenderer>,
+        batches: &HashMap<u64, ModelBatch>,
+        model_cache: &HashMap<u64, Arc<Model>>,
+        instance_buffer_cache: &HashMap<u64, DynamicBuffer<InstanceRaw>>,
+    ) {
+        let Some(shadows) = shadows else { return };
+        puffin::profile_scope!("shadow passes");
+
+        let mut casters = Vec::with_capacity(batches.len());
+        for batch in batches.values() {
+            // batches without static instances keep whatever their buffer last held
+            if batch.instances.iter().all(|i| i.animation.is_some()) { continue; }
+
+            let (Some(model), Some(instance_buffer)) = (
+                model_cache.get(&batch.model_id),
+                instance_buffer_cache.get(&batch.model_id),
+            ) else { continue };
+
+            casters.push(ShadowCaster {
+                id: batch.model_id,
+                model,
+                instances: instance_buffer,
+            });
+        }
+
+        shadows.render(graphics, encoder, &casters);
+    }
+
     pub fn render_light_cubes(
         graphics: &Arc<SharedGraphicsContext>,
         encoder: &mut CommandEncoder,
         hdr: &HdrPipeline,
-        lights: &[Light],
         camera: &Camera,
-
         light_cube_pipeline: Option<&LightCubePipeline>,
     ) {
-        let (Some(light_pipeline), Some(l)) = (&light_cube_pipeline, lights.first()) else { return };
-        let Some(model) = ASSET_REGISTRY.read().get_model(l.cube_model) else {
+        let Some(light_pipeline) = light_cube_pipeline else { return };
+        let (instance_buffer, cube_count) = light_pipeline.cube_instances();
+        if cube_count == 0 { return; }
+        let Some(model) = ASSET_REGISTRY.read().get_model(light_pipeline.cube_model()) else {
             log_once::error_once!("Missing light cube model handle in registry");
             return;
         };
@@ -263,16 +654,13 @@ impl RendererCommon {
                 stencil_ops: None,
             }),
             occlusion_query_set: None,
-            timestamp_writes: None,
+            timestamp_writes: graphics.gpu_profiler.timestamp_writes("light cube"),
             multiview_mask: None,
         });
         pass.set_pipeline(light_pipeline.pipeline());
-        for light in lights {
-            puffin::profile_scope!("rendering light", &light.label);
-            pass.set_vertex_buffer(1, light.instance_buffer.buffer().slice(..));
-            if !light.component.visible { continue; }
-            pass.draw_light_model(&model, &camera.bind_group, &light.bind_group);
-        }
+        // every cube in one draw, the hidden ones are collapsed to nothing
+        pass.set_vertex_buffer(1, instance_buffer.slice(..));
+        pass.draw_light_model_instanced(&model, 0..cube_count, &camera.bind_group);
     }
 
     pub fn render_models(
@@ -294,7 +682,14 @@ impl RendererCommon {
     ) {
         puffin::profile_scope!("model render pass");
 
-        for (_, batch) in batches {
+        enum Instances {
+            Static { model_id: u64, count: u32 },
+            Animated(Entity),
+        }
+
+        // buffers and bind groups are written first, so the draw list below only borrows them
+        let mut items: Vec<(&Model, hecs::Ref<'_, MeshRenderer>, Instances)> = Vec::new();
+        for batch in batches.values() {
             let Some(model) = model_cache.get(&batch.model_id) else { continue };
 
             let static_count = batch.instances.iter().filter(|i| i.animation.is_none()).count() as u32;
@@ -318,33 +713,7 @@ impl RendererCommon {
                     }
                 }
 
-                let animation_bg: &wgpu::BindGroup = if model.morph_deltas_buffer.is_some() {
-                    static_bind_group_cache.get(&batch.model_id).unwrap()
-                } else {
-                    &animation_defaults.animation_bind_group
-                };
-
-                let Some(instance_buffer) = instance_buffer_cache.get(&batch.model_id) else { continue };
-
-                let mut pass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
-                    label: Some("model render pass"),
-                    color_attachments: &[Some(wgpu::RenderPassColorAttachment {
-                        view: hdr.render_view(),
-                        depth_slice: None,
-                        resolve_target: hdr.resolve_target(),
-                        ops: wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store },
-                    })],
-                    depth_stencil_attachment: Some(wgpu::RenderPassDepthStencilAttachment {
-                        view: &graphics.depth_texture.view,
-                        depth_ops: Some(wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store }),
-                        stencil_ops: None,
-                    }),
-                    occlusion_query_set: None,
-                    timestamp_writes: None,
-                    multiview_mask: None,
-                });
-                pass.set_pipeline(&pipeline.pipeline());
-                pass.set_vertex_buffer(1, instance_buffer.slice(static_count as usize));
+                if !instance_buffer_cache.contains_key(&batch.model_id) { continue; }
 
                 for mesh in &model.meshes {
                     let mut weights = mesh.morph_default_weights.clone();
@@ -380,14 +749,13 @@ impl RendererCommon {
                         );
                         last_morph_info_per_mesh.insert(cache_key, info);
                     }
-
-                    let material = Self::resolve_material(model, mesh, &renderer);
-                    pass.draw_mesh_instanced(mesh, material, 0..static_count, per_frame_bind_group, animation_bg, environment_bind_group);
                 }
+
+                items.push((model, renderer, Instances::Static { model_id: batch.model_id, count: static_count }));
             }
 
             for inst in batch.instances.iter().filter(|i| i.animation.is_some()) {
-                puffin::profile_scope!("rendering animated model", format!("{:?}", inst.entity));
+                puffin::profile_scope!("preparing animated model", format!("{:?}", inst.entity));
                 let anim = inst.animation.as_ref().unwrap();
 
                 {
@@ -398,7 +766,7 @@ impl RendererCommon {
                             "animated instance buffer",
                         )
                     });
-                    buf.write(&graphics.device, &graphics.queue, &[inst.instance]);
+                    buf.write_changed(&graphics.device, &graphics.queue, &[inst.instance]);
                 }
 
                 let Ok(renderer) = world.get::<&MeshRenderer>(inst.entity) else { continue };
@@ -425,29 +793,6 @@ impl RendererCommon {
                     }
                 }
 
-                let animation_bg = &animated_bind_group_cache[&inst.entity].1;
-                let instance_buffer = &animated_instance_buffers[&inst.entity];
-
-                let mut pass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
-                    label: Some("animated model render pass"),
-                    color_attachments: &[Some(wgpu::RenderPassColorAttachment {
-                        view: hdr.render_view(),
-                        depth_slice: None,
-                        resolve_target: hdr.resolve_target(),
-                        ops: wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store },
-                    })],
-                    depth_stencil_attachment: Some(wgpu::RenderPassDepthStencilAttachment {
-                        view: &graphics.depth_texture.view,
-                        depth_ops: Some(wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store }),
-                        stencil_ops: None,
-                    }),
-                    occlusion_query_set: None,
-                    timestamp_writes: None,
-                    multiview_mask: None,
-                });
-                pass.set_pipeline(&pipeline.pipeline());
-                pass.set_vertex_buffer(1, instance_buffer.slice(1));
-
                 for mesh in &model.meshes {
                     let mesh_target_count = mesh.morph_target_count.min(anim.weight_count);
                     let info = MorphTargetInfo {
@@ -459,12 +804,67 @@ impl RendererCommon {
                         _padding: Default::default(),
                     };
                     graphics.queue.write_buffer(&anim.morph_info, 0, bytemuck::bytes_of(&info));
-
-                    let material = Self::resolve_material(model, mesh, &renderer);
-                    pass.draw_mesh_instanced(mesh, material, 0..1, per_frame_bind_group, animation_bg, environment_bind_group);
                 }
+
+                items.push((model, renderer, Instances::Animated(inst.entity)));
+            }
+        }
+
+        let main_pipeline = pipeline.pipeline();
+        let mut draws = DrawList::with_capacity(items.iter().map(|(model, ..)| model.meshes.len()).sum());
+        for (model, renderer, instances) in &items {
+            let (animation_bind_group, instance_buffer, instances) = match instances {
+                Instances::Static { model_id, count } => (
+                    static_bind_group_cache.get(model_id).unwrap_or(&animation_defaults.animation_bind_group),
+                    &instance_buffer_cache[model_id],
+                    0..*count,
+                ),
+                Instances::Animated(entity) => (
+                    &animated_bind_group_cache[entity].1,
+                    &animated_instance_buffers[entity],
+                    0..1,
+                ),
+            };
+
+            for mesh in &model.meshes {
+                draws.push(DrawCommand {
+                    pipeline: &main_pipeline,
+                    mesh,
+                    material: Self::resolve_material(model, mesh, renderer),
+                    animation_bind_group,
+                    instance_buffer,
+                    instances: instances.clone(),
+                });
             }
         }
+        if draws.is_empty() { return; }
+        draws.sort();
+
+        let mut pass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
+            label: Some("model render pass"),
+            color_attachments: &[Some(wgpu::RenderPassColorAttachment {
+                view: hdr.render_view(),
+                depth_slice: None,
+                resolve_target: hdr.resolve_target(),
+                ops: wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store },
+            })],
+            depth_stencil_attachment: Some(wgpu::RenderPassDepthStencilAttachment {
+                view: &graphics.depth_texture.view,
+                depth_ops: Some(wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store }),
+                stencil_ops: None,
+            }),
+            occlusion_query_set: None,
+            timestamp_writes: graphics.gpu_profiler.timestamp_writes("model"),
+            multiview_mask: None,
+        });
+        let targets = PassTargets {
+            color_format: hdr.format(),
+            depth_format: Some(Texture::DEPTH_FORMAT),
+            sample_count: (*graphics.antialiasing.read()).into(),
+        };
+        let stats = draws.record_parallel(&graphics.device, targets, &mut pass, per_frame_bind_group, environment_bind_group);
+        // shows up in puffin next to the pass, only formatted while puffin is recording
+        puffin::profile_scope!("model draw list", stats.to_string());
     }
 
     pub fn render_sky(
@@ -487,7 +887,7 @@ impl RendererCommon {
                 depth_ops: Some(wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store }),
                 stencil_ops: None,
             }),
-            timestamp_writes: None,
+            timestamp_writes: graphics.gpu_profiler.timestamp_writes("sky"),
             occlusion_query_set: None,
             multiview_mask: None,
         });
@@ -558,13 +958,29 @@ impl RendererCommon {
             kino_views.extend(kino.billboard_render_target_views());
         }
 
+        Self::draw_billboards(graphics, encoder, hdr, camera, world, &kino_views, billboard_pipeline);
+    }
+
+    /// Draws every enabled [`BillboardComponent`] with the texture in `views` keyed by its entity.
+    /// If there is only one view, it is used for every billboard.
+    pub fn draw_billboards(
+        graphics: &Arc<SharedGraphicsContext>,
+        encoder: &mut CommandEncoder,
+        hdr: &HdrPipeline,
+        camera: &Camera,
+        world: &World,
+        views: &HashMap<u64, wgpu::TextureView>,
+        billboard_pipeline: Option<&BillboardPipeline>,
+    ) {
         let Some(billboard_pipeline) = billboard_pipeline else { return };
 
-        let camera_position = camera.position().as_vec3();
+        // the camera uniform is relative to the render origin, so the billboards are made relative too
+        let origin = camera.render_origin;
+        let camera_position = (camera.position() - origin).as_vec3();
         let camera_projection = Mat4::from_cols_array_2d(&camera.uniform.view_proj);
 
-        let single_fallback_view = if kino_views.len() == 1 {
-            kino_views.values().next().cloned()
+        let single_fallback_view = if views.len() == 1 {
+            views.values().next().cloned()
         } else {
             None
         };
@@ -577,13 +993,13 @@ impl RendererCommon {
             if !billboard.enabled { continue; }
 
             let entity_id = entity.to_bits().get();
-            let texture_view = kino_views.get(&entity_id).cloned()
+            let texture_view = views.get(&entity_id).cloned()
                 .or_else(|| single_fallback_view.clone());
             let Some(texture_view) = texture_view else { continue };
 
             let position = entity_transform
-                .map(|t| t.sync().position.as_vec3())
-                .unwrap_or(Vec3::ZERO)
+                .map(|t| (t.sync().position - origin).as_vec3())
+                .unwrap_or((-origin).as_vec3())
                 + billboard.offset;
             let scale = Vec3::new(billboard.world_size.x, billboard.world_size.y, 1.0);
 
@@ -621,7 +1037,7 @@ impl RendererCommon {
                 depth_ops: Some(wgpu::Operations { load: wgpu::LoadOp::Load, store: wgpu::StoreOp::Store }),
                 stencil_ops: None,
             }),
-            timestamp_writes: None,
+            timestamp_writes: graphics.gpu_profiler.timestamp_writes("billboard"),
             occlusion_query_set: None,
             multiview_mask: None,
         });
@@ -638,4 +1054,84 @@ impl RendererCommon {
             material
         })
     }
-}
\ No newline at end of file
+}
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::change::mark_changed;
+
+    fn place(cache: &mut RendererCache, entity: Entity, model_id: u64) {
+        let batch = cache.batches
+            .entry(model_id)
+            .or_insert_with(|| ModelBatch { model_id, instances: Vec::new() });
+        cache.located.insert(entity, Located {
+            model_id,
+            index: batch.instances.len(),
+            centre: DVec3::ZERO,
+            radius: 1.0,
+            textures: Vec::new(),
+        });
+        batch.instances.push(RenderInstance {
+            entity,
+            instance: InstanceRaw::default(),
+            animation: None,
+        });
+    }
+
+    fn batched(cache: &RendererCache, model_id: u64) -> Vec<Entity> {
+        cache.batches[&model_id].instances.iter().map(|i| i.entity).collect()
+    }
+
+    #[test]
+    fn forgetting_moves_the_last_instance_into_the_gap() {
+        let mut world = World::new();
+        let [a, b, c] = [(), (), ()].map(|_| world.spawn(()));
+
+        let mut cache = RendererCache::default();
+        for entity in [a, b, c] {
+            place(&mut cache, entity, 7);
+        }
+
+        cache.forget(b);
+        assert_eq!(batched(&cache, 7), vec![a, c]);
+        assert_eq!(cache.located[&c].index, 1);
+
+        // forgetting what is not batched does nothing
+        cache.forget(b);
+        assert_eq!(batched(&cache, 7), vec![a, c]);
+
+        cache.forget(a);
+        assert_eq!(batched(&cache, 7), vec![c]);
+        assert_eq!(cache.located[&c].index, 0);
+
+        cache.forget(c);
+        assert!(cache.batches.is_empty());
+        assert!(cache.located.is_empty());
+    }
+
+    #[test]
+    fn only_changed_renderers_are_batched_again() {
+        let mut world = World::new();
+        let a = world.spawn((MeshRenderer::from_handle(Handle::NULL),));
+        let b = world.spawn((MeshRenderer::from_handle(Handle::NULL),));
+
+        let mut cache = RendererCache::default();
+        let mut changed = Vec::new();
+        assert!(!cache.collect_changes(&world, 0, &mut changed));
+
+        // other tests mark renderers of their own worlds too, so there can be more entities
+        mark_changed::<MeshRenderer>(b);
+        assert!(cache.collect_changes(&world, 0, &mut changed));
+        assert!(changed.contains(&b));
+
+        // a moved render origin converts every instance again
+        assert!(!cache.collect_changes(&world, 1, &mut changed));
+
+        world.despawn(a).unwrap();
+        assert!(!cache.collect_changes(&world, 1, &mut changed));
+
+        cache.clear();
+        assert!(!cache.collect_changes(&world, 1, &mut changed));
+        assert!(cache.collect_changes(&world, 1, &mut changed));
+    }
+}
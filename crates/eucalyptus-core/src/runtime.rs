@@ -23,6 +23,29 @@ pub struct RuntimeSettings {
     pub initial_scene: Option<String>,
     #[serde(default)]
     pub target_fps: HistoricalOption<u32>,
+    /// The amount of video memory (in MiB) streamed textures can keep resident.
+    ///
+    /// When unset, the engine's default budget is used.
+    #[serde(default)]
+    pub texture_budget_mb: HistoricalOption<u32>,
+    /// The amount of threads rapier solves physics islands on.
+    ///
+    /// When unset, it is sized from the amount of cores, leaving room for the main thread and
+    /// the job system. `1` solves everything on one thread.
+    #[serde(default)]
+    pub physics_threads: HistoricalOption<u32>,
+    /// How far (in metres) a dynamic body can be from the active camera before it is put to sleep
+    /// until the camera comes back.
+    ///
+    /// When unset, every body is simulated no matter how far away it is.
+    #[serde(default)]
+    pub physics_sleep_distance: HistoricalOption<f32>,
+    /// How many ticks have to pass before scripts get another contact force event for the same
+    /// pair of colliders. Collision start and stop events are always delivered.
+    ///
+    /// When unset, contact force events are delivered every tick.
+    #[serde(default)]
+    pub contact_force_event_interval: HistoricalOption<u32>,
 }
 
 impl RuntimeSettings {
@@ -31,6 +54,10 @@ impl RuntimeSettings {
         Self {
             initial_scene: None,
             target_fps: HistoricalOption::none(),
+            texture_budget_mb: HistoricalOption::none(),
+            physics_threads: HistoricalOption::none(),
+            physics_sleep_distance: HistoricalOption::none(),
+            contact_force_event_interval: HistoricalOption::none(),
         }
     }
 }
@@ -4,6 +4,7 @@ pub mod loading;
 pub mod scripting;
 
 use crate::camera::CameraComponent;
+use crate::change;
 use crate::component::{ComponentRegistry, SerializedComponent};
 use crate::hierarchy::{Children, EntityTransformExt, Parent, SceneHierarchy};
 use crate::physics::PhysicsState;
@@ -277,7 +278,7 @@ impl SceneConfig {
                 applier.apply_to_builder(&mut builder);
             }
 
-            let entity = world.spawn(builder.build());
+            let entity = change::spawn(world, builder.build());
 
             if let Some(previous) = label_to_entity.insert(label_for_map.clone(), entity) {
                 log::warn!(
@@ -370,7 +371,7 @@ impl SceneConfig {
             for child_label in child_labels {
                 if let Some(&child_entity) = label_to_entity.get(&child_label) {
                     resolved_children.push(child_entity);
-                    if let Err(e) = world.insert_one(child_entity, Parent::new(parent_entity)) {
+                    if let Err(e) = change::insert_one(world, child_entity, Parent::new(parent_entity)) {
                         log::error!(
                             "Failed to attach Parent component to child entity {:?}: {}",
                             child_entity,
@@ -410,7 +411,7 @@ impl SceneConfig {
             }
 
             if let Some(parent_entity) = local_insert_one
-                && let Err(e) = world.insert_one(parent_entity, Children::new(resolved_children))
+                && let Err(e) = change::insert_one(world, parent_entity, Children::new(resolved_children))
             {
                 log::error!(
                     "Failed to attach Parent component to entity {:?}: {}",
@@ -453,7 +454,7 @@ impl SceneConfig {
 
             let transform = comp.to_transform();
 
-            world.spawn((
+            change::spawn(world, (
                 Label::from("Default Light"),
                 comp,
                 light,
@@ -528,7 +529,7 @@ impl SceneConfig {
                 let camera = Camera::predetermined(graphics.clone(), Some("Viewport Camera"));
                 let component = crate::camera::DebugCamera::new();
                 let label = Label::new("Viewport Camera");
-                let camera_entity = world.spawn((label, camera, component));
+                let camera_entity = change::spawn(world, (label, camera, component));
                 Ok(camera_entity)
             }
         }
@@ -4,6 +4,7 @@
 //! it is that JVM and Kotlin/Native languages are prioritised in the dropbear project.
 pub mod components;
 pub mod error;
+pub mod events;
 pub mod jni;
 pub mod native;
 pub mod result;
@@ -13,18 +14,19 @@ pub mod utils;
 pub static JVM_ARGS: OnceLock<String> = OnceLock::new();
 pub static AWAIT_JDB: OnceLock<bool> = OnceLock::new();
 
+use crate::change::{ChangeCursor, Changes};
 use crate::ptr::{
-    AssetRegistryPtr, CommandBufferPtr, GraphicsContextPtr, InputStatePtr, PhysicsStatePtr,
-    SceneLoaderPtr, UiBufferPtr, WorldPtr,
+    AssetRegistryPtr, AudioEnginePtr, CommandBufferPtr, GraphicsContextPtr, InputStatePtr,
+    PhysicsStatePtr, SceneLoaderPtr, UiBufferPtr, WorldPtr,
 };
 use crate::scene::loading::SCENE_LOADER;
 use crate::scripting::jni::JavaContext;
 use crate::scripting::native::NativeLibrary;
 use crate::states::Script;
-use crate::types::{CollisionEvent, ContactForceEvent};
 use anyhow::Context;
 use crossbeam_channel::Sender;
 use dropbear_engine::asset::ASSET_REGISTRY;
+use dropbear_engine::audio::AUDIO;
 use hecs::{Entity, World};
 use magna_carta::Target;
 use std::collections::{HashMap, HashSet};
@@ -91,6 +93,9 @@ pub struct ScriptManager {
 
     /// True once `load_script` has successfully initialised the current target.
     scripts_loaded: bool,
+
+    /// Which [`Script`]s changed since the entity tag database was last brought up to date.
+    script_changes: ChangeCursor<Script>,
 }
 
 impl ScriptManager {
@@ -108,6 +113,7 @@ impl ScriptManager {
             loaded_tags: HashSet::new(),
             active_tags: HashSet::new(),
             scripts_loaded: false,
+            script_changes: ChangeCursor::new(),
         };
 
         #[cfg(feature = "jvm")]
@@ -168,6 +174,7 @@ impl ScriptManager {
         self.active_tags = next_active;
 
         self.entity_tag_database = entity_tag_database;
+        self.script_changes.reset();
         self.script_target = target.clone();
         self.lib_path = new_path;
 
@@ -227,6 +234,7 @@ impl ScriptManager {
     ) -> anyhow::Result<()> {
         let assets = &raw const *ASSET_REGISTRY;
         let scene_loader = &raw const *SCENE_LOADER;
+        let audio = &raw const *AUDIO;
 
         let context = DropbearContext {
             world,
@@ -237,6 +245,7 @@ impl ScriptManager {
             scene_loader,
             physics_state,
             ui_buffer,
+            audio,
         };
 
         if world.is_null() {
@@ -263,6 +272,9 @@ impl ScriptManager {
         if ui_buffer.is_null() {
             log::error!("UiBuffer pointer is null");
         }
+        if audio.is_null() {
+            log::error!("AudioEngine pointer is null");
+        }
 
         match &self.script_target {
             ScriptTarget::JVM { .. } => {
@@ -319,112 +331,6 @@ impl ScriptManager {
         Err(anyhow::anyhow!("Invalid script target configuration"))
     }
 
-    pub fn collision_event_script(
-        &mut self,
-        world: &World,
-        event: &CollisionEvent,
-    ) -> anyhow::Result<()> {
-        self.rebuild_entity_tag_database(world)?;
-
-        let a = event.collider1_entity_id();
-        let b = event.collider2_entity_id();
-
-        for (tag, entities) in &self.entity_tag_database {
-            let entity_ids: Vec<u64> = entities
-                .iter()
-                .map(|entity| entity.to_bits().get())
-                .collect();
-
-            if entity_ids.is_empty() {
-                continue;
-            }
-
-            let mut relevant = Vec::new();
-            if entity_ids.iter().any(|id| *id == a) {
-                relevant.push(a);
-            }
-            if b != a && entity_ids.iter().any(|id| *id == b) {
-                relevant.push(b);
-            }
-            if relevant.is_empty() {
-                continue;
-            }
-
-            match &self.script_target {
-                ScriptTarget::JVM { .. } => {
-                    if let Some(jvm) = &self.jvm {
-                        for current in relevant {
-                            jvm.collision_event(tag, current, event)?;
-                        }
-                    }
-                }
-                ScriptTarget::Native { .. } => {
-                    if let Some(library) = &self.library {
-                        for current in relevant {
-                            library.collision_event(tag, current, event)?;
-                        }
-                    }
-                }
-                ScriptTarget::None => {}
-            }
-        }
-
-        Ok(())
-    }
-
-    pub fn contact_force_event_script(
-        &mut self,
-        world: &World,
-        event: &ContactForceEvent,
-    ) -> anyhow::Result<()> {
-        self.rebuild_entity_tag_database(world)?;
-
-        let a = event.collider1_entity_id();
-        let b = event.collider2_entity_id();
-
-        for (tag, entities) in &self.entity_tag_database {
-            let entity_ids: Vec<u64> = entities
-                .iter()
-                .map(|entity| entity.to_bits().get())
-                .collect();
-
-            if entity_ids.is_empty() {
-                continue;
-            }
-
-            let mut relevant = Vec::new();
-            if entity_ids.iter().any(|id| *id == a) {
-                relevant.push(a);
-            }
-            if b != a && entity_ids.iter().any(|id| *id == b) {
-                relevant.push(b);
-            }
-            if relevant.is_empty() {
-                continue;
-            }
-
-            match &self.script_target {
-                ScriptTarget::JVM { .. } => {
-                    if let Some(jvm) = &self.jvm {
-                        for current in relevant {
-                            jvm.contact_force_event(tag, current, event)?;
-                        }
-                    }
-                }
-                ScriptTarget::Native { .. } => {
-                    if let Some(library) = &self.library {
-                        for current in relevant {
-                            library.contact_force_event(tag, current, event)?;
-                        }
-                    }
-                }
-                ScriptTarget::None => {}
-            }
-        }
-
-        Ok(())
-    }
-
     /// Updates the script as loaded into [`ScriptManager`].
     ///
     /// This function needs to be called every frame.
@@ -655,22 +561,45 @@ impl ScriptManager {
         }
     }
 
-    /// Rebuilds the ScriptManagers entity database by parsing a [`World`].
+    /// Brings the ScriptManagers entity database up to date with a [`World`].
+    ///
+    /// Only the entities whose [`Script`] changed are looked at again, unless entities gained or
+    /// lost one, in which case the database is rebuilt.
     ///
     /// If scripts are already loaded, this also:
     /// - loads tags entering scope, and
     /// - calls `destroy()` for tags leaving scope (without unloading instances).
     fn rebuild_entity_tag_database(&mut self, world: &World) -> anyhow::Result<()> {
-        let mut new_map: HashMap<String, Vec<Entity>> = HashMap::new();
-
-        for (entity, script) in world.query::<(Entity, &Script)>().iter() {
-            for tag in &script.tags {
-                new_map.entry(tag.clone()).or_default().push(entity);
+        puffin::profile_function!();
+        match self.script_changes.changed(world) {
+            Changes::Only([]) => {}
+            Changes::Only(changed) => {
+                let database = &mut self.entity_tag_database;
+                for entities in database.values_mut() {
+                    entities.retain(|entity| changed.binary_search(entity).is_err());
+                }
+                for entity in changed {
+                    if let Ok(script) = world.get::<&Script>(*entity) {
+                        for tag in &script.tags {
+                            database.entry(tag.clone()).or_default().push(*entity);
+                        }
+                    }
+                }
+                database.retain(|_, entities| !entities.is_empty());
+            }
+            Changes::All => {
+                let mut new_map: HashMap<String, Vec<Entity>> = HashMap::new();
+                for (entity, script) in world.query::<(Entity, &Script)>().iter() {
+                    for tag in &script.tags {
+                        new_map.entry(tag.clone()).or_default().push(entity);
+                    }
+                }
+                self.entity_tag_database = new_map;
             }
         }
 
+        let next_active: HashSet<String> = self.entity_tag_database.keys().cloned().collect();
         if self.scripts_loaded {
-            let next_active: HashSet<String> = new_map.keys().cloned().collect();
             let removed: Vec<String> = self.active_tags.difference(&next_active).cloned().collect();
             let added: Vec<String> = next_active.difference(&self.active_tags).cloned().collect();
 
@@ -680,13 +609,9 @@ impl ScriptManager {
             for tag in added {
                 self.load_tagged(&tag)?;
             }
-
-            self.active_tags = next_active;
-        } else {
-            self.active_tags = new_map.keys().cloned().collect();
         }
 
-        self.entity_tag_database = new_map;
+        self.active_tags = next_active;
         Ok(())
     }
 }
@@ -1030,4 +955,5 @@ pub struct DropbearContext {
     pub scene_loader: SceneLoaderPtr,
     pub physics_state: PhysicsStatePtr,
     pub ui_buffer: UiBufferPtr,
+    pub audio: AudioEnginePtr,
 }
@@ -0,0 +1,416 @@
+//! Batched delivery of physics events to scripts.
+//!
+//! A pile of debris can raise tens of thousands of collision and contact force events in one tick,
+//! and handing them to scripts one call at a time (with a walk over every tag for each) quickly
+//! becomes the slowest part of the frame. A [`PhysicsEventBuffer`] collects the events of a tick
+//! and drops the duplicates, then [`ScriptManager::dispatch_physics_events`] hands every tag the
+//! events of its entities in one call, as a contiguous array of records.
+//!
+//! Every field of a record is 8 bytes wide, so the records have no padding and can be read as a
+//! plain array of longs on the script side (doubles are stored as their bits).
+
+use crate::scripting::{ScriptManager, ScriptTarget};
+use crate::types::{CollisionEvent, CollisionEventType, ContactForceEvent, NCollider};
+use bytemuck::{Pod, Zeroable};
+use hecs::World;
+use std::collections::{HashMap, HashSet};
+
+/// A collider as stored in an event record.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, Pod, Zeroable)]
+pub struct ColliderRecord {
+    pub index: u64,
+    pub generation: u64,
+    pub entity_id: u64,
+    pub id: u64,
+}
+
+impl From<&NCollider> for ColliderRecord {
+    fn from(collider: &NCollider) -> Self {
+        Self {
+            index: collider.index.index as u64,
+            generation: collider.index.generation as u64,
+            entity_id: collider.entity_id,
+            id: collider.id as u64,
+        }
+    }
+}
+
+/// A [`CollisionEvent`] as delivered to the entity `current_entity_id`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, Pod, Zeroable)]
+pub struct CollisionEventRecord {
+    pub current_entity_id: u64,
+    /// `0` when the colliders started touching, `1` when they stopped.
+    pub event_type: u64,
+    pub collider1: ColliderRecord,
+    pub collider2: ColliderRecord,
+    pub flags: u64,
+}
+
+impl CollisionEventRecord {
+    /// The amount of 8 byte lanes in one record.
+    pub const LANES: usize = size_of::<Self>() / size_of::<u64>();
+
+    pub fn new(current_entity_id: u64, event: &CollisionEvent) -> Self {
+        Self {
+            current_entity_id,
+            event_type: match event.event_type {
+                CollisionEventType::Started => 0,
+                CollisionEventType::Stopped => 1,
+            },
+            collider1: (&event.collider1).into(),
+            collider2: (&event.collider2).into(),
+            flags: event.flags,
+        }
+    }
+}
+
+/// A [`ContactForceEvent`] as delivered to the entity `current_entity_id`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, Pod, Zeroable)]
+pub struct ContactForceEventRecord {
+    pub current_entity_id: u64,
+    pub collider1: ColliderRecord,
+    pub collider2: ColliderRecord,
+    pub total_force: [f64; 3],
+    pub total_force_magnitude: f64,
+    pub max_force_direction: [f64; 3],
+    pub max_force_magnitude: f64,
+}
+
+impl ContactForceEventRecord {
+    /// The amount of 8 byte lanes in one record.
+    pub const LANES: usize = size_of::<Self>() / size_of::<u64>();
+
+    pub fn new(current_entity_id: u64, event: &ContactForceEvent) -> Self {
+        let total = &event.total_force;
+        let direction = &event.max_force_direction;
+        Self {
+            current_entity_id,
+            collider1: (&event.collider1).into(),
+            collider2: (&event.collider2).into(),
+            total_force: [total.x, total.y, total.z],
+            total_force_magnitude: event.total_force_magnitude,
+            max_force_direction: [direction.x, direction.y, direction.z],
+            max_force_magnitude: event.max_force_magnitude,
+        }
+    }
+}
+
+/// Two colliders, in the same order no matter which one the event named first.
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+struct ColliderPair(u64, u64);
+
+impl ColliderPair {
+    fn new(a: &NCollider, b: &NCollider) -> Self {
+        let raw = |c: &NCollider| (c.index.index as u64) | ((c.index.generation as u64) << 32);
+        let (a, b) = (raw(a), raw(b));
+        Self(a.min(b), a.max(b))
+    }
+}
+
+/// The physics events of one tick, waiting to be handed to scripts.
+#[derive(Default)]
+pub struct PhysicsEventBuffer {
+    tick: u64,
+    collisions: Vec<CollisionEvent>,
+    seen_collisions: HashSet<(ColliderPair, bool)>,
+    contact_forces: Vec<ContactForceEvent>,
+    contact_force_slots: HashMap<ColliderPair, usize>,
+    /// The tick each pair last had a contact force event let through.
+    last_contact_force: HashMap<ColliderPair, u64>,
+    contact_force_interval: u64,
+}
+
+impl PhysicsEventBuffer {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Lets through at most one contact force event for each pair of colliders every `ticks`
+    /// ticks, or every tick with `None`. Collision start and stop events are never throttled.
+    pub fn set_contact_force_interval(&mut self, ticks: Option<u32>) {
+        self.contact_force_interval = ticks.unwrap_or(1).max(1) as u64;
+    }
+
+    pub fn collisions(&self) -> &[CollisionEvent] {
+        &self.collisions
+    }
+
+    pub fn contact_forces(&self) -> &[ContactForceEvent] {
+        &self.contact_forces
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.collisions.is_empty() && self.contact_forces.is_empty()
+    }
+
+    /// Adds a collision event, unless the same pair already started (or stopped) touching this
+    /// tick.
+    pub fn push_collision(&mut self, event: CollisionEvent) {
+        let pair = ColliderPair::new(&event.collider1, &event.collider2);
+        let started = matches!(event.event_type, CollisionEventType::Started);
+        if self.seen_collisions.insert((pair, started)) {
+            self.collisions.push(event);
+        }
+    }
+
+    /// Adds a contact force event. A pair only gets one event per tick, the strongest one.
+    pub fn push_contact_force(&mut self, event: ContactForceEvent) {
+        let pair = ColliderPair::new(&event.collider1, &event.collider2);
+
+        if let Some(&slot) = self.contact_force_slots.get(&pair) {
+            let current = &mut self.contact_forces[slot];
+            if event.total_force_magnitude > current.total_force_magnitude {
+                *current = event;
+            }
+            return;
+        }
+
+        if let Some(&last) = self.last_contact_force.get(&pair)
+            && self.tick - last < self.contact_force_interval
+        {
+            return;
+        }
+
+        self.last_contact_force.insert(pair, self.tick);
+        self.contact_force_slots
+            .insert(pair, self.contact_forces.len());
+        self.contact_forces.push(event);
+    }
+
+    /// Forgets the events of this tick and moves on to the next.
+    pub fn finish_tick(&mut self) {
+        self.collisions.clear();
+        self.seen_collisions.clear();
+        self.contact_forces.clear();
+        self.contact_force_slots.clear();
+
+        self.tick += 1;
+        let (tick, interval) = (self.tick, self.contact_force_interval);
+        self.last_contact_force
+            .retain(|_, last| tick - *last < interval);
+    }
+
+    /// Forgets everything, throttling included, such as when the scene is replaced.
+    pub fn clear(&mut self) {
+        self.finish_tick();
+        self.last_contact_force.clear();
+    }
+}
+
+/// `a` and `b`, or just `a` when an entity collided with itself.
+fn involved(a: u64, b: u64) -> impl Iterator<Item = u64> {
+    std::iter::once(a).chain((b != a).then_some(b))
+}
+
+/// The records of one tag, ready to be handed to its scripts.
+#[derive(Default)]
+struct TagEvents {
+    collisions: Vec<CollisionEventRecord>,
+    contact_forces: Vec<ContactForceEventRecord>,
+}
+
+impl ScriptManager {
+    /// Hands the events in `events` to the scripts of the entities involved, with one call per
+    /// tag for each kind of event, then clears `events` for the next tick.
+    pub fn dispatch_physics_events(
+        &mut self,
+        world: &World,
+        events: &mut PhysicsEventBuffer,
+    ) -> anyhow::Result<()> {
+        puffin::profile_function!();
+
+        let result = if events.is_empty() {
+            Ok(())
+        } else {
+            self.deliver_physics_events(world, events)
+        };
+        events.finish_tick();
+        result
+    }
+
+    fn deliver_physics_events(
+        &mut self,
+        world: &World,
+        events: &PhysicsEventBuffer,
+    ) -> anyhow::Result<()> {
+        self.rebuild_entity_tag_database(world)?;
+
+        // every entity maps to the tags it has, so each event is only looked at once
+        let tags: Vec<&String> = self.entity_tag_database.keys().collect();
+        let mut tags_of: HashMap<u64, Vec<usize>> = HashMap::new();
+        for (index, entities) in self.entity_tag_database.values().enumerate() {
+            for entity in entities {
+                tags_of
+                    .entry(entity.to_bits().get())
+                    .or_default()
+                    .push(index);
+            }
+        }
+
+        let mut per_tag: Vec<TagEvents> = std::iter::repeat_with(TagEvents::default)
+            .take(tags.len())
+            .collect();
+
+        for event in events.collisions() {
+            let (a, b) = (event.collider1_entity_id(), event.collider2_entity_id());
+            for current in involved(a, b) {
+                for &tag in tags_of.get(&current).into_iter().flatten() {
+                    per_tag[tag]
+                        .collisions
+                        .push(CollisionEventRecord::new(current, event));
+                }
+            }
+        }
+
+        for event in events.contact_forces() {
+            let (a, b) = (event.collider1_entity_id(), event.collider2_entity_id());
+            for current in involved(a, b) {
+                for &tag in tags_of.get(&current).into_iter().flatten() {
+                    per_tag[tag]
+                        .contact_forces
+                        .push(ContactForceEventRecord::new(current, event));
+                }
+            }
+        }
+
+        for (tag, records) in tags.into_iter().zip(per_tag) {
+            let TagEvents {
+                collisions,
+                contact_forces,
+            } = records;
+            if collisions.is_empty() && contact_forces.is_empty() {
+                continue;
+            }
+
+            match &self.script_target {
+                ScriptTarget::JVM { .. } => {
+                    if let Some(jvm) = &self.jvm {
+                        if !collisions.is_empty() {
+                            jvm.collision_events(tag, &collisions)?;
+                        }
+                        if !contact_forces.is_empty() {
+                            jvm.contact_force_events(tag, &contact_forces)?;
+                        }
+                    }
+                }
+                ScriptTarget::Native { .. } => {
+                    if let Some(library) = &self.library {
+                        if !collisions.is_empty() {
+                            library.collision_events(tag, &collisions)?;
+                        }
+                        if !contact_forces.is_empty() {
+                            library.contact_force_events(tag, &contact_forces)?;
+                        }
+                    }
+                }
+                ScriptTarget::None => {}
+            }
+        }
+
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::types::{IndexNative, NVector3};
+
+    fn collider(index: u32) -> NCollider {
+        NCollider {
+            index: IndexNative {
+                index,
+                generation: 0,
+            },
+            entity_id: index as u64 + 100,
+            id: index,
+        }
+    }
+
+    fn collision(a: u32, b: u32, event_type: CollisionEventType) -> CollisionEvent {
+        CollisionEvent {
+            event_type,
+            collider1: collider(a),
+            collider2: collider(b),
+            flags: 0,
+        }
+    }
+
+    fn contact_force(a: u32, b: u32, magnitude: f64) -> ContactForceEvent {
+        ContactForceEvent {
+            collider1: collider(a),
+            collider2: collider(b),
+            total_force: NVector3::new(0.0, magnitude, 0.0),
+            total_force_magnitude: magnitude,
+            max_force_direction: NVector3::new(0.0, 1.0, 0.0),
+            max_force_magnitude: magnitude,
+        }
+    }
+
+    #[test]
+    fn collisions_are_deduplicated_per_pair_and_kind() {
+        let mut buffer = PhysicsEventBuffer::new();
+        buffer.push_collision(collision(1, 2, CollisionEventType::Started));
+        // the same pair, named the other way around
+        buffer.push_collision(collision(2, 1, CollisionEventType::Started));
+        buffer.push_collision(collision(1, 2, CollisionEventType::Stopped));
+        buffer.push_collision(collision(1, 3, CollisionEventType::Started));
+        assert_eq!(buffer.collisions().len(), 3);
+
+        buffer.finish_tick();
+        assert!(buffer.is_empty());
+        buffer.push_collision(collision(1, 2, CollisionEventType::Started));
+        assert_eq!(buffer.collisions().len(), 1);
+    }
+
+    #[test]
+    fn contact_forces_keep_the_strongest_event_per_pair() {
+        let mut buffer = PhysicsEventBuffer::new();
+        buffer.push_contact_force(contact_force(1, 2, 5.0));
+        buffer.push_contact_force(contact_force(2, 1, 9.0));
+        buffer.push_contact_force(contact_force(1, 2, 3.0));
+        buffer.push_contact_force(contact_force(1, 3, 1.0));
+
+        let forces = buffer.contact_forces();
+        assert_eq!(forces.len(), 2);
+        assert_eq!(forces[0].total_force_magnitude, 9.0);
+        assert_eq!(forces[1].total_force_magnitude, 1.0);
+    }
+
+    #[test]
+    fn contact_forces_are_throttled_per_pair() {
+        let mut buffer = PhysicsEventBuffer::new();
+        buffer.set_contact_force_interval(Some(3));
+
+        let mut delivered = Vec::new();
+        for _ in 0..7 {
+            buffer.push_contact_force(contact_force(1, 2, 1.0));
+            delivered.push(buffer.contact_forces().len());
+            buffer.finish_tick();
+        }
+        assert_eq!(delivered, vec![1, 0, 0, 1, 0, 0, 1]);
+
+        // a pair that was quiet is let through straight away
+        buffer.push_contact_force(contact_force(1, 3, 1.0));
+        assert_eq!(buffer.contact_forces().len(), 1);
+
+        // throttling is forgotten along with the scene
+        buffer.clear();
+        buffer.push_contact_force(contact_force(1, 2, 1.0));
+        assert_eq!(buffer.contact_forces().len(), 1);
+    }
+
+    #[test]
+    fn collisions_are_never_throttled() {
+        let mut buffer = PhysicsEventBuffer::new();
+        buffer.set_contact_force_interval(Some(10));
+        for _ in 0..3 {
+            buffer.push_collision(collision(1, 2, CollisionEventType::Started));
+            assert_eq!(buffer.collisions().len(), 1);
+            buffer.finish_tick();
+        }
+    }
+}
@@ -9,6 +9,7 @@ use crate::ptr::WorldPtr;
 use crate::scripting::DropbearContext;
 use crate::scripting::JVM_ARGS;
 use crate::scripting::error::LastErrorMessage;
+use crate::scripting::events::{CollisionEventRecord, ContactForceEventRecord};
 use crate::scripting::jni::utils::ToJObject;
 use crate::types::{CollisionEvent, ContactForceEvent};
 use jni::objects::{Global, JClass, JLongArray, JObject, JString, JValue};
@@ -309,6 +310,7 @@ impl JavaContext {
             let scene_loader_handle = context.scene_loader as jlong;
             let physics_handle = context.physics_state as jlong;
             let ui_handle = context.ui_buffer as jlong;
+            let audio_handle = context.audio as jlong;
 
             let args = [
                 JValue::Long(world_handle),
@@ -319,6 +321,7 @@ impl JavaContext {
                 JValue::Long(scene_loader_handle),
                 JValue::Long(physics_handle),
                 JValue::Long(ui_handle),
+                JValue::Long(audio_handle),
             ];
 
             let mut sig = String::from("(");
@@ -624,6 +627,55 @@ impl JavaContext {
         }
     }
 
+    /// Delivers a tick's collision events for `tag` in one call, as a `long[]` of
+    /// [`CollisionEventRecord`]s.
+    pub fn collision_events(
+        &self,
+        tag: &str,
+        events: &[CollisionEventRecord],
+    ) -> anyhow::Result<()> {
+        self.call_with_records(tag, "collisionEvents", bytemuck::cast_slice(events))
+    }
+
+    /// Delivers a tick's contact force events for `tag` in one call, as a `long[]` of
+    /// [`ContactForceEventRecord`]s.
+    pub fn contact_force_events(
+        &self,
+        tag: &str,
+        events: &[ContactForceEventRecord],
+    ) -> anyhow::Result<()> {
+        self.call_with_records(tag, "collisionForceEvents", bytemuck::cast_slice(events))
+    }
+
+    fn call_with_records(&self, tag: &str, method: &str, lanes: &[i64]) -> anyhow::Result<()> {
+        if let Some(ref manager_ref) = self.system_manager_instance {
+            let jvm = JavaVM::singleton()?;
+            jvm.attach_current_thread(|env| -> anyhow::Result<()> {
+                let tag_jstring = env.new_string(tag)?;
+                let lane_array: JLongArray = env.new_long_array(lanes.len())?;
+                lane_array.set_region(env, 0, lanes)?;
+                let lane_array_obj = JObject::from(lane_array);
+
+                env.call_method(
+                    manager_ref,
+                    JNIString::from(method),
+                    jni_sig!((java.lang.String, [long]) -> ()),
+                    &[
+                        JValue::Object(&tag_jstring),
+                        JValue::Object(&lane_array_obj),
+                    ],
+                )?;
+
+                Ok(())
+            })
+        } else {
+            Err(anyhow::anyhow!(
+                "SystemManager not initialised when delivering {}.",
+                method
+            ))
+        }
+    }
+
     pub fn update_all_systems(&self, dt: f64) -> anyhow::Result<()> {
         if let Some(ref manager_ref) = self.system_manager_instance {
             let jvm = JavaVM::singleton()?;
@@ -14,6 +14,7 @@ use libloading::{Library, Symbol};
 use std::ffi::CString;
 // use std::fmt::{Display, Formatter}; // Display derived by thiserror
 use crate::scripting::DropbearContext;
+use crate::scripting::events::{CollisionEventRecord, ContactForceEventRecord};
 use crate::types::{
     CollisionEvent as CollisionEventFFI, ContactForceEvent as ContactForceEventFFI,
 };
@@ -42,6 +43,9 @@ pub struct NativeLibrary {
 
     collision_event_fn: Symbol<'static, CollisionEvent>,
     contact_force_event_fn: Symbol<'static, ContactForceEvent>,
+    /// Libraries generated before batched events existed only have the per event functions.
+    collision_events_fn: Option<Symbol<'static, sig::CollisionEvents>>,
+    contact_force_events_fn: Option<Symbol<'static, sig::ContactForceEvents>>,
 
     // err msg
     #[allow(dead_code)]
@@ -136,6 +140,24 @@ impl NativeLibrary {
                 &[b"dropbear_contact_force_event\0"],
                 "dropbear_contact_force_event",
             )?;
+            let collision_events_fn = library
+                .get::<sig::CollisionEvents>(b"dropbear_collision_events\0")
+                .ok()
+                .map(|s| {
+                    std::mem::transmute::<
+                        Symbol<sig::CollisionEvents>,
+                        Symbol<'static, sig::CollisionEvents>,
+                    >(s)
+                });
+            let contact_force_events_fn = library
+                .get::<sig::ContactForceEvents>(b"dropbear_contact_force_events\0")
+                .ok()
+                .map(|s| {
+                    std::mem::transmute::<
+                        Symbol<sig::ContactForceEvents>,
+                        Symbol<'static, sig::ContactForceEvents>,
+                    >(s)
+                });
             let get_last_err_msg_fn = load_symbol(
                 &library,
                 &[
@@ -189,6 +211,8 @@ impl NativeLibrary {
 
                 collision_event_fn,
                 contact_force_event_fn,
+                collision_events_fn,
+                contact_force_events_fn,
                 get_last_err_msg_fn,
                 set_last_err_msg_fn,
                 update_kotlin_component_fn,
@@ -292,6 +316,96 @@ impl NativeLibrary {
         }
     }
 
+    /// Delivers a tick's collision events for `tag` in one call, or one call per event if the
+    /// library has no `dropbear_collision_events`.
+    pub fn collision_events(
+        &self,
+        tag: &str,
+        events: &[CollisionEventRecord],
+    ) -> anyhow::Result<()> {
+        let c_string = CString::new(tag)?;
+
+        let Some(collision_events_fn) = &self.collision_events_fn else {
+            for event in events {
+                let result = unsafe {
+                    (self.collision_event_fn)(
+                        c_string.as_ptr(),
+                        event.current_entity_id,
+                        event.event_type as i32,
+                        event.collider1.index as i32,
+                        event.collider1.generation as i32,
+                        event.collider1.entity_id,
+                        event.collider1.id as i32,
+                        event.collider2.index as i32,
+                        event.collider2.generation as i32,
+                        event.collider2.entity_id,
+                        event.collider2.id as i32,
+                        event.flags,
+                    )
+                };
+                self.handle_result(result, "collision_event")?;
+            }
+            return Ok(());
+        };
+
+        unsafe {
+            let result = collision_events_fn(
+                c_string.as_ptr(),
+                events.as_ptr() as *const u64,
+                events.len() as i32,
+            );
+            self.handle_result(result, "collision_events")
+        }
+    }
+
+    /// Delivers a tick's contact force events for `tag` in one call, or one call per event if
+    /// the library has no `dropbear_contact_force_events`.
+    pub fn contact_force_events(
+        &self,
+        tag: &str,
+        events: &[ContactForceEventRecord],
+    ) -> anyhow::Result<()> {
+        let c_string = CString::new(tag)?;
+
+        let Some(contact_force_events_fn) = &self.contact_force_events_fn else {
+            for event in events {
+                let result = unsafe {
+                    (self.contact_force_event_fn)(
+                        c_string.as_ptr(),
+                        event.current_entity_id,
+                        event.collider1.index as i32,
+                        event.collider1.generation as i32,
+                        event.collider1.entity_id,
+                        event.collider1.id as i32,
+                        event.collider2.index as i32,
+                        event.collider2.generation as i32,
+                        event.collider2.entity_id,
+                        event.collider2.id as i32,
+                        event.total_force[0],
+                        event.total_force[1],
+                        event.total_force[2],
+                        event.total_force_magnitude,
+                        event.max_force_direction[0],
+                        event.max_force_direction[1],
+                        event.max_force_direction[2],
+                        event.max_force_magnitude,
+                    )
+                };
+                self.handle_result(result, "contact_force_event")?;
+            }
+            return Ok(());
+        };
+
+        unsafe {
+            let result = contact_force_events_fn(
+                c_string.as_ptr(),
+                events.as_ptr() as *const u64,
+                events.len() as i32,
+            );
+            self.handle_result(result, "contact_force_events")
+        }
+    }
+
     pub fn update_all(&mut self, dt: f64) -> anyhow::Result<()> {
         unsafe {
             let result = (self.update_all_fn)(dt);
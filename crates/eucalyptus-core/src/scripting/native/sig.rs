@@ -71,6 +71,19 @@ pub type ContactForceEvent = unsafe extern "C" fn(
     max_fz: f64,
     max_force_magnitude: f64,
 ) -> i32;
+
+/// CName: `dropbear_collision_events`
+///
+/// `events` points to `count` [`crate::scripting::events::CollisionEventRecord`]s.
+pub type CollisionEvents =
+    unsafe extern "C" fn(tag: *const c_char, events: *const u64, count: i32) -> i32;
+
+/// CName: `dropbear_contact_force_events`
+///
+/// `events` points to `count` [`crate::scripting::events::ContactForceEventRecord`]s.
+pub type ContactForceEvents =
+    unsafe extern "C" fn(tag: *const c_char, events: *const u64, count: i32) -> i32;
+
 /// CName: `dropbear_destroy_tagged`
 pub type DestroyTagged = unsafe extern "C" fn(tag: *const c_char) -> i32;
 /// CName: `dropbear_destroy_in_scope_tagged`
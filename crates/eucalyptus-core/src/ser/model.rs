@@ -4,6 +4,7 @@ use dropbear_engine::graphics::SharedGraphicsContext;
 use dropbear_engine::model::{
     AlphaMode, Animation, Material, Mesh, Model, ModelVertex, Node, Skin,
 };
+use dropbear_engine::streaming::StreamSource;
 use dropbear_engine::texture::{Texture, TextureWrapMode};
 use dropbear_engine::utils::ResourceReference;
 use dropbear_engine::wgpu;
@@ -299,6 +300,8 @@ impl EucalyptusMaterial {
                         dropbear_engine::texture::TextureBuilder::new(&graphics.device)
                             .with_bytes(graphics.clone(), bytes.as_slice())
                             .label(label.as_str())
+                            .stream_source(StreamSource::File(abs.clone()))
+                            .streamed()
                             .build();
                     texture.reference = engine_ref;
                     let mut registry = ASSET_REGISTRY.write();
@@ -313,6 +316,7 @@ impl EucalyptusMaterial {
                 let texture = dropbear_engine::texture::TextureBuilder::new(&graphics.device)
                     .with_bytes(graphics.clone(), bytes)
                     .label(label.as_str())
+                    .streamed()
                     .build();
                 let mut registry = ASSET_REGISTRY.write();
                 Some(registry.add_texture(texture))
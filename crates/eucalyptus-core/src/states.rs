@@ -3,6 +3,7 @@
 //! It's really just a "throw everything in here, organise later".
 
 use crate::camera::{CameraComponent, CameraType};
+use crate::change::mark_changed;
 use crate::component::{
     Component, ComponentDescriptor, ComponentInitFuture, DisabilityFlags, InspectableComponent,
     SerializedComponent,
@@ -214,13 +215,16 @@ impl InspectableComponent for Script {
                     .id_salt(format!("Scripting Tags {}", entity.to_bits()))
                     .show(ui, |ui| {
                         let mut local_del: Option<usize> = None;
+                        let mut edited = false;
                         for (i, tag) in self.tags.iter_mut().enumerate() {
                             let current_width = ui.available_width();
                             ui.horizontal(|ui| {
-                                ui.add_sized(
-                                    [current_width * 70.0 / 100.0, 20.0],
-                                    TextEdit::singleline(tag),
-                                );
+                                edited |= ui
+                                    .add_sized(
+                                        [current_width * 70.0 / 100.0, 20.0],
+                                        TextEdit::singleline(tag),
+                                    )
+                                    .changed();
                                 if ui.button("🗑️").clicked() {
                                     local_del = Some(i);
                                 }
@@ -228,9 +232,15 @@ impl InspectableComponent for Script {
                         }
                         if let Some(i) = local_del {
                             self.tags.remove(i);
+                            edited = true;
                         }
                         if ui.button("➕ Add").clicked() {
-                            self.tags.push(String::new())
+                            self.tags.push(String::new());
+                            edited = true;
+                        }
+                        // the tag database of the script manager is rebuilt from these
+                        if edited {
+                            mark_changed::<Script>(entity);
                         }
                     });
             });
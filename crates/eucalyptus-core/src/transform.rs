@@ -1,4 +1,5 @@
 use crate::camera::{CameraComponent, CameraType};
+use crate::change::mark_changed;
 use crate::component::{
     Component, ComponentDescriptor, ComponentInitFuture, DisabilityFlags, InspectableComponent,
     SerializedComponent,
@@ -249,12 +250,13 @@ impl Component for OnRails {
         _graphics: Arc<SharedGraphicsContext>,
     ) {
         // this might be bad practice, idk
-        for (rails, et) in
-            world.query::<(&mut OnRails, &mut EntityTransform)>().iter()
+        for (rail_entity, rails, et) in
+            world.query::<(Entity, &mut OnRails, &mut EntityTransform)>().iter()
         {
             if let Some((pos, rot)) = rails.pending_transform.take() {
                 et.world_mut().position = pos;
                 et.world_mut().rotation = rot;
+                mark_changed::<EntityTransform>(rail_entity);
             }
         }
 
@@ -386,6 +388,7 @@ impl InspectableComponent for OnRails {
                     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
                         et.world_mut().position = snapped;
                         et.world_mut().rotation = rot;
+                        mark_changed::<EntityTransform>(entity);
                     }
                     if let Ok(mut camera) = world.get::<&mut Camera>(entity) {
                         apply_rot_to_camera(&mut camera, snapped, rot);
@@ -413,6 +416,7 @@ impl InspectableComponent for OnRails {
                     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
                         et.world_mut().position = pos;
                         et.world_mut().rotation = rot;
+                        mark_changed::<EntityTransform>(entity);
                     }
                     if let Ok(mut camera) = world.get::<&mut Camera>(entity) {
                         apply_rot_to_camera(&mut camera, pos, rot);
@@ -423,6 +423,65 @@ impl From<rapier3d::parry::query::ShapeCastStatus> for NShapeCastStatus {
     }
 }
 
+// ------------------------------------------------------------ scene queries --
+
+/// A ray for a batched scene query, see [`crate::physics::query`].
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct NRay {
+    pub origin: NVector3,
+    pub direction: NVector3,
+    pub max_distance: f64,
+}
+
+/// Which colliders a scene query can hit.
+///
+/// `memberships` and `filter` are collision group bit masks, compared like rapier's
+/// `InteractionGroups`. `exclude_entity` skips the colliders of an entity, such as the one doing
+/// the query, and is `0` to not skip any.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct NQueryFilter {
+    pub memberships: u32,
+    pub filter: u32,
+    pub exclude_sensors: bool,
+    pub exclude_fixed: bool,
+    pub exclude_dynamic: bool,
+    pub exclude_kinematic: bool,
+    pub exclude_entity: u64,
+}
+
+impl Default for NQueryFilter {
+    fn default() -> Self {
+        Self {
+            memberships: u32::MAX,
+            filter: u32::MAX,
+            exclude_sensors: false,
+            exclude_fixed: false,
+            exclude_dynamic: false,
+            exclude_kinematic: false,
+            exclude_entity: 0,
+        }
+    }
+}
+
+/// A collider hit by the query at `query` in a batch.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct NQueryHit {
+    pub query: u32,
+    pub collider: NCollider,
+    pub distance: f64,
+}
+
+/// A shape cast hit by the cast at `query` in a batch.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct NShapeQueryHit {
+    pub query: u32,
+    pub hit: NShapeCastHit,
+}
+
 // -------------------------------------------------------------- event types --
 
 #[repr(C)]
@@ -457,18 +516,7 @@ impl CollisionEvent {
             physics: &PhysicsState,
             handle: ColliderHandle,
         ) -> Option<hecs::Entity> {
-            let label = physics.colliders_entity_map.iter().find_map(|(l, s)| {
-                for (_, h) in s {
-                    if *h == handle {
-                        return Some(l.clone());
-                    }
-                }
-                None
-            })?;
-            physics
-                .entity_label_map
-                .iter()
-                .find_map(|(e, l)| if l == &label { Some(*e) } else { None })
+            physics.collider_entity(handle)
         }
 
         match value {
@@ -535,20 +583,7 @@ impl ContactForceEvent {
         physics: &PhysicsState,
         event: rapier3d::prelude::ContactForceEvent,
     ) -> Option<Self> {
-        let find_entity = |handle: ColliderHandle| -> Option<hecs::Entity> {
-            let label = physics.colliders_entity_map.iter().find_map(|(l, s)| {
-                for (_, h) in s {
-                    if *h == handle {
-                        return Some(l.clone());
-                    }
-                }
-                None
-            })?;
-            physics
-                .entity_label_map
-                .iter()
-                .find_map(|(e, l)| if l == &label { Some(*e) } else { None })
-        };
+        let find_entity = |handle: ColliderHandle| physics.collider_entity(handle);
 
         Some(Self {
             collider1: NCollider {
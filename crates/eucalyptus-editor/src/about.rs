@@ -29,7 +29,7 @@ impl AboutWindow {
 
 impl Scene for AboutWindow {
     fn load(&mut self, graphics: std::sync::Arc<dropbear_engine::graphics::SharedGraphicsContext>, _ui: &mut Ui,) {
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn physics_update(
@@ -73,7 +73,7 @@ impl Scene for AboutWindow {
             });
         });
 
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn render<'a>(
@@ -32,7 +32,7 @@ impl DebugWindow {
 
 impl Scene for DebugWindow {
     fn load(&mut self, graphics: std::sync::Arc<dropbear_engine::graphics::SharedGraphicsContext>, _ui: &mut Ui,) {
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn physics_update(
@@ -53,7 +53,7 @@ impl Scene for DebugWindow {
             ui.label("Hello Debug Window!");
         });
 
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn render<'a>(
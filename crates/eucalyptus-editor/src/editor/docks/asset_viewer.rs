@@ -1,23 +1,27 @@
 use dropbear_engine::asset::ASSET_REGISTRY;
+use dropbear_engine::future::JobPriority;
 use dropbear_engine::model::Model;
 use dropbear_engine::texture::TextureBuilder;
+use dropbear_engine::graphics::SharedGraphicsContext;
 use dropbear_engine::{graphics::NO_TEXTURE, utils::ResourceReference};
 use egui_ltreeview::{Action, NodeBuilder, TreeViewBuilder};
 use eucalyptus_core::ser::model::EucalyptusModel;
+use eucalyptus_core::asset_index::ASSET_INDEX;
 use eucalyptus_core::states::PROJECT;
 use eucalyptus_core::utils::ResolveReference;
 use hecs::Entity;
 use log::{info, warn};
 use std::hash::{Hash, Hasher};
 use std::{
-    cmp::Ordering,
     fs,
     hash::DefaultHasher,
     io,
     path::{Path, PathBuf},
+    sync::Arc,
 };
 
 use crate::editor::page::EditorTabVisibility;
+use crate::editor::project_tree::PROJECT_TREE;
 use crate::editor::{
     AssetDivision, AssetNodeInfo, AssetNodeKind, ComponentNodeSelection, DraggedAsset,
     EditorTabDock, EditorTabDockDescriptor, EditorTabViewer, FsEntry, ResourceDivision,
@@ -168,7 +172,7 @@ impl<'a> EditorTabViewer<'a> {
             }
         };
 
-        for entry in entries {
+        for entry in entries.iter() {
             let full_label = Self::resource_label(base_path, &entry.path);
             if entry.is_dir {
                 let dir_info = AssetNodeInfo {
@@ -336,7 +340,7 @@ impl<'a> EditorTabViewer<'a> {
         };
 
         let mut had_content = false;
-        for entry in entries {
+        for entry in entries.iter() {
             if entry.is_dir {
                 let source_label = format!("{}/{}", label, entry.name);
                 let kotlin_root = entry.path.join("kotlin");
@@ -416,7 +420,7 @@ impl<'a> EditorTabViewer<'a> {
         };
 
         let mut had_content = false;
-        for entry in entries {
+        for entry in entries.iter() {
             if entry.is_dir {
                 if entry.name.eq_ignore_ascii_case("kotlin") {
                     if self.build_kotlin_tree(cfg, builder, &entry.path, source_label) {
@@ -523,7 +527,7 @@ impl<'a> EditorTabViewer<'a> {
             return;
         }
 
-        for entry in entries {
+        for entry in entries.iter() {
             let child_label = format!("{}/{}", parent_label, entry.name);
             if entry.is_dir {
                 let dir_info = AssetNodeInfo {
@@ -606,7 +610,7 @@ impl<'a> EditorTabViewer<'a> {
         }
 
         let mut had_entries = false;
-        for entry in entries {
+        for entry in entries.iter() {
             if entry.is_dir {
                 self.build_kotlin_package_collapsed(
                     cfg,
@@ -785,7 +789,7 @@ impl<'a> EditorTabViewer<'a> {
         };
 
         let mut had_entries = false;
-        for entry in entries {
+        for entry in entries.iter() {
             if entry.is_dir {
                 let child_label = format!("{}/{}", label, entry.name);
                 let dir_info = AssetNodeInfo {
@@ -852,26 +856,10 @@ impl<'a> EditorTabViewer<'a> {
         builder.close_dir();
     }
 
-    fn sorted_entries(path: &Path) -> io::Result<Vec<FsEntry>> {
-        let mut entries = Vec::new();
-        for entry in fs::read_dir(path)? {
-            let entry = entry?;
-            let file_type = entry.file_type()?;
-            let name = entry.file_name().to_string_lossy().to_string();
-            entries.push(FsEntry {
-                path: entry.path(),
-                name_lower: name.to_lowercase(),
-                name,
-                is_dir: file_type.is_dir(),
-            });
-        }
-
-        entries.sort_by(|a, b| match b.is_dir.cmp(&a.is_dir) {
-            Ordering::Equal => a.name_lower.cmp(&b.name_lower),
-            other => other,
-        });
-
-        Ok(entries)
+    /// Directory listings come from the cached [`PROJECT_TREE`] rather than the filesystem, so
+    /// drawing the tree doesn't hit the disk every frame.
+    fn sorted_entries(path: &Path) -> io::Result<Arc<[FsEntry]>> {
+        PROJECT_TREE.lock().entries(path)
     }
 
     fn asset_node_id(label: &str) -> u64 {
@@ -1102,6 +1090,7 @@ impl<'a> EditorTabViewer<'a> {
                     );
                 }
             }
+            ASSET_INDEX.write().moved(&rename.original_path, &target_path);
         }
     }
 
@@ -1121,6 +1110,7 @@ impl<'a> EditorTabViewer<'a> {
             warn!("Failed to delete '{}': {}", info.path.display(), err);
         } else {
             info!("Deleted {}", info.path.display());
+            ASSET_INDEX.write().removed(&info.path);
             if !info.is_dir {
                 let meta = PathBuf::from(format!("{}.eucmeta", info.path.display()));
                 if meta.exists() {
@@ -1245,6 +1235,7 @@ impl<'a> EditorTabViewer<'a> {
                     }
                 }
             }
+            ASSET_INDEX.write().moved(&source_info.path, &target_path);
         }
     }
 
@@ -1278,15 +1269,32 @@ impl<'a> EditorTabViewer<'a> {
         queue.push(async move {
             let path = reference.resolve()?;
             let buffer = fs::read(&path)?;
-            let extension = path
-                .extension()
-                .and_then(|ext| ext.to_str())
-                .map(|ext| ext.to_ascii_lowercase());
 
-            let handle = match extension.as_deref() {
-                Some("eucmdl") => {
-                    let model = rkyv::from_bytes::<EucalyptusModel, rkyv::rancor::Error>(&buffer)
-                        .map_err(|e| {
+            // only the read belongs on the I/O runtime, parsing the model is CPU bound
+            let queue = graphics.future_queue.clone();
+            queue.push_compute_future(JobPriority::Normal, async move {
+                Self::parse_model(graphics, reference, label, path, buffer).await
+            });
+            Ok::<(), anyhow::Error>(())
+        });
+    }
+
+    async fn parse_model(
+        graphics: Arc<SharedGraphicsContext>,
+        reference: ResourceReference,
+        label: String,
+        path: PathBuf,
+        buffer: Vec<u8>,
+    ) -> anyhow::Result<()> {
+        let extension = path
+            .extension()
+            .and_then(|ext| ext.to_str())
+            .map(|ext| ext.to_ascii_lowercase());
+
+        let handle = match extension.as_deref() {
+            Some("eucmdl") => {
+                let model = rkyv::from_bytes::<EucalyptusModel, rkyv::rancor::Error>(&buffer)
+                    .map_err(|e| {
                         anyhow::anyhow!(
                             "Unable to deserialize .eucmdl model '{}': {}",
                             path.display(),
@@ -1294,33 +1302,32 @@ impl<'a> EditorTabViewer<'a> {
                         )
                     })?;
 
-                    let runtime_model = model.load(reference.clone(), graphics.clone());
-                    let mut registry = ASSET_REGISTRY.write();
-                    registry.add_model_with_label(label.clone(), runtime_model)
+                let runtime_model = model.load(reference.clone(), graphics.clone());
+                let mut registry = ASSET_REGISTRY.write();
+                registry.add_model_with_label(label.clone(), runtime_model)
+            }
+            _ => match Model::load_from_memory_raw(
+                graphics.clone(),
+                buffer,
+                Some(reference.clone()),
+                Some(label.as_str()),
+                ASSET_REGISTRY.clone(),
+            )
+            .await
+            {
+                Ok(v) => v,
+                Err(e) => {
+                    eucalyptus_core::warn!("Unable to load model {}: {}", reference, e);
+                    return Err(e);
                 }
-                _ => match Model::load_from_memory_raw(
-                    graphics.clone(),
-                    buffer,
-                    Some(reference.clone()),
-                    Some(label.as_str()),
-                    ASSET_REGISTRY.clone(),
-                )
-                .await
-                {
-                    Ok(v) => v,
-                    Err(e) => {
-                        eucalyptus_core::warn!("Unable to load model {}: {}", reference, e);
-                        return Err(e);
-                    }
-                },
-            };
+            },
+        };
 
-            let mut registry = ASSET_REGISTRY.write();
-            registry.label_model(label.clone(), handle);
+        let mut registry = ASSET_REGISTRY.write();
+        registry.label_model(label.clone(), handle);
 
-            eucalyptus_core::success!("Loaded model {}", label);
-            Ok::<(), anyhow::Error>(())
-        });
+        eucalyptus_core::success!("Loaded model {}", label);
+        Ok(())
     }
 
     fn queue_texture_load(
@@ -1340,7 +1347,8 @@ impl<'a> EditorTabViewer<'a> {
 
         let graphics = self.graphics.clone();
         let queue = graphics.future_queue.clone();
-        queue.push(async move {
+        // decoding is CPU bound, so keep it off the I/O runtime
+        queue.push_compute(JobPriority::Normal, move || {
             let path = reference.resolve()?;
             let bytes = fs::read(&path)?;
 
@@ -1,5 +1,6 @@
 use egui_ltreeview::{NodeBuilder, TreeViewBuilder};
 use eucalyptus_core::{
+    change,
     component::ComponentRegistry,
     hierarchy::{Children, Hierarchy, Parent},
     physics::{collider::ColliderGroup, rigidbody::RigidBody},
@@ -39,7 +40,7 @@ impl<'a> EditorTabViewer<'a> {
                             .context_menu(|ui| {
                                 if ui.button("New Empty Entity").clicked() {
                                     let label = Editor::unique_label_for_world(self.world, "Blank Entity");
-                                    self.world.spawn((label,));
+                                    change::spawn(self.world, (label,));
                                     ui.close();
                                 }
                                 ui.menu_button("Import Template", |_| {});
@@ -86,7 +87,7 @@ impl<'a> EditorTabViewer<'a> {
                                 ui.menu_button("New", |ui| {
                                     if ui.button("Child").clicked() {
                                         let label = Editor::unique_label_for_world(world, "New Entity");
-                                        let child = world.spawn((label,));
+                                        let child = change::spawn(world, (label,));
                                         Hierarchy::set_parent(world, child, entity);
                                         ui.close();
                                     }
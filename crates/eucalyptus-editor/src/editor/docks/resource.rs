@@ -2,6 +2,7 @@ use crate::editor::page::EditorTabVisibility;
 use crate::editor::{EditorTabDock, EditorTabDockDescriptor, EditorTabViewer, TABS_GLOBAL};
 use dropbear_engine::camera::Camera;
 use eucalyptus_core::camera::{CameraComponent, CameraType};
+use eucalyptus_core::change::{self, mark_changed};
 use eucalyptus_core::entity_status::EntityStatus;
 use hecs::Entity;
 
@@ -42,11 +43,14 @@ impl<'a> EditorTabViewer<'a> {
                             if let Ok(mut s) = self.world.get::<&mut EntityStatus>(inspect_entity) {
                                 s.hidden = hidden;
                                 s.disabled = disabled;
+                                mark_changed::<EntityStatus>(inspect_entity);
                             }
                         } else {
-                            let _ = self
-                                .world
-                                .insert_one(inspect_entity, EntityStatus { hidden, disabled });
+                            let _ = change::insert_one(
+                                self.world,
+                                inspect_entity,
+                                EntityStatus { hidden, disabled },
+                            );
                         }
                     }
                 }
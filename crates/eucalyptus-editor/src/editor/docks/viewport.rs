@@ -7,6 +7,7 @@ use dropbear_engine::asset::ASSET_REGISTRY;
 use dropbear_engine::camera::Camera;
 use dropbear_engine::entity::{EntityTransform, MeshRenderer, Transform};
 use dropbear_engine::lighting::Light;
+use eucalyptus_core::change::mark_changed;
 use eucalyptus_core::camera::CameraComponent;
 use eucalyptus_core::hierarchy::EntityTransformExt;
 use eucalyptus_core::input::ndc::NormalisedDeviceCoordinates;
@@ -132,6 +133,7 @@ impl<'a> EditorTabViewer<'a> {
 
         if let Ok(mut et) = self.world.get::<&mut EntityTransform>(entity) {
             et.world_mut().position = new_pos;
+            mark_changed::<EntityTransform>(entity);
         } else if let Ok(mut tr) = self.world.get::<&mut Transform>(entity) {
             tr.position = new_pos;
         }
@@ -310,6 +312,7 @@ impl<'a> EditorTabViewer<'a> {
                 if let Some((_result, new_transforms)) = self.gizmo.interact(ui, &[gizmo_transform])
                     && let Some(new_transform) = new_transforms.first()
                 {
+                    mark_changed::<EntityTransform>(*entity_id);
                     let new_synced_pos: glam::DVec3 = new_transform.translation.into();
                     let new_synced_rot: glam::DQuat = new_transform.rotation.into();
                     let new_synced_scale: glam::DVec3 = new_transform.scale.into();
@@ -419,6 +422,7 @@ impl<'a> EditorTabViewer<'a> {
                     light.component.position = updated_transform.position;
                     light.component.direction =
                         (updated_transform.rotation * forward).normalize_or_zero();
+                    mark_changed::<Light>(*entity_id);
                 }
             }
         }
@@ -2,6 +2,7 @@ pub mod dock;
 pub mod docks;
 pub mod input;
 pub mod page;
+pub mod project_tree;
 pub mod scene;
 pub mod settings;
 pub mod ui;
@@ -24,22 +25,29 @@ use dropbear_engine::billboarding::BillboardPipeline;
 use dropbear_engine::buffer::DynamicBuffer;
 use dropbear_engine::entity::EntityTransform;
 use dropbear_engine::graphics::InstanceRaw;
+use dropbear_engine::ibl::{self, EnvironmentMaps};
 use dropbear_engine::mipmap::MipMapper;
 use dropbear_engine::multisampling::AntiAliasingMode;
 use dropbear_engine::pipelines::DropbearShaderPipeline;
 use dropbear_engine::pipelines::GlobalsUniform;
 use dropbear_engine::pipelines::light_cube::LightCubePipeline;
 use dropbear_engine::pipelines::shader::MainRenderPipeline;
-use dropbear_engine::sky::{DEFAULT_SKY_TEXTURE, HdrLoader, SkyPipeline};
+use dropbear_engine::shadows::{ShadowRenderer, ShadowSettings};
+use dropbear_engine::sky::{DEFAULT_SKY_TEXTURE, SkyPipeline};
 use dropbear_engine::{
-    DropbearWindowBuilder, WindowData, camera::Camera, entity::Transform, future::FutureHandle,
-    graphics::SharedGraphicsContext, scene::SceneCommand,
+    DropbearWindowBuilder, WindowData,
+    camera::Camera,
+    entity::Transform,
+    future::{FutureHandle, JobPriority},
+    graphics::SharedGraphicsContext,
+    scene::SceneCommand,
 };
 use egui::{self, Ui};
 use egui_dock::{DockArea, DockState, NodeIndex, Style};
 use eucalyptus_core::component::{ComponentRegistry, SerializedComponent};
 use eucalyptus_core::hierarchy::{Children, Parent, SceneHierarchy};
 use eucalyptus_core::physics::PhysicsState;
+use eucalyptus_core::rendering::{LightChangeCursor, RendererCache};
 use eucalyptus_core::scene::{SceneConfig, SceneEntity};
 use eucalyptus_core::states::Label;
 use eucalyptus_core::{APP_INFO, register_components};
@@ -92,6 +100,8 @@ pub struct Editor {
 
     // rendering
     pub light_cube_pipeline: Option<LightCubePipeline>,
+    pub light_changes: LightChangeCursor,
+    pub shadow_renderer: Option<ShadowRenderer>,
     pub main_render_pipeline: Option<MainRenderPipeline>,
     pub shader_globals: Option<GlobalsUniform>,
     pub mipmapper: Option<MipMapper>,
@@ -99,6 +109,7 @@ pub struct Editor {
     pub billboard_pipeline: Option<BillboardPipeline>,
     pub kino: Option<KinoState>,
     pub animation_pipeline: Option<AnimationDefaults>,
+    pub(crate) renderer_cache: RendererCache,
     pub(crate) animated_instance_buffers: HashMap<Entity, DynamicBuffer<InstanceRaw>>,
     pub(crate) animated_bind_group_cache: HashMap<Entity, (u64, wgpu::BindGroup)>,
     pub(crate) static_bind_group_cache: HashMap<u64, wgpu::BindGroup>,
@@ -279,6 +290,8 @@ impl Editor {
             tab_registry,
             input_state: Box::new(InputState::new()),
             light_cube_pipeline: None,
+            light_changes: LightChangeCursor::default(),
+            shadow_renderer: None,
             active_camera: Arc::new(Mutex::new(None)),
             selected_entities: Vec::new(),
             progress_tx: None,
@@ -318,6 +331,7 @@ impl Editor {
             billboard_pipeline: None,
             kino: None,
             animation_pipeline: None,
+            renderer_cache: Default::default(),
             animated_instance_buffers: Default::default(),
             animated_bind_group_cache: Default::default(),
             static_bind_group_cache: Default::default(),
@@ -729,7 +743,10 @@ impl Editor {
                     let component = DebugCamera::new();
 
                     {
-                        let e = world.spawn((Label::from("Debug Camera"), debug_camera, component));
+                        let e = eucalyptus_core::change::spawn(
+                            world,
+                            (Label::from("Debug Camera"), debug_camera, component),
+                        );
                         let mut a_c = active_camera.lock();
                         *a_c = Some(e);
                     }
@@ -762,6 +779,8 @@ impl Editor {
         self.current_state = WorldLoadingStatus::Idle;
 
         self.world.clear();
+        self.renderer_cache.clear();
+        self.light_changes.reset();
         self.selected_entity = None;
         self.previously_selected_entity = None;
         self.active_camera.lock().take();
@@ -770,6 +789,7 @@ impl Editor {
         self.shader_globals = None;
         self.texture_id = None;
         self.light_cube_pipeline = None;
+        self.shadow_renderer = None;
     }
 
     fn start_async_scene_load(
@@ -794,7 +814,7 @@ impl Editor {
         let scene_name = scene.scene_name.clone();
         let component_registry_clone = self.component_registry.clone();
 
-        let handle = graphics.future_queue.push(async move {
+        let handle = graphics.future_queue.push_compute_future(JobPriority::High, async move {
             let mut temp_world = World::new();
 
             let load_result = scene
@@ -1623,33 +1643,54 @@ impl Editor {
         graphics: std::sync::Arc<dropbear_engine::graphics::SharedGraphicsContext>,
         skybox_texture: Option<&Vec<u8>>,
     ) {
-        let mut main_render_pipeline = MainRenderPipeline::new(graphics.clone());
-        let light_cube_pipeline = LightCubePipeline::new(graphics.clone());
-        self.shader_globals = Some(GlobalsUniform::new(
-            graphics.clone(),
-            Some("editor shader globals"),
-        ));
-        self.mipmapper = None;
-        self.billboard_pipeline = Some(BillboardPipeline::new(graphics.clone()));
-        *graphics.debug_draw.lock() =
-            Some(dropbear_engine::debug::DebugDraw::new(graphics.clone()));
-        self.kino = Some(KinoState::new(
-            KinoWGPURenderer::new(
-                &graphics.device,
-                &graphics.queue,
-                graphics.hdr.read().format(),
-                [
-                    graphics.viewport_texture.size.width as f32,
-                    graphics.viewport_texture.size.height as f32,
-                ],
-            ),
-            KinoWinitWindowing::new(graphics.window.clone(), None),
-        ));
+        puffin::profile_function!();
+        // the pipelines are independent of each other, so they are compiled at the same time
+        let (mut main_render_pipeline, light_cube_pipeline, shadow_renderer) =
+            std::thread::scope(|scope| {
+                let main = scope.spawn(|| MainRenderPipeline::new(graphics.clone()));
+                let light_cube = scope.spawn(|| LightCubePipeline::new(graphics.clone()));
+                let shadows =
+                    scope.spawn(|| ShadowRenderer::new(&graphics, ShadowSettings::default()));
+                let billboard = scope.spawn(|| BillboardPipeline::new(graphics.clone()));
+                let debug_draw =
+                    scope.spawn(|| dropbear_engine::debug::DebugDraw::new(graphics.clone()));
+
+                self.shader_globals = Some(GlobalsUniform::new(
+                    graphics.clone(),
+                    Some("editor shader globals"),
+                ));
+                self.mipmapper = None;
+                self.kino = Some(KinoState::new(
+                    KinoWGPURenderer::new(
+                        &graphics.device,
+                        &graphics.queue,
+                        graphics.hdr.read().format(),
+                        [
+                            graphics.viewport_texture.size.width as f32,
+                            graphics.viewport_texture.size.height as f32,
+                        ],
+                    ),
+                    KinoWinitWindowing::new(graphics.window().clone(), None),
+                ));
+
+                const PANICKED: &str = "Pipeline creation panicked";
+                self.billboard_pipeline = Some(billboard.join().expect(PANICKED));
+                *graphics.debug_draw.lock() = Some(debug_draw.join().expect(PANICKED));
+                (
+                    main.join().expect(PANICKED),
+                    light_cube.join().expect(PANICKED),
+                    shadows.join().expect(PANICKED),
+                )
+            });
+
+        if let Err(e) = graphics.pipeline_cache.save() {
+            log::warn!("Unable to save pipeline cache: {}", e);
+        }
 
         self.animation_pipeline = None;
 
         self.texture_id = Some((*graphics.texture_id).clone());
-        self.window = Some(graphics.window.clone());
+        self.window = Some(graphics.window().clone());
         self.is_world_loaded.mark_rendering_loaded();
 
         let mut pending_sky_pipeline = None;
@@ -1665,22 +1706,24 @@ impl Editor {
                         globals.buffer.buffer(),
                         camera.buffer(),
                         light_cube_pipeline.light_buffer(),
+                        &shadow_renderer,
                     );
                 }
 
-                let sky_texture_result = HdrLoader::from_equirectangular_bytes(
+                let environment_result = EnvironmentMaps::load_or_bake(
                     &graphics.device,
                     &graphics.queue,
                     skybox_texture.map_or(DEFAULT_SKY_TEXTURE, |v| v.as_slice()),
                     1080,
+                    ibl::cache_dir(&APP_INFO).as_deref(),
                     Some("sky texture"),
                 );
 
-                match sky_texture_result {
-                    Ok(sky_texture) => {
+                match environment_result {
+                    Ok(environment) => {
                         pending_sky_pipeline = Some(SkyPipeline::new(
                             graphics.clone(),
-                            sky_texture,
+                            environment,
                             camera.buffer(),
                         ));
                     }
@@ -1702,6 +1745,7 @@ impl Editor {
         // leave to last
         self.main_render_pipeline = Some(main_render_pipeline);
         self.light_cube_pipeline = Some(light_cube_pipeline);
+        self.shadow_renderer = Some(shadow_renderer);
     }
 
     /// Initialises another eucalyptus-editor play mode app as a separate process and monitors it in a separate thread.
@@ -1804,6 +1848,7 @@ impl UndoableAction {
             UndoableAction::EntityTransform(entity, transform) => {
                 if let Ok(e_t) = world.query_one::<&mut EntityTransform>(*entity).get() {
                     *e_t = *transform;
+                    eucalyptus_core::change::mark_changed::<EntityTransform>(*entity);
                     log::debug!("Reverted entity transform");
                     Ok(())
                 } else {
@@ -1813,6 +1858,7 @@ impl UndoableAction {
             UndoableAction::Label(entity, original_label) => {
                 if let Ok(label) = world.query_one_mut::<&mut Label>(*entity) {
                     label.set(original_label.clone());
+                    eucalyptus_core::change::mark_changed::<Label>(*entity);
                     Ok(())
                 } else {
                     anyhow::bail!("No entity found (with or without the Label property)");
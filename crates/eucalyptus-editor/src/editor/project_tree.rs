@@ -0,0 +1,462 @@
+//! An in-memory copy of the project's directory tree, used by the asset viewer.
+//!
+//! Listing `resources/` and `src/` with `read_dir` every frame gets expensive on large projects,
+//! so the listings are read once and cached per directory. A filesystem watcher invalidates the
+//! listings that change, and re-imports the assets that were added or modified outside the
+//! editor. Importing hashes every file it touches, so it runs on the compute pool rather than
+//! stalling the frame.
+
+use crate::editor::FsEntry;
+use dropbear_engine::future::{FutureQueue, JobPriority};
+use eucalyptus_core::asset_index::ASSET_INDEX;
+use eucalyptus_core::metadata::{self, ImportOutcome};
+use eucalyptus_core::states::PROJECT;
+use notify::event::ModifyKind;
+use notify::{EventKind, RecommendedWatcher, RecursiveMode, Watcher};
+use std::cmp::Ordering;
+use std::collections::{HashMap, HashSet};
+use std::path::{Path, PathBuf};
+use std::sync::mpsc::{Receiver, channel};
+use std::sync::{Arc, LazyLock};
+use std::time::{Duration, Instant};
+use std::{fs, io};
+
+/// The file tree of the currently open project.
+pub static PROJECT_TREE: LazyLock<parking_lot::Mutex<ProjectTree>> =
+    LazyLock::new(|| parking_lot::Mutex::new(ProjectTree::default()));
+
+/// Editors and asset tools tend to write a file several times in a row, so changes are only
+/// applied once the filesystem has been quiet for this long.
+const DEBOUNCE: Duration = Duration::from_millis(250);
+
+/// The directories of a project that are watched, relative to the project root.
+const WATCHED_DIRS: [&str; 2] = ["resources", "src"];
+
+/// Gathers changed paths until the filesystem has been quiet for [`DEBOUNCE`].
+#[derive(Default)]
+struct Debouncer {
+    pending: HashSet<PathBuf>,
+    last_event: Option<Instant>,
+}
+
+impl Debouncer {
+    fn push(&mut self, paths: impl IntoIterator<Item = PathBuf>, now: Instant) {
+        self.pending.extend(paths);
+        self.last_event = Some(now);
+    }
+
+    /// Takes every path that changed, once nothing has changed for [`DEBOUNCE`].
+    fn take_settled(&mut self, now: Instant) -> Option<HashSet<PathBuf>> {
+        let last = self.last_event?;
+        if now.duration_since(last) < DEBOUNCE {
+            return None;
+        }
+        self.last_event = None;
+        Some(std::mem::take(&mut self.pending)).filter(|pending| !pending.is_empty())
+    }
+
+    fn clear(&mut self) {
+        self.pending.clear();
+        self.last_event = None;
+    }
+}
+
+/// What a settled batch of changes means for the tree.
+#[derive(Debug, Default)]
+struct PendingChanges {
+    /// Directories whose listing is out of date.
+    dirty_dirs: HashSet<PathBuf>,
+    /// Paths that no longer exist.
+    removed: Vec<PathBuf>,
+    /// Assets under `resources/` to (re-)import.
+    imports: Vec<PathBuf>,
+}
+
+impl PendingChanges {
+    fn of(pending: HashSet<PathBuf>, resources: &Path) -> Self {
+        let mut changes = Self::default();
+        for path in pending {
+            if let Some(parent) = path.parent() {
+                changes.dirty_dirs.insert(parent.to_path_buf());
+            }
+            changes.dirty_dirs.insert(path.clone());
+
+            // by the time the changes settle, whatever is gone was removed or renamed away, which
+            // saves tracking each platform's flavour of rename events
+            if !path.exists() {
+                changes.removed.push(path);
+            } else if path.starts_with(resources) {
+                collect_imports(&path, &mut changes.imports);
+            }
+        }
+        changes
+    }
+}
+
+/// The result of an import job.
+struct ImportReport {
+    root: PathBuf,
+    changed: usize,
+}
+
+#[derive(Default)]
+pub struct ProjectTree {
+    root: PathBuf,
+    listings: HashMap<PathBuf, Arc<[FsEntry]>>,
+    watcher: Option<RecommendedWatcher>,
+    events: Option<Receiver<notify::Result<notify::Event>>>,
+    debounce: Debouncer,
+    /// Assets waiting to be imported.
+    queued_imports: Vec<PathBuf>,
+    /// Whether an import job is running. Only one runs at a time, so the same file is never
+    /// imported by two jobs at once.
+    importing: bool,
+}
+
+impl ProjectTree {
+    /// Returns the sorted listing of `dir`, with directories first.
+    ///
+    /// Directories inside the watched folders are read once and served from the cache until they
+    /// change, anything else is read every call.
+    pub(crate) fn entries(&mut self, dir: &Path) -> io::Result<Arc<[FsEntry]>> {
+        if !self.is_watched(dir) {
+            return read_sorted(dir).map(Arc::from);
+        }
+        if let Some(entries) = self.listings.get(dir) {
+            return Ok(entries.clone());
+        }
+
+        puffin::profile_function!();
+        let entries: Arc<[FsEntry]> = read_sorted(dir)?.into();
+        self.listings.insert(dir.to_path_buf(), entries.clone());
+        Ok(entries)
+    }
+
+    /// Picks up filesystem changes, and starts importing the assets that changed on `queue`.
+    /// Call once per frame.
+    pub fn poll(&mut self, queue: &FutureQueue) {
+        puffin::profile_function!();
+        let project_path = PROJECT.read().project_path.clone();
+        if project_path != self.root {
+            self.open(project_path);
+        }
+
+        if let Some(events) = &self.events {
+            for result in events.try_iter() {
+                let event = match result {
+                    Ok(event) => event,
+                    Err(e) => {
+                        log::warn!("Project watcher error: {}", e);
+                        continue;
+                    }
+                };
+
+                // metadata-only changes (permissions, access times) don't affect the tree
+                if !matches!(
+                    event.kind,
+                    EventKind::Create(_)
+                        | EventKind::Remove(_)
+                        | EventKind::Modify(ModifyKind::Name(_))
+                        | EventKind::Modify(ModifyKind::Data(_))
+                        | EventKind::Modify(ModifyKind::Any)
+                ) {
+                    continue;
+                }
+
+                self.debounce.push(event.paths, Instant::now());
+            }
+        }
+
+        if let Some(pending) = self.debounce.take_settled(Instant::now()) {
+            self.apply_pending(pending);
+        }
+        self.start_imports(queue);
+    }
+
+    fn open(&mut self, root: PathBuf) {
+        self.listings.clear();
+        self.debounce.clear();
+        self.queued_imports.clear();
+        // a job still importing into the old project reports back, and is ignored then
+        self.importing = false;
+        self.watcher = None;
+        self.events = None;
+        self.root = root;
+
+        if self.root.as_os_str().is_empty() {
+            return;
+        }
+
+        let (tx, rx) = channel::<notify::Result<notify::Event>>();
+        let mut watcher = match RecommendedWatcher::new(tx, notify::Config::default()) {
+            Ok(watcher) => watcher,
+            Err(e) => {
+                log::warn!(
+                    "Unable to watch {}, the asset viewer will not update: {}",
+                    self.root.display(),
+                    e
+                );
+                return;
+            }
+        };
+
+        for dir in WATCHED_DIRS {
+            let dir = self.root.join(dir);
+            if !dir.is_dir() {
+                continue;
+            }
+            if let Err(e) = watcher.watch(&dir, RecursiveMode::Recursive) {
+                log::warn!("Unable to watch {}: {}", dir.display(), e);
+            }
+        }
+
+        log::debug!("Watching project files in {}", self.root.display());
+        self.watcher = Some(watcher);
+        self.events = Some(rx);
+    }
+
+    fn apply_pending(&mut self, pending: HashSet<PathBuf>) {
+        puffin::profile_function!();
+        let resources = self.root.join("resources");
+        let changes = PendingChanges::of(pending, &resources);
+
+        // a sidecar may have been added outside the editor, which the next missed lookup finds
+        if changes.dirty_dirs.iter().any(|dir| dir.starts_with(&resources)) {
+            ASSET_INDEX.write().files_changed();
+        }
+
+        for path in &changes.removed {
+            self.listings.retain(|dir, _| !dir.starts_with(path));
+            if path.starts_with(&resources) {
+                ASSET_INDEX.write().removed(path);
+            }
+        }
+        for dir in &changes.dirty_dirs {
+            self.listings.remove(dir);
+        }
+
+        for path in changes.imports {
+            if !self.queued_imports.contains(&path) {
+                self.queued_imports.push(path);
+            }
+        }
+    }
+
+    /// Hands the queued imports to the compute pool, unless an import job is already running.
+    fn start_imports(&mut self, queue: &FutureQueue) {
+        if self.importing || self.queued_imports.is_empty() {
+            return;
+        }
+        self.importing = true;
+
+        let imports = std::mem::take(&mut self.queued_imports);
+        let root = self.root.clone();
+        queue.push_compute_then(
+            JobPriority::Low,
+            move || {
+                // the queue contains panics by dropping the completion, which would leave
+                // `importing` set for good, so a panic is reported back like any other result
+                let job_root = root.clone();
+                std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                    import_all(imports, job_root)
+                }))
+                .unwrap_or_else(|_| {
+                    log::error!("Importing assets panicked, the rest of the batch was skipped");
+                    ImportReport { root, changed: 0 }
+                })
+            },
+            |report: ImportReport| PROJECT_TREE.lock().imports_finished(report),
+        );
+    }
+
+    fn imports_finished(&mut self, report: ImportReport) {
+        if report.root != self.root {
+            return;
+        }
+        self.importing = false;
+        if report.changed > 0 {
+            log::info!("Imported {} changed assets", report.changed);
+        }
+    }
+
+    fn is_watched(&self, dir: &Path) -> bool {
+        self.watcher.is_some()
+            && WATCHED_DIRS
+                .iter()
+                .any(|watched| dir.starts_with(self.root.join(watched)))
+    }
+}
+
+/// Imports `imports` and saves the asset index if any of them changed. Ran on the compute pool.
+fn import_all(imports: Vec<PathBuf>, root: PathBuf) -> ImportReport {
+    puffin::profile_function!();
+    let mut changed = 0;
+    for path in imports {
+        match metadata::import_asset(&path, &root) {
+            Ok(ImportOutcome::Created) | Ok(ImportOutcome::Changed(_)) => {
+                log::debug!("Imported {}", path.display());
+                changed += 1;
+            }
+            Ok(_) => {}
+            Err(e) => log::warn!("Unable to import {}: {}", path.display(), e),
+        }
+    }
+
+    if changed > 0
+        && let Err(e) = ASSET_INDEX.write().flush()
+    {
+        log::warn!("Unable to save asset index: {}", e);
+    }
+    ImportReport { root, changed }
+}
+
+/// Collects the assets at `path`, walking into it when it is a directory that was created or
+/// moved in.
+fn collect_imports(path: &Path, imports: &mut Vec<PathBuf>) {
+    if path.is_dir() {
+        let Ok(read) = fs::read_dir(path) else {
+            return;
+        };
+        for entry in read.flatten() {
+            collect_imports(&entry.path(), imports);
+        }
+    } else if path.is_file() && metadata::detect_asset_type(path).is_some() {
+        imports.push(path.to_path_buf());
+    }
+}
+
+fn read_sorted(path: &Path) -> io::Result<Vec<FsEntry>> {
+    let mut entries = Vec::new();
+    for entry in fs::read_dir(path)? {
+        let entry = entry?;
+        let file_type = entry.file_type()?;
+        let name = entry.file_name().to_string_lossy().to_string();
+        entries.push(FsEntry {
+            path: entry.path(),
+            name_lower: name.to_lowercase(),
+            name,
+            is_dir: file_type.is_dir(),
+        });
+    }
+
+    entries.sort_by(|a, b| match b.is_dir.cmp(&a.is_dir) {
+        Ordering::Equal => a.name_lower.cmp(&b.name_lower),
+        other => other,
+    });
+
+    Ok(entries)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// A scratch directory that is removed when dropped.
+    struct ScratchDir(PathBuf);
+
+    impl ScratchDir {
+        fn new(name: &str) -> Self {
+            let dir = std::env::temp_dir().join(format!(
+                "eucalyptus-project-tree-{}-{}",
+                name,
+                std::process::id()
+            ));
+            let _ = fs::remove_dir_all(&dir);
+            fs::create_dir_all(&dir).unwrap();
+            Self(dir)
+        }
+    }
+
+    impl Drop for ScratchDir {
+        fn drop(&mut self) {
+            let _ = fs::remove_dir_all(&self.0);
+        }
+    }
+
+    #[test]
+    fn debounce_waits_for_the_filesystem_to_settle() {
+        let start = Instant::now();
+        let mut debounce = Debouncer::default();
+        assert!(debounce.take_settled(start + DEBOUNCE * 4).is_none());
+
+        debounce.push([PathBuf::from("a.png")], start);
+        assert!(debounce.take_settled(start + DEBOUNCE / 2).is_none());
+
+        // another write restarts the wait
+        debounce.push([PathBuf::from("b.png")], start + DEBOUNCE / 2);
+        assert!(debounce.take_settled(start + DEBOUNCE).is_none());
+
+        let settled = debounce.take_settled(start + DEBOUNCE * 2).unwrap();
+        assert_eq!(settled.len(), 2);
+        assert!(debounce.take_settled(start + DEBOUNCE * 3).is_none());
+    }
+
+    #[test]
+    fn pending_changes_sort_removals_from_imports() {
+        let scratch = ScratchDir::new("pending");
+        let resources = scratch.0.join("resources");
+        let models = resources.join("models");
+        fs::create_dir_all(&models).unwrap();
+        fs::write(resources.join("a.png"), b"png").unwrap();
+        fs::write(models.join("b.glb"), b"glb").unwrap();
+        fs::write(models.join("notes.txt"), b"not an asset").unwrap();
+        let script = scratch.0.join("src").join("Main.kt");
+        fs::create_dir_all(script.parent().unwrap()).unwrap();
+        fs::write(&script, b"fun main() {}").unwrap();
+
+        let gone = resources.join("gone.png");
+        let pending = HashSet::from([
+            resources.join("a.png"),
+            models.clone(),
+            gone.clone(),
+            script.clone(),
+        ]);
+        let mut changes = PendingChanges::of(pending, &resources);
+        changes.imports.sort();
+
+        assert_eq!(
+            changes.imports,
+            vec![resources.join("a.png"), models.join("b.glb")]
+        );
+        assert_eq!(changes.removed, vec![gone]);
+        assert!(changes.dirty_dirs.contains(&resources));
+        assert!(changes.dirty_dirs.contains(&models));
+        assert!(changes.dirty_dirs.contains(script.parent().unwrap()));
+    }
+
+    #[test]
+    fn imports_run_one_job_at_a_time() {
+        // never polled, so the jobs are only queued
+        let queue = FutureQueue::new();
+        let mut tree = ProjectTree {
+            root: PathBuf::from("project"),
+            ..Default::default()
+        };
+
+        tree.queued_imports
+            .push(PathBuf::from("project/resources/a.png"));
+        tree.start_imports(&queue);
+        assert!(tree.importing);
+        assert!(tree.queued_imports.is_empty());
+
+        tree.queued_imports
+            .push(PathBuf::from("project/resources/b.png"));
+        tree.start_imports(&queue);
+        assert_eq!(tree.queued_imports.len(), 1);
+
+        // a job for a project that was closed in the meantime does not count
+        tree.imports_finished(ImportReport {
+            root: PathBuf::from("other"),
+            changed: 0,
+        });
+        assert!(tree.importing);
+
+        tree.imports_finished(ImportReport {
+            root: PathBuf::from("project"),
+            changed: 1,
+        });
+        tree.start_imports(&queue);
+        assert!(tree.importing);
+        assert!(tree.queued_imports.is_empty());
+    }
+}
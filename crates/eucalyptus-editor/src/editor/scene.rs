@@ -1,14 +1,16 @@
 use super::*;
 use crate::signal::SignalController;
+use crate::editor::project_tree::PROJECT_TREE;
 use crate::spawn::PendingSpawnController;
 use crossbeam_channel::unbounded;
-use dropbear_engine::graphics::CommandEncoder;
+use dropbear_engine::streaming::TEXTURE_STREAMER;
 use dropbear_engine::{
     entity::{EntityTransform, MeshRenderer, Transform},
     lighting::Light,
     scene::{Scene, SceneCommand},
 };
 use eucalyptus_core::billboard::BillboardComponent;
+use eucalyptus_core::change;
 use eucalyptus_core::component::KotlinComponentDecl;
 use eucalyptus_core::properties::CustomProperties;
 use eucalyptus_core::states::{Label, SCENES, WorldLoadingStatus};
@@ -27,7 +29,7 @@ use std::{
 };
 use winit::event::{MouseScrollDelta, TouchPhase};
 use winit::{event::WindowEvent, event_loop::ActiveEventLoop, keyboard::KeyCode};
-use eucalyptus_core::rendering::RendererCommon;
+use eucalyptus_core::rendering::{RendererCommon, SceneFrame};
 
 impl Scene for Editor {
     fn load(&mut self, graphics: Arc<SharedGraphicsContext>, _ui: &mut Ui) {
@@ -109,7 +111,8 @@ impl Scene for Editor {
 
         let component_registry = self.component_registry.clone();
 
-        let handle = graphics.future_queue.push(async move {
+        // loading parses every model in the scene, so it runs on the compute pool
+        let handle = graphics.future_queue.push_compute_future(JobPriority::High, async move {
             let mut temp_world = World::new();
             if let Err(e) = Self::load_project_config(
                 graphics_shared,
@@ -134,7 +137,7 @@ impl Scene for Editor {
         self.game_dock_state_shared = Some(game_dock_state_shared);
         self.ui_dock_state_shared = Some(ui_dock_state_shared);
 
-        self.window = Some(graphics.window.clone());
+        self.window = Some(graphics.window().clone());
         self.is_world_loaded.mark_scene_loaded();
     }
 
@@ -154,6 +157,8 @@ impl Scene for Editor {
     ) {
         self.dt = dt;
 
+        PROJECT_TREE.lock().poll(&graphics.future_queue);
+
         if let Some(rx) = &self.play_mode_exit_rx {
             if rx.try_recv().is_ok() {
                 log::info!("Play mode process has exited, returning to editing mode");
@@ -172,6 +177,8 @@ impl Scene for Editor {
             self.show_project_loading_window(ui.ctx());
             if let Ok(loaded_world) = receiver.try_recv() {
                 self.world = Box::new(loaded_world);
+                self.renderer_cache.clear();
+                self.light_changes.reset();
                 self.is_world_loaded.mark_project_loaded();
 
                 if let Some(dock_state_shared) = &self.game_dock_state_shared
@@ -196,12 +203,13 @@ impl Scene for Editor {
         }
 
         {
-            for (rails, et) in
-                self.world.query_mut::<(&mut OnRails, &mut EntityTransform)>()
+            for (entity, rails, et) in
+                self.world.query_mut::<(Entity, &mut OnRails, &mut EntityTransform)>()
             {
                 if let Some((pos, rot)) = rails.pending_transform.take() {
                     et.world_mut().position = pos;
                     et.world_mut().rotation = rot;
+                    change::mark_changed::<EntityTransform>(entity);
                 }
             }
         }
@@ -274,7 +282,7 @@ impl Scene for Editor {
                 )
             };
 
-            graphics.window.set_title(&title);
+            graphics.window().set_title(&title);
         }
 
         {
@@ -286,13 +294,17 @@ impl Scene for Editor {
             }
         }
 
+        if let Some(budget) = PROJECT.read().runtime_settings.texture_budget_mb.get() {
+            TEXTURE_STREAMER.lock().set_budget(*budget as u64 * 1024 * 1024);
+        }
+
         {
             // basic futurequeue spawn queue management.
             let mut completed = Vec::new();
             for (i, handle) in self.light_spawn_queue.iter().enumerate() {
                 if let Some(l) = graphics.future_queue.exchange_owned_as::<Light>(handle) {
                     let label_component = Label::from(l.label.clone());
-                    self.world.spawn((
+                    change::spawn(&mut self.world, (
                         label_component,
                         l,
                         Transform::default(),
@@ -372,14 +384,10 @@ impl Scene for Editor {
             }
         }
 
-        if let Some(l) = &mut self.light_cube_pipeline {
-            l.update(graphics.clone(), &self.world);
-        }
-
         {
-            self.nerd_stats
-                .write()
-                .record_stats(dt, self.world.len() as u32);
+            let mut nerd_stats = self.nerd_stats.write();
+            nerd_stats.record_stats(dt, self.world.len() as u32);
+            nerd_stats.record_gpu_timings(&graphics.gpu_profiler);
         }
 
         let open_ui_editor = ui.ctx().data_mut(|d: &mut egui::util::IdTypeMap| {
@@ -453,23 +461,25 @@ impl Scene for Editor {
         self.editor_specific_render(&graphics, ui);
 
         let hdr = graphics.hdr.read();
-        let mut encoder = CommandEncoder::new(graphics.clone(), Some("runtime viewport encoder"));
 
         let Some(active_camera) = self.active_camera.lock().as_ref().cloned() else { return };
         log_once::debug_once!("Active camera found: {:?}", active_camera);
-        let Some(camera) = self.world.query_one::<&Camera>(active_camera).get().ok().cloned() else { return };
+        let Some(mut camera) = self.world.query_one::<&Camera>(active_camera).get().ok().cloned() else { return };
         log_once::debug_once!("Camera ready: {}", camera.label);
+        camera.follow_render_origin(graphics.clone());
 
-        RendererCommon::clear_viewport(&graphics, &mut encoder, &hdr);
-
+        if let Some(shadows) = &mut self.shadow_renderer {
+            shadows.assign(&self.world, &camera);
+        }
         if let Some(p) = &mut self.light_cube_pipeline {
-            p.update(graphics.clone(), &self.world);
+            let changes = self.light_changes.changed(&self.world, self.shadow_renderer.as_ref());
+            p.update(graphics.clone(), &self.world, &camera, changes);
         }
-        let (lights, enabled_light_count) = RendererCommon::collect_lights(&self.world);
+        let light_count = self.light_cube_pipeline.as_ref().map_or(0, |p| p.light_count());
 
         {
             let Some(globals) = &mut self.shader_globals else { return };
-            globals.data.num_lights = enabled_light_count;
+            globals.data.num_lights = light_count;
             if let Some(scene_name) = &self.current_scene_name {
                 let scenes = SCENES.read();
                 if let Some(scene) = scenes.iter().find(|s| s.scene_name == *scene_name) {
@@ -479,18 +489,18 @@ impl Scene for Editor {
             globals.write(&graphics.queue);
         }
 
-        let mut batches = HashMap::new();
         let default_skinning = self.animation_pipeline.as_ref().map(|p| p.skinning_buffer.buffer().clone());
-        RendererCommon::locate_renderers(&self.world, &mut batches, graphics.clone(), &default_skinning);
+        RendererCommon::locate_renderers(&self.world, &mut self.renderer_cache, graphics.clone(), &camera, &default_skinning);
 
-        let (_, model_cache) = RendererCommon::prepare_models(&graphics, &batches, &mut self.instance_buffer_cache);
+        let (_, model_cache) = RendererCommon::prepare_models(&graphics, &self.renderer_cache.batches, &mut self.instance_buffer_cache);
 
         if self.last_active_camera_for_per_frame != Some(active_camera) {
             self.last_active_camera_for_per_frame = Some(active_camera);
-            if let (Some(pipeline), Some(globals), Some(light_pipeline)) = (
+            if let (Some(pipeline), Some(globals), Some(light_pipeline), Some(shadows)) = (
                 self.main_render_pipeline.as_mut(),
                 self.shader_globals.as_ref(),
                 self.light_cube_pipeline.as_ref(),
+                self.shadow_renderer.as_ref(),
             ) {
                 pipeline.per_frame = None;
                 pipeline.per_frame_bind_group(
@@ -498,12 +508,12 @@ impl Scene for Editor {
                     globals.buffer.buffer(),
                     camera.buffer(),
                     light_pipeline.light_buffer(),
+                    shadows,
                 );
             }
         }
 
         let sky = self.sky_pipeline.as_ref().expect("Sky pipeline must be initialised");
-        let environment_bind_group = &sky.environment_bind_group;
 
         let Some(pipeline) = self.main_render_pipeline.as_ref() else {
             log_once::warn_once!("Render pipeline not ready");
@@ -518,50 +528,31 @@ impl Scene for Editor {
             .expect("Per-frame bind group not initialised")
             .clone();
 
-        RendererCommon::render_light_cubes(&graphics, &mut encoder, &hdr, &lights, &camera, self.light_cube_pipeline.as_ref());
-
-        RendererCommon::render_models(
-            &graphics, &mut encoder, &hdr,
-            &self.world, &batches, &model_cache,
-            &per_frame_bind_group, environment_bind_group,
-            &pipeline, animation_defaults,
-            &self.instance_buffer_cache,
-            &mut self.animated_instance_buffers,
-            &mut self.animated_bind_group_cache,
-            &mut self.static_bind_group_cache,
-            &mut self.last_morph_info_per_mesh,
-        );
-
-        RendererCommon::render_sky(&graphics, &mut encoder, &hdr, sky);
-
-        RendererCommon::render_collider_debug(
-            &graphics,
-            &self.world,
-            self.current_scene_name.as_deref(),
-        );
-
-        RendererCommon::render_billboards(
-            &graphics, &mut encoder, &hdr, &camera,
-            &self.world,
-            self.kino.as_mut(),
-            self.billboard_pipeline.as_ref(),
-        );
-
-        if let Some(debug_draw) = graphics.debug_draw.lock().as_mut() {
-            let view_proj = Mat4::from_cols_array_2d(&camera.uniform.view_proj);
-            debug_draw.flush(graphics.clone(), &mut encoder, view_proj);
-        }
-
-        hdr.process(&mut encoder, &graphics.viewport_texture.view);
-        if let Err(e) = encoder.submit() { log_once::error_once!("{}", e); }
-
-        {
-            let Some(kino) = &mut self.kino else { return };
-            let mut encoder = CommandEncoder::new(graphics.clone(), Some("kino encoder"));
-            kino.render(&graphics.device, &graphics.queue, &mut encoder, hdr.view());
-            if let Err(e) = encoder.submit() {
-                log_once::error_once!("Unable to submit kino: {}", e);
-            }
+        let mut frame = SceneFrame {
+            graphics: &graphics,
+            hdr: &hdr,
+            world: &self.world,
+            camera: &camera,
+            current_scene_name: self.current_scene_name.as_deref(),
+            batches: &self.renderer_cache.batches,
+            model_cache: &model_cache,
+            per_frame_bind_group: &per_frame_bind_group,
+            pipeline,
+            animation_defaults,
+            sky,
+            light_cube_pipeline: self.light_cube_pipeline.as_ref(),
+            billboard_pipeline: self.billboard_pipeline.as_ref(),
+            shadows: self.shadow_renderer.as_mut(),
+            kino: self.kino.as_mut(),
+            instance_buffer_cache: &self.instance_buffer_cache,
+            animated_instance_buffers: &mut self.animated_instance_buffers,
+            animated_bind_group_cache: &mut self.animated_bind_group_cache,
+            static_bind_group_cache: &mut self.static_bind_group_cache,
+            last_morph_info_per_mesh: &mut self.last_morph_info_per_mesh,
+            billboard_views: HashMap::new(),
+        };
+        if let Err(e) = RendererCommon::scene_graph().execute(&graphics, &mut frame) {
+            log_once::error_once!("Unable to render the scene: {}", e);
         }
     }
 
@@ -721,7 +712,7 @@ impl Editor {
     fn editor_specific_render(&mut self, graphics: &Arc<SharedGraphicsContext>, ui: &mut Ui) {
         self.size = graphics.viewport_texture.size;
         self.texture_id = Some(*graphics.texture_id.clone());
-        self.window = Some(graphics.window.clone());
+        self.window = Some(graphics.window().clone());
 
         self.show_ui(ui, graphics.clone());
         eucalyptus_core::logging::render(ui);
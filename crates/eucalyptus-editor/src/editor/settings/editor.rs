@@ -139,7 +139,7 @@ impl EditorSettingsWindow {
 
 impl Scene for EditorSettingsWindow {
     fn load(&mut self, graphics: std::sync::Arc<dropbear_engine::graphics::SharedGraphicsContext>, _ui: &mut Ui,) {
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn physics_update(
@@ -259,7 +259,7 @@ impl Scene for EditorSettingsWindow {
             });
         });
 
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn render<'a>(
@@ -45,7 +45,7 @@ impl ProjectSettingsWindow {
 
 impl Scene for ProjectSettingsWindow {
     fn load(&mut self, graphics: std::sync::Arc<dropbear_engine::graphics::SharedGraphicsContext>, _ui: &mut Ui,) {
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn physics_update(
@@ -190,13 +190,132 @@ impl Scene for ProjectSettingsWindow {
                                     );
                                 }
                             });
+
+                            ui.label("Texture Streaming:");
+                            ui.horizontal(|ui| {
+                                let mut local_set_budget =
+                                    project.runtime_settings.texture_budget_mb.is_some();
+
+                                if ui
+                                    .checkbox(
+                                        &mut local_set_budget,
+                                        "Limit streamed texture memory (MiB)",
+                                    )
+                                    .changed()
+                                {
+                                    if local_set_budget {
+                                        project.runtime_settings.texture_budget_mb.enable_or(1024);
+                                    } else {
+                                        project.runtime_settings.texture_budget_mb.disable();
+                                    }
+                                }
+
+                                if let Some(v) = project.runtime_settings.texture_budget_mb.get_mut()
+                                {
+                                    ui.add(
+                                        Slider::new(v, 64..=16384)
+                                            .clamping(SliderClamping::Never),
+                                    );
+                                }
+                            });
+
+                            ui.label("Physics:");
+                            ui.horizontal(|ui| {
+                                let mut local_set_threads =
+                                    project.runtime_settings.physics_threads.is_some();
+
+                                if ui
+                                    .checkbox(&mut local_set_threads, "Set physics solver threads")
+                                    .on_hover_text(
+                                        "When unset, the threads are sized from the amount of cores",
+                                    )
+                                    .changed()
+                                {
+                                    if local_set_threads {
+                                        project.runtime_settings.physics_threads.enable_or(1);
+                                    } else {
+                                        project.runtime_settings.physics_threads.disable();
+                                    }
+                                }
+
+                                if let Some(v) = project.runtime_settings.physics_threads.get_mut()
+                                {
+                                    ui.add(Slider::new(v, 1..=64));
+                                }
+                            });
+                            ui.horizontal(|ui| {
+                                let mut local_set_sleep =
+                                    project.runtime_settings.physics_sleep_distance.is_some();
+
+                                if ui
+                                    .checkbox(&mut local_set_sleep, "Sleep distant bodies")
+                                    .on_hover_text(
+                                        "Dynamic bodies further than this from the camera stop being simulated",
+                                    )
+                                    .changed()
+                                {
+                                    if local_set_sleep {
+                                        project
+                                            .runtime_settings
+                                            .physics_sleep_distance
+                                            .enable_or(200.0);
+                                    } else {
+                                        project.runtime_settings.physics_sleep_distance.disable();
+                                    }
+                                }
+
+                                if let Some(v) =
+                                    project.runtime_settings.physics_sleep_distance.get_mut()
+                                {
+                                    ui.add(
+                                        Slider::new(v, 10.0..=5000.0)
+                                            .logarithmic(true)
+                                            .suffix(" m"),
+                                    );
+                                }
+                            });
+                            ui.horizontal(|ui| {
+                                let mut local_set_interval = project
+                                    .runtime_settings
+                                    .contact_force_event_interval
+                                    .is_some();
+
+                                if ui
+                                    .checkbox(
+                                        &mut local_set_interval,
+                                        "Throttle contact force events",
+                                    )
+                                    .on_hover_text(
+                                        "Scripts get at most one contact force event per pair of colliders every this many ticks",
+                                    )
+                                    .changed()
+                                {
+                                    if local_set_interval {
+                                        project
+                                            .runtime_settings
+                                            .contact_force_event_interval
+                                            .enable_or(4);
+                                    } else {
+                                        project
+                                            .runtime_settings
+                                            .contact_force_event_interval
+                                            .disable();
+                                    }
+                                }
+
+                                if let Some(v) =
+                                    project.runtime_settings.contact_force_event_interval.get_mut()
+                                {
+                                    ui.add(Slider::new(v, 1..=60).suffix(" ticks"));
+                                }
+                            });
                         }
                         _ => {}
                     });
             });
         });
 
-        self.window = Some(graphics.window.id());
+        self.window = Some(graphics.window().id());
     }
 
     fn render<'a>(
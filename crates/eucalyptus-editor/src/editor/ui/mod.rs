@@ -172,6 +172,7 @@ impl UIGridPipeline {
         let format = graphics.surface_format.add_srgb_suffix();
 
         let device = graphics.device.clone();
+        let pipeline_cache = graphics.pipeline_cache.clone();
         let shader_dir = std::path::PathBuf::from(concat!(
             env!("CARGO_MANIFEST_DIR"),
             "/src/editor/ui/shader"
@@ -222,7 +223,7 @@ impl UIGridPipeline {
                                 write_mask: wgpu::ColorWrites::ALL,
                             })],
                         }),
-                        cache: None,
+                        cache: pipeline_cache.get(),
                         multiview_mask: None,
                     });
                 Ok(pipeline)
@@ -328,7 +329,7 @@ impl UIGridPipeline {
 
         if let Some(texture_id) = self.texture_id {
             graphics
-                .egui_renderer
+                .egui_renderer()
                 .lock()
                 .renderer()
                 .update_egui_texture_from_wgpu_texture(
@@ -339,7 +340,7 @@ impl UIGridPipeline {
                 );
         } else {
             let texture_id = graphics
-                .egui_renderer
+                .egui_renderer()
                 .lock()
                 .renderer()
                 .register_native_texture(&graphics.device, &resolve_view, wgpu::FilterMode::Linear);
@@ -270,7 +270,7 @@ async fn main() -> anyhow::Result<()> {
             eucalyptus_core::states::load_scene_into_memory(scene_to_load)?;
             log::info!("Loaded initial scene '{}' for play mode", scene_to_load);
 
-            let future_queue = Arc::new(FutureQueue::new());
+            let future_queue = Arc::new(FutureQueue::with_job_system_or_fallback());
 
             let play_mode = Rc::new(RwLock::new(
                 eucalyptus_editor::runtime::PlayMode::new(initial_scene).unwrap_or_else(|e| {
@@ -295,7 +295,7 @@ async fn main() -> anyhow::Result<()> {
         None => {
             let _ = RUNTIME_MODE.set(RuntimeMode::Editor);
 
-            let future_queue = Arc::new(FutureQueue::new());
+            let future_queue = Arc::new(FutureQueue::with_job_system_or_fallback());
 
             let main_menu = Rc::new(RwLock::new(menu::MainMenu::new()));
             let editor =
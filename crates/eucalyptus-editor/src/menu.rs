@@ -2,7 +2,7 @@ use crate::editor::settings::editor::EditorSettingsWindow;
 use anyhow::{Context, anyhow};
 use dropbear_engine::{
     DropbearWindowBuilder,
-    future::{FutureHandle, FutureQueue},
+    future::{FutureHandle, FutureQueue, JobPriority},
     input::{Controller, Keyboard, Mouse},
     scene::{Scene, SceneCommand},
 };
@@ -76,7 +76,8 @@ impl MainMenu {
         self.show_progress = true;
         self.progress = 0.0;
 
-        let handle = queue.push(async move {
+        // unpacking the templates is CPU bound, so it runs on the compute pool
+        let handle = queue.push_compute_future(JobPriority::High, async move {
             let mut errors = Vec::new();
             let folders = [
                 ("gradle", 0.1, "Unpacking gradle template..."),
@@ -308,8 +309,8 @@ impl Scene for MainMenu {
         }
 
         let screen_size: (f32, f32) = (
-            graphics.window.inner_size().width as f32 - 100.0,
-            graphics.window.inner_size().height as f32 - 100.0,
+            graphics.window().inner_size().width as f32 - 100.0,
+            graphics.window().inner_size().height as f32 - 100.0,
         );
         let egui_ctx = ui.ctx().clone();
         let mut local_open_project = false;
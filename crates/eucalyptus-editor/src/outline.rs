@@ -18,7 +18,7 @@ pub struct OutlineShader {
 
 impl OutlineShader {
     pub fn new(graphics: Arc<SharedGraphicsContext>) -> anyhow::Result<Self> {
-        let size = graphics.window.inner_size();
+        let size = graphics.window().inner_size();
 
         let depth_stencil_format = wgpu::TextureFormat::Depth24PlusStencil8;
         let depth_stencil = TextureBuilder::new(&graphics.device)
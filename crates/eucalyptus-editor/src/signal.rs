@@ -2,9 +2,11 @@ use crate::editor::{AssetClipboard, Editor, EditorState, Signal};
 use crate::spawn::{PendingSpawn, push_pending_spawn};
 use dropbear_engine::asset::ASSET_REGISTRY;
 use dropbear_engine::entity::MeshRenderer;
+use dropbear_engine::future::JobPriority;
 use dropbear_engine::graphics::SharedGraphicsContext;
 use egui::Align2;
 use eucalyptus_core::camera::{CameraComponent, CameraType};
+use eucalyptus_core::change;
 use eucalyptus_core::scene::SceneEntity;
 use eucalyptus_core::scripting::types::KotlinComponents;
 use eucalyptus_core::scripting::{BuildStatus, build_jvm};
@@ -95,6 +97,14 @@ impl SignalController for Editor {
 
                     info!("Pasted asset to {}", target_path.display());
 
+                    // the copy is a new asset, so it gets its own sidecar and UUID
+                    if eucalyptus_core::metadata::detect_asset_type(&target_path).is_some() {
+                        let project_root = PROJECT.read().project_path.clone();
+                        if let Err(e) = eucalyptus_core::metadata::generate_eucmeta(&target_path, &project_root) {
+                            log::warn!("Failed to generate .eucmeta for '{}': {}", target_path.display(), e);
+                        }
+                    }
+
                     Ok(())
                 }
                 Signal::Paste(entities, parent_map, paste_parent) => {
@@ -155,7 +165,7 @@ impl SignalController for Editor {
 
                             Ok(())
                         } else {
-                            match self.world.despawn(*sel_e) {
+                            match change::despawn(&mut self.world, *sel_e) {
                                 Ok(_) => {
                                     info!("Decimated entity");
 
@@ -580,7 +590,7 @@ impl SignalController for Editor {
                             } else {
                                 let mut new_kc = KotlinComponents::default();
                                 new_kc.attach(&fqcn);
-                                if let Err(e) = self.world.insert_one(entity, new_kc) {
+                                if let Err(e) = change::insert_one(&mut self.world, entity, new_kc) {
                                     warn!(
                                         "Failed to insert KotlinComponents for '{}': {}",
                                         fqcn, e
@@ -637,7 +647,9 @@ impl SignalController for Editor {
 
                         loader_future.await
                     };
-                    let handle = graphics.future_queue.push(init_future);
+                    let handle = graphics
+                        .future_queue
+                        .push_compute_future(JobPriority::Normal, init_future);
                     self.pending_components.push((entity, handle));
 
                     success!("Queued component addition for entity {:?}", entity);
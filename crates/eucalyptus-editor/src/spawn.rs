@@ -1,9 +1,10 @@
 use crate::editor::Editor;
 use dropbear_engine::asset::Handle;
 use dropbear_engine::entity::{EntityTransform, MeshRenderer};
-use dropbear_engine::future::{FutureHandle, FutureQueue};
+use dropbear_engine::future::{FutureHandle, FutureQueue, JobPriority};
 use dropbear_engine::graphics::SharedGraphicsContext;
 use dropbear_engine::model::Model;
+use eucalyptus_core::change::{self, mark_changed};
 use eucalyptus_core::component::ComponentApply;
 use eucalyptus_core::hierarchy::{Hierarchy, Parent};
 use eucalyptus_core::scene::SceneEntity;
@@ -81,7 +82,7 @@ impl PendingSpawnController for Editor {
                     ))
                 };
 
-                let handle = queue.push(Box::pin(future));
+                let handle = queue.push_compute_future(JobPriority::Normal, future);
                 spawn.handle = Some(handle);
             }
 
@@ -99,10 +100,13 @@ impl PendingSpawnController for Editor {
                                     applier.apply_to_builder(&mut builder);
                                 }
 
-                                let entity = self.world.spawn(builder.build());
+                                let entity = change::spawn(&mut self.world, builder.build());
                                 if self.world.get::<&EntityTransform>(entity).is_err() {
-                                    let _ =
-                                        self.world.insert_one(entity, EntityTransform::default());
+                                    let _ = change::insert_one(
+                                        &mut self.world,
+                                        entity,
+                                        EntityTransform::default(),
+                                    );
                                 }
 
                                 // attach to parent
@@ -195,10 +199,11 @@ impl PendingSpawnController for Editor {
                     Ok(r) => match Arc::try_unwrap(r) {
                         Ok(Ok(loaded_model)) => {
                             if let Ok(mut renderer) = self.world.get::<&mut MeshRenderer>(*entity) {
-                                renderer.set_model(loaded_model)
+                                renderer.set_model(loaded_model);
+                                mark_changed::<MeshRenderer>(*entity);
                             } else {
                                 let renderer = MeshRenderer::from_handle(loaded_model);
-                                let _ = self.world.insert_one(*entity, renderer);
+                                let _ = change::insert_one(&mut self.world, *entity, renderer);
                             }
 
                             success!("Swapped MeshRenderer model for entity {:?}", entity);
@@ -1,6 +1,7 @@
-use std::{collections::VecDeque, time::Instant};
+use std::{collections::VecDeque, sync::Arc, time::Instant};
 
 use dropbear_engine::WGPU_BACKEND;
+use dropbear_engine::gpu_profiler::{GpuFrameTimings, GpuProfiler};
 use dropbear_engine::input::{Controller, Keyboard, Mouse};
 use dropbear_engine::scene::Scene;
 use egui::{Color32, RichText, Ui};
@@ -35,6 +36,10 @@ pub struct NerdStats {
     max_fps: f32,
     avg_fps: f32,
     entity_count: u32,
+
+    gpu_profiling: bool,
+    gpu_timings: Option<Arc<GpuFrameTimings>>,
+    gpu_time_history: VecDeque<[f64; 2]>,
 }
 
 impl Default for NerdStats {
@@ -53,6 +58,9 @@ impl Default for NerdStats {
             avg_fps: 0.0,
             show_window: false,
             entity_count: 0,
+            gpu_profiling: false,
+            gpu_timings: None,
+            gpu_time_history: VecDeque::with_capacity(300),
         }
     }
 }
@@ -110,6 +118,29 @@ impl NerdStats {
         self.entity_count = entity_count;
     }
 
+    /// Picks up the latest pass timings from the [`GpuProfiler`], which lag a few frames behind.
+    pub fn record_gpu_timings(&mut self, profiler: &GpuProfiler) {
+        self.gpu_profiling = profiler.is_enabled();
+        let Some(timings) = profiler.latest() else {
+            return;
+        };
+        if self
+            .gpu_timings
+            .as_ref()
+            .is_some_and(|previous| Arc::ptr_eq(previous, &timings))
+        {
+            return;
+        }
+
+        let elapsed = self.start_time.elapsed().as_secs_f64();
+        self.gpu_time_history
+            .push_back([elapsed, timings.total_milliseconds]);
+        if self.gpu_time_history.len() > 300 {
+            self.gpu_time_history.pop_front();
+        }
+        self.gpu_timings = Some(timings);
+    }
+
     /// Resets statistics to their defaults
     pub fn reset_stats(&mut self) {
         self.min_fps = self.current_fps;
@@ -117,6 +148,7 @@ impl NerdStats {
         self.fps_history.clear();
         self.frame_time_history.clear();
         self.memory_history.clear();
+        self.gpu_time_history.clear();
         self.start_time = Instant::now();
         self.total_frames = 0;
     }
@@ -290,6 +322,60 @@ impl NerdStats {
                     }
                 });
 
+            ui.separator();
+            ui.collapsing("GPU Passes", |ui| {
+                if !self.gpu_profiling {
+                    ui.label("This adapter does not support timestamp queries.");
+                    return;
+                }
+                let Some(timings) = &self.gpu_timings else {
+                    ui.label("Waiting for the GPU...");
+                    return;
+                };
+
+                egui::Grid::new("gpu_passes")
+                    .num_columns(3)
+                    .striped(true)
+                    .show(ui, |ui| {
+                        ui.label(RichText::new("Pass").strong());
+                        ui.label(RichText::new("Count").strong());
+                        ui.label(RichText::new("Time (ms)").strong());
+                        ui.end_row();
+
+                        for pass in &timings.passes {
+                            ui.label(&pass.label);
+                            ui.label(pass.count.to_string());
+                            ui.label(format!("{:.3}", pass.milliseconds));
+                            ui.end_row();
+                        }
+
+                        ui.label(RichText::new("Frame").strong());
+                        ui.label("");
+                        ui.label(
+                            RichText::new(format!("{:.3}", timings.total_milliseconds)).strong(),
+                        );
+                        ui.end_row();
+                    });
+
+                ui.add_space(5.0);
+                Plot::new("gpu_time_plot")
+                    .height(120.0)
+                    .show_axes([false, true])
+                    .show_grid([false, true])
+                    .legend(Legend::default())
+                    .show(ui, |plot_ui| {
+                        if !self.gpu_time_history.is_empty() {
+                            let points: Vec<[f64; 2]> =
+                                self.gpu_time_history.iter().cloned().collect();
+                            plot_ui.line(
+                                Line::new("gputime", PlotPoints::from(points))
+                                    .color(Color32::from_rgb(200, 120, 255))
+                                    .name("GPU Time (ms)"),
+                            );
+                        }
+                    });
+            });
+
             ui.separator();
             ui.collapsing("System Information", |ui| {
                 ui.horizontal(|ui| {
@@ -2,6 +2,7 @@ use hecs::{Entity, World};
 use dropbear_engine::animation::{AnimationComponent, AnimationSettings};
 use dropbear_engine::asset::ASSET_REGISTRY;
 use dropbear_engine::entity::MeshRenderer;
+use eucalyptus_core::change::mark_changed;
 use eucalyptus_core::ptr::WorldPtr;
 use eucalyptus_core::scripting::native::DropbearNativeError;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
@@ -52,6 +53,7 @@ fn set_active_animation_index(
     let mut component = world
         .get::<&mut AnimationComponent>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<AnimationComponent>(entity);
 
     let index = match index {
         Some(value) if *value >= 0 => Some(*value as usize),
@@ -110,6 +112,7 @@ fn set_time(
     let mut component = world
         .get::<&mut AnimationComponent>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<AnimationComponent>(entity);
 
     component.time = value as f32;
 
@@ -174,6 +177,7 @@ fn set_speed(
     let mut component = world
         .get::<&mut AnimationComponent>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<AnimationComponent>(entity);
 
     component.speed = value as f32;
 
@@ -238,6 +242,7 @@ fn set_looping(
     let mut component = world
         .get::<&mut AnimationComponent>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<AnimationComponent>(entity);
 
     component.looping = value;
 
@@ -302,6 +307,7 @@ fn set_is_playing(
     let mut component = world
         .get::<&mut AnimationComponent>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<AnimationComponent>(entity);
 
     component.is_playing = value;
 
@@ -0,0 +1,145 @@
+use dropbear_engine::audio::{PlayParams, SoundId, SoundSource};
+use dropbear_engine::utils::ResourceReference;
+use eucalyptus_core::ptr::{AudioEnginePtr, AudioEngineUnwrapped, WorldPtr};
+use eucalyptus_core::scripting::native::DropbearNativeError;
+use eucalyptus_core::scripting::result::DropbearNativeResult;
+use eucalyptus_core::utils::ResolveReference;
+
+/// Resolves a clip's eucalyptus URI (such as `euca://sounds/hit.ogg`) into the file to stream.
+fn clip_source(clip: &str) -> DropbearNativeResult<SoundSource> {
+    let reference =
+        ResourceReference::from_euca_uri(clip).map_err(|_| DropbearNativeError::InvalidURI)?;
+    let path = reference
+        .resolve()
+        .map_err(|_| DropbearNativeError::AssetNotFound)?;
+    Ok(SoundSource::File(path))
+}
+
+fn play(
+    audio: &AudioEngineUnwrapped,
+    clip: &str,
+    params: PlayParams,
+    attach: Option<(&hecs::World, hecs::Entity)>,
+) -> DropbearNativeResult<u64> {
+    let source = clip_source(clip)?;
+    let mut audio = audio.lock();
+    let result = match attach {
+        Some((world, entity)) => audio.play_attached(world, entity, source, params),
+        None => audio.play(source, params),
+    };
+    // failing to decode the clip is logged by the streamer, this only fails when the mixer is
+    // overwhelmed with commands
+    result
+        .map(|id| id.0)
+        .map_err(|_| DropbearNativeError::GenericError)
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "play"),
+    c
+)]
+fn play_sound(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    clip: String,
+    volume: f64,
+    pitch: f64,
+    looping: bool,
+) -> DropbearNativeResult<u64> {
+    let params = PlayParams {
+        volume: volume as f32,
+        pitch: pitch as f32,
+        looping,
+        ..Default::default()
+    };
+    play(audio, &clip, params, None)
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "playAtEntity"),
+    c
+)]
+fn play_sound_at_entity(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    #[dropbear_macro::define(WorldPtr)] world: &hecs::World,
+    #[dropbear_macro::entity] entity: hecs::Entity,
+    clip: String,
+    volume: f64,
+    pitch: f64,
+    looping: bool,
+    min_distance: f64,
+    max_distance: f64,
+) -> DropbearNativeResult<u64> {
+    if !world.contains(entity) {
+        return Err(DropbearNativeError::NoSuchEntity);
+    }
+    let params = PlayParams {
+        volume: volume as f32,
+        pitch: pitch as f32,
+        looping,
+        min_distance: min_distance as f32,
+        max_distance: max_distance as f32,
+        ..Default::default()
+    };
+    play(audio, &clip, params, Some((world, entity)))
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "stop"),
+    c
+)]
+fn stop_sound(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    sound: u64,
+) -> DropbearNativeResult<()> {
+    audio.lock().stop(SoundId(sound));
+    Ok(())
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "setVolume"),
+    c
+)]
+fn set_sound_volume(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    sound: u64,
+    volume: f64,
+) -> DropbearNativeResult<()> {
+    audio.lock().set_volume(SoundId(sound), volume as f32);
+    Ok(())
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "setPitch"),
+    c
+)]
+fn set_sound_pitch(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    sound: u64,
+    pitch: f64,
+) -> DropbearNativeResult<()> {
+    audio.lock().set_pitch(SoundId(sound), pitch as f32);
+    Ok(())
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "isPlaying"),
+    c
+)]
+fn is_sound_playing(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    sound: u64,
+) -> DropbearNativeResult<bool> {
+    Ok(audio.lock().is_playing(SoundId(sound)))
+}
+
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.audio.AudioNative", func = "setMasterVolume"),
+    c
+)]
+fn set_master_volume(
+    #[dropbear_macro::define(AudioEnginePtr)] audio: &AudioEngineUnwrapped,
+    volume: f64,
+) -> DropbearNativeResult<()> {
+    audio.lock().set_master_volume(volume as f32);
+    Ok(())
+}
@@ -10,6 +10,7 @@ pub use eucalyptus_core::convert_jlong_to_entity;
 
 pub mod animation;
 pub mod asset;
+pub mod audio;
 pub mod camera;
 pub mod component;
 pub mod debug;
@@ -1,3 +1,4 @@
+use eucalyptus_core::change::mark_changed;
 use eucalyptus_core::ptr::WorldPtr;
 use eucalyptus_core::scripting::native::DropbearNativeError;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
@@ -140,6 +141,7 @@ fn set_transform_position(
     position: DVec3,
 ) -> DropbearNativeResult<()> {
     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
+        mark_changed::<EntityTransform>(entity);
         et.local_mut().position = position;
         Ok(())
     } else if let Ok(mut t) = world.get::<&mut Transform>(entity) {
@@ -156,6 +158,7 @@ fn set_transform_rotation(
     rotation: DQuat,
 ) -> DropbearNativeResult<()> {
     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
+        mark_changed::<EntityTransform>(entity);
         et.local_mut().rotation = rotation;
         Ok(())
     } else if let Ok(mut t) = world.get::<&mut Transform>(entity) {
@@ -260,6 +263,7 @@ fn set_colour(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.colour = colour.to_linear_rgb();
     Ok(())
 }
@@ -290,6 +294,7 @@ fn set_light_type(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.light_type = match light_type {
         0 => LightType::Directional,
         1 => LightType::Point,
@@ -325,6 +330,7 @@ fn set_intensity(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.intensity = intensity as f32;
     Ok(())
 }
@@ -359,6 +365,7 @@ fn set_attenuation(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.attenuation.constant = attenuation.constant;
     light.component.attenuation.linear = attenuation.linear;
     light.component.attenuation.quadratic = attenuation.quadratic;
@@ -391,6 +398,7 @@ fn set_enabled(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.enabled = enabled;
     Ok(())
 }
@@ -421,6 +429,7 @@ fn set_cutoff_angle(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.cutoff_angle = cutoff_angle as f32;
     Ok(())
 }
@@ -451,6 +460,7 @@ fn set_outer_cutoff_angle(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.outer_cutoff_angle = outer_cutoff_angle as f32;
     Ok(())
 }
@@ -481,6 +491,7 @@ fn set_casts_shadows(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.cast_shadows = casts_shadows;
     Ok(())
 }
@@ -520,6 +531,7 @@ fn set_depth(
     let mut light = world
         .get::<&mut Light>(entity)
         .map_err(|_| DropbearNativeError::MissingComponent)?;
+    mark_changed::<Light>(entity);
     light.component.depth = depth.start..depth.end;
     Ok(())
 }
@@ -1,3 +1,4 @@
+use eucalyptus_core::change::mark_changed;
 use eucalyptus_core::ptr::{AssetRegistryPtr, AssetRegistryUnwrapped, GraphicsContextPtr, WorldPtr};
 use eucalyptus_core::scripting::native::DropbearNativeError;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
@@ -74,6 +75,7 @@ fn set_model(
     }
 
     if let Ok(mut mesh) = world.get::<&mut MeshRenderer>(entity) {
+        mark_changed::<MeshRenderer>(entity);
         mesh.set_model(handle);
         Ok(())
     } else {
@@ -180,6 +182,7 @@ fn set_texture_override(
     let mut renderer = world
         .get::<&mut MeshRenderer>(entity)
         .map_err(|_| DropbearNativeError::NoSuchComponent)?;
+    mark_changed::<MeshRenderer>(entity);
 
     if let Some(v) = renderer.material_snapshot.get_mut(&material_name) {
         v.diffuse_texture = handle;
@@ -212,6 +215,7 @@ fn set_material_tint(
     let mut renderer = world
         .get::<&mut MeshRenderer>(entity)
         .map_err(|_| DropbearNativeError::NoSuchComponent)?;
+    mark_changed::<MeshRenderer>(entity);
 
     let material = renderer
         .material_snapshot
@@ -1,10 +1,8 @@
-use eucalyptus_core::physics::kcc::{CharacterMovementResult, KCC};
+use eucalyptus_core::physics::kcc::{CharacterMove, CharacterMovementResult, KCC};
 use eucalyptus_core::physics::PhysicsState;
 use eucalyptus_core::ptr::WorldPtr;
-use eucalyptus_core::rapier3d;
 use eucalyptus_core::rapier3d::dynamics::RigidBodyType;
 use eucalyptus_core::rapier3d::math::Rotation;
-use eucalyptus_core::rapier3d::pipeline::QueryFilter;
 use eucalyptus_core::scripting::native::DropbearNativeError;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
 use eucalyptus_core::states::Label;
@@ -375,91 +373,42 @@ fn move_character(
     translation: &NVector3,
     delta_time: f64,
 ) -> DropbearNativeResult<()> {
-    if let Ok((label, kcc)) = world.query_one::<(&Label, &mut KCC)>(entity).get() {
-        let rigid_body_handle = physics_state
-            .bodies_entity_map
-            .get(label)
-            .ok_or(DropbearNativeError::NoSuchHandle)?;
-
-        let (body_type, body_pos) = {
-            let body = physics_state
-                .bodies
-                .get(*rigid_body_handle)
-                .ok_or(DropbearNativeError::PhysicsObjectNotFound)?;
-            (body.body_type(), *body.position())
-        };
-
-        if body_type != RigidBodyType::KinematicPositionBased {
-            return Ok(()); // soft error, just tell the user
-        }
-
-        let collider_handles = physics_state
-            .colliders_entity_map
-            .get(label)
-            .ok_or(DropbearNativeError::NoSuchHandle)?;
-        let (_, collider_handle) = collider_handles
-            .first()
-            .ok_or(DropbearNativeError::NoSuchHandle)?;
-        let collider = physics_state
-            .colliders
-            .get(*collider_handle)
-            .ok_or(DropbearNativeError::PhysicsObjectNotFound)?;
-
-        let character_pos = if let Some(pos_wrt_parent) = collider.position_wrt_parent() {
-            body_pos * (*pos_wrt_parent)
-        } else {
-            *collider.position()
-        };
+    if world.get::<&KCC>(entity).is_err() {
+        return Err(DropbearNativeError::MissingComponent);
+    }
 
-        let filter = QueryFilter::default()
-            .exclude_rigid_body(*rigid_body_handle)
-            .exclude_sensors();
-        let query_pipeline = physics_state.broad_phase.as_query_pipeline(
-            physics_state.narrow_phase.query_dispatcher(),
-            &physics_state.bodies,
-            &physics_state.colliders,
-            filter,
-        );
-
-        let movement = kcc.controller.move_shape(
-            delta_time as f32,
-            &query_pipeline,
-            collider.shape(),
-            &character_pos,
-            rapier3d::prelude::Vector::new(
-                translation.x as f32,
-                translation.y as f32,
-                translation.z as f32,
-            ),
-            |collision| {
-                if let Some(collisions) =
-                    physics_state.collision_events_to_deal_with.get_mut(&entity)
-                {
-                    collisions.push(collision)
-                } else {
-                    physics_state
-                        .collision_events_to_deal_with
-                        .insert(entity, vec![collision]);
-                }
-            },
-        );
+    physics_state.character_moves.push(CharacterMove {
+        entity_id: entity.to_bits().get(),
+        translation: *translation,
+        delta_time,
+    });
+    Ok(())
+}
 
-        if let Some(body) = physics_state.bodies.get_mut(*rigid_body_handle) {
-            let current_pos = body.translation();
-            let new_pos = current_pos + movement.translation;
-            body.set_next_kinematic_translation(new_pos);
+#[dropbear_macro::export(
+    kotlin(
+        class = "com.dropbear.physics.KinematicCharacterControllerNative",
+        func = "moveCharacters"
+    ),
+    c
+)]
+fn move_characters(
+    #[dropbear_macro::define(WorldPtr)] world: &hecs::World,
+    #[dropbear_macro::define(crate::ptr::PhysicsStatePtr)] physics_state: &mut PhysicsState,
+    moves: &Vec<CharacterMove>,
+) -> DropbearNativeResult<()> {
+    // all or nothing: every entry is checked before any is queued, so a script that gets an error
+    // back can fix the batch and send it again without moving a character twice this tick
+    for character_move in moves {
+        let has_kcc = hecs::Entity::from_bits(character_move.entity_id)
+            .is_some_and(|entity| world.get::<&KCC>(entity).is_ok());
+        if !has_kcc {
+            return Err(DropbearNativeError::MissingComponent);
         }
-
-        kcc.movement = Some(CharacterMovementResult {
-            translation: movement.translation.into(),
-            grounded: movement.grounded,
-            is_sliding_down_slope: movement.is_sliding_down_slope,
-        });
-
-        Ok(())
-    } else {
-        Err(DropbearNativeError::MissingComponent)
     }
+
+    physics_state.character_moves.extend_from_slice(moves);
+    Ok(())
 }
 
 #[dropbear_macro::export(
@@ -1,6 +1,6 @@
 pub use eucalyptus_core::types::{
-    CollisionEvent, CollisionEventType, ContactForceEvent, IndexNative, NCollider, NShapeCastHit,
-    NShapeCastStatus, RayHit, RigidBodyContext,
+    CollisionEvent, CollisionEventType, ContactForceEvent, IndexNative, NCollider, NQueryFilter,
+    NQueryHit, NRay, NShapeCastHit, NShapeCastStatus, NShapeQueryHit, RayHit, RigidBodyContext,
 };
 
 pub mod physics;
@@ -8,7 +8,7 @@ pub mod physics;
 use jni::objects::JObject;
 use jni::sys::jdouble;
 use jni::{jni_sig, jni_str, Env, JValue};
-use eucalyptus_core::physics::kcc::CharacterMovementResult;
+use eucalyptus_core::physics::kcc::{CharacterMove, CharacterMovementResult};
 use eucalyptus_core::scripting::native::DropbearNativeError;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
 use crate::{FromJObject, ToJObject};
@@ -245,6 +245,139 @@ impl ToJObject for NShapeCastHit {
     }
 }
 
+// ------------------------------------------------- scene query JNI impls ----
+
+impl FromJObject for NRay {
+    fn from_jobject(env: &mut Env, obj: &JObject) -> DropbearNativeResult<Self> {
+        let origin_obj = env
+            .get_field(obj, jni_str!("origin"), jni_sig!(com.dropbear.math.Vector3d))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .l()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let direction_obj = env
+            .get_field(obj, jni_str!("direction"), jni_sig!(com.dropbear.math.Vector3d))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .l()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let max_distance = env
+            .get_field(obj, jni_str!("maxDistance"), jni_sig!(double))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .d()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        Ok(NRay {
+            origin: NVector3::from_jobject(env, &origin_obj)?,
+            direction: NVector3::from_jobject(env, &direction_obj)?,
+            max_distance,
+        })
+    }
+}
+
+impl FromJObject for NQueryFilter {
+    fn from_jobject(env: &mut Env, obj: &JObject) -> DropbearNativeResult<Self> {
+        let memberships = env
+            .get_field(obj, jni_str!("memberships"), jni_sig!(int))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .i()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)? as u32;
+
+        let filter = env
+            .get_field(obj, jni_str!("filter"), jni_sig!(int))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .i()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)? as u32;
+
+        let exclude_sensors = env
+            .get_field(obj, jni_str!("excludeSensors"), jni_sig!(boolean))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .z()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let exclude_fixed = env
+            .get_field(obj, jni_str!("excludeFixed"), jni_sig!(boolean))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .z()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let exclude_dynamic = env
+            .get_field(obj, jni_str!("excludeDynamic"), jni_sig!(boolean))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .z()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let exclude_kinematic = env
+            .get_field(obj, jni_str!("excludeKinematic"), jni_sig!(boolean))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .z()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let entity_obj = env
+            .get_field(obj, jni_str!("excludeEntity"), jni_sig!(com.dropbear.EntityId))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .l()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let exclude_entity = if entity_obj.is_null() {
+            0
+        } else {
+            env.get_field(&entity_obj, jni_str!("raw"), jni_sig!(long))
+                .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+                .j()
+                .map_err(|_| DropbearNativeError::JNIUnwrapFailed)? as u64
+        };
+
+        Ok(NQueryFilter {
+            memberships,
+            filter,
+            exclude_sensors,
+            exclude_fixed,
+            exclude_dynamic,
+            exclude_kinematic,
+            exclude_entity,
+        })
+    }
+}
+
+impl ToJObject for NQueryHit {
+    fn to_jobject<'a>(&self, env: &mut Env<'a>) -> DropbearNativeResult<JObject<'a>> {
+        let collider = self.collider.to_jobject(env)?;
+
+        let class = env
+            .load_class(jni_str!("com/dropbear/physics/QueryHit"))
+            .map_err(|_| DropbearNativeError::JNIClassNotFound)?;
+
+        env.new_object(
+            class,
+            jni_sig!((int, com.dropbear.physics.Collider, double) -> void),
+            &[
+                JValue::Int(self.query as i32),
+                JValue::Object(&collider),
+                JValue::Double(self.distance as jdouble),
+            ],
+        )
+        .map_err(|_| DropbearNativeError::JNIFailedToCreateObject)
+    }
+}
+
+impl ToJObject for NShapeQueryHit {
+    fn to_jobject<'a>(&self, env: &mut Env<'a>) -> DropbearNativeResult<JObject<'a>> {
+        let hit = self.hit.to_jobject(env)?;
+
+        let class = env
+            .load_class(jni_str!("com/dropbear/physics/ShapeQueryHit"))
+            .map_err(|_| DropbearNativeError::JNIClassNotFound)?;
+
+        env.new_object(
+            class,
+            jni_sig!((int, com.dropbear.physics.ShapeCastHit) -> void),
+            &[JValue::Int(self.query as i32), JValue::Object(&hit)],
+        )
+        .map_err(|_| DropbearNativeError::JNIFailedToCreateObject)
+    }
+}
+
 // ------------------------------------------------ NShapeCastStatus JNI impl --
 
 impl ToJObject for NShapeCastStatus {
@@ -434,6 +567,42 @@ impl ToJObject for RayHit {
     }
 }
 
+// ---------------------------------------------- CharacterMove JNI impl -------
+
+impl FromJObject for CharacterMove {
+    fn from_jobject(env: &mut Env, obj: &JObject) -> DropbearNativeResult<Self> {
+        let entity_obj = env
+            .get_field(obj, jni_str!("entity"), jni_sig!(com.dropbear.EntityId))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .l()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let entity_raw = env
+            .get_field(&entity_obj, jni_str!("raw"), jni_sig!(long))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .j()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let translation_obj = env
+            .get_field(obj, jni_str!("translation"), jni_sig!(com.dropbear.math.Vector3d))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .l()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        let delta_time = env
+            .get_field(obj, jni_str!("dt"), jni_sig!(double))
+            .map_err(|_| DropbearNativeError::JNIFailedToGetField)?
+            .d()
+            .map_err(|_| DropbearNativeError::JNIUnwrapFailed)?;
+
+        Ok(CharacterMove {
+            entity_id: entity_raw as u64,
+            translation: NVector3::from_jobject(env, &translation_obj)?,
+            delta_time,
+        })
+    }
+}
+
 // ------------------------------------- CharacterMovementResult JNI impl -------
 
 impl ToJObject for CharacterMovementResult {
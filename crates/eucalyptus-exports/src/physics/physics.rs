@@ -1,12 +1,14 @@
 use glam::Vec3;
 use eucalyptus_core::ptr::PhysicsStatePtr;
 use eucalyptus_core::scripting::result::DropbearNativeResult;
-use eucalyptus_core::types::{IndexNative, NCollider, NShapeCastHit, NVector3, RayHit};
+use eucalyptus_core::types::{
+    NCollider, NQueryFilter, NQueryHit, NRay, NShapeCastHit, NShapeQueryHit, NVector3, RayHit,
+};
 use eucalyptus_core::rapier3d::parry::query::{DefaultQueryDispatcher, ShapeCastOptions};
 use hecs::Entity;
 use eucalyptus_core::physics::collider::ColliderShape;
-use eucalyptus_core::physics::PhysicsState;
-use eucalyptus_core::rapier3d::prelude::{nalgebra, point, vector, ColliderHandle, Pose3, QueryFilter, Ray, SharedShape};
+use eucalyptus_core::physics::{query, PhysicsState};
+use eucalyptus_core::rapier3d::prelude::{nalgebra, point, vector, Pose3, QueryFilter, Ray};
 
 pub mod shared {
     use hecs::Entity;
@@ -139,48 +141,12 @@ fn raycast(
         vector![dir.x as f32, dir.y as f32, dir.z as f32].into(),
     );
 
-    if let Some((hit, distance)) = qp.cast_ray(&ray, time_of_impact as f32, solid) {
-        let raw = hit.0;
-
-        let mut found = None;
-        for (l, colliders) in physics.colliders_entity_map.iter() {
-            for (_, c) in colliders {
-                if c.0 == hit.0 {
-                    found = Some((l, c.0));
-                }
-            }
-        }
-
-        if let Some((label, _)) = found {
-            let entity = physics.entity_label_map.iter().find(|(_, l)| *l == label);
-            if let Some((e, _)) = entity {
-                let rayhit = RayHit {
-                    collider: NCollider {
-                        index: IndexNative::from(raw),
-                        entity_id: e.to_bits().get(),
-                        id: raw.into_raw_parts().0,
-                    },
-                    distance: distance as f64,
-                };
-                Ok(Some(rayhit))
-            } else {
-                Ok(None)
-            }
-        } else {
-            eprintln!("Unknown collider, still returning value without entity_id");
-            let rayhit = RayHit {
-                collider: NCollider {
-                    index: IndexNative::from(raw),
-                    entity_id: Entity::DANGLING.to_bits().get(),
-                    id: raw.into_raw_parts().0,
-                },
-                distance: distance as f64,
-            };
-            Ok(Some(rayhit))
-        }
-    } else {
-        Ok(None)
-    }
+    Ok(qp
+        .cast_ray(&ray, time_of_impact as f32, solid)
+        .map(|(hit, distance)| RayHit {
+            collider: physics.collider_ffi(hit),
+            distance: distance as f64,
+        }))
 }
 
 #[dropbear_macro::export(
@@ -215,23 +181,7 @@ fn shape_cast(
         z: direction.z / dir_len,
     };
 
-    let cast_shape = match shape {
-        ColliderShape::Box { half_extents } => SharedShape::cuboid(
-            half_extents.x as f32,
-            half_extents.y as f32,
-            half_extents.z as f32,
-        ),
-        ColliderShape::Sphere { radius } => SharedShape::ball(*radius),
-        ColliderShape::Capsule { half_height, radius } => {
-            SharedShape::capsule_y(*half_height, *radius)
-        }
-        ColliderShape::Cylinder { half_height, radius } => {
-            SharedShape::cylinder(*half_height, *radius)
-        }
-        ColliderShape::Cone { half_height, radius } => {
-            SharedShape::cone(*half_height, *radius)
-        }
-    };
+    let cast_shape = shape.to_shared_shape();
 
     let iso: Pose3 =
         nalgebra::Isometry3::translation(origin.x as f32, origin.y as f32, origin.z as f32)
@@ -249,19 +199,8 @@ fn shape_cast(
         return Ok(None);
     };
 
-    let collider = collider_ffi_from_handle(physics, hit_handle);
-
-    let hit = NShapeCastHit {
-        collider,
-        distance: toi.time_of_impact as f64,
-        witness1: NVector3::from([toi.witness1.x, toi.witness1.y, toi.witness1.z]),
-        witness2: NVector3::from([toi.witness2.x, toi.witness2.y, toi.witness2.z]),
-        normal1: NVector3::from([toi.normal1.x, toi.normal1.y, toi.normal1.z]),
-        normal2: NVector3::from([toi.normal2.x, toi.normal2.y, toi.normal2.z]),
-        status: toi.status.into(),
-    };
-
-    Ok(Some(hit))
+    let collider = physics.collider_ffi(hit_handle);
+    Ok(Some(NShapeCastHit::from_rapier(collider, &toi)))
 }
 
 #[dropbear_macro::export(
@@ -300,36 +239,43 @@ fn is_touching(
     Ok(shared::touching(physics, entity1, entity2))
 }
 
-fn collider_ffi_from_handle(physics: &PhysicsState, handle: ColliderHandle) -> NCollider {
-    let (idx, generation) = handle.into_raw_parts();
-
-    let mut found_label = None;
-    for (label, colliders) in physics.colliders_entity_map.iter() {
-        for (_, c) in colliders {
-            if c.0 == handle.0 {
-                found_label = Some(label);
-                break;
-            }
-        }
-        if found_label.is_some() {
-            break;
-        }
-    }
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.physics.PhysicsNative", func = "castRays"),
+    c
+)]
+fn cast_rays(
+    #[dropbear_macro::define(PhysicsStatePtr)] physics: &PhysicsState,
+    rays: &Vec<NRay>,
+    filter: &NQueryFilter,
+    solid: bool,
+    all_hits: bool,
+) -> DropbearNativeResult<Vec<NQueryHit>> {
+    Ok(query::cast_rays(physics, rays, filter, solid, all_hits))
+}
 
-    let entity_id = if let Some(label) = found_label {
-        physics
-            .entity_label_map
-            .iter()
-            .find(|(_, l)| *l == label)
-            .map(|(e, _)| e.to_bits().get())
-            .unwrap_or(Entity::DANGLING.to_bits().get())
-    } else {
-        Entity::DANGLING.to_bits().get()
-    };
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.physics.PhysicsNative", func = "castShapes"),
+    c
+)]
+fn cast_shapes(
+    #[dropbear_macro::define(PhysicsStatePtr)] physics: &PhysicsState,
+    shape: &ColliderShape,
+    casts: &Vec<NRay>,
+    filter: &NQueryFilter,
+    solid: bool,
+) -> DropbearNativeResult<Vec<NShapeQueryHit>> {
+    Ok(query::cast_shapes(physics, shape, casts, filter, solid))
+}
 
-    NCollider {
-        index: IndexNative { index: idx, generation },
-        entity_id,
-        id: idx,
-    }
+#[dropbear_macro::export(
+    kotlin(class = "com.dropbear.physics.PhysicsNative", func = "overlapShapes"),
+    c
+)]
+fn overlap_shapes(
+    #[dropbear_macro::define(PhysicsStatePtr)] physics: &PhysicsState,
+    shape: &ColliderShape,
+    positions: &Vec<NVector3>,
+    filter: &NQueryFilter,
+) -> DropbearNativeResult<Vec<NQueryHit>> {
+    Ok(query::overlap_shapes(physics, shape, positions, filter))
 }
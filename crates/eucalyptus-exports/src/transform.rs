@@ -1,3 +1,4 @@
+use eucalyptus_core::change::mark_changed;
 use eucalyptus_core::hierarchy::EntityTransformExt;
 use eucalyptus_core::ptr::WorldPtr;
 use eucalyptus_core::scripting::native::DropbearNativeError;
@@ -163,6 +164,7 @@ fn set_local_transform(
     transform: &NTransform,
 ) -> DropbearNativeResult<()> {
     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
+        mark_changed::<EntityTransform>(entity);
         *et.local_mut() = (*transform).into();
         Ok(())
     } else {
@@ -201,6 +203,7 @@ fn set_world_transform(
     transform: &NTransform,
 ) -> DropbearNativeResult<()> {
     if let Ok(mut et) = world.get::<&mut EntityTransform>(entity) {
+        mark_changed::<EntityTransform>(entity);
         *et.world_mut() = (*transform).into();
         Ok(())
     } else {
@@ -390,6 +390,19 @@ impl KinoState {
         queue: &wgpu::Queue,
         encoder: &mut wgpu::CommandEncoder,
         view: &wgpu::TextureView,
+    ) {
+        self.render_timed(device, queue, encoder, view, None);
+    }
+
+    /// Same as [`KinoState::render`], with `timestamp_writes` passed to the HUD render pass so a
+    /// GPU profiler can time it.
+    pub fn render_timed(
+        &mut self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        encoder: &mut wgpu::CommandEncoder,
+        view: &wgpu::TextureView,
+        timestamp_writes: Option<wgpu::RenderPassTimestampWrites<'_>>,
     ) {
         log::trace!("rendering kinostate");
         self.renderer.upload_camera_matrix(
@@ -428,7 +441,7 @@ impl KinoState {
                     },
                 })],
                 depth_stencil_attachment: None,
-                timestamp_writes: None,
+                timestamp_writes,
                 occlusion_query_set: None,
                 multiview_mask: None,
             });
@@ -64,6 +64,8 @@ mod tests {
         assert!(output.contains("@CName(\"dropbear_load\")"));
         assert!(output.contains("@CName(\"dropbear_update\")"));
         assert!(output.contains("@CName(\"dropbear_destroy\")"));
+        assert!(output.contains("@CName(\"dropbear_collision_events\")"));
+        assert!(output.contains("@CName(\"dropbear_contact_force_events\")"));
     }
 
     #[test]
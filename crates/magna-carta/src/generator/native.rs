@@ -470,6 +470,76 @@ object ScriptManager {{
         }}
     }}
 
+    fun collisionEvents(tag: String, events: CPointer<LongVar>, count: Int): Int {{
+        val engine = dropbearEngine ?: return -2
+        try {{
+            val instances = scriptsByTag[tag] ?: emptyList()
+            if (instances.isEmpty()) return 0
+
+            val lanes = LongArray(count * EventRecords.COLLISION_LANES) {{ index -> events[index] }}
+            for (record in 0 until count) {{
+                val offset = record * EventRecords.COLLISION_LANES
+                val currentEntityId = EventRecords.currentEntity(lanes, offset)
+                val event = EventRecords.collisionEvent(lanes, offset)
+
+                for (instance in instances) {{
+                    try {{
+                        instance.attachEngine(engine)
+                        instance.setCurrentEntity(currentEntityId)
+                        instance.collisionEvent(engine, event)
+                    }} catch (ex: Exception) {{
+                        Logger.error("Failed to deliver collision event to $instance for entity $currentEntityId: ${{ex.message}}")
+                    }}
+                }}
+            }}
+
+            for (instance in instances) {{
+                instance.clearCurrentEntity()
+            }}
+
+            return 0
+        }} catch (e: Exception) {{
+            dropbear_set_last_error("Error delivering collision events for tag '$tag': ${{e.message}}")
+            e.printStackTrace()
+            return -1
+        }}
+    }}
+
+    fun contactForceEvents(tag: String, events: CPointer<LongVar>, count: Int): Int {{
+        val engine = dropbearEngine ?: return -2
+        try {{
+            val instances = scriptsByTag[tag] ?: emptyList()
+            if (instances.isEmpty()) return 0
+
+            val lanes = LongArray(count * EventRecords.CONTACT_FORCE_LANES) {{ index -> events[index] }}
+            for (record in 0 until count) {{
+                val offset = record * EventRecords.CONTACT_FORCE_LANES
+                val currentEntityId = EventRecords.currentEntity(lanes, offset)
+                val event = EventRecords.contactForceEvent(lanes, offset)
+
+                for (instance in instances) {{
+                    try {{
+                        instance.attachEngine(engine)
+                        instance.setCurrentEntity(currentEntityId)
+                        instance.collisionForceEvent(engine, event)
+                    }} catch (ex: Exception) {{
+                        Logger.error("Failed to deliver contact force event to $instance for entity $currentEntityId: ${{ex.message}}")
+                    }}
+                }}
+            }}
+
+            for (instance in instances) {{
+                instance.clearCurrentEntity()
+            }}
+
+            return 0
+        }} catch (e: Exception) {{
+            dropbear_set_last_error("Error delivering contact force events for tag '$tag': ${{e.message}}")
+            e.printStackTrace()
+            return -1
+        }}
+    }}
+
     fun destroyByTag(tag: String): Int {{
         try {{
             val engine = dropbearEngine ?: return -2
@@ -745,6 +815,18 @@ fun dropbear_contact_force_event(
     )
 }}
 
+@CName("dropbear_collision_events")
+fun dropbear_collision_events(tag: String?, events: CPointer<LongVar>?, count: Int): Int {{
+    if (tag == null || events == null) return -1
+    return ScriptManager.collisionEvents(tag, events, count)
+}}
+
+@CName("dropbear_contact_force_events")
+fun dropbear_contact_force_events(tag: String?, events: CPointer<LongVar>?, count: Int): Int {{
+    if (tag == null || events == null) return -1
+    return ScriptManager.contactForceEvents(tag, events, count)
+}}
+
 @CName("dropbear_destroy_tagged")
 fun dropbear_destroy(tag: String?): Int {{
     if (tag == null) return -1
@@ -15,7 +15,7 @@ impl CommandBufferPoller for PlayMode {
                 CommandBuffer::WindowCommand(w_cmd) => match w_cmd {
                     WindowCommand::WindowGrab(lock) => {
                         if lock {
-                            let window = &graphics.window;
+                            let window = graphics.window();
                             window.set_cursor_visible(false);
                             if let Err(e) =
                                 window.set_cursor_grab(CursorGrabMode::Locked).or_else(|_| {
@@ -29,7 +29,7 @@ impl CommandBufferPoller for PlayMode {
                             }
                         } else if let Err(e) = graphics
                             .clone()
-                            .window
+                            .window()
                             .set_cursor_grab(CursorGrabMode::None)
                         {
                             log_once::warn_once!("Failed to release cursor: {:?}", e);
@@ -39,14 +39,14 @@ impl CommandBufferPoller for PlayMode {
                     }
                     WindowCommand::HideCursor(should_hide) => {
                         if should_hide {
-                            graphics.window.set_cursor_visible(false);
+                            graphics.window().set_cursor_visible(false);
                         } else {
-                            graphics.window.set_cursor_visible(true);
+                            graphics.window().set_cursor_visible(true);
                         }
                     }
                 },
                 CommandBuffer::Quit => {
-                    self.scene_command = SceneCommand::CloseWindow(graphics.window.id());
+                    self.scene_command = SceneCommand::CloseWindow(graphics.window().id());
                 }
                 CommandBuffer::SwitchSceneImmediate(scene_name) => {
                     log::debug!("Immediate scene switch requested: {}", scene_name);
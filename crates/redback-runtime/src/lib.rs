@@ -2,29 +2,37 @@
 
 use crossbeam_channel::{Receiver, unbounded};
 use dropbear_engine::animation::MorphTargetInfo;
+use dropbear_engine::audio::AUDIO;
 use dropbear_engine::billboarding::BillboardPipeline;
 use dropbear_engine::buffer::DynamicBuffer;
 use dropbear_engine::camera::Camera;
-use dropbear_engine::future::{FutureHandle, FutureQueue};
+use dropbear_engine::future::{FutureHandle, JobPriority};
 use dropbear_engine::graphics::{InstanceRaw, SharedGraphicsContext};
+use dropbear_engine::ibl::{self, EnvironmentMaps};
 use dropbear_engine::pipelines::DropbearShaderPipeline;
 use dropbear_engine::pipelines::GlobalsUniform;
 use dropbear_engine::pipelines::animation::AnimationDefaults;
 use dropbear_engine::pipelines::light_cube::LightCubePipeline;
 use dropbear_engine::pipelines::shader::MainRenderPipeline;
 use dropbear_engine::scene::SceneCommand;
-use dropbear_engine::sky::{DEFAULT_SKY_TEXTURE, HdrLoader, SkyPipeline};
+use dropbear_engine::shadows::{ShadowRenderer, ShadowSettings};
+use dropbear_engine::sky::{DEFAULT_SKY_TEXTURE, SkyPipeline};
 use eucalyptus_core::command::COMMAND_BUFFER;
 use eucalyptus_core::component::ComponentRegistry;
 use eucalyptus_core::input::InputState;
 use eucalyptus_core::physics::PhysicsState;
+use eucalyptus_core::physics::interpolation::PoseHistory;
+use eucalyptus_core::physics::lod::SimulationLod;
+use eucalyptus_core::physics::workers::PhysicsWorkers;
 use eucalyptus_core::ptr::{
     CommandBufferPtr, GraphicsContextPtr, InputStatePtr, PhysicsStatePtr, UiBufferPtr, WorldPtr,
 };
 use eucalyptus_core::rapier3d::prelude::*;
-use eucalyptus_core::register_components;
+use eucalyptus_core::rendering::{LightChangeCursor, RendererCache};
+use eucalyptus_core::{APP_INFO, register_components};
 use eucalyptus_core::scene::loading::IsSceneLoaded;
 use eucalyptus_core::scene::loading::{SCENE_LOADER, SceneLoadResult};
+use eucalyptus_core::scripting::events::PhysicsEventBuffer;
 use eucalyptus_core::scripting::{ScriptManager, ScriptTarget};
 use eucalyptus_core::states::{SCENES, Script, WorldLoadingStatus};
 use futures::executor;
@@ -129,9 +137,12 @@ pub struct PlayMode {
 
     // rendering
     light_cube_pipeline: Option<LightCubePipeline>,
+    light_changes: LightChangeCursor,
+    shadow_renderer: Option<ShadowRenderer>,
     main_pipeline: Option<MainRenderPipeline>,
     shader_globals: Option<GlobalsUniform>,
     instance_buffer_cache: HashMap<u64, DynamicBuffer<InstanceRaw>>,
+    renderer_cache: RendererCache,
     animated_instance_buffers: HashMap<Entity, DynamicBuffer<InstanceRaw>>,
     sky_pipeline: Option<SkyPipeline>,
     animation_pipeline: Option<AnimationDefaults>,
@@ -157,10 +168,15 @@ pub struct PlayMode {
 
     // physics
     physics_pipeline: PhysicsPipeline,
+    physics_workers: PhysicsWorkers,
     physics_state: Box<PhysicsState>,
     collision_event_receiver: Option<std::sync::mpsc::Receiver<CollisionEvent>>,
     collision_force_event_receiver: Option<std::sync::mpsc::Receiver<ContactForceEvent>>,
     event_collector: ChannelEventCollector,
+    pose_history: PoseHistory,
+    physics_alpha: f32,
+    simulation_lod: SimulationLod,
+    physics_events: PhysicsEventBuffer,
 
     viewport_offset: (f32, f32),
 
@@ -199,12 +215,16 @@ impl PlayMode {
             active_camera: None,
             main_pipeline: None,
             light_cube_pipeline: None,
+            light_changes: LightChangeCursor::default(),
+            shadow_renderer: None,
             shader_globals: None,
             instance_buffer_cache: HashMap::new(),
+            renderer_cache: RendererCache::default(),
             animated_instance_buffers: HashMap::new(),
             scripts_ready: false,
             has_initial_resize_done: false,
             physics_pipeline: Default::default(),
+            physics_workers: PhysicsWorkers::new(None, None)?,
             physics_state: Box::new(PhysicsState::new()),
             pending_physics_state: Default::default(),
             physics_receiver: Default::default(),
@@ -212,6 +232,10 @@ impl PlayMode {
             collision_event_receiver: Some(ce_r),
             collision_force_event_receiver: Some(cfe_r),
             event_collector,
+            pose_history: PoseHistory::default(),
+            physics_alpha: 1.0,
+            simulation_lod: SimulationLod::default(),
+            physics_events: PhysicsEventBuffer::new(),
             display_settings: DisplaySettings {
                 window_mode: WindowMode::Windowed,
                 maintain_aspect_ratio: false,
@@ -241,6 +265,7 @@ impl PlayMode {
         sky_texture: Option<&Vec<u8>>,
     ) {
         self.light_cube_pipeline = None;
+        self.shadow_renderer = None;
         self.main_pipeline = None;
         self.shader_globals = None;
         self.kino = None;
@@ -256,51 +281,71 @@ impl PlayMode {
         graphics: Arc<SharedGraphicsContext>,
         sky_texture: Option<&Vec<u8>>,
     ) {
-        self.light_cube_pipeline = Some(LightCubePipeline::new(graphics.clone()));
-        self.main_pipeline = Some(MainRenderPipeline::new(graphics.clone()));
-        self.shader_globals = Some(GlobalsUniform::new(
-            graphics.clone(),
-            Some("runtime shader globals"),
-        ));
+        puffin::profile_function!();
+        // none of the pipelines depend on each other, so they are compiled at the same time and
+        // the main thread only sets up what needs the window in the meantime
+        let environment_result = std::thread::scope(|scope| {
+            let light_cube = scope.spawn(|| LightCubePipeline::new(graphics.clone()));
+            let shadows = scope.spawn(|| ShadowRenderer::new(&graphics, ShadowSettings::default()));
+            let main = scope.spawn(|| MainRenderPipeline::new(graphics.clone()));
+            let billboard = scope.spawn(|| BillboardPipeline::new(graphics.clone()));
+            let debug_draw =
+                scope.spawn(|| dropbear_engine::debug::DebugDraw::new(graphics.clone()));
+            let environment = scope.spawn(|| {
+                EnvironmentMaps::load_or_bake(
+                    &graphics.device,
+                    &graphics.queue,
+                    sky_texture.map_or(DEFAULT_SKY_TEXTURE, |v| v.as_slice()),
+                    1080,
+                    ibl::cache_dir(&APP_INFO).as_deref(),
+                    Some("sky texture"),
+                )
+            });
 
-        let mut pending_sky_pipeline = None;
+            self.shader_globals = Some(GlobalsUniform::new(
+                graphics.clone(),
+                Some("runtime shader globals"),
+            ));
 
-        if self.animation_pipeline.is_none() {
-            self.animation_pipeline = Some(AnimationDefaults::new(graphics.clone()));
+            if self.animation_pipeline.is_none() {
+                self.animation_pipeline = Some(AnimationDefaults::new(graphics.clone()));
+            }
+
+            self.kino = Some(kino_ui::KinoState::new(
+                KinoWGPURenderer::new(
+                    &graphics.device,
+                    &graphics.queue,
+                    graphics.hdr.read().format(),
+                    [
+                        graphics.viewport_texture.size.width as f32,
+                        graphics.viewport_texture.size.height as f32,
+                    ],
+                ),
+                KinoWinitWindowing::new(graphics.window().clone(), None),
+            ));
+
+            const PANICKED: &str = "Pipeline creation panicked";
+            self.light_cube_pipeline = Some(light_cube.join().expect(PANICKED));
+            self.shadow_renderer = Some(shadows.join().expect(PANICKED));
+            self.main_pipeline = Some(main.join().expect(PANICKED));
+            self.billboard_pipeline = Some(billboard.join().expect(PANICKED));
+            *graphics.debug_draw.lock() = Some(debug_draw.join().expect(PANICKED));
+            environment.join().expect(PANICKED)
+        });
+
+        if let Err(e) = graphics.pipeline_cache.save() {
+            log::warn!("Unable to save pipeline cache: {}", e);
         }
 
-        self.kino = Some(kino_ui::KinoState::new(
-            KinoWGPURenderer::new(
-                &graphics.device,
-                &graphics.queue,
-                graphics.hdr.read().format(),
-                [
-                    graphics.viewport_texture.size.width as f32,
-                    graphics.viewport_texture.size.height as f32,
-                ],
-            ),
-            KinoWinitWindowing::new(graphics.window.clone(), None),
-        ));
-
-        self.billboard_pipeline = Some(BillboardPipeline::new(graphics.clone()));
-        *graphics.debug_draw.lock() =
-            Some(dropbear_engine::debug::DebugDraw::new(graphics.clone()));
-
-        let sky_texture_result = HdrLoader::from_equirectangular_bytes(
-            &graphics.device,
-            &graphics.queue,
-            sky_texture.map_or(DEFAULT_SKY_TEXTURE, |v| v.as_slice()),
-            1080,
-            Some("sky texture"),
-        );
+        let mut pending_sky_pipeline = None;
 
         if let Some(camera_entity) = self.active_camera {
             if let Ok(camera) = self.world.query_one::<&Camera>(camera_entity).get() {
-                match sky_texture_result {
-                    Ok(sky_texture) => {
+                match environment_result {
+                    Ok(environment) => {
                         pending_sky_pipeline = Some(SkyPipeline::new(
                             graphics.clone(),
-                            sky_texture,
+                            environment,
                             camera.buffer(),
                         ));
                     }
@@ -309,16 +354,18 @@ impl PlayMode {
                     }
                 }
 
-                if let (Some(main_pipeline), Some(globals), Some(light_pipeline)) = (
+                if let (Some(main_pipeline), Some(globals), Some(light_pipeline), Some(shadows)) = (
                     self.main_pipeline.as_mut(),
                     self.shader_globals.as_ref(),
                     self.light_cube_pipeline.as_ref(),
+                    self.shadow_renderer.as_ref(),
                 ) {
                     let _ = main_pipeline.per_frame_bind_group(
                         graphics.clone(),
                         globals.buffer.buffer(),
                         camera.buffer(),
                         light_pipeline.light_buffer(),
+                        shadows,
                     );
                 }
             } else {
@@ -493,7 +540,7 @@ impl PlayMode {
         let graphics_cloned = graphics.clone();
         let component_registry = self.component_registry.clone();
 
-        let handle = FutureQueue::push(&graphics.future_queue, async move {
+        let handle = graphics.future_queue.push_compute_future(JobPriority::High, async move {
             let mut temp_world = World::new();
             let load_status = scene_to_load
                 .load_into_world(
@@ -552,11 +599,18 @@ impl PlayMode {
         log::debug!("Immediate scene load requested: {}", scene_name);
 
         self.world = Box::new(World::new());
+        self.renderer_cache.clear();
+        self.light_changes.reset();
         self.physics_state = Box::new(PhysicsState::new());
+        self.pose_history.clear();
+        self.simulation_lod.clear();
+        self.physics_events.clear();
+        AUDIO.lock().stop_all();
         self.physics_receiver = None;
         self.active_camera = None;
         self.main_pipeline = None;
         self.light_cube_pipeline = None;
+        self.shadow_renderer = None;
         self.current_scene = None;
         self.world_loading_progress = None;
         self.world_receiver = None;
@@ -599,7 +653,13 @@ impl PlayMode {
         });
 
         self.world = Box::new(loaded_world);
+        self.renderer_cache.clear();
+        self.light_changes.reset();
         self.physics_state = Box::new(physics_state);
+        self.pose_history.clear();
+        self.simulation_lod.clear();
+        self.physics_events.clear();
+        AUDIO.lock().stop_all();
         self.active_camera = Some(camera_entity);
         self.current_scene = Some(scene_name.clone());
 
@@ -630,10 +690,16 @@ impl PlayMode {
         if scene_progress.is_everything_loaded() {
             if let Some(new_world) = self.pending_world.take() {
                 self.world = new_world;
+                self.renderer_cache.clear();
+                self.light_changes.reset();
             }
             if let Some(physics_state) = self.pending_physics_state.take() {
                 self.physics_state = physics_state;
             }
+            self.pose_history.clear();
+            self.simulation_lod.clear();
+            self.physics_events.clear();
+            AUDIO.lock().stop_all();
             self.has_initial_resize_done = false;
             if let Some(new_camera) = self.pending_camera.take() {
                 self.active_camera = Some(new_camera);
@@ -658,7 +724,7 @@ pub struct DisplaySettings {
 
 impl DisplaySettings {
     pub fn update(&mut self, graphics: Arc<SharedGraphicsContext>) {
-        let window = graphics.window.clone();
+        let window = graphics.window().clone();
         let size = (
             graphics.viewport_texture.size.width,
             graphics.viewport_texture.size.height,
@@ -1,25 +1,26 @@
 use std::sync::Arc;
 
 use crate::PlayMode;
+use dropbear_engine::audio::{AUDIO, Listener};
 use dropbear_engine::camera::Camera;
 use dropbear_engine::entity::EntityTransform;
-use dropbear_engine::graphics::CommandEncoder;
 use dropbear_engine::graphics::SharedGraphicsContext;
 use dropbear_engine::scene::{Scene, SceneCommand};
+use dropbear_engine::streaming::TEXTURE_STREAMER;
 use eucalyptus_core::billboard::BillboardComponent;
+use eucalyptus_core::change::CHANGES;
 use eucalyptus_core::command::CommandBufferPoller;
 use eucalyptus_core::egui::CentralPanel;
-use eucalyptus_core::entity_status::EntityStatus;
 use eucalyptus_core::hierarchy::{EntityTransformExt, Parent};
-use eucalyptus_core::physics::kcc::KCC;
-use eucalyptus_core::rapier3d::geometry::SharedShape;
-use eucalyptus_core::rapier3d::prelude::QueryFilter;
-use eucalyptus_core::rendering::RendererCommon;
+use eucalyptus_core::physics::interpolation::PhysicsPose;
+use eucalyptus_core::physics::kcc::{self, KCC};
+use eucalyptus_core::rapier3d::prelude::Vector;
+use eucalyptus_core::rendering::{RendererCommon, SceneFrame};
 use eucalyptus_core::scene::loading::{IsSceneLoaded, SCENE_LOADER, SceneLoadResult};
 use eucalyptus_core::states::SCENES;
 use eucalyptus_core::states::{Label, PROJECT};
 use eucalyptus_core::ui::HUDComponent;
-use glam::{DVec3, Mat4, Quat, Vec2};
+use glam::{DVec3, Quat, Vec2};
 use hecs::Entity;
 use kino_ui::WidgetTree;
 use kino_ui::rendering::KinoRenderTargetId;
@@ -56,10 +57,6 @@ impl Scene for PlayMode {
                 .physics_update_script(self.world.as_mut(), dt as f64);
         }
 
-        for kcc in self.world.query::<&mut KCC>().iter() {
-            kcc.collisions.clear();
-        }
-
         for (e, l, _) in self.world.query::<(Entity, &Label, &KCC)>().iter() {
             log_once::debug_once!(
                 "This entity [{:?}, label = {}] has the KCC (KinematicCharacterController) component attached",
@@ -68,117 +65,39 @@ impl Scene for PlayMode {
             );
         }
 
-        if !self.physics_state.collision_events_to_deal_with.is_empty() {
-            let entities_with_collisions: Vec<Entity> = self
-                .physics_state
-                .collision_events_to_deal_with
-                .keys()
-                .copied()
-                .collect();
-
-            for entity in entities_with_collisions {
-                let Some(collisions) = self
-                    .physics_state
-                    .collision_events_to_deal_with
-                    .remove(&entity)
-                else {
-                    continue;
-                };
-                if collisions.is_empty() {
-                    continue;
-                }
-
-                if let Ok(mut kcc) = self.world.get::<&mut KCC>(entity) {
-                    kcc.collisions = collisions.clone();
-                }
+        kcc::solve_character_moves(
+            &self.world,
+            &mut self.physics_state,
+            &self.physics_workers,
+            dt,
+        );
 
-                let (label, kcc_controller) =
-                    match self.world.query_one::<(&Label, &KCC)>(entity).get() {
-                        Ok(v) => (v.0.clone(), v.1.clone()),
-                        Err(e) => {
-                            log_once::warn_once!("Unable to query {:?}: {}", entity, e);
-                            continue;
-                        }
-                    };
-
-                let Some(rigid_body_handle) =
-                    self.physics_state.bodies_entity_map.get(&label).copied()
-                else {
-                    continue;
-                };
-
-                let Some((_, collider_handle)) = self
-                    .physics_state
-                    .colliders_entity_map
-                    .get(&label)
-                    .and_then(|handles| handles.first())
-                    .copied()
-                else {
-                    continue;
-                };
-
-                let (character_shape, character_mass): (SharedShape, f32) = {
-                    let Some(collider) = self.physics_state.colliders.get(collider_handle) else {
-                        continue;
-                    };
-
-                    (collider.shared_shape().clone(), collider.mass())
-                };
-
-                let character_mass = if character_mass > 0.0 {
-                    character_mass
-                } else {
-                    1.0
-                };
-
-                let filter = QueryFilter::default()
-                    .exclude_rigid_body(rigid_body_handle)
-                    .exclude_sensors();
-                let dispatcher = self.physics_state.narrow_phase.query_dispatcher();
-
-                let broad_phase = &mut self.physics_state.broad_phase;
-                let bodies = &mut self.physics_state.bodies;
-                let colliders = &mut self.physics_state.colliders;
-
-                let mut query_pipeline_mut =
-                    broad_phase.as_query_pipeline_mut(dispatcher, bodies, colliders, filter);
-
-                kcc_controller
-                    .controller
-                    .solve_character_collision_impulses(
-                        dt,
-                        &mut query_pipeline_mut,
-                        character_shape.as_ref(),
-                        character_mass,
-                        &collisions,
-                    );
-            }
-        }
+        self.physics_state.update_entity_labels(&self.world);
 
-        let mut entity_label_map = HashMap::new();
         {
-            let all: Vec<(Entity, Label)> = self
-                .world
-                .query::<(Entity, &Label)>()
-                .iter()
-                .map(|(e, l)| (e, l.clone()))
-                .collect();
-            for (entity, label) in all {
-                // disabled physics cannot partake
-                let disabled = self
-                    .world
-                    .get::<&EntityStatus>(entity)
-                    .map(|s| s.disabled)
-                    .unwrap_or(false);
-                if !disabled {
-                    entity_label_map.insert(entity, label);
-                }
-            }
+            let sleep_distance = PROJECT
+                .read()
+                .runtime_settings
+                .physics_sleep_distance
+                .get()
+                .copied();
+            let camera: Option<Vector> = self
+                .active_camera
+                .and_then(|camera| self.world.get::<&Camera>(camera).ok())
+                .map(|camera| {
+                    Vector::new(camera.eye.x as f32, camera.eye.y as f32, camera.eye.z as f32)
+                });
+            self.simulation_lod.update(
+                &mut self.physics_state,
+                &self.world,
+                camera.as_slice(),
+                sleep_distance,
+            );
         }
 
         self.physics_state.step(
-            entity_label_map,
             &mut self.physics_pipeline,
+            &self.physics_workers,
             &(),
             &self.event_collector,
         );
@@ -188,19 +107,21 @@ impl Scene for PlayMode {
                 &self.collision_event_receiver,
                 &self.collision_force_event_receiver,
             ) {
-                // both are not crucial, so no need to panic
+                let interval = PROJECT
+                    .read()
+                    .runtime_settings
+                    .contact_force_event_interval
+                    .get()
+                    .copied();
+                self.physics_events.set_contact_force_interval(interval);
+
                 while let Ok(event) = ce_r.try_recv() {
                     log_once::debug_once!("Collision event received");
                     if let Some(evt) = eucalyptus_core::types::CollisionEvent::from_rapier3d(
                         &self.physics_state,
                         event,
                     ) {
-                        if let Err(err) = self
-                            .script_manager
-                            .collision_event_script(self.world.as_mut(), &evt)
-                        {
-                            log::error!("Script collision event error: {}", err);
-                        }
+                        self.physics_events.push_collision(evt);
                     }
                 }
 
@@ -210,38 +131,51 @@ impl Scene for PlayMode {
                         &self.physics_state,
                         event,
                     ) {
-                        if let Err(err) = self
-                            .script_manager
-                            .contact_force_event_script(self.world.as_mut(), &evt)
-                        {
-                            log::error!("Script contact force event error: {}", err);
-                        }
+                        self.physics_events.push_contact_force(evt);
                     }
                 }
+
+                // not crucial, so no need to panic
+                if let Err(err) = self
+                    .script_manager
+                    .dispatch_physics_events(self.world.as_mut(), &mut self.physics_events)
+                {
+                    log::error!("Script physics event error: {}", err);
+                }
             }
         }
 
+        // fixed and sleeping bodies (including the ones put to sleep by the simulation LOD) are
+        // where the last sync left them, and bodies that did not move since are skipped as well,
+        // so only the transforms of bodies that moved are written and marked as changed
+        let mut poses = Vec::new();
         let mut sync_updates = Vec::new();
+        for (label, handle) in &self.physics_state.bodies_entity_map {
+            let Some(body) = self.physics_state.bodies.get(*handle) else {
+                continue;
+            };
+            if body.is_fixed() || body.is_sleeping() {
+                continue;
+            }
+            let Some(entity) = self.physics_state.body_entity(label, body) else {
+                continue;
+            };
 
-        for (entity, label, _) in self
-            .world
-            .query::<(Entity, &Label, &EntityTransform)>()
-            .iter()
-        {
-            if let Some(handle) = self.physics_state.bodies_entity_map.get(label) {
-                if let Some(body) = self.physics_state.bodies.get(*handle) {
-                    let p = body.translation();
-                    let r = body.rotation();
-
-                    sync_updates.push((
-                        entity,
-                        DVec3::new(p.x as f64, p.y as f64, p.z as f64),
-                        Quat::from(r.clone()).as_dquat(),
-                    ));
-                }
+            let p = body.translation();
+            let r = body.rotation();
+            let pose = PhysicsPose::new(
+                DVec3::new(p.x as f64, p.y as f64, p.z as f64),
+                Quat::from(r.clone()).as_dquat(),
+            );
+            if self.pose_history.current(entity) != Some(&pose) {
+                sync_updates.push((entity, pose.position, pose.rotation));
             }
+            poses.push((entity, pose));
         }
 
+        self.pose_history.record(poses);
+
+        let mut changes = CHANGES.lock();
         for (entity, new_world_pos, new_world_rot) in sync_updates {
             let parent_world = if let Ok(parent_comp) = self.world.get::<&Parent>(entity) {
                 let parent_entity = parent_comp.parent();
@@ -270,10 +204,15 @@ impl Scene for PlayMode {
                     base.position = new_world_pos;
                     base.rotation = new_world_rot;
                 }
+                changes.mark::<EntityTransform>(entity);
             }
         }
     }
 
+    fn set_physics_alpha(&mut self, alpha: f32) {
+        self.physics_alpha = alpha;
+    }
+
     fn update(&mut self, dt: f32, graphics: Arc<SharedGraphicsContext>, ui: &mut Ui,) {
         graphics.future_queue.poll();
         self.poll(graphics.clone());
@@ -281,7 +220,7 @@ impl Scene for PlayMode {
         self.display_settings.update(graphics.clone());
 
         if matches!(self.scene_command, SceneCommand::None) {
-            let window_size = graphics.window.inner_size();
+            let window_size = graphics.window().inner_size();
             if window_size.width > 0 && window_size.height > 0 {
                 let current = graphics.viewport_texture.size;
                 if current.width != window_size.width || current.height != window_size.height {
@@ -292,7 +231,7 @@ impl Scene for PlayMode {
         }
 
         {
-            let window_size = graphics.window.inner_size();
+            let window_size = graphics.window().inner_size();
             let size_changed = window_size.width != self.display_settings.last_size.0
                 || window_size.height != self.display_settings.last_size.1;
             if size_changed && window_size.height > 0 {
@@ -313,6 +252,16 @@ impl Scene for PlayMode {
             }
         }
 
+        if let Some(budget) = PROJECT.read().runtime_settings.texture_budget_mb.get() {
+            TEXTURE_STREAMER.lock().set_budget(*budget as u64 * 1024 * 1024);
+        }
+
+        let physics_threads = PROJECT.read().runtime_settings.physics_threads.get().copied();
+        let jobs = graphics.future_queue.job_system().map(|jobs| jobs.as_ref());
+        if let Err(e) = self.physics_workers.configure(physics_threads, jobs) {
+            log_once::warn_once!("Unable to resize the physics thread pool: {}", e);
+        }
+
         if let Some(ref progress) = self.scene_progress {
             if !progress.scene_handle_requested
                 && self.world_receiver.is_none()
@@ -401,6 +350,16 @@ impl Scene for PlayMode {
             dt,
             graphics.clone(),
         );
+        self.pose_history.apply(&self.world, self.physics_alpha);
+
+        {
+            let listener = self
+                .active_camera
+                .and_then(|camera| self.world.get::<&Camera>(camera).ok())
+                .map(|camera| Listener::from_camera(&camera))
+                .unwrap_or_default();
+            AUDIO.lock().update(&self.world, listener);
+        }
 
         #[cfg(feature = "debug")]
         egui::Panel::top("menu_bar").show_inside(ui, |ui| {
@@ -458,7 +417,7 @@ impl Scene for PlayMode {
                             if ui.button("⏹").clicked() {
                                 log::debug!("Menu button Stop button pressed");
                                 self.scene_command =
-                                    SceneCommand::CloseWindow(graphics.window.id());
+                                    SceneCommand::CloseWindow(graphics.window().id());
                             }
                         });
 
@@ -599,22 +558,24 @@ impl Scene for PlayMode {
 
     fn render<'a>(&mut self, graphics: Arc<SharedGraphicsContext>, _ui: &mut Ui,) {
         let hdr = graphics.hdr.read();
-        let mut encoder = CommandEncoder::new(graphics.clone(), Some("runtime viewport encoder"));
 
         let Some(active_camera) = self.active_camera.as_ref().cloned() else { return };
         log_once::debug_once!("Active camera found: {:?}", active_camera);
-        let Some(camera) = self.world.query_one::<&Camera>(active_camera).get().ok().cloned() else { return };
+        let Some(mut camera) = self.world.query_one::<&Camera>(active_camera).get().ok().cloned() else { return };
         log_once::debug_once!("Camera ready: {}", camera.label);
+        camera.follow_render_origin(graphics.clone());
 
-        RendererCommon::clear_viewport(&graphics, &mut encoder, &hdr);
-
+        if let Some(shadows) = &mut self.shadow_renderer {
+            shadows.assign(&self.world, &camera);
+        }
         if let Some(light_pipeline) = &mut self.light_cube_pipeline {
-            light_pipeline.update(graphics.clone(), &self.world);
+            let changes = self.light_changes.changed(&self.world, self.shadow_renderer.as_ref());
+            light_pipeline.update(graphics.clone(), &self.world, &camera, changes);
         }
-        let (lights, enabled_light_count) = RendererCommon::collect_lights(&self.world);
+        let light_count = self.light_cube_pipeline.as_ref().map_or(0, |p| p.light_count());
 
         if let Some(globals) = &mut self.shader_globals {
-            globals.set_num_lights(enabled_light_count);
+            globals.set_num_lights(light_count);
             if let Some(scene_name) = &self.current_scene {
                 let scenes = SCENES.read();
                 if let Some(scene) = scenes.iter().find(|s| &s.scene_name == scene_name) {
@@ -624,18 +585,18 @@ impl Scene for PlayMode {
             globals.write(&graphics.queue);
         }
 
-        let mut batches = HashMap::new();
         let default_skinning = self.animation_pipeline.as_ref().map(|p| p.skinning_buffer.buffer().clone());
-        RendererCommon::locate_renderers(&self.world, &mut batches, graphics.clone(), &default_skinning);
+        RendererCommon::locate_renderers(&self.world, &mut self.renderer_cache, graphics.clone(), &camera, &default_skinning);
 
-        let (_, model_cache) = RendererCommon::prepare_models(&graphics, &batches, &mut self.instance_buffer_cache);
+        let (_, model_cache) = RendererCommon::prepare_models(&graphics, &self.renderer_cache.batches, &mut self.instance_buffer_cache);
 
         if self.last_active_camera_for_per_frame != Some(active_camera) {
             self.last_active_camera_for_per_frame = Some(active_camera);
-            if let (Some(pipeline), Some(globals), Some(light_pipeline)) = (
+            if let (Some(pipeline), Some(globals), Some(light_pipeline), Some(shadows)) = (
                 self.main_pipeline.as_mut(),
                 self.shader_globals.as_ref(),
                 self.light_cube_pipeline.as_ref(),
+                self.shadow_renderer.as_ref(),
             ) {
                 pipeline.per_frame = None;
                 pipeline.per_frame_bind_group(
@@ -643,12 +604,12 @@ impl Scene for PlayMode {
                     globals.buffer.buffer(),
                     camera.buffer(),
                     light_pipeline.light_buffer(),
+                    shadows,
                 );
             }
         }
 
         let sky = self.sky_pipeline.as_ref().expect("Sky pipeline must be initialised before rendering models");
-        let environment_bind_group = &sky.environment_bind_group;
 
         let Some(pipeline) = self.main_pipeline.as_ref() else {
             log_once::warn_once!("Render pipeline not ready");
@@ -662,49 +623,31 @@ impl Scene for PlayMode {
             .expect("Per-frame bind group not initialised")
             .clone();
 
-        RendererCommon::render_light_cubes(&graphics, &mut encoder, &hdr, &lights, &camera, self.light_cube_pipeline.as_ref());
-
-        RendererCommon::render_models(
-            &graphics, &mut encoder, &hdr,
-            &self.world, &batches, &model_cache,
-            &per_frame_bind_group, environment_bind_group,
-            pipeline, animation_defaults,
-            &self.instance_buffer_cache,
-            &mut self.animated_instance_buffers,
-            &mut self.animated_bind_group_cache,
-            &mut self.static_bind_group_cache,
-            &mut self.last_morph_info_per_mesh,
-        );
-
-        RendererCommon::render_sky(&graphics, &mut encoder, &hdr, sky);
-
-        RendererCommon::render_collider_debug(
-            &graphics,
-            &self.world,
-            self.current_scene.as_deref(),
-        );
-
-        RendererCommon::render_billboards(
-            &graphics, &mut encoder, &hdr, &camera,
-            &self.world,
-            self.kino.as_mut(),
-            self.billboard_pipeline.as_ref(),
-        );
-
-        if let Some(debug_draw) = graphics.debug_draw.lock().as_mut() {
-            let view_proj = Mat4::from_cols_array_2d(&camera.uniform.view_proj);
-            debug_draw.flush(graphics.clone(), &mut encoder, view_proj);
-        }
-
-        hdr.process(&mut encoder, &graphics.viewport_texture.view);
-        if let Err(e) = encoder.submit() { log_once::error_once!("{}", e); }
-
-        if let Some(kino) = &mut self.kino {
-            let mut encoder = CommandEncoder::new(graphics.clone(), Some("kino encoder"));
-            kino.render(&graphics.device, &graphics.queue, &mut encoder, hdr.view());
-            if let Err(e) = encoder.submit() {
-                log_once::error_once!("Unable to submit kino: {}", e);
-            }
+        let mut frame = SceneFrame {
+            graphics: &graphics,
+            hdr: &hdr,
+            world: &self.world,
+            camera: &camera,
+            current_scene_name: self.current_scene.as_deref(),
+            batches: &self.renderer_cache.batches,
+            model_cache: &model_cache,
+            per_frame_bind_group: &per_frame_bind_group,
+            pipeline,
+            animation_defaults,
+            sky,
+            light_cube_pipeline: self.light_cube_pipeline.as_ref(),
+            billboard_pipeline: self.billboard_pipeline.as_ref(),
+            shadows: self.shadow_renderer.as_mut(),
+            kino: self.kino.as_mut(),
+            instance_buffer_cache: &self.instance_buffer_cache,
+            animated_instance_buffers: &mut self.animated_instance_buffers,
+            animated_bind_group_cache: &mut self.animated_bind_group_cache,
+            static_bind_group_cache: &mut self.static_bind_group_cache,
+            last_morph_info_per_mesh: &mut self.last_morph_info_per_mesh,
+            billboard_views: HashMap::new(),
+        };
+        if let Err(e) = RendererCommon::scene_graph().execute(&graphics, &mut frame) {
+            log_once::error_once!("Unable to render the scene: {}", e);
         }
     }
 
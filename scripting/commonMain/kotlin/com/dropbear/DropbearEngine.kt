@@ -3,6 +3,7 @@ package com.dropbear
 import com.dropbear.asset.AssetEntry
 import com.dropbear.asset.AssetType
 import com.dropbear.asset.Handle
+import com.dropbear.audio.AudioManager
 import com.dropbear.ffi.NativeEngine
 import com.dropbear.input.InputState
 import com.dropbear.scene.SceneManager
@@ -23,6 +24,7 @@ var lastErrorMessage: String? = null
 class DropbearEngine(val native: NativeEngine) {
     val inputState: InputState = InputState()
     val sceneManager: SceneManager = SceneManager()
+    val audio: AudioManager = AudioManager()
 
     init {
         Companion.native = native
@@ -0,0 +1,69 @@
+package com.dropbear.audio
+
+import com.dropbear.EntityRef
+
+/**
+ * Plays sounds.
+ *
+ * Clips are referenced by their eucalyptus URI, such as `euca://sounds/explosion.ogg`, and are
+ * streamed as they play, so a long music track is as cheap to start as a footstep. WAV, OGG
+ * Vorbis, FLAC and MP3 clips are supported.
+ */
+class AudioManager {
+    /**
+     * Plays a clip that sounds the same wherever the listener is, such as music or UI sounds.
+     *
+     * Returns `null` if the clip could not be found.
+     */
+    fun play(
+        clip: String,
+        volume: Double = 1.0,
+        pitch: Double = 1.0,
+        looping: Boolean = false,
+    ): Sound? {
+        return playNative(clip, volume, pitch, looping)
+    }
+
+    /**
+     * Plays a clip that follows [entity] around, panned and attenuated by its distance to the
+     * active camera.
+     *
+     * Closer than [minDistance] the clip plays at full volume, and further than [maxDistance] it
+     * is silent.
+     */
+    fun playAt(
+        entity: EntityRef,
+        clip: String,
+        volume: Double = 1.0,
+        pitch: Double = 1.0,
+        looping: Boolean = false,
+        minDistance: Double = 1.0,
+        maxDistance: Double = 50.0,
+    ): Sound? {
+        return playAtNative(entity, clip, volume, pitch, looping, minDistance, maxDistance)
+    }
+
+    /**
+     * Sets the volume every sound is scaled by.
+     */
+    fun setMasterVolume(volume: Double) {
+        setMasterVolumeNative(volume)
+    }
+}
+
+internal expect fun AudioManager.playNative(
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+): Sound?
+internal expect fun AudioManager.playAtNative(
+    entity: EntityRef,
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+    minDistance: Double,
+    maxDistance: Double,
+): Sound?
+internal expect fun AudioManager.setMasterVolumeNative(volume: Double)
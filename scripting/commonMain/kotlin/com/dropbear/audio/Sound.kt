@@ -0,0 +1,37 @@
+package com.dropbear.audio
+
+/**
+ * A sound started by the [AudioManager].
+ *
+ * Once a sound ends or is stopped, calls on it do nothing.
+ */
+class Sound(val id: Long) {
+    /**
+     * Whether the sound is still playing, as of the start of this frame.
+     */
+    val isPlaying: Boolean
+        get() = isPlayingNative()
+
+    /**
+     * Stops the sound, fading it out over a few milliseconds.
+     */
+    fun stop() {
+        stopNative()
+    }
+
+    fun setVolume(volume: Double) {
+        setVolumeNative(volume)
+    }
+
+    /**
+     * Sets the playback speed, where `2.0` plays an octave higher.
+     */
+    fun setPitch(pitch: Double) {
+        setPitchNative(pitch)
+    }
+}
+
+internal expect fun Sound.isPlayingNative(): Boolean
+internal expect fun Sound.stopNative()
+internal expect fun Sound.setVolumeNative(volume: Double)
+internal expect fun Sound.setPitchNative(pitch: Double)
@@ -0,0 +1,21 @@
+package com.dropbear.physics
+
+import com.dropbear.EntityId
+import com.dropbear.math.Vector3d
+
+/**
+ * A move for [KinematicCharacterController.moveAll].
+ *
+ * @param entity The entity of the character, which must have a [KinematicCharacterController].
+ * @param translation How far to move the character this tick.
+ * @param dt The delta time of the tick.
+ */
+class CharacterMove(
+    val entity: EntityId,
+    val translation: Vector3d,
+    val dt: Double,
+) {
+    override fun toString(): String {
+        return "CharacterMove(entity=$entity, translation=$translation, dt=$dt)"
+    }
+}
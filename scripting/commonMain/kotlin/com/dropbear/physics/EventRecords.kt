@@ -0,0 +1,67 @@
+package com.dropbear.physics
+
+import com.dropbear.EntityId
+import com.dropbear.math.Vector3d
+
+/**
+ * Reads the physics events the engine hands over once per tick, as a flat array of longs.
+ *
+ * Each record starts with the id of the entity the event is delivered to, followed by the event.
+ * Doubles are stored as their bits.
+ */
+object EventRecords {
+    /**
+     * The amount of longs in one [CollisionEvent] record.
+     */
+    const val COLLISION_LANES = 11
+
+    /**
+     * The amount of longs in one [ContactForceEvent] record.
+     */
+    const val CONTACT_FORCE_LANES = 17
+
+    private const val COLLIDER_LANES = 4
+
+    /**
+     * The entity the record at [offset] is delivered to.
+     */
+    fun currentEntity(lanes: LongArray, offset: Int): Long = lanes[offset]
+
+    /**
+     * Reads the [CollisionEvent] record that starts at [offset].
+     */
+    fun collisionEvent(lanes: LongArray, offset: Int): CollisionEvent {
+        val type = CollisionEventType.entries.getOrNull(lanes[offset + 1].toInt())
+            ?: CollisionEventType.Started
+        val collider1 = collider(lanes, offset + 2)
+        val collider2 = collider(lanes, offset + 2 + COLLIDER_LANES)
+        val flags = lanes[offset + 2 + COLLIDER_LANES * 2]
+        return CollisionEvent(type, collider1, collider2, flags.toInt())
+    }
+
+    /**
+     * Reads the [ContactForceEvent] record that starts at [offset].
+     */
+    fun contactForceEvent(lanes: LongArray, offset: Int): ContactForceEvent {
+        val collider1 = collider(lanes, offset + 1)
+        val collider2 = collider(lanes, offset + 1 + COLLIDER_LANES)
+        val forces = offset + 1 + COLLIDER_LANES * 2
+        fun double(lane: Int) = Double.fromBits(lanes[forces + lane])
+        return ContactForceEvent(
+            collider1,
+            collider2,
+            Vector3d(double(0), double(1), double(2)),
+            double(3),
+            Vector3d(double(4), double(5), double(6)),
+            double(7),
+        )
+    }
+
+    private fun collider(lanes: LongArray, offset: Int): Collider {
+        return Collider(
+            Index(lanes[offset].toUInt(), lanes[offset + 1].toUInt()),
+            EntityId(lanes[offset + 2]),
+            lanes[offset + 3].toUInt(),
+        )
+    }
+}
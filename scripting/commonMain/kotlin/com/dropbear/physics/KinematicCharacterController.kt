@@ -24,6 +24,10 @@ class KinematicCharacterController(
      *
      * Since the KinematicCharacterController uses [RigidBodyMode.KinematicPosition], it uses position manipulation
      * instead of impulse/force based movement.
+     *
+     * The move is queued and solved together with every other character moved this tick, right after
+     * [com.dropbear.ecs.System.physicsUpdate] returns, so [movementResult] is updated by the next tick.
+     * When moving many characters at once, [moveAll] does the same in a single call.
      */
     fun move(dt: Double, translation: Vector3d) {
         moveCharacter(dt, translation)
@@ -63,12 +67,25 @@ class KinematicCharacterController(
         override fun get(entityId: EntityId): KinematicCharacterController? {
             return if (kccExistsForEntity(entityId)) KinematicCharacterController(entityId) else null
         }
+
+        /**
+         * Moves every character in [moves] for this tick, like calling [move] on each of them but
+         * with a single call into the engine.
+         *
+         * The batch is applied as a whole: if any entity in [moves] has no controller, none of the
+         * moves are queued.
+         */
+        fun moveAll(moves: List<CharacterMove>) {
+            if (moves.isEmpty()) return
+            moveCharacters(moves)
+        }
     }
 }
 
 internal expect fun kccExistsForEntity(entityId: EntityId): Boolean
 
 internal expect fun KinematicCharacterController.moveCharacter(dt: Double, translation: Vector3d)
+internal expect fun moveCharacters(moves: List<CharacterMove>)
 internal expect fun KinematicCharacterController.setRotationNative(rotation: Quaterniond)
 internal expect fun KinematicCharacterController.getHitsNative(): List<CharacterCollision>
 internal expect fun KinematicCharacterController.getMovementResult(): CharacterMovementResult?
\ No newline at end of file
@@ -81,6 +81,60 @@ class Physics {
                 shapeCast(origin, direction, shape, toi = Double.MAX_VALUE, solid)
             }
         }
+
+        /**
+         * Casts every ray in [rays] at once. This is much faster than calling [raycast] for each
+         * ray, as the rays are cast in parallel.
+         *
+         * @param rays The rays to cast.
+         * @param filter Limits which colliders can be hit.
+         * @param solid If true, detects hits even if a ray starts inside a shape.
+         * @param allHits If true, returns every collider each ray passes through (closest first)
+         *                instead of only the closest one.
+         * @return The hits of every ray, where [QueryHit.query] is the index of the ray in [rays].
+         */
+        fun raycastBatch(
+            rays: List<Ray>,
+            filter: QueryFilter = QueryFilter(),
+            solid: Boolean = true,
+            allHits: Boolean = false,
+        ): List<QueryHit> {
+            if (rays.isEmpty()) return emptyList()
+            return castRays(rays, filter, solid, allHits)
+        }
+
+        /**
+         * Sweeps [shape] along every ray in [casts] at once, returning the first hit of each.
+         *
+         * @param shape The shape to cast.
+         * @param casts Where each cast starts, its direction and how far it goes.
+         * @param filter Limits which colliders can be hit.
+         * @param solid If true, detects hits even if a cast starts inside a shape.
+         * @return The hits of every cast, where [ShapeQueryHit.query] is the index of the cast in [casts].
+         */
+        fun shapeCastBatch(
+            shape: ColliderShape,
+            casts: List<Ray>,
+            filter: QueryFilter = QueryFilter(),
+            solid: Boolean = true,
+        ): List<ShapeQueryHit> {
+            if (casts.isEmpty()) return emptyList()
+            return castShapes(shape, casts, filter, solid)
+        }
+
+        /**
+         * Places [shape] at every position in [positions] and finds every collider it overlaps.
+         *
+         * @return The overlapped colliders, where [QueryHit.query] is the index of the position in [positions].
+         */
+        fun overlapBatch(
+            shape: ColliderShape,
+            positions: List<Vector3d>,
+            filter: QueryFilter = QueryFilter(),
+        ): List<QueryHit> {
+            if (positions.isEmpty()) return emptyList()
+            return overlapShapes(shape, positions, filter)
+        }
     }
 }
 
@@ -92,4 +146,8 @@ internal expect fun isOverlapping(collider1: Collider, collider2: Collider): Boo
 internal expect fun isTriggering(collider1: Collider, collider2: Collider): Boolean
 internal expect fun isTouching(entity1: EntityRef, entity2: EntityRef): Boolean
 
-internal expect fun shapeCast(origin: Vector3d, direction: Vector3d, shape: ColliderShape, toi: Double, solid: Boolean): ShapeCastHit?
\ No newline at end of file
+internal expect fun shapeCast(origin: Vector3d, direction: Vector3d, shape: ColliderShape, toi: Double, solid: Boolean): ShapeCastHit?
+
+internal expect fun castRays(rays: List<Ray>, filter: QueryFilter, solid: Boolean, allHits: Boolean): List<QueryHit>
+internal expect fun castShapes(shape: ColliderShape, casts: List<Ray>, filter: QueryFilter, solid: Boolean): List<ShapeQueryHit>
+internal expect fun overlapShapes(shape: ColliderShape, positions: List<Vector3d>, filter: QueryFilter): List<QueryHit>
@@ -0,0 +1,32 @@
+package com.dropbear.physics
+
+import com.dropbear.EntityId
+
+/**
+ * Limits which colliders a batched scene query can hit.
+ *
+ * @param memberships The collision groups the query belongs to, as a bit mask.
+ * @param filter The collision groups the query can hit, as a bit mask. A collider is only hit if
+ *               it is in one of the [filter] groups, and its own filter includes one of the
+ *               [memberships] groups.
+ * @param excludeSensors Skips sensor colliders.
+ * @param excludeFixed Skips colliders attached to fixed rigid bodies.
+ * @param excludeDynamic Skips colliders attached to dynamic rigid bodies.
+ * @param excludeKinematic Skips colliders attached to kinematic rigid bodies.
+ * @param excludeEntity Skips the colliders of this entity, such as the one doing the query.
+ */
+class QueryFilter(
+    val memberships: Int = -1,
+    val filter: Int = -1,
+    val excludeSensors: Boolean = false,
+    val excludeFixed: Boolean = false,
+    val excludeDynamic: Boolean = false,
+    val excludeKinematic: Boolean = false,
+    val excludeEntity: EntityId? = null,
+) {
+    override fun toString(): String {
+        return "QueryFilter(memberships=$memberships, filter=$filter, excludeSensors=$excludeSensors, " +
+            "excludeFixed=$excludeFixed, excludeDynamic=$excludeDynamic, excludeKinematic=$excludeKinematic, " +
+            "excludeEntity=$excludeEntity)"
+    }
+}
@@ -0,0 +1,34 @@
+package com.dropbear.physics
+
+/**
+ * A hit from a batched ray-cast or overlap query.
+ *
+ * @param query The index of the ray or position in the batch that made this hit.
+ * @param collider The collider that is hit.
+ * @param distance The distance from the origin of the ray to the collider. Always `0.0` for
+ *                 overlaps.
+ */
+class QueryHit(
+    val query: Int,
+    val collider: Collider,
+    val distance: Double,
+) {
+    override fun toString(): String {
+        return "QueryHit(query=$query, collider=$collider, distance=$distance)"
+    }
+}
+
+/**
+ * A hit from a batched shape-cast.
+ *
+ * @param query The index of the cast in the batch that made this hit.
+ * @param hit The hit itself.
+ */
+class ShapeQueryHit(
+    val query: Int,
+    val hit: ShapeCastHit,
+) {
+    override fun toString(): String {
+        return "ShapeQueryHit(query=$query, hit=$hit)"
+    }
+}
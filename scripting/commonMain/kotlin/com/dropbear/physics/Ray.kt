@@ -0,0 +1,20 @@
+package com.dropbear.physics
+
+import com.dropbear.math.Vector3d
+
+/**
+ * A ray for a batched scene query, such as [Physics.raycastBatch].
+ *
+ * @param origin Where the ray starts.
+ * @param direction The direction of the ray. It does not need to be normalised.
+ * @param maxDistance How far along the ray to look for hits.
+ */
+class Ray(
+    val origin: Vector3d,
+    val direction: Vector3d,
+    val maxDistance: Double = Double.MAX_VALUE,
+) {
+    override fun toString(): String {
+        return "Ray(origin=$origin, direction=$direction, maxDistance=$maxDistance)"
+    }
+}
@@ -0,0 +1,17 @@
+package com.dropbear.audio;
+
+import com.dropbear.EucalyptusCoreLoader;
+
+public class AudioNative {
+    static {
+        new EucalyptusCoreLoader().ensureLoaded();
+    }
+
+    public static native long play(long audioHandle, String clip, double volume, double pitch, boolean looping);
+    public static native long playAtEntity(long audioHandle, long worldHandle, long entityId, String clip, double volume, double pitch, boolean looping, double minDistance, double maxDistance);
+    public static native void stop(long audioHandle, long sound);
+    public static native void setVolume(long audioHandle, long sound, double volume);
+    public static native void setPitch(long audioHandle, long sound, double pitch);
+    public static native boolean isPlaying(long audioHandle, long sound);
+    public static native void setMasterVolume(long audioHandle, double volume);
+}
@@ -14,6 +14,7 @@ public class KinematicCharacterControllerNative {
     public static native boolean existsForEntity(long worldHandle, long entityHandle);
 
     public static native void moveCharacter(long worldHandle, long physicsHandle, long entityHandle, Vector3d translation, double deltaTime);
+    public static native void moveCharacters(long worldHandle, long physicsHandle, List<CharacterMove> moves);
     public static native void setRotation(long worldHandle, long physicsHandle, long entityHandle, Quaterniond rotation);
     public static native List<CharacterCollision> getHit(long worldHandle, long entity);
     public static native CharacterMovementResult getMovementResult(long worldHandle, long entity);
@@ -3,6 +3,8 @@ package com.dropbear.physics;
 import com.dropbear.EucalyptusCoreLoader;
 import com.dropbear.math.Vector3d;
 
+import java.util.List;
+
 public class PhysicsNative {
     static {
         new EucalyptusCoreLoader().ensureLoaded();
@@ -16,4 +18,8 @@ public class PhysicsNative {
     public static native boolean isOverlapping(long physicsHandle, Collider collider1, Collider collider2);
     public static native boolean isTriggering(long physicsHandle, Collider collider1, Collider collider2);
     public static native boolean isTouching(long physicsHandle, long entity1, long entity2);
+
+    public static native List<QueryHit> castRays(long physicsHandle, List<Ray> rays, QueryFilter filter, boolean solid, boolean allHits);
+    public static native List<ShapeQueryHit> castShapes(long physicsHandle, ColliderShape shape, List<Ray> casts, QueryFilter filter, boolean solid);
+    public static native List<QueryHit> overlapShapes(long physicsHandle, ColliderShape shape, List<Vector3d> positions, QueryFilter filter);
 }
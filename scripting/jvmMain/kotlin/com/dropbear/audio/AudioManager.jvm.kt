@@ -0,0 +1,41 @@
+package com.dropbear.audio
+
+import com.dropbear.DropbearEngine
+import com.dropbear.EntityRef
+
+internal actual fun AudioManager.playNative(
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+): Sound? {
+    val id = AudioNative.play(DropbearEngine.native.audioHandle, clip, volume, pitch, looping)
+    return if (id <= 0L) null else Sound(id)
+}
+
+internal actual fun AudioManager.playAtNative(
+    entity: EntityRef,
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+    minDistance: Double,
+    maxDistance: Double,
+): Sound? {
+    val id = AudioNative.playAtEntity(
+        DropbearEngine.native.audioHandle,
+        DropbearEngine.native.worldHandle,
+        entity.id.raw,
+        clip,
+        volume,
+        pitch,
+        looping,
+        minDistance,
+        maxDistance
+    )
+    return if (id <= 0L) null else Sound(id)
+}
+
+internal actual fun AudioManager.setMasterVolumeNative(volume: Double) {
+    AudioNative.setMasterVolume(DropbearEngine.native.audioHandle, volume)
+}
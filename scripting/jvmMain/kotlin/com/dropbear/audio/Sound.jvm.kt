@@ -0,0 +1,19 @@
+package com.dropbear.audio
+
+import com.dropbear.DropbearEngine
+
+internal actual fun Sound.isPlayingNative(): Boolean {
+    return AudioNative.isPlaying(DropbearEngine.native.audioHandle, id)
+}
+
+internal actual fun Sound.stopNative() {
+    AudioNative.stop(DropbearEngine.native.audioHandle, id)
+}
+
+internal actual fun Sound.setVolumeNative(volume: Double) {
+    AudioNative.setVolume(DropbearEngine.native.audioHandle, id, volume)
+}
+
+internal actual fun Sound.setPitchNative(pitch: Double) {
+    AudioNative.setPitch(DropbearEngine.native.audioHandle, id, pitch)
+}
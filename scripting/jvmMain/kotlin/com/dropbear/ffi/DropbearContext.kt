@@ -12,4 +12,5 @@ class DropbearContext(
     val sceneLoaderHandle: Long,
     val physicsEngineHandle: Long,
     val uiHandle: Long,
+    val audioHandle: Long,
 )
\ No newline at end of file
@@ -11,6 +11,7 @@ actual class NativeEngine {
     internal var sceneLoaderHandle: Long = 0L
     internal var physicsEngineHandle: Long = 0L
     internal var uiBufferHandle: Long = 0L
+    internal var audioHandle: Long = 0L
 
     @JvmName("init")
     fun init(ctx: DropbearContext) {
@@ -22,6 +23,7 @@ actual class NativeEngine {
         this.sceneLoaderHandle = ctx.sceneLoaderHandle
         this.physicsEngineHandle = ctx.physicsEngineHandle
         this.uiBufferHandle = ctx.uiHandle
+        this.audioHandle = ctx.audioHandle
 
         if (this.worldHandle <= 0L) {
             Logger.error("NativeEngine: Error - Invalid world handle received!")
@@ -55,5 +57,9 @@ actual class NativeEngine {
             Logger.error("NativeEngine: Error - Invalid ui command buffer handle received!")
             return
         }
+        if (this.audioHandle <= 0L) {
+            Logger.error("NativeEngine: Error - Invalid audio handle received!")
+            return
+        }
     }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ import com.dropbear.logging.LogLevel
 import com.dropbear.logging.LogWriter
 import com.dropbear.logging.Logger
 import com.dropbear.logging.StdoutWriter
+import com.dropbear.physics.EventRecords
 
 @Suppress("UNUSED")
 class SystemManager(
@@ -291,6 +292,36 @@ class SystemManager(
         }
     }
 
+    /**
+     * Delivers a tick's collision events for [tag], packed as described by [EventRecords].
+     */
+    fun collisionEvents(tag: String, lanes: LongArray) {
+        var offset = 0
+        while (offset + EventRecords.COLLISION_LANES <= lanes.size) {
+            collisionEvent(
+                tag,
+                EventRecords.currentEntity(lanes, offset),
+                EventRecords.collisionEvent(lanes, offset),
+            )
+            offset += EventRecords.COLLISION_LANES
+        }
+    }
+
+    /**
+     * Delivers a tick's contact force events for [tag], packed as described by [EventRecords].
+     */
+    fun collisionForceEvents(tag: String, lanes: LongArray) {
+        var offset = 0
+        while (offset + EventRecords.CONTACT_FORCE_LANES <= lanes.size) {
+            collisionForceEvent(
+                tag,
+                EventRecords.currentEntity(lanes, offset),
+                EventRecords.contactForceEvent(lanes, offset),
+            )
+            offset += EventRecords.CONTACT_FORCE_LANES
+        }
+    }
+
     private fun updateSystemsInternal(tag: String, systems: List<System>, deltaTime: Double) {
         for (system in systems) {
             try {
@@ -18,6 +18,14 @@ internal actual fun KinematicCharacterController.moveCharacter(dt: Double, trans
     )
 }
 
+internal actual fun moveCharacters(moves: List<CharacterMove>) {
+    return KinematicCharacterControllerNative.moveCharacters(
+        DropbearEngine.native.worldHandle,
+        DropbearEngine.native.physicsEngineHandle,
+        moves
+    )
+}
+
 internal actual fun KinematicCharacterController.setRotationNative(rotation: com.dropbear.math.Quaterniond) {
     return KinematicCharacterControllerNative.setRotation(
         DropbearEngine.native.worldHandle,
@@ -41,4 +41,30 @@ internal actual fun shapeCast(
     solid: Boolean
 ): ShapeCastHit? {
     return PhysicsNative.shapeCast(DropbearEngine.native.physicsEngineHandle, origin, direction, shape, toi, solid)
-}
\ No newline at end of file
+}
+
+internal actual fun castRays(
+    rays: List<Ray>,
+    filter: QueryFilter,
+    solid: Boolean,
+    allHits: Boolean
+): List<QueryHit> {
+    return PhysicsNative.castRays(DropbearEngine.native.physicsEngineHandle, rays, filter, solid, allHits) ?: emptyList()
+}
+
+internal actual fun castShapes(
+    shape: ColliderShape,
+    casts: List<Ray>,
+    filter: QueryFilter,
+    solid: Boolean
+): List<ShapeQueryHit> {
+    return PhysicsNative.castShapes(DropbearEngine.native.physicsEngineHandle, shape, casts, filter, solid) ?: emptyList()
+}
+
+internal actual fun overlapShapes(
+    shape: ColliderShape,
+    positions: List<Vector3d>,
+    filter: QueryFilter
+): List<QueryHit> {
+    return PhysicsNative.overlapShapes(DropbearEngine.native.physicsEngineHandle, shape, positions, filter) ?: emptyList()
+}
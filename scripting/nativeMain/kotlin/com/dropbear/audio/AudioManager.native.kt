@@ -0,0 +1,53 @@
+@file:OptIn(ExperimentalForeignApi::class)
+
+package com.dropbear.audio
+
+import com.dropbear.DropbearEngine
+import com.dropbear.EntityRef
+import com.dropbear.ffi.generated.*
+import kotlin.String
+import kotlinx.cinterop.*
+
+internal actual fun AudioManager.playNative(
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+): Sound? = memScoped {
+    val audio = DropbearEngine.native.audioHandle ?: return@memScoped null
+    val out = alloc<ULongVar>()
+    val rc = dropbear_audio_play_sound(audio, clip, volume, pitch, looping, out.ptr)
+    if (rc != 0) null else Sound(out.value.toLong())
+}
+
+internal actual fun AudioManager.playAtNative(
+    entity: EntityRef,
+    clip: String,
+    volume: Double,
+    pitch: Double,
+    looping: Boolean,
+    minDistance: Double,
+    maxDistance: Double,
+): Sound? = memScoped {
+    val audio = DropbearEngine.native.audioHandle ?: return@memScoped null
+    val world = DropbearEngine.native.worldHandle ?: return@memScoped null
+    val out = alloc<ULongVar>()
+    val rc = dropbear_audio_play_sound_at_entity(
+        audio,
+        world,
+        entity.id.raw.toULong(),
+        clip,
+        volume,
+        pitch,
+        looping,
+        minDistance,
+        maxDistance,
+        out.ptr
+    )
+    if (rc != 0) null else Sound(out.value.toLong())
+}
+
+internal actual fun AudioManager.setMasterVolumeNative(volume: Double) {
+    val audio = DropbearEngine.native.audioHandle ?: return
+    dropbear_audio_set_master_volume(audio, volume)
+}
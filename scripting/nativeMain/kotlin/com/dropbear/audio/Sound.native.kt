@@ -0,0 +1,29 @@
+@file:OptIn(ExperimentalForeignApi::class)
+
+package com.dropbear.audio
+
+import com.dropbear.DropbearEngine
+import com.dropbear.ffi.generated.*
+import kotlinx.cinterop.*
+
+internal actual fun Sound.isPlayingNative(): Boolean = memScoped {
+    val audio = DropbearEngine.native.audioHandle ?: return@memScoped false
+    val out = alloc<BooleanVar>()
+    val rc = dropbear_audio_is_sound_playing(audio, id.toULong(), out.ptr)
+    rc == 0 && out.value
+}
+
+internal actual fun Sound.stopNative() {
+    val audio = DropbearEngine.native.audioHandle ?: return
+    dropbear_audio_stop_sound(audio, id.toULong())
+}
+
+internal actual fun Sound.setVolumeNative(volume: Double) {
+    val audio = DropbearEngine.native.audioHandle ?: return
+    dropbear_audio_set_sound_volume(audio, id.toULong(), volume)
+}
+
+internal actual fun Sound.setPitchNative(pitch: Double) {
+    val audio = DropbearEngine.native.audioHandle ?: return
+    dropbear_audio_set_sound_pitch(audio, id.toULong(), pitch)
+}
@@ -21,6 +21,7 @@ actual class NativeEngine {
     internal var sceneLoaderHandle: COpaquePointer? = null
     internal var physicsEngineHandle: COpaquePointer? = null
     internal var uiBufferHandle: COpaquePointer? = null
+    internal var audioHandle: COpaquePointer? = null
 
     @Suppress("unused")
     fun init(
@@ -34,6 +35,7 @@ actual class NativeEngine {
         this.sceneLoaderHandle = ctx?.sceneLoader?.rawValue?.let { interpretCPointer(it) }
         this.physicsEngineHandle = ctx?.physicsEngine?.rawValue?.let { interpretCPointer(it) }
         this.uiBufferHandle = ctx?.uiBuffer?.rawValue?.let { interpretCPointer(it) }
+        this.audioHandle = ctx?.audio?.rawValue?.let { interpretCPointer(it) }
 
         Logger.init(com.dropbear.logging.SocketWriter())
 
@@ -78,5 +80,11 @@ actual class NativeEngine {
                 throw DropbearNativeException("init failed - Invalid ui command buffer engine handle received!")
             }
         }
+        if (this.audioHandle == null) {
+            Logger.error("NativeEngine: Error - Invalid audio handle received!")
+            if (exceptionOnError) {
+                throw DropbearNativeException("init failed - Invalid audio handle received!")
+            }
+        }
     }
 }
\ No newline at end of file
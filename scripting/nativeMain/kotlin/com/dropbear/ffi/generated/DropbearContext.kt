@@ -16,5 +16,6 @@ data class DropbearContext(
     val assets: NativeHandle?,
     val sceneLoader: NativeHandle?,
     val physicsEngine: NativeHandle?,
-    val uiBuffer: NativeHandle?
+    val uiBuffer: NativeHandle?,
+    val audio: NativeHandle?
 )
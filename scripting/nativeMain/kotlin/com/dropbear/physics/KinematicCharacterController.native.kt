@@ -5,6 +5,8 @@ package com.dropbear.physics
 import com.dropbear.DropbearEngine
 import com.dropbear.EntityId
 import com.dropbear.ffi.generated.CharacterCollisionArray
+import com.dropbear.ffi.generated.CharacterMove as FfiCharacterMove
+import com.dropbear.ffi.generated.CharacterMoveArray
 import com.dropbear.ffi.generated.CharacterMovementResult as FfiCharacterMovementResult
 import com.dropbear.ffi.generated.NQuaternion
 import com.dropbear.ffi.generated.NVector3
@@ -13,6 +15,7 @@ import com.dropbear.ffi.generated.dropbear_kcc_get_hit
 import com.dropbear.ffi.generated.dropbear_kcc_get_movement_result
 import com.dropbear.ffi.generated.dropbear_kcc_kcc_exists_for_entity
 import com.dropbear.ffi.generated.dropbear_kcc_move_character
+import com.dropbear.ffi.generated.dropbear_kcc_move_characters
 import com.dropbear.ffi.generated.dropbear_kcc_set_rotation
 import com.dropbear.math.Quaterniond
 import com.dropbear.math.Vector3d
@@ -25,6 +28,24 @@ internal actual fun KinematicCharacterController.moveCharacter(dt: Double, trans
     dropbear_kcc_move_character(world, physics, entity.raw.toULong(), nv.ptr, dt)
 }
 
+internal actual fun moveCharacters(moves: List<CharacterMove>) = memScoped {
+    val world = DropbearEngine.native.worldHandle ?: return@memScoped
+    val physics = DropbearEngine.native.physicsEngineHandle ?: return@memScoped
+    val values = allocArray<FfiCharacterMove>(moves.size)
+    moves.forEachIndexed { i, move ->
+        values[i].entity_id = move.entity.raw.toULong()
+        values[i].translation.x = move.translation.x
+        values[i].translation.y = move.translation.y
+        values[i].translation.z = move.translation.z
+        values[i].delta_time = move.dt
+    }
+    val nMoves = alloc<CharacterMoveArray>()
+    nMoves.values = values
+    nMoves.length = moves.size.toULong()
+    nMoves.capacity = moves.size.toULong()
+    dropbear_kcc_move_characters(world, physics, nMoves.ptr)
+}
+
 internal actual fun KinematicCharacterController.setRotationNative(rotation: Quaterniond) = memScoped {
     val world = DropbearEngine.native.worldHandle ?: return@memScoped
     val physics = DropbearEngine.native.physicsEngineHandle ?: return@memScoped
@@ -4,16 +4,25 @@ package com.dropbear.physics
 
 import com.dropbear.DropbearEngine
 import com.dropbear.EntityRef
+import com.dropbear.ffi.generated.NQueryFilter
+import com.dropbear.ffi.generated.NQueryHitArray
+import com.dropbear.ffi.generated.NRay
+import com.dropbear.ffi.generated.NRayArray
 import com.dropbear.ffi.generated.NShapeCastHit
+import com.dropbear.ffi.generated.NShapeQueryHitArray
 import com.dropbear.ffi.generated.NVector3
+import com.dropbear.ffi.generated.NVector3Array
 import com.dropbear.ffi.generated.RayHit as FfiRayHit
 import com.dropbear.ffi.generated.allocCollider
 import com.dropbear.ffi.generated.allocColliderShape
 import com.dropbear.ffi.generated.allocVec3
+import com.dropbear.ffi.generated.dropbear_physics_cast_rays
+import com.dropbear.ffi.generated.dropbear_physics_cast_shapes
 import com.dropbear.ffi.generated.dropbear_physics_get_gravity
 import com.dropbear.ffi.generated.dropbear_physics_is_overlapping
 import com.dropbear.ffi.generated.dropbear_physics_is_touching
 import com.dropbear.ffi.generated.dropbear_physics_is_triggering
+import com.dropbear.ffi.generated.dropbear_physics_overlap_shapes
 import com.dropbear.ffi.generated.dropbear_physics_raycast
 import com.dropbear.ffi.generated.dropbear_physics_set_gravity
 import com.dropbear.ffi.generated.dropbear_physics_shape_cast
@@ -87,4 +96,95 @@ internal actual fun shapeCast(origin: Vector3d, direction: Vector3d, shape: Coll
         Vector3d(out.normal2.x, out.normal2.y, out.normal2.z),
         readShapeCastStatus(out.status),
     )
-}
\ No newline at end of file
+}
+
+private fun MemScope.allocRays(rays: List<Ray>): NRayArray {
+    val values = allocArray<NRay>(rays.size)
+    rays.forEachIndexed { i, ray ->
+        values[i].origin.x = ray.origin.x
+        values[i].origin.y = ray.origin.y
+        values[i].origin.z = ray.origin.z
+        values[i].direction.x = ray.direction.x
+        values[i].direction.y = ray.direction.y
+        values[i].direction.z = ray.direction.z
+        values[i].max_distance = ray.maxDistance
+    }
+    val array = alloc<NRayArray>()
+    array.values = values
+    array.length = rays.size.toULong()
+    array.capacity = rays.size.toULong()
+    return array
+}
+
+private fun MemScope.allocQueryFilter(filter: QueryFilter): NQueryFilter {
+    val nf = alloc<NQueryFilter>()
+    nf.memberships = filter.memberships.toUInt()
+    nf.filter = filter.filter.toUInt()
+    nf.exclude_sensors = filter.excludeSensors
+    nf.exclude_fixed = filter.excludeFixed
+    nf.exclude_dynamic = filter.excludeDynamic
+    nf.exclude_kinematic = filter.excludeKinematic
+    nf.exclude_entity = filter.excludeEntity?.raw?.toULong() ?: 0uL
+    return nf
+}
+
+private fun readQueryHits(out: NQueryHitArray): List<QueryHit> {
+    val ptr = out.values ?: return emptyList()
+    val len = out.length.toInt()
+    return (0 until len).map { i -> QueryHit(ptr[i].query.toInt(), readCollider(ptr[i].collider), ptr[i].distance) }
+}
+
+internal actual fun castRays(rays: List<Ray>, filter: QueryFilter, solid: Boolean, allHits: Boolean): List<QueryHit> = memScoped {
+    val physics = DropbearEngine.native.physicsEngineHandle ?: return@memScoped emptyList()
+    val nRays = allocRays(rays)
+    val nFilter = allocQueryFilter(filter)
+    val out = alloc<NQueryHitArray>()
+    val rc = dropbear_physics_cast_rays(physics, nRays.ptr, nFilter.ptr, solid, allHits, out.ptr)
+    if (rc != 0) emptyList() else readQueryHits(out)
+}
+
+internal actual fun castShapes(shape: ColliderShape, casts: List<Ray>, filter: QueryFilter, solid: Boolean): List<ShapeQueryHit> = memScoped {
+    val physics = DropbearEngine.native.physicsEngineHandle ?: return@memScoped emptyList()
+    val nShape = allocColliderShape(shape)
+    val nCasts = allocRays(casts)
+    val nFilter = allocQueryFilter(filter)
+    val out = alloc<NShapeQueryHitArray>()
+    val rc = dropbear_physics_cast_shapes(physics, nShape.ptr, nCasts.ptr, nFilter.ptr, solid, out.ptr)
+    if (rc != 0) return@memScoped emptyList()
+    val ptr = out.values ?: return@memScoped emptyList()
+    val len = out.length.toInt()
+    (0 until len).map { i ->
+        val hit = ptr[i].hit
+        ShapeQueryHit(
+            ptr[i].query.toInt(),
+            ShapeCastHit(
+                readCollider(hit.collider),
+                hit.distance,
+                Vector3d(hit.witness1.x, hit.witness1.y, hit.witness1.z),
+                Vector3d(hit.witness2.x, hit.witness2.y, hit.witness2.z),
+                Vector3d(hit.normal1.x, hit.normal1.y, hit.normal1.z),
+                Vector3d(hit.normal2.x, hit.normal2.y, hit.normal2.z),
+                readShapeCastStatus(hit.status),
+            ),
+        )
+    }
+}
+
+internal actual fun overlapShapes(shape: ColliderShape, positions: List<Vector3d>, filter: QueryFilter): List<QueryHit> = memScoped {
+    val physics = DropbearEngine.native.physicsEngineHandle ?: return@memScoped emptyList()
+    val nShape = allocColliderShape(shape)
+    val values = allocArray<NVector3>(positions.size)
+    positions.forEachIndexed { i, position ->
+        values[i].x = position.x
+        values[i].y = position.y
+        values[i].z = position.z
+    }
+    val nPositions = alloc<NVector3Array>()
+    nPositions.values = values
+    nPositions.length = positions.size.toULong()
+    nPositions.capacity = positions.size.toULong()
+    val nFilter = allocQueryFilter(filter)
+    val out = alloc<NQueryHitArray>()
+    val rc = dropbear_physics_overlap_shapes(physics, nShape.ptr, nPositions.ptr, nFilter.ptr, out.ptr)
+    if (rc != 0) emptyList() else readQueryHits(out)
+}